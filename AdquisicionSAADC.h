@@ -0,0 +1,501 @@
+/*
+ * Nombre del fichero: AdquisicionSAADC.h
+ * Descripción: Definición de la clase AdquisicionSAADC para muestrear gas y referencia por bloques.
+ * Autores: agent
+ * Fecha: 18 de octubre de 2026
+ *
+ * Este archivo ha sido realizado por agent.
+ * Contiene la clase AdquisicionSAADC. En la placa NRF52840 pone el SAADC en modo scan sobre
+ * los pines de gas y de referencia; un temporizador dispara cada conversión por PPI y el
+ * resultado va por EasyDMA a dos buffers que se alternan, sin que la CPU intervenga en cada
+ * muestra. Cada bloque terminado genera una interrupción, que lo deja para obtenerBloque()
+ * y mete sus muestras en una ColaSPSC para sacarMuestras(); con filtrar(), además, pasa cada
+ * canal por FiltroBloques (FIR, diezmado y mediana) para obtenerFiltrado(). En el ordenador (simulacion/)
+ * los bloques se generan con analogRead() sobre el reloj virtual.
+ *
+ * Todos los derechos reservados.
+ */
+
+#ifndef ADQUISICION_SAADC_H_INCLUIDO
+#define ADQUISICION_SAADC_H_INCLUIDO
+
+#include <Arduino.h>
+#include "ColaSPSC.h"
+#include "FiltroBloques.h"
+
+/// @brief Un par (gas, referencia) de la cola de muestras de AdquisicionSAADC.
+struct MuestraSAADC {
+  int16_t gas;
+  int16_t ref;
+}; // struct
+
+static_assert( sizeof(MuestraSAADC) == 2 * sizeof(int16_t), "un par ocupa lo mismo que en el buffer del SAADC" );
+
+/**
+ * @brief Adquisición continua del SAADC por bloques con doble buffer.
+ *
+ * Cada muestra es un par (gas, referencia), así que un bloque son
+ * 2 * MUESTRAS_POR_BLOQUE valores int16_t intercalados: gas, ref, gas, ref...
+ *
+ * Mientras está en marcha no se puede usar analogRead() (reconfigura el SAADC).
+ *
+ * @section ejemplos Ejemplo de uso
+ * @code
+ * AdquisicionSAADC adquisicion( PIN_VGAS, PIN_VREF, 1000 );
+ * adquisicion.iniciar();
+ * int16_t bloque[2 * AdquisicionSAADC::MUESTRAS_POR_BLOQUE];
+ * if ( adquisicion.obtenerBloque( bloque ) ) {
+ *   double ppm = elMedidor.medirGasBloque( bloque, AdquisicionSAADC::MUESTRAS_POR_BLOQUE );
+ * }
+ * @endcode
+ */
+class AdquisicionSAADC {
+
+public:
+
+  static const uint16_t MUESTRAS_POR_BLOQUE = 64; ///< Pares (gas, referencia) por bloque.
+  static const uint16_t VALORES_POR_BLOQUE = 2 * MUESTRAS_POR_BLOQUE;
+  static const uint32_t CAPACIDAD_MUESTRAS = 4 * MUESTRAS_POR_BLOQUE; ///< Pares que caben en la cola de muestras.
+
+  static_assert( MUESTRAS_POR_BLOQUE <= FiltroBloques::MAXIMO_MUESTRAS && MUESTRAS_POR_BLOQUE % FiltroBloques::DECIMACION == 0,
+				 "un bloque tiene que caber entero en FiltroBloques" );
+
+  /// @brief Callback que se llama (en la interrupción) con cada bloque terminado.
+  using CallbackBloque = void ( const int16_t * valores, uint16_t numMuestras );
+
+private:
+
+  const uint8_t pinVgas;
+  const uint8_t pinVref;
+  const uint32_t frecuenciaHz; ///< Muestras (pares) por segundo.
+
+  int16_t buffers[2][VALORES_POR_BLOQUE];
+  volatile uint8_t bufferEnCurso = 0;   ///< Buffer en el que está escribiendo el SAADC.
+  volatile uint8_t ultimoTerminado = 0; ///< Último buffer completo.
+  volatile bool hayBloqueSinLeer = false;
+  volatile uint32_t bloquesTerminados = 0;
+  volatile uint32_t bloquesPerdidos = 0; ///< Bloques terminados que nadie ha llegado a leer.
+  CallbackBloque * callbackBloque = nullptr;
+  bool enMarcha = false;
+  ColaSPSC< MuestraSAADC, CAPACIDAD_MUESTRAS > muestras; ///< La llena la interrupción, la vacía sacarMuestras().
+
+  // filtrado (con filtrar( true ))
+  bool filtrando = false;
+  bool filtrosEmpezados = false;        ///< Ya han recibido el primer bloque.
+  FiltroBloques filtroGas;
+  FiltroBloques filtroRef;
+  volatile bool hayFiltradoSinLeer = false;
+  int16_t gasFiltrado = 0;              ///< Última salida de filtroGas.
+  int16_t refFiltrado = 0;
+  uint32_t ciclosFiltro = 0;            ///< Lo que han tardado los dos filtros con el último bloque.
+
+  // .........................................................
+  // separa los dos canales del bloque y los filtra (en la interrupción)
+  // .........................................................
+  void filtrarBloque( const int16_t * valores ) {
+	int16_t gas[MUESTRAS_POR_BLOQUE];
+	int16_t ref[MUESTRAS_POR_BLOQUE];
+	int16_t salida[MUESTRAS_POR_BLOQUE / FiltroBloques::DECIMACION];
+	for ( uint16_t i = 0; i < MUESTRAS_POR_BLOQUE; i++ ) {
+	  gas[i] = valores[2*i];
+	  ref[i] = valores[2*i + 1];
+	}
+	if ( ! (*this).filtrosEmpezados ) {
+	  (*this).filtroGas.reiniciar( gas[0] ); // sin arrastrar ceros al empezar
+	  (*this).filtroRef.reiniciar( ref[0] );
+	  (*this).filtrosEmpezados = true;
+	}
+#ifdef ARDUINO_ARCH_NRF52
+	uint32_t ciclosInicio = DWT->CYCCNT;
+#endif
+	uint16_t m = (*this).filtroGas.procesar( gas, MUESTRAS_POR_BLOQUE, salida );
+	(*this).gasFiltrado = salida[m - 1];
+	m = (*this).filtroRef.procesar( ref, MUESTRAS_POR_BLOQUE, salida );
+	(*this).refFiltrado = salida[m - 1];
+#ifdef ARDUINO_ARCH_NRF52
+	(*this).ciclosFiltro = DWT->CYCCNT - ciclosInicio;
+#endif
+	(*this).hayFiltradoSinLeer = true;
+  } // ()
+
+  // .........................................................
+  // lo común a placa y simulación: se llama con cada bloque terminado
+  // .........................................................
+  void bloqueTerminado( uint8_t indice ) {
+	if ( (*this).hayBloqueSinLeer ) {
+	  (*this).bloquesPerdidos++;
+	}
+	(*this).ultimoTerminado = indice;
+	(*this).hayBloqueSinLeer = true;
+	(*this).bloquesTerminados++;
+
+	MuestraSAADC pares[MUESTRAS_POR_BLOQUE];
+	memcpy( pares, (*this).buffers[indice], sizeof(pares) );
+	(*this).muestras.meterBloque( pares, MUESTRAS_POR_BLOQUE ); // lo que no cabe se cuenta
+	if ( (*this).filtrando ) {
+	  filtrarBloque( (*this).buffers[indice] );
+	}
+	if ( (*this).callbackBloque != nullptr ) {
+	  (*this).callbackBloque( (*this).buffers[indice], MUESTRAS_POR_BLOQUE );
+	}
+  } // ()
+
+#ifdef ARDUINO_ARCH_NRF52
+
+  // ---------------------------------------------------------
+  // Recursos de la placa. TIMER0 es del SoftDevice y TIMER1 lo usa el core;
+  // los canales PPI 0..16 son de la aplicación.
+  // ---------------------------------------------------------
+  static NRF_TIMER_Type * temporizador() { return NRF_TIMER2; }
+  static const uint8_t CANAL_PPI_MUESTREO = 8;  ///< COMPARE[0] del temporizador -> SAMPLE
+  static const uint8_t CANAL_PPI_REINICIO = 9;  ///< END del SAADC -> START (cambio de buffer)
+
+  static AdquisicionSAADC * activa; ///< La instancia que atiende SAADC_IRQHandler.
+
+  // .........................................................
+  // pin de Arduino -> entrada analógica del SAADC (igual que analogRead() del core)
+  // .........................................................
+  static uint32_t entradaAnalogica( uint8_t pin ) {
+	switch ( g_ADigitalPinMap[pin] ) {
+	case 2:  return SAADC_CH_PSELP_PSELP_AnalogInput0;
+	case 3:  return SAADC_CH_PSELP_PSELP_AnalogInput1;
+	case 4:  return SAADC_CH_PSELP_PSELP_AnalogInput2;
+	case 5:  return SAADC_CH_PSELP_PSELP_AnalogInput3;
+	case 28: return SAADC_CH_PSELP_PSELP_AnalogInput4;
+	case 29: return SAADC_CH_PSELP_PSELP_AnalogInput5;
+	case 30: return SAADC_CH_PSELP_PSELP_AnalogInput6;
+	case 31: return SAADC_CH_PSELP_PSELP_AnalogInput7;
+	default: return SAADC_CH_PSELP_PSELP_NC;
+	}
+  } // ()
+
+  // .........................................................
+  // con el SoftDevice en marcha el PPI se toca a través de sus llamadas
+  // .........................................................
+  static void conectarPPI( uint8_t canal, volatile uint32_t * evento, volatile uint32_t * tarea ) {
+	uint8_t sdActivo = 0;
+	sd_softdevice_is_enabled( &sdActivo );
+	if ( sdActivo ) {
+	  sd_ppi_channel_assign( canal, evento, tarea );
+	  sd_ppi_channel_enable_set( 1UL << canal );
+	} else {
+	  NRF_PPI->CH[canal].EEP = (uint32_t) evento;
+	  NRF_PPI->CH[canal].TEP = (uint32_t) tarea;
+	  NRF_PPI->CHENSET = 1UL << canal;
+	}
+  } // ()
+
+  static void desconectarPPI( uint8_t canal ) {
+	uint8_t sdActivo = 0;
+	sd_softdevice_is_enabled( &sdActivo );
+	if ( sdActivo ) {
+	  sd_ppi_channel_enable_clr( 1UL << canal );
+	} else {
+	  NRF_PPI->CHENCLR = 1UL << canal;
+	}
+  } // ()
+
+#else
+
+  // ---------------------------------------------------------
+  // Simulación: las muestras se leen con analogRead() (Simulacion::fuenteADC)
+  // a medida que avanza el reloj virtual
+  // ---------------------------------------------------------
+  uint64_t proximaMuestraUs = 0;
+  uint16_t muestrasEnCurso = 0;
+
+#endif
+
+public:
+
+  // .........................................................
+  /**
+   * @brief Constructor.
+   *
+   * @param pinVgas_ Pin del gas.
+   * @param pinVref_ Pin de la referencia.
+   * @param frecuenciaHz_ Pares de muestras por segundo (de 1 Hz a 100 kHz).
+   */
+  AdquisicionSAADC( uint8_t pinVgas_, uint8_t pinVref_, uint32_t frecuenciaHz_ )
+	: pinVgas( pinVgas_ ), pinVref( pinVref_ ),
+	  frecuenciaHz( frecuenciaHz_ < 1 ? 1 : ( frecuenciaHz_ > 100000 ? 100000 : frecuenciaHz_ ) ) {
+  } // ()
+
+#ifdef ARDUINO_ARCH_NRF52
+  // .........................................................
+  /**
+   * @brief Atiende la interrupción del SAADC (la llama SAADC_IRQHandler).
+   *
+   * END se atiende antes que STARTED: cuando el bloque termina, el PPI ya ha lanzado
+   * START con el otro buffer, y sólo entonces se puede preparar el siguiente.
+   */
+  void atenderInterrupcion() {
+	if ( NRF_SAADC->EVENTS_END ) {
+	  NRF_SAADC->EVENTS_END = 0;
+	  uint8_t terminado = (*this).bufferEnCurso;
+	  (*this).bufferEnCurso = 1 - terminado;
+	  bloqueTerminado( terminado );
+	}
+	if ( NRF_SAADC->EVENTS_STARTED ) {
+	  NRF_SAADC->EVENTS_STARTED = 0;
+	  // el buffer en curso ya está cogido; el siguiente START usará el otro
+	  NRF_SAADC->RESULT.PTR = (uint32_t) (*this).buffers[ 1 - (*this).bufferEnCurso ];
+	}
+  } // ()
+
+  static void atenderInterrupcionActiva() {
+	if ( activa != nullptr ) {
+	  activa->atenderInterrupcion();
+	}
+  } // ()
+
+#else
+
+  // .........................................................
+  /**
+   * @brief Genera los bloques que tocan hasta el instante actual del reloj virtual.
+   */
+  void actualizar() {
+	if ( ! (*this).enMarcha ) {
+	  return;
+	}
+	const uint64_t periodoUs = 1000000 / (*this).frecuenciaHz;
+	while ( (*this).proximaMuestraUs <= Simulacion::relojUs ) {
+	  int16_t * b = (*this).buffers[ (*this).bufferEnCurso ];
+	  b[ 2 * (*this).muestrasEnCurso ] = (int16_t) analogRead( (*this).pinVgas );
+	  b[ 2 * (*this).muestrasEnCurso + 1 ] = (int16_t) analogRead( (*this).pinVref );
+	  (*this).proximaMuestraUs += periodoUs;
+	  if ( ++(*this).muestrasEnCurso == MUESTRAS_POR_BLOQUE ) {
+		(*this).muestrasEnCurso = 0;
+		uint8_t terminado = (*this).bufferEnCurso;
+		(*this).bufferEnCurso = 1 - terminado;
+		bloqueTerminado( terminado );
+	  }
+	} // while
+  } // ()
+
+#endif
+
+  // .........................................................
+  /**
+   * @brief Instala el callback de bloque terminado.
+   *
+   * OJO: en la placa se llama desde la interrupción; tiene que ser corto y no usar Serial.
+   */
+  void instalarCallbackBloque( CallbackBloque * cb ) {
+	(*this).callbackBloque = cb;
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Activa (o quita) el filtrado de cada bloque en la interrupción (antes de iniciar()).
+   *
+   * Los dos filtros cuestan unos miles de ciclos por bloque (ver getCiclosFiltro());
+   * sin filtrar no se gastan.
+   */
+  void filtrar( bool activar ) {
+	(*this).filtrando = activar;
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Configura el SAADC, el temporizador y el PPI y empieza a muestrear.
+   */
+  void iniciar() {
+	if ( (*this).enMarcha ) {
+	  return;
+	}
+	(*this).bufferEnCurso = 0;
+	(*this).hayBloqueSinLeer = false;
+	(*this).filtrosEmpezados = false;
+	(*this).hayFiltradoSinLeer = false;
+
+#ifdef ARDUINO_ARCH_NRF52
+	activa = this;
+
+	if ( (*this).filtrando ) {
+	  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk; // contador de ciclos para getCiclosFiltro()
+	  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+	}
+
+	// SAADC: 10 bits como analogRead(), referencia interna con ganancia 1/6, dos canales (scan)
+	NRF_SAADC->ENABLE = SAADC_ENABLE_ENABLE_Disabled;
+	NRF_SAADC->RESOLUTION = SAADC_RESOLUTION_VAL_10bit;
+	NRF_SAADC->OVERSAMPLE = SAADC_OVERSAMPLE_OVERSAMPLE_Bypass;
+	for ( int i = 0; i < 8; i++ ) {
+	  NRF_SAADC->CH[i].PSELP = SAADC_CH_PSELP_PSELP_NC;
+	  NRF_SAADC->CH[i].PSELN = SAADC_CH_PSELN_PSELN_NC;
+	}
+	const uint32_t config =
+	  ( SAADC_CH_CONFIG_RESP_Bypass << SAADC_CH_CONFIG_RESP_Pos )
+	  | ( SAADC_CH_CONFIG_RESN_Bypass << SAADC_CH_CONFIG_RESN_Pos )
+	  | ( SAADC_CH_CONFIG_GAIN_Gain1_6 << SAADC_CH_CONFIG_GAIN_Pos )
+	  | ( SAADC_CH_CONFIG_REFSEL_Internal << SAADC_CH_CONFIG_REFSEL_Pos )
+	  | ( SAADC_CH_CONFIG_TACQ_3us << SAADC_CH_CONFIG_TACQ_Pos )
+	  | ( SAADC_CH_CONFIG_MODE_SE << SAADC_CH_CONFIG_MODE_Pos )
+	  | ( SAADC_CH_CONFIG_BURST_Disabled << SAADC_CH_CONFIG_BURST_Pos );
+	NRF_SAADC->CH[0].CONFIG = config;
+	NRF_SAADC->CH[0].PSELP = entradaAnalogica( (*this).pinVgas );
+	NRF_SAADC->CH[1].CONFIG = config;
+	NRF_SAADC->CH[1].PSELP = entradaAnalogica( (*this).pinVref );
+
+	NRF_SAADC->RESULT.PTR = (uint32_t) (*this).buffers[0];
+	NRF_SAADC->RESULT.MAXCNT = VALORES_POR_BLOQUE;
+
+	NRF_SAADC->EVENTS_STARTED = 0;
+	NRF_SAADC->EVENTS_END = 0;
+	NRF_SAADC->INTENCLR = 0xFFFFFFFF;
+	NRF_SAADC->INTENSET = SAADC_INTENSET_STARTED_Msk | SAADC_INTENSET_END_Msk;
+	NVIC_SetPriority( SAADC_IRQn, 3 ); // prioridad permitida con el SoftDevice
+	NVIC_ClearPendingIRQ( SAADC_IRQn );
+	NVIC_EnableIRQ( SAADC_IRQn );
+	NRF_SAADC->ENABLE = SAADC_ENABLE_ENABLE_Enabled;
+
+	// temporizador a 1 MHz que marca cada muestra
+	temporizador()->TASKS_STOP = 1;
+	temporizador()->MODE = TIMER_MODE_MODE_Timer;
+	temporizador()->BITMODE = TIMER_BITMODE_BITMODE_32Bit;
+	temporizador()->PRESCALER = 4;
+	temporizador()->CC[0] = 1000000 / (*this).frecuenciaHz;
+	temporizador()->SHORTS = TIMER_SHORTS_COMPARE0_CLEAR_Msk;
+	temporizador()->TASKS_CLEAR = 1;
+
+	conectarPPI( CANAL_PPI_MUESTREO, &temporizador()->EVENTS_COMPARE[0], &NRF_SAADC->TASKS_SAMPLE );
+	conectarPPI( CANAL_PPI_REINICIO, &NRF_SAADC->EVENTS_END, &NRF_SAADC->TASKS_START );
+
+	NRF_SAADC->TASKS_START = 1;
+	temporizador()->TASKS_START = 1;
+#else
+	(*this).muestrasEnCurso = 0;
+	(*this).proximaMuestraUs = Simulacion::relojUs;
+#endif
+
+	(*this).enMarcha = true;
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Para el muestreo y deja el SAADC libre para analogRead().
+   */
+  void detener() {
+	if ( ! (*this).enMarcha ) {
+	  return;
+	}
+#ifdef ARDUINO_ARCH_NRF52
+	temporizador()->TASKS_STOP = 1;
+	desconectarPPI( CANAL_PPI_MUESTREO );
+	desconectarPPI( CANAL_PPI_REINICIO );
+	NVIC_DisableIRQ( SAADC_IRQn );
+	NRF_SAADC->INTENCLR = 0xFFFFFFFF;
+	NRF_SAADC->TASKS_STOP = 1;
+	while ( NRF_SAADC->EVENTS_STOPPED == 0 ) { }
+	NRF_SAADC->EVENTS_STOPPED = 0;
+	NRF_SAADC->ENABLE = SAADC_ENABLE_ENABLE_Disabled;
+	activa = nullptr;
+#endif
+	(*this).enMarcha = false;
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Copia el último bloque terminado, si hay uno que no se haya leído aún.
+   *
+   * El bucle tiene que llamarlo al menos una vez por bloque; si no, los bloques
+   * intermedios se cuentan en getBloquesPerdidos().
+   *
+   * @param destino Sitio para VALORES_POR_BLOQUE valores.
+   * @return true si se ha copiado un bloque nuevo.
+   */
+  bool obtenerBloque( int16_t * destino ) {
+#ifdef ARDUINO_ARCH_NRF52
+	NVIC_DisableIRQ( SAADC_IRQn );
+#else
+	actualizar();
+#endif
+	bool hay = (*this).hayBloqueSinLeer;
+	if ( hay ) {
+	  memcpy( destino, (*this).buffers[ (*this).ultimoTerminado ], sizeof( (*this).buffers[0] ) );
+	  (*this).hayBloqueSinLeer = false;
+	}
+#ifdef ARDUINO_ARCH_NRF52
+	NVIC_EnableIRQ( SAADC_IRQn );
+#endif
+	return hay;
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Saca, en orden y sin saltarse ninguna, las muestras que han llegado.
+   *
+   * No para la interrupción: la cola es de un productor (ella) y un consumidor (el
+   * que llama a esto). Si se llama menos de una vez cada CAPACIDAD_MUESTRAS muestras,
+   * las que no caben se cuentan en getMuestrasPerdidas() (también si sólo se usa
+   * obtenerBloque()).
+   *
+   * @param destino Sitio para maximo pares.
+   * @param maximo Cuántos como mucho.
+   * @return Cuántos pares ha sacado.
+   */
+  uint32_t sacarMuestras( MuestraSAADC * destino, uint32_t maximo ) {
+#ifndef ARDUINO_ARCH_NRF52
+	actualizar();
+#endif
+	return (*this).muestras.sacarBloque( destino, maximo );
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Última salida de los filtros (con filtrar( true )), si hay una que no se haya leído.
+   *
+   * Es la muestra más reciente ya filtrada (paso bajo, diezmado y mediana) de cada
+   * canal; como los filtros siguen de un bloque a otro, no importa cuántos bloques
+   * hayan pasado desde la llamada anterior.
+   *
+   * @param gas Donde deja el gas filtrado (cuentas del ADC).
+   * @param ref Donde deja la referencia filtrada.
+   * @return true si ha salido algo nuevo desde la llamada anterior.
+   */
+  bool obtenerFiltrado( int16_t & gas, int16_t & ref ) {
+#ifdef ARDUINO_ARCH_NRF52
+	NVIC_DisableIRQ( SAADC_IRQn );
+#else
+	actualizar();
+#endif
+	bool hay = (*this).hayFiltradoSinLeer;
+	if ( hay ) {
+	  gas = (*this).gasFiltrado;
+	  ref = (*this).refFiltrado;
+	  (*this).hayFiltradoSinLeer = false;
+	}
+#ifdef ARDUINO_ARCH_NRF52
+	NVIC_EnableIRQ( SAADC_IRQn );
+#endif
+	return hay;
+  } // ()
+
+  /**
+   * @return Ciclos de CPU de los dos filtros con el último bloque (contador DWT; 0 en el ordenador).
+   */
+  uint32_t getCiclosFiltro() const { return (*this).ciclosFiltro; }
+
+  uint32_t getMuestrasPerdidas() const { return (*this).muestras.getDesbordamientos(); }
+  uint32_t getBloquesTerminados() const { return (*this).bloquesTerminados; }
+  uint32_t getBloquesPerdidos() const { return (*this).bloquesPerdidos; }
+  uint32_t getFrecuencia() const { return (*this).frecuenciaHz; }
+
+}; // class
+
+#ifdef ARDUINO_ARCH_NRF52
+AdquisicionSAADC * AdquisicionSAADC::activa = nullptr;
+
+extern "C" void SAADC_IRQHandler( void ) {
+  AdquisicionSAADC::atenderInterrupcionActiva();
+} // ()
+#endif
+
+#endif
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
@@ -0,0 +1,147 @@
+/*
+ * Nombre del fichero: AlarmaOzono.h
+ * Descripción: Umbral de alarma de ozono con histéresis y latencia de la alarma.
+ * Autores: agent
+ * Fecha: 18 de octubre de 2026
+ *
+ * Este archivo ha sido realizado por agent.
+ * Contiene la clase AlarmaOzono, que decide cuándo empieza y cuándo acaba una alarma: se
+ * activa cuando una lectura llega al umbral de alarma y no se desactiva hasta que baja del
+ * umbral de fin, que es más bajo, para que el ruido alrededor del umbral no la encienda y
+ * la apague en cada lectura. Lleva también la cuenta de la latencia: desde la lectura que
+ * la activa hasta que empieza el anuncio de alarma. No depende de Arduino.
+ *
+ * Todos los derechos reservados.
+ */
+
+#ifndef ALARMA_OZONO_H_INCLUIDO
+#define ALARMA_OZONO_H_INCLUIDO
+
+#include <stdint.h>
+
+// ----------------------------------------------------------
+/**
+ * @brief Alarma de ozono con histéresis.
+ *
+ * @section ejemplos Ejemplo de uso
+ * @code
+ * AlarmaOzono alarma( 5.0, 4.0 );
+ * unsigned long us = micros();
+ * if ( alarma.evaluar( medidor.vigilarGas(), us ) == AlarmaOzono::ACTIVADA ) {
+ *   publicador.empezarPublicarAlarma( ... );
+ *   alarma.apuntarAnuncio( publicador.laEmisora.getTiempoUltimoAnuncio() );
+ * }
+ * @endcode
+ */
+class AlarmaOzono {
+public:
+
+  /// Lo que ha pasado con la última lectura.
+  enum Cambio {
+	NINGUNO,    ///< Sigue como estaba.
+	ACTIVADA,   ///< Ha llegado al umbral de alarma.
+	DESACTIVADA ///< Ha bajado del umbral de fin.
+  };
+
+private:
+
+  double umbralAlarma; ///< ppm a partir de las que se activa.
+  double umbralFin;    ///< ppm por debajo de las que se desactiva.
+
+  bool activa = false;
+  double pico = 0;                    ///< Lectura más alta de la alarma en curso (o de la última).
+  uint32_t usLecturaActivacion = 0;   ///< micros() de la lectura que la ha activado.
+  bool esperandoAnuncio = false;      ///< Activada y aún sin anuncio de alarma.
+
+  uint32_t activaciones = 0;
+  uint32_t latenciaUltimaUs = 0;
+  uint32_t latenciaMaximaUs = 0;
+
+public:
+
+  // .........................................................
+  /**
+   * @brief Constructor.
+   *
+   * @param umbralAlarma_ ppm a partir de las que se activa.
+   * @param umbralFin_ ppm por debajo de las que se desactiva (si no es menor que
+   *                   umbralAlarma_, no hay histéresis: se usa umbralAlarma_).
+   */
+  AlarmaOzono( double umbralAlarma_, double umbralFin_ )
+	: umbralAlarma( umbralAlarma_ ), umbralFin( umbralFin_ < umbralAlarma_ ? umbralFin_ : umbralAlarma_ ) {
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Mira una lectura.
+   *
+   * @param ppm La lectura.
+   * @param usLectura micros() al leerla (para la latencia).
+   * @return Si con ella la alarma se ha activado, desactivado o sigue igual.
+   */
+  Cambio evaluar( double ppm, uint32_t usLectura ) {
+	if ( ! (*this).activa ) {
+	  if ( ppm < (*this).umbralAlarma ) {
+		return NINGUNO;
+	  }
+	  (*this).activa = true;
+	  (*this).pico = ppm;
+	  (*this).usLecturaActivacion = usLectura;
+	  (*this).esperandoAnuncio = true;
+	  (*this).activaciones++;
+	  return ACTIVADA;
+	}
+	if ( ppm > (*this).pico ) {
+	  (*this).pico = ppm;
+	}
+	if ( ppm >= (*this).umbralFin ) {
+	  return NINGUNO;
+	}
+	(*this).activa = false;
+	(*this).esperandoAnuncio = false;
+	return DESACTIVADA;
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Apunta cuándo ha empezado el anuncio de alarma (sólo cuenta el primero de cada alarma).
+   *
+   * @param usAnuncio micros() al empezar el anuncio.
+   */
+  void apuntarAnuncio( uint32_t usAnuncio ) {
+	if ( ! (*this).esperandoAnuncio ) {
+	  return;
+	}
+	(*this).esperandoAnuncio = false;
+	(*this).latenciaUltimaUs = usAnuncio - (*this).usLecturaActivacion; // sin signo: aunque micros() dé la vuelta
+	if ( (*this).latenciaUltimaUs > (*this).latenciaMaximaUs ) {
+	  (*this).latenciaMaximaUs = (*this).latenciaUltimaUs;
+	}
+  } // ()
+
+  bool estaActiva() const { return (*this).activa; }
+
+  double getUmbralAlarma() const { return (*this).umbralAlarma; }
+  double getUmbralFin() const { return (*this).umbralFin; }
+
+  /**
+   * @return Lectura más alta de la alarma en curso (o de la última).
+   */
+  double getPico() const { return (*this).pico; }
+
+  uint32_t getActivaciones() const { return (*this).activaciones; }
+
+  /**
+   * @return us desde la lectura que activó la última alarma hasta su primer anuncio.
+   */
+  uint32_t getLatenciaUltimaUs() const { return (*this).latenciaUltimaUs; }
+  uint32_t getLatenciaMaximaUs() const { return (*this).latenciaMaximaUs; }
+
+}; // class
+
+#endif
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
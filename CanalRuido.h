@@ -0,0 +1,302 @@
+/*
+ * Nombre del fichero: CanalRuido.h
+ * Descripción: Definición de la clase CanalRuido para medir el ruido con el micrófono PDM.
+ * Autores: agent
+ * Fecha: 18 de octubre de 2026
+ *
+ * Este archivo ha sido realizado por agent.
+ * Contiene la clase CanalRuido. En la placa NRF52840 pone el periférico PDM a 16 kHz
+ * (reloj de 1.28 MHz, diezmado 80): las muestras van por EasyDMA a dos buffers que se
+ * alternan y cada bloque terminado genera una interrupción, que lo pasa por NivelRuido
+ * (ponderación A y energía) y acumula la energía. tomarNivel() da el nivel equivalente
+ * desde la llamada anterior, uno por periodo de publicación. El audio no sale nunca de la
+ * interrupción: loop() puede estar segundos esperando y no se pierde nada. En el ordenador
+ * (simulacion/) los bloques salen de Simulacion::fuentePDM a medida que avanza el reloj.
+ *
+ * Todos los derechos reservados.
+ */
+
+#ifndef CANAL_RUIDO_H_INCLUIDO
+#define CANAL_RUIDO_H_INCLUIDO
+
+#include <Arduino.h>
+#include "NivelRuido.h"
+
+/**
+ * @brief Nivel de ruido continuo con el micrófono PDM.
+ *
+ * Los primeros BLOQUES_DESCARTADOS bloques después de iniciar() no cuentan: son el
+ * arranque del micrófono y del filtro.
+ *
+ * @section ejemplos Ejemplo de uso
+ * @code
+ * CanalRuido elCanalRuido( PIN_PDM_DATOS, PIN_PDM_RELOJ );
+ * elCanalRuido.iniciar();
+ * double db;
+ * if ( elCanalRuido.tomarNivel( db ) ) {
+ *   elPublicador.empezarPublicarRuido( db, cont );
+ * }
+ * @endcode
+ */
+class CanalRuido {
+
+public:
+
+  static const uint16_t MUESTRAS_POR_BLOQUE = NivelRuido::MAXIMO_MUESTRAS; ///< 16 ms a 16 kHz.
+  static const uint8_t BLOQUES_DESCARTADOS = 4;
+
+private:
+
+  const uint8_t pinDatos;
+  const uint8_t pinReloj;
+
+  NivelRuido nivel;
+
+  int16_t buffers[2][MUESTRAS_POR_BLOQUE];
+  volatile uint8_t bufferEnCurso = 0; ///< Buffer en el que está escribiendo el PDM.
+  volatile uint32_t bloquesTerminados = 0;
+  bool enMarcha = false;
+
+  // lo acumulado desde el último tomarNivel() (lo escribe la interrupción)
+  double energia = 0;
+  uint32_t muestras = 0;
+
+  uint32_t ciclosUltimoBloque = 0; ///< Lo que ha tardado NivelRuido con el último bloque.
+  uint32_t ciclosMaximo = 0;
+
+  // .........................................................
+  // lo común a placa y simulación: se llama con cada bloque terminado
+  // .........................................................
+  void bloqueTerminado( uint8_t indice ) {
+	if ( ++(*this).bloquesTerminados <= BLOQUES_DESCARTADOS ) {
+	  (*this).nivel.procesarBloque( (*this).buffers[indice], MUESTRAS_POR_BLOQUE ); // el filtro sí arranca
+	  return;
+	}
+#ifdef ARDUINO_ARCH_NRF52
+	uint32_t ciclosInicio = DWT->CYCCNT;
+#endif
+	int64_t e = (*this).nivel.procesarBloque( (*this).buffers[indice], MUESTRAS_POR_BLOQUE );
+#ifdef ARDUINO_ARCH_NRF52
+	(*this).ciclosUltimoBloque = DWT->CYCCNT - ciclosInicio;
+	if ( (*this).ciclosUltimoBloque > (*this).ciclosMaximo ) {
+	  (*this).ciclosMaximo = (*this).ciclosUltimoBloque;
+	}
+#endif
+	(*this).energia += (double) e;
+	(*this).muestras += MUESTRAS_POR_BLOQUE;
+  } // ()
+
+#ifdef ARDUINO_ARCH_NRF52
+
+  static CanalRuido * activo; ///< La instancia que atiende PDM_IRQHandler.
+
+#else
+
+  // ---------------------------------------------------------
+  // Simulación: cada bloque se pide a Simulacion::fuentePDM cuando el reloj ya ha
+  // pasado de su final
+  // ---------------------------------------------------------
+  uint64_t inicioBloqueUs = 0;
+
+#endif
+
+public:
+
+  // .........................................................
+  /**
+   * @brief Constructor.
+   *
+   * @param pinDatos_ Pin de datos del micrófono (DIN).
+   * @param pinReloj_ Pin del reloj del micrófono (CLK).
+   * @param calibracionDb dB SPL de un seno a fondo de escala (ver NivelRuido).
+   */
+  CanalRuido( uint8_t pinDatos_, uint8_t pinReloj_, double calibracionDb = 120.0 )
+	: pinDatos( pinDatos_ ), pinReloj( pinReloj_ ), nivel( calibracionDb ) {
+  } // ()
+
+#ifdef ARDUINO_ARCH_NRF52
+  // .........................................................
+  /**
+   * @brief Atiende la interrupción del PDM (la llama PDM_IRQHandler).
+   *
+   * Igual que en AdquisicionSAADC, END antes que STARTED; aquí no hace falta PPI
+   * porque el PDM sigue solo con el buffer que se le dejó en SAMPLE.PTR.
+   */
+  void atenderInterrupcion() {
+	if ( NRF_PDM->EVENTS_END ) {
+	  NRF_PDM->EVENTS_END = 0;
+	  uint8_t terminado = (*this).bufferEnCurso;
+	  (*this).bufferEnCurso = 1 - terminado;
+	  bloqueTerminado( terminado );
+	}
+	if ( NRF_PDM->EVENTS_STARTED ) {
+	  NRF_PDM->EVENTS_STARTED = 0;
+	  NRF_PDM->SAMPLE.PTR = (uint32_t) (*this).buffers[ 1 - (*this).bufferEnCurso ];
+	}
+  } // ()
+
+  static void atenderInterrupcionActiva() {
+	if ( activo != nullptr ) {
+	  activo->atenderInterrupcion();
+	}
+  } // ()
+
+#else
+
+  // .........................................................
+  /**
+   * @brief Genera los bloques que tocan hasta el instante actual.
+   */
+  void actualizar() {
+	if ( ! (*this).enMarcha ) {
+	  return;
+	}
+	const uint64_t usPorBloque = 1000000ULL * MUESTRAS_POR_BLOQUE / NivelRuido::FRECUENCIA_HZ;
+	while ( (*this).inicioBloqueUs + usPorBloque <= Simulacion::ahoraUs() ) {
+	  int16_t * b = (*this).buffers[ (*this).bufferEnCurso ];
+	  if ( Simulacion::fuentePDM != nullptr ) {
+		Simulacion::fuentePDM( b, MUESTRAS_POR_BLOQUE, (*this).inicioBloqueUs );
+	  } else {
+		memset( b, 0, sizeof( (*this).buffers[0] ) );
+	  }
+	  (*this).inicioBloqueUs += usPorBloque;
+	  uint8_t terminado = (*this).bufferEnCurso;
+	  (*this).bufferEnCurso = 1 - terminado;
+	  bloqueTerminado( terminado );
+	} // while
+  } // ()
+
+#endif
+
+  // .........................................................
+  /**
+   * @brief Configura el PDM y empieza a capturar.
+   */
+  void iniciar() {
+	if ( (*this).enMarcha ) {
+	  return;
+	}
+	(*this).nivel.reiniciar();
+	(*this).bufferEnCurso = 0;
+	(*this).bloquesTerminados = 0;
+	(*this).energia = 0;
+	(*this).muestras = 0;
+	(*this).ciclosMaximo = 0;
+
+#ifdef ARDUINO_ARCH_NRF52
+	activo = this;
+
+	// contador de ciclos para getCiclosUltimoBloque()
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	pinMode( (*this).pinReloj, OUTPUT );
+	digitalWrite( (*this).pinReloj, LOW );
+	pinMode( (*this).pinDatos, INPUT );
+
+	// mono, 1.28 MHz / 80 = 16 kHz, ganancia 0 dB
+	NRF_PDM->ENABLE = PDM_ENABLE_ENABLE_Disabled;
+	NRF_PDM->PSEL.CLK = g_ADigitalPinMap[ (*this).pinReloj ];
+	NRF_PDM->PSEL.DIN = g_ADigitalPinMap[ (*this).pinDatos ];
+	NRF_PDM->PDMCLKCTRL = PDM_PDMCLKCTRL_FREQ_1280K;
+	NRF_PDM->RATIO = PDM_RATIO_RATIO_Ratio80 << PDM_RATIO_RATIO_Pos;
+	NRF_PDM->MODE = ( PDM_MODE_OPERATION_Mono << PDM_MODE_OPERATION_Pos )
+	  | ( PDM_MODE_EDGE_LeftFalling << PDM_MODE_EDGE_Pos );
+	NRF_PDM->GAINL = PDM_GAINL_GAINL_DefaultGain;
+	NRF_PDM->GAINR = PDM_GAINR_GAINR_DefaultGain;
+
+	NRF_PDM->SAMPLE.PTR = (uint32_t) (*this).buffers[0];
+	NRF_PDM->SAMPLE.MAXCNT = MUESTRAS_POR_BLOQUE;
+
+	NRF_PDM->EVENTS_STARTED = 0;
+	NRF_PDM->EVENTS_END = 0;
+	NRF_PDM->INTENCLR = 0xFFFFFFFF;
+	NRF_PDM->INTENSET = PDM_INTENSET_STARTED_Msk | PDM_INTENSET_END_Msk;
+	NVIC_SetPriority( PDM_IRQn, 3 ); // prioridad permitida con el SoftDevice
+	NVIC_ClearPendingIRQ( PDM_IRQn );
+	NVIC_EnableIRQ( PDM_IRQn );
+	NRF_PDM->ENABLE = PDM_ENABLE_ENABLE_Enabled;
+	NRF_PDM->TASKS_START = 1;
+#else
+	(*this).inicioBloqueUs = Simulacion::ahoraUs();
+#endif
+
+	(*this).enMarcha = true;
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Para la captura (el micrófono deja de tener reloj).
+   */
+  void detener() {
+	if ( ! (*this).enMarcha ) {
+	  return;
+	}
+#ifdef ARDUINO_ARCH_NRF52
+	NVIC_DisableIRQ( PDM_IRQn );
+	NRF_PDM->INTENCLR = 0xFFFFFFFF;
+	NRF_PDM->TASKS_STOP = 1;
+	while ( NRF_PDM->EVENTS_STOPPED == 0 ) { }
+	NRF_PDM->EVENTS_STOPPED = 0;
+	NRF_PDM->ENABLE = PDM_ENABLE_ENABLE_Disabled;
+	activo = nullptr;
+#endif
+	(*this).enMarcha = false;
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Nivel equivalente (energía media) desde la llamada anterior.
+   *
+   * @param db Donde deja los dB(A) SPL (-INFINITY si ha sido silencio digital).
+   * @return false si desde la llamada anterior no ha terminado ningún bloque.
+   */
+  bool tomarNivel( double & db ) {
+#ifdef ARDUINO_ARCH_NRF52
+	NVIC_DisableIRQ( PDM_IRQn );
+#else
+	actualizar();
+#endif
+	double e = (*this).energia;
+	uint32_t n = (*this).muestras;
+	(*this).energia = 0;
+	(*this).muestras = 0;
+#ifdef ARDUINO_ARCH_NRF52
+	NVIC_EnableIRQ( PDM_IRQn );
+#endif
+	if ( n == 0 ) {
+	  return false;
+	}
+	db = (*this).nivel.decibelios( e, n );
+	return true;
+  } // ()
+
+  /**
+   * @return Ciclos de CPU que ha gastado NivelRuido en el último bloque (0 en el ordenador).
+   *         Un bloque dura 16 ms: 1 024 000 ciclos a 64 MHz.
+   */
+  uint32_t getCiclosUltimoBloque() const { return (*this).ciclosUltimoBloque; }
+
+  /**
+   * @return El máximo de getCiclosUltimoBloque() desde iniciar().
+   */
+  uint32_t getCiclosMaximo() const { return (*this).ciclosMaximo; }
+
+  uint32_t getBloquesTerminados() const { return (*this).bloquesTerminados; }
+
+}; // class
+
+#ifdef ARDUINO_ARCH_NRF52
+CanalRuido * CanalRuido::activo = nullptr;
+
+extern "C" void PDM_IRQHandler( void ) {
+  CanalRuido::atenderInterrupcionActiva();
+} // ()
+#endif
+
+#endif
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
@@ -0,0 +1,199 @@
+/*
+ * Nombre del fichero: ColaSPSC.h
+ * Descripción: Cola sin bloqueos de un productor y un consumidor (interrupción y bucle, o dos hilos).
+ * Autores: agent
+ * Fecha: 18 de octubre de 2026
+ *
+ * Este archivo ha sido realizado por agent.
+ * Contiene la plantilla ColaSPSC, un buffer circular de capacidad fija (potencia de dos).
+ * En la placa la llena la interrupción del SAADC y la vacía el bucle; en la pasarela la
+ * llena el hilo lector de MotorIngestion y la vacía cada trabajador. Meter y sacar no
+ * esperan nunca y tardan siempre lo mismo. No depende de Arduino.
+ *
+ * Todos los derechos reservados.
+ */
+
+#ifndef COLA_SPSC_H_INCLUIDO
+#define COLA_SPSC_H_INCLUIDO
+
+#include <atomic>
+#include <stdint.h>
+
+/// Bytes de una línea de caché. El nRF52840 (Cortex-M4) no tiene caché de datos:
+/// separar índices sólo gastaría RAM.
+#ifdef ARDUINO_ARCH_NRF52
+#define LINEA_CACHE_SPSC 4
+#else
+#define LINEA_CACHE_SPSC 64
+#endif
+
+// ----------------------------------------------------------
+/**
+ * @brief Cola circular de un productor y un consumidor, sin bloqueos.
+ *
+ * El productor sólo escribe la cola y el consumidor sólo la cabeza; cada uno publica
+ * su índice con release y lee el del otro con acquire, así que los elementos se ven
+ * enteros en x86 y en Cortex-M (que con un solo núcleo sólo necesita que el compilador
+ * no los reordene). Cada lado guarda además la última copia que ha visto del índice
+ * del otro y sólo vuelve a leerlo cuando con esa copia parece llena (o vacía): en el
+ * caso normal no se toca la línea de caché del otro lado.
+ *
+ * Si la cola está llena, meter() no espera: devuelve false y lo cuenta como
+ * desbordamiento (desde una interrupción no se puede esperar).
+ *
+ * @tparam T Tipo de los elementos (se copian).
+ * @tparam CAPACIDAD Número de huecos, potencia de dos.
+ */
+template< typename T, uint32_t CAPACIDAD >
+class ColaSPSC {
+
+  static_assert( CAPACIDAD > 0 && ( CAPACIDAD & (CAPACIDAD - 1) ) == 0, "CAPACIDAD tiene que ser potencia de dos" );
+  static_assert( CAPACIDAD <= 0x80000000u, "los índices son de 32 bits" );
+
+private:
+
+  static const uint32_t MASCARA = CAPACIDAD - 1;
+
+  // lado del productor
+  alignas(LINEA_CACHE_SPSC) std::atomic<uint32_t> cola { 0 }; ///< Siguiente hueco a escribir.
+  uint32_t cabezaVista = 0;                     ///< Última cabeza leída por el productor.
+  std::atomic<uint32_t> desbordamientos { 0 };  ///< Elementos que no cabían.
+
+  // lado del consumidor
+  alignas(LINEA_CACHE_SPSC) std::atomic<uint32_t> cabeza { 0 }; ///< Siguiente hueco a leer.
+  uint32_t colaVista = 0;                       ///< Última cola leída por el consumidor.
+
+  alignas(LINEA_CACHE_SPSC) T elementos[CAPACIDAD];
+
+  // .........................................................
+  // huecos libres vistos por el productor (sólo vuelve a leer la cabeza si hace falta)
+  // .........................................................
+  uint32_t libres( uint32_t c, uint32_t n ) {
+	uint32_t l = CAPACIDAD - ( c - (*this).cabezaVista );
+	if ( l < n ) {
+	  (*this).cabezaVista = (*this).cabeza.load( std::memory_order_acquire );
+	  l = CAPACIDAD - ( c - (*this).cabezaVista );
+	}
+	return l;
+  } // ()
+
+  // .........................................................
+  // elementos disponibles vistos por el consumidor
+  // .........................................................
+  uint32_t disponibles( uint32_t h, uint32_t n ) {
+	uint32_t d = (*this).colaVista - h;
+	if ( d < n ) {
+	  (*this).colaVista = (*this).cola.load( std::memory_order_acquire );
+	  d = (*this).colaVista - h;
+	}
+	return d;
+  } // ()
+
+public:
+
+  /**
+   * @return Los huecos de la cola.
+   */
+  static constexpr uint32_t capacidad() { return CAPACIDAD; }
+
+  // .........................................................
+  /**
+   * @brief Mete un elemento (sólo el productor).
+   * @return false si la cola está llena (se cuenta como desbordamiento).
+   */
+  bool meter( const T & elemento ) {
+	uint32_t c = (*this).cola.load( std::memory_order_relaxed );
+	if ( libres( c, 1 ) == 0 ) {
+	  (*this).desbordamientos.fetch_add( 1, std::memory_order_relaxed );
+	  return false;
+	}
+	(*this).elementos[ c & MASCARA ] = elemento;
+	(*this).cola.store( c + 1, std::memory_order_release );
+	return true;
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Mete todos los elementos que quepan de un bloque (sólo el productor).
+   *
+   * Los que no caben se cuentan como desbordamientos. Publica una sola vez.
+   *
+   * @param origen Elementos.
+   * @param n Cuántos.
+   * @return Cuántos ha metido (los primeros).
+   */
+  uint32_t meterBloque( const T * origen, uint32_t n ) {
+	uint32_t c = (*this).cola.load( std::memory_order_relaxed );
+	uint32_t l = libres( c, n );
+	uint32_t k = n < l ? n : l;
+	for ( uint32_t i = 0; i < k; i++ ) {
+	  (*this).elementos[ ( c + i ) & MASCARA ] = origen[i];
+	}
+	(*this).cola.store( c + k, std::memory_order_release );
+	if ( k < n ) {
+	  (*this).desbordamientos.fetch_add( n - k, std::memory_order_relaxed );
+	}
+	return k;
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Saca un elemento (sólo el consumidor).
+   * @return false si la cola está vacía.
+   */
+  bool sacar( T & elemento ) {
+	uint32_t h = (*this).cabeza.load( std::memory_order_relaxed );
+	if ( disponibles( h, 1 ) == 0 ) {
+	  return false;
+	}
+	elemento = (*this).elementos[ h & MASCARA ];
+	(*this).cabeza.store( h + 1, std::memory_order_release );
+	return true;
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Saca de una vez todo lo que haya, hasta maximo elementos (sólo el consumidor).
+   *
+   * Para procesar por bloques: una sola lectura de la cola y una sola publicación
+   * de la cabeza para todo el bloque.
+   *
+   * @param destino Sitio para maximo elementos.
+   * @param maximo Cuántos como mucho.
+   * @return Cuántos ha sacado.
+   */
+  uint32_t sacarBloque( T * destino, uint32_t maximo ) {
+	uint32_t h = (*this).cabeza.load( std::memory_order_relaxed );
+	uint32_t d = disponibles( h, maximo );
+	uint32_t k = maximo < d ? maximo : d;
+	for ( uint32_t i = 0; i < k; i++ ) {
+	  destino[i] = (*this).elementos[ ( h + i ) & MASCARA ];
+	}
+	(*this).cabeza.store( h + k, std::memory_order_release );
+	return k;
+  } // ()
+
+  /**
+   * @return Elementos esperando (aproximado si el otro lado está trabajando).
+   */
+  uint32_t pendientes() const {
+	uint32_t h = (*this).cabeza.load( std::memory_order_acquire ); // primero la cabeza: la cola nunca queda detrás
+	uint32_t n = (*this).cola.load( std::memory_order_acquire ) - h;
+	return n < CAPACIDAD ? n : CAPACIDAD;
+  } // ()
+
+  /**
+   * @return Elementos que no cabían desde que se creó la cola.
+   */
+  uint32_t getDesbordamientos() const {
+	return (*this).desbordamientos.load( std::memory_order_relaxed );
+  } // ()
+
+}; // class
+
+#endif
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
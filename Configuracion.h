@@ -0,0 +1,349 @@
+/*
+ * Nombre del fichero: Configuracion.h
+ * Descripción: Configuración del nodo que se puede cambiar por BLE sin volver a grabar el firmware.
+ * Autores: agent
+ * Fecha: 18 de octubre de 2026
+ *
+ * Este archivo ha sido realizado por agent.
+ * Contiene la estructura Configuracion (periodo de publicación, duración e intervalo del
+ * anuncio, banda muerta, recta de calibración y ventana de estadísticas), su formato binario por campos, la clase
+ * ConfiguracionCompartida, que pasa la configuración del callback BLE al bucle sin bloqueos,
+ * y AlmacenConfiguracion, que la guarda en la flash interna para que sobreviva a un reinicio.
+ *
+ * Todos los derechos reservados.
+ */
+
+#ifndef CONFIGURACION_H_INCLUIDO
+#define CONFIGURACION_H_INCLUIDO
+
+#include <atomic>
+
+#include <InternalFileSystem.h>
+
+/**
+ * @brief Configuración del nodo.
+ *
+ * Por BLE y en la flash va por campos: un byte con el identificador y después el valor en
+ * little endian. Los números con decimales van en millonésimas (int32) para que los valores
+ * por defecto (0.3 y -1.5) salgan exactamente iguales que los de antes.
+ *
+ * Ejemplo: cambiar sólo el periodo a 10 s -> 01 10 27 00 00
+ */
+struct Configuracion {
+
+  // identificadores de los campos
+  enum Campo {
+	PERIODO_PUBLICACION = 1, ///< uint32, ms entre publicaciones.
+	DURACION_ANUNCIO = 2,    ///< uint16, ms que dura cada anuncio.
+	INTERVALO_ANUNCIO = 3,   ///< uint16, en unidades de 0.625 ms.
+	BANDA_MUERTA = 4,        ///< int32, millonésimas de ppm.
+	PENDIENTE = 5,           ///< int32, millonésimas (m de la calibración).
+	ORDENADA = 6,            ///< int32, millonésimas de ppm (b de la calibración).
+	DURACION_VENTANA = 7     ///< uint32, ms de cada ventana de estadísticas (0 = sin ventanas).
+  };
+
+  static const uint8_t LONGITUD_SERIALIZADA = 5 + 3 + 3 + 5 + 5 + 5 + 5;
+
+  uint32_t periodoPublicacionMs = 3000;
+  uint16_t duracionAnuncioMs = 1000;
+  uint16_t intervaloAnuncio = 100;
+  int32_t bandaMuerta = 0;
+  int32_t pendiente = 300000;
+  int32_t ordenada = -1500000;
+  uint32_t duracionVentanaMs = 0; ///< 0: se publica cada medida; si no, el resumen de cada ventana.
+
+  // .........................................................
+  /**
+   * @return true si los valores tienen sentido.
+   */
+  bool valida() const {
+	return periodoPublicacionMs >= 500 && periodoPublicacionMs <= 3600000
+	  && duracionAnuncioMs >= 100 && duracionAnuncioMs <= periodoPublicacionMs
+	  && intervaloAnuncio >= 32 && intervaloAnuncio <= 16384 // 20 ms .. 10.24 s (BLE)
+	  && bandaMuerta >= 0 && bandaMuerta <= 100000000
+	  && pendiente > 0 && pendiente <= 1000000000
+	  && ordenada >= -1000000000 && ordenada <= 1000000000
+	  && ( duracionVentanaMs == 0
+		   || ( duracionVentanaMs >= periodoPublicacionMs && duracionVentanaMs <= 65535000 ) ); // s en la trama
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Cambia los campos que vengan en datos (no comprueba si son válidos).
+   *
+   * @return false si hay un campo desconocido o cortado.
+   */
+  bool aplicarCampos( const uint8_t * datos, uint16_t longitud ) {
+	uint16_t i = 0;
+	while ( i < longitud ) {
+	  uint8_t campo = datos[i++];
+	  uint8_t tam = ( campo == DURACION_ANUNCIO || campo == INTERVALO_ANUNCIO ) ? 2 : 4;
+	  if ( campo < PERIODO_PUBLICACION || campo > DURACION_VENTANA || i + tam > longitud ) {
+		return false;
+	  }
+	  uint32_t v = 0;
+	  for ( uint8_t k = 0; k < tam; k++ ) {
+		v |= (uint32_t) datos[i + k] << ( 8 * k );
+	  }
+	  i += tam;
+
+	  switch ( campo ) {
+	  case PERIODO_PUBLICACION: periodoPublicacionMs = v; break;
+	  case DURACION_ANUNCIO: duracionAnuncioMs = (uint16_t) v; break;
+	  case INTERVALO_ANUNCIO: intervaloAnuncio = (uint16_t) v; break;
+	  case BANDA_MUERTA: bandaMuerta = (int32_t) v; break;
+	  case PENDIENTE: pendiente = (int32_t) v; break;
+	  case ORDENADA: ordenada = (int32_t) v; break;
+	  case DURACION_VENTANA: duracionVentanaMs = v; break;
+	  }
+	} // while
+	return true;
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Escribe todos los campos.
+   *
+   * @param destino Al menos LONGITUD_SERIALIZADA bytes.
+   * @return Bytes escritos.
+   */
+  uint8_t serializar( uint8_t * destino ) const {
+	uint8_t i = 0;
+	auto poner = [&]( uint8_t campo, uint32_t v, uint8_t tam ) {
+	  destino[i++] = campo;
+	  for ( uint8_t k = 0; k < tam; k++ ) {
+		destino[i++] = (uint8_t) ( v >> ( 8 * k ) );
+	  }
+	};
+	poner( PERIODO_PUBLICACION, periodoPublicacionMs, 4 );
+	poner( DURACION_ANUNCIO, duracionAnuncioMs, 2 );
+	poner( INTERVALO_ANUNCIO, intervaloAnuncio, 2 );
+	poner( BANDA_MUERTA, (uint32_t) bandaMuerta, 4 );
+	poner( PENDIENTE, (uint32_t) pendiente, 4 );
+	poner( ORDENADA, (uint32_t) ordenada, 4 );
+	poner( DURACION_VENTANA, duracionVentanaMs, 4 );
+	return i;
+  } // ()
+
+  // .........................................................
+  /**
+   * @return FNV-1a de la configuración serializada (para ver si ha cambiado).
+   */
+  uint32_t huella() const {
+	uint8_t bytes[LONGITUD_SERIALIZADA];
+	return huellaDe( bytes, serializar( bytes ) );
+  } // ()
+
+  /**
+   * @return FNV-1a de n bytes.
+   */
+  static uint32_t huellaDe( const uint8_t * bytes, uint16_t n ) {
+	uint32_t h = 2166136261u;
+	for ( uint16_t k = 0; k < n; k++ ) {
+	  h = ( h ^ bytes[k] ) * 16777619u;
+	}
+	return h;
+  } // ()
+
+  double getBandaMuerta() const { return bandaMuerta / 1e6; }
+  double getPendiente() const { return pendiente / 1e6; }
+  double getOrdenada() const { return ordenada / 1e6; }
+
+}; // struct
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+
+/**
+ * @brief Paso de la configuración del callback BLE al bucle sin bloqueos.
+ *
+ * Hay dos copias. El escritor (el callback de la característica, o setup() antes de
+ * encender la emisora) rellena la que no está activa y después la activa. El lector
+ * (loop(), una vez por vuelta) copia la activa. Cada copia lleva un número de secuencia
+ * que es impar mientras se escribe: si al acabar de copiar no es el mismo que al
+ * empezar, es que el escritor ha dado dos vueltas entretanto y se vuelve a copiar.
+ * El escritor nunca espera y el lector nunca ve una configuración a medias.
+ *
+ * Sólo puede haber un escritor a la vez. publicar() sólo se llama antes de que haya más
+ * (setup()); proponer() lo pueden llamar dos a la vez (el callback BLE y la consola
+ * del puerto serie): si coinciden, el segundo no espera, se le rechaza.
+ */
+class ConfiguracionCompartida {
+private:
+
+  Configuracion copias[2];
+  std::atomic<uint32_t> secuencias[2];
+  std::atomic<uint8_t> activa { 0 };
+  std::atomic<uint32_t> version { 0 };
+  std::atomic<uint32_t> rechazadas { 0 };
+  std::atomic<bool> ocupada { false }; ///< Alguien está en proponer().
+
+  Configuracion ultima; ///< Última publicada (sólo la usa el escritor).
+
+public:
+
+  ConfiguracionCompartida() {
+	secuencias[0].store( 0 );
+	secuencias[1].store( 0 );
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Publica una configuración completa (sólo el escritor).
+   */
+  void publicar( const Configuracion & c ) {
+	uint8_t i = 1 - (*this).activa.load( std::memory_order_relaxed );
+	uint32_t s = (*this).secuencias[i].load( std::memory_order_relaxed );
+
+	(*this).secuencias[i].store( s + 1, std::memory_order_relaxed ); // impar: escribiendo
+	std::atomic_thread_fence( std::memory_order_release );
+	(*this).copias[i] = c;
+	(*this).secuencias[i].store( s + 2, std::memory_order_release );
+
+	(*this).activa.store( i, std::memory_order_release );
+	(*this).version.fetch_add( 1, std::memory_order_release );
+	(*this).ultima = c;
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Aplica unos campos a la última configuración y, si es válida, la publica.
+   *
+   * Es lo que llama el callback de escritura de la característica (y la consola). No bloquea.
+   *
+   * @return false si se ha rechazado (y no cambia nada): no es válida o estaba proponiendo otro.
+   */
+  bool proponer( const uint8_t * datos, uint16_t longitud ) {
+	if ( (*this).ocupada.exchange( true, std::memory_order_acquire ) ) {
+	  return false;
+	}
+	Configuracion c = (*this).ultima;
+	bool vale = c.aplicarCampos( datos, longitud ) && c.valida();
+	if ( vale ) {
+	  publicar( c );
+	} else {
+	  (*this).rechazadas.fetch_add( 1, std::memory_order_relaxed );
+	}
+	(*this).ocupada.store( false, std::memory_order_release );
+	return vale;
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Copia la configuración activa (desde el bucle).
+   *
+   * @param laVersion Si no es nullptr, aquí la versión leída (cambia con cada publicación).
+   */
+  Configuracion leer( uint32_t * laVersion = nullptr ) const {
+	for ( ;; ) {
+	  uint32_t v = (*this).version.load( std::memory_order_acquire );
+	  uint8_t i = (*this).activa.load( std::memory_order_acquire );
+	  uint32_t s1 = (*this).secuencias[i].load( std::memory_order_acquire );
+	  if ( s1 & 1 ) {
+		continue;
+	  }
+	  Configuracion c = (*this).copias[i];
+	  std::atomic_thread_fence( std::memory_order_acquire );
+	  if ( (*this).secuencias[i].load( std::memory_order_relaxed ) == s1 ) {
+		if ( laVersion != nullptr ) {
+		  *laVersion = v;
+		}
+		return c;
+	  }
+	} // for
+  } // ()
+
+  /**
+   * @return Número de escrituras rechazadas por no ser válidas.
+   */
+  uint32_t getRechazadas() const {
+	return (*this).rechazadas.load( std::memory_order_relaxed );
+  } // ()
+
+}; // class
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+
+/**
+ * @brief Guarda y carga la configuración en la flash interna (LittleFS).
+ *
+ * Escribir en la flash tarda, así que se llama desde el bucle, nunca desde el callback BLE.
+ * El fichero es "CFG1", los campos serializados y su huella (FNV-1a) al final. Los campos
+ * que no estén en el fichero (guardado por un firmware anterior) se quedan por defecto.
+ */
+namespace AlmacenConfiguracion {
+
+  const char NOMBRE_FICHERO[] = "/configuracion.bin";
+  const uint8_t MAGICO[4] = { 'C', 'F', 'G', '1' };
+
+  // .........................................................
+  /**
+   * @brief Carga la configuración guardada.
+   *
+   * @param c Se deja sin tocar si no hay nada guardado o no es válido.
+   * @return true si se ha cargado.
+   */
+  inline bool cargar( Configuracion & c ) {
+	using namespace Adafruit_LittleFS_Namespace;
+
+	uint8_t bytes[4 + Configuracion::LONGITUD_SERIALIZADA + 4];
+	File fichero( InternalFS );
+	if ( ! fichero.open( NOMBRE_FICHERO, FILE_O_READ ) ) {
+	  return false;
+	}
+	uint32_t n = fichero.read( bytes, sizeof(bytes) );
+	fichero.close();
+
+	if ( n < 4 + 4 || memcmp( bytes, MAGICO, 4 ) != 0 ) {
+	  return false;
+	}
+	uint16_t campos = n - 4 - 4;
+	uint32_t huella = 0;
+	for ( uint8_t k = 0; k < 4; k++ ) {
+	  huella |= (uint32_t) bytes[4 + campos + k] << ( 8 * k );
+	}
+	if ( huella != Configuracion::huellaDe( &bytes[4], campos ) ) {
+	  return false;
+	}
+	Configuracion leida;
+	if ( ! leida.aplicarCampos( &bytes[4], campos ) || ! leida.valida() ) {
+	  return false;
+	}
+	c = leida;
+	return true;
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Guarda la configuración (sustituye a la anterior).
+   */
+  inline bool guardar( const Configuracion & c ) {
+	using namespace Adafruit_LittleFS_Namespace;
+
+	uint8_t bytes[4 + Configuracion::LONGITUD_SERIALIZADA + 4];
+	memcpy( bytes, MAGICO, 4 );
+	uint8_t n = 4 + c.serializar( &bytes[4] );
+	uint32_t huella = c.huella();
+	for ( uint8_t k = 0; k < 4; k++ ) {
+	  bytes[n++] = (uint8_t) ( huella >> ( 8 * k ) );
+	}
+
+	InternalFS.remove( NOMBRE_FICHERO ); // FILE_O_WRITE añade al final
+	File fichero( InternalFS );
+	if ( ! fichero.open( NOMBRE_FICHERO, FILE_O_WRITE ) ) {
+	  return false;
+	}
+	bool correcto = fichero.write( bytes, n ) == n;
+	fichero.close();
+	return correcto;
+  } // ()
+
+}; // namespace
+
+#endif
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
@@ -0,0 +1,310 @@
+/*
+ * Nombre del fichero: ConsolaSerie.h
+ * Descripción: Órdenes por el puerto serie para diagnosticar el nodo sin pararlo.
+ * Autores: agent
+ * Fecha: 18 de octubre de 2026
+ *
+ * Este archivo ha sido realizado por agent.
+ * Contiene la clase ConsolaSerie, que junta los bytes que llegan por el puerto serie en
+ * líneas y, al acabar cada una, la parte en palabras y llama a la orden con ese nombre,
+ * y EstadisticaTiempo, que acumula tiempos (número, media, mínimo y máximo) para la
+ * orden que los enseña. Las órdenes las pone quien la usa (HolaMundoIBeacon.ino).
+ * No depende de Arduino: los bytes los saca una función que se le pasa.
+ *
+ * Todos los derechos reservados.
+ */
+
+#ifndef CONSOLA_SERIE_H_INCLUIDO
+#define CONSOLA_SERIE_H_INCLUIDO
+
+#include <stdint.h>
+#include <string.h>
+
+#include <atomic>
+
+// ----------------------------------------------------------
+/**
+ * @brief Número, suma, mínimo y máximo de unos tiempos.
+ *
+ * Los apunta una tarea y los lee (o los borra) otra: cada campo es atómico, así que
+ * una lectura a la vez que se apunta puede mezclar dos tiempos, pero nunca da basura.
+ */
+class EstadisticaTiempo {
+private:
+
+  std::atomic<uint32_t> numero { 0 };
+  std::atomic<uint32_t> suma { 0 };
+  std::atomic<uint32_t> minimo { 0xffffffff };
+  std::atomic<uint32_t> maximo { 0 };
+
+public:
+
+  // .........................................................
+  /**
+   * @brief Apunta un tiempo.
+   *
+   * @param t El tiempo (en las unidades que se quiera; la suma da la vuelta a los 2^32).
+   */
+  void anyadir( uint32_t t ) {
+	(*this).numero.fetch_add( 1, std::memory_order_relaxed );
+	(*this).suma.fetch_add( t, std::memory_order_relaxed );
+	if ( t < (*this).minimo.load( std::memory_order_relaxed ) ) {
+	  (*this).minimo.store( t, std::memory_order_relaxed );
+	}
+	if ( t > (*this).maximo.load( std::memory_order_relaxed ) ) {
+	  (*this).maximo.store( t, std::memory_order_relaxed );
+	}
+  } // ()
+
+  void reiniciar() {
+	(*this).numero.store( 0, std::memory_order_relaxed );
+	(*this).suma.store( 0, std::memory_order_relaxed );
+	(*this).minimo.store( 0xffffffff, std::memory_order_relaxed );
+	(*this).maximo.store( 0, std::memory_order_relaxed );
+  } // ()
+
+  uint32_t getNumero() const { return (*this).numero.load( std::memory_order_relaxed ); }
+  uint32_t getMinimo() const { return getNumero() > 0 ? (*this).minimo.load( std::memory_order_relaxed ) : 0; }
+  uint32_t getMaximo() const { return (*this).maximo.load( std::memory_order_relaxed ); }
+
+  /**
+   * @return La media (0 si no hay ninguno).
+   */
+  double getMedia() const {
+	uint32_t n = getNumero();
+	return n > 0 ? (double) (*this).suma.load( std::memory_order_relaxed ) / n : 0.0;
+  } // ()
+
+}; // class
+
+// ----------------------------------------------------------
+/**
+ * @brief Intérprete de órdenes de una línea que nunca espera.
+ *
+ * atender() saca como mucho MAXIMO_BYTES_POR_VUELTA bytes de lo que ya haya llegado y
+ * ejecuta como mucho una orden, así que lo que añade a una vuelta del bucle está acotado:
+ * unos pocos bytes, y al acabar una línea, partirla (LONGITUD_MAXIMA_LINEA) y buscar el
+ * nombre entre MAXIMO_ORDENES. Lo que tarde la orden ya es cosa de la orden. Lo que no
+ * quepa en la línea se descarta hasta el siguiente fin de línea ('\n' o '\r').
+ *
+ * Las órdenes reciben las palabras que van detrás del nombre (separadas por espacios).
+ *
+ * @section ejemplos Ejemplo de uso
+ * @code
+ * ConsolaSerie consola( escribirTexto );
+ * consola.anyadirOrden( "periodo", "<ms> cambia el periodo", ordenPeriodo );
+ * // en cada vuelta, o mientras se espera:
+ * consola.atender( leerByte );
+ * @endcode
+ */
+class ConsolaSerie {
+public:
+
+  static const uint8_t LONGITUD_MAXIMA_LINEA = 40;
+  static const uint8_t MAXIMO_ARGUMENTOS = 3;       ///< Palabras detrás del nombre.
+  static const uint8_t MAXIMO_ORDENES = 12;
+  static const uint8_t MAXIMO_BYTES_POR_VUELTA = 16; ///< Lo más que saca atender() cada vez.
+
+  /// @brief Saca el siguiente byte recibido sin esperar; -1 si no hay.
+  using LeerByte = int ();
+
+  /// @brief Escribe las contestaciones de la propia consola (ayuda y errores).
+  using Escribir = void ( const char * texto );
+
+  /// @brief Una orden: las palabras que van detrás de su nombre.
+  using Orden = void ( uint8_t numArgumentos, char * const * argumentos );
+
+private:
+
+  struct EntradaOrden {
+	const char * nombre;
+	const char * ayuda;
+	Orden * orden;
+  }; // struct
+
+  EntradaOrden ordenes[MAXIMO_ORDENES];
+  uint8_t numOrdenes = 0;
+
+  char linea[LONGITUD_MAXIMA_LINEA + 1];
+  uint8_t longitud = 0;
+  bool desbordada = false; ///< La línea en curso no cabe: se descarta hasta el fin de línea.
+
+  Escribir * escribir;
+
+  uint32_t lineas = 0;      ///< Órdenes ejecutadas.
+  uint32_t desconocidas = 0;
+  uint32_t largas = 0;
+
+  // .........................................................
+  // parte la línea en palabras (en el sitio) y ejecuta la orden
+  // .........................................................
+  void ejecutar() {
+	char * palabras[1 + MAXIMO_ARGUMENTOS];
+	uint8_t n = 0;
+	char * p = (*this).linea;
+	while ( *p != '\0' ) {
+	  while ( *p == ' ' || *p == '\t' ) {
+		*p++ = '\0';
+	  }
+	  if ( *p == '\0' ) {
+		break;
+	  }
+	  if ( n == 1 + MAXIMO_ARGUMENTOS ) {
+		break; // las de más no se miran
+	  }
+	  palabras[n++] = p;
+	  while ( *p != '\0' && *p != ' ' && *p != '\t' ) {
+		p++;
+	  }
+	} // while
+	if ( n == 0 ) {
+	  return; // línea vacía
+	}
+
+	for ( uint8_t i = 0; i < (*this).numOrdenes; i++ ) {
+	  if ( strcmp( palabras[0], (*this).ordenes[i].nombre ) == 0 ) {
+		(*this).lineas++;
+		(*this).ordenes[i].orden( n - 1, &palabras[1] );
+		return;
+	  }
+	}
+	(*this).desconocidas++;
+	(*this).escribir( "consola: no conozco la orden " );
+	(*this).escribir( palabras[0] );
+	(*this).escribir( " (ayuda)\n" );
+  } // ()
+
+public:
+
+  // .........................................................
+  /**
+   * @brief Constructor.
+   *
+   * @param escribir_ Por donde salen la ayuda y los errores.
+   */
+  ConsolaSerie( Escribir * escribir_ ) : escribir( escribir_ ) {
+	(*this).linea[0] = '\0';
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Añade una orden (nombre y ayuda tienen que durar: literales).
+   *
+   * @param nombre Lo que se teclea.
+   * @param ayuda Lo que sale en la ayuda detrás del nombre.
+   * @param orden La función.
+   * @return false si ya hay MAXIMO_ORDENES.
+   */
+  bool anyadirOrden( const char * nombre, const char * ayuda, Orden * orden ) {
+	if ( (*this).numOrdenes >= MAXIMO_ORDENES ) {
+	  return false;
+	}
+	(*this).ordenes[ (*this).numOrdenes++ ] = { nombre, ayuda, orden };
+	return true;
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Pasa un byte a la consola.
+   *
+   * @param c El byte.
+   * @return true si acaba una línea (y, si era una orden, se ha ejecutado).
+   */
+  bool alimentar( char c ) {
+	if ( c == '\n' || c == '\r' ) {
+	  bool habia = (*this).longitud > 0 || (*this).desbordada;
+	  if ( (*this).desbordada ) {
+		(*this).largas++;
+		(*this).escribir( "consola: línea demasiado larga\n" );
+	  } else if ( (*this).longitud > 0 ) {
+		(*this).linea[ (*this).longitud ] = '\0';
+		ejecutar();
+	  }
+	  (*this).longitud = 0;
+	  (*this).desbordada = false;
+	  return habia; // el '\n' de un "\r\n" no cuenta
+	}
+	if ( (*this).desbordada ) {
+	  return false;
+	}
+	if ( (*this).longitud >= LONGITUD_MAXIMA_LINEA ) {
+	  (*this).desbordada = true;
+	  return false;
+	}
+	(*this).linea[ (*this).longitud++ ] = c;
+	return false;
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Atiende lo que haya llegado, sin esperar.
+   *
+   * @param leer De donde salen los bytes.
+   * @return true si ha acabado una línea (entonces no saca más hasta la próxima vez).
+   */
+  bool atender( LeerByte * leer ) {
+	for ( uint8_t i = 0; i < MAXIMO_BYTES_POR_VUELTA; i++ ) {
+	  int c = leer();
+	  if ( c < 0 ) {
+		return false;
+	  }
+	  if ( alimentar( (char) c ) ) {
+		return true;
+	  }
+	}
+	return false;
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Escribe las órdenes con su ayuda.
+   */
+  void escribirAyuda() const {
+	for ( uint8_t i = 0; i < (*this).numOrdenes; i++ ) {
+	  (*this).escribir( "  " );
+	  (*this).escribir( (*this).ordenes[i].nombre );
+	  (*this).escribir( " " );
+	  (*this).escribir( (*this).ordenes[i].ayuda );
+	  (*this).escribir( "\n" );
+	}
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Lee un número sin signo en decimal (una palabra entera).
+   *
+   * @param texto La palabra.
+   * @param valor Donde se deja.
+   * @return false si no es un número o no cabe en 32 bits.
+   */
+  static bool leerNumero( const char * texto, uint32_t & valor ) {
+	if ( *texto == '\0' ) {
+	  return false;
+	}
+	uint32_t v = 0;
+	for ( ; *texto != '\0'; texto++ ) {
+	  if ( *texto < '0' || *texto > '9' ) {
+		return false;
+	  }
+	  uint32_t cifra = (uint32_t) ( *texto - '0' );
+	  if ( v > ( 0xffffffffu - cifra ) / 10 ) {
+		return false;
+	  }
+	  v = v * 10 + cifra;
+	}
+	valor = v;
+	return true;
+  } // ()
+
+  uint32_t getLineas() const { return (*this).lineas; }
+  uint32_t getDesconocidas() const { return (*this).desconocidas; }
+  uint32_t getLargas() const { return (*this).largas; }
+
+}; // class
+
+#endif
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
@@ -0,0 +1,336 @@
+/*
+ * Nombre del fichero: ControlPotencia.h
+ * Descripción: Potencia de emisión según lo que dice la pasarela que oye.
+ * Autores: agent
+ * Fecha: 18 de octubre de 2026
+ *
+ * Este archivo ha sido realizado por agent.
+ * Contiene el formato de la realimentación que escribe la pasarela en la característica
+ * de potencia (Realimentacion), el buzón que la pasa del callback BLE al bucle
+ * (BuzonRealimentacion) y ControlPotencia, que sube o baja la potencia un nivel cada vez,
+ * entre unos límites, y estima la energía por trama entregada. No depende de Arduino:
+ * lo usan el firmware y la simulación (simulacion/medirPotencia.cpp).
+ *
+ * Todos los derechos reservados.
+ */
+
+#ifndef CONTROL_POTENCIA_H_INCLUIDO
+#define CONTROL_POTENCIA_H_INCLUIDO
+
+#include <stdint.h>
+
+#include <atomic>
+
+// ----------------------------------------------------------
+// Lo que escribe la pasarela (4 bytes), de las copias que ha oído desde la vez anterior:
+//
+//   byte 0: RSSI medio en dBm (con signo)
+//   byte 1: potencia con la que se emitieron, en dBm (TramaIBeacon::potenciaEmision())
+//   byte 2: tramas distintas oídas
+//   byte 3: copias oídas (se satura en 255)
+// ----------------------------------------------------------
+struct Realimentacion {
+  int8_t rssi;
+  int8_t potencia;
+  uint8_t tramas;
+  uint8_t copias;
+
+  static const uint8_t LONGITUD = 4;
+
+  void codificar( uint8_t * destino ) const {
+	destino[0] = (uint8_t) rssi;
+	destino[1] = (uint8_t) potencia;
+	destino[2] = tramas;
+	destino[3] = copias;
+  } // ()
+
+  /**
+   * @return false si no son LONGITUD bytes.
+   */
+  bool decodificar( const uint8_t * datos, uint16_t longitud ) {
+	if ( longitud != LONGITUD ) {
+	  return false;
+	}
+	rssi = (int8_t) datos[0];
+	potencia = (int8_t) datos[1];
+	tramas = datos[2];
+	copias = datos[3];
+	return true;
+  } // ()
+}; // struct
+
+// ----------------------------------------------------------
+/**
+ * @brief Pasa la última realimentación del callback BLE al bucle sin esperar.
+ *
+ * Los 4 bytes van juntos en un atómico de 32 bits, así que nunca se leen a medias;
+ * si llegan dos antes de que el bucle mire, vale la última.
+ */
+class BuzonRealimentacion {
+private:
+
+  std::atomic<uint32_t> datos { 0 };
+  std::atomic<uint32_t> numero { 0 };
+  uint32_t numeroLeido = 0; ///< Sólo lo toca quien lee.
+
+public:
+
+  // .........................................................
+  /**
+   * @brief Deja una realimentación (desde el callback).
+   *
+   * @return false si no tiene el formato de Realimentacion.
+   */
+  bool dejar( const uint8_t * bytes, uint16_t longitud ) {
+	Realimentacion r;
+	if ( ! r.decodificar( bytes, longitud ) ) {
+	  return false;
+	}
+	uint32_t v = (uint32_t) bytes[0] | ( (uint32_t) bytes[1] << 8 ) | ( (uint32_t) bytes[2] << 16 ) | ( (uint32_t) bytes[3] << 24 );
+	(*this).datos.store( v, std::memory_order_relaxed );
+	(*this).numero.fetch_add( 1, std::memory_order_release );
+	return true;
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Recoge la última realimentación, si ha llegado alguna desde la vez anterior.
+   *
+   * @param r Donde se deja.
+   * @return false si no hay nada nuevo.
+   */
+  bool tomar( Realimentacion & r ) {
+	uint32_t n = (*this).numero.load( std::memory_order_acquire );
+	if ( n == (*this).numeroLeido ) {
+	  return false;
+	}
+	(*this).numeroLeido = n;
+	uint32_t v = (*this).datos.load( std::memory_order_relaxed );
+	uint8_t bytes[Realimentacion::LONGITUD] = { (uint8_t) v, (uint8_t) ( v >> 8 ), (uint8_t) ( v >> 16 ), (uint8_t) ( v >> 24 ) };
+	return r.decodificar( bytes, sizeof(bytes) );
+  } // ()
+
+}; // class
+
+// ----------------------------------------------------------
+/**
+ * @brief Sube o baja la potencia de emisión para que la pasarela oiga con el margen justo.
+ *
+ * El margen es el RSSI medio (corregido a la potencia actual, por si la pasarela habla de
+ * copias emitidas con otra) menos la sensibilidad de la pasarela. Con cada realimentación:
+ * - si el margen no llega al objetivo, o se oyen menos de ENTREGA_MINIMA de las copias
+ *   emitidas, sube un nivel;
+ * - si bajando un nivel el margen seguiría por encima del objetivo más HISTERESIS_DB,
+ *   baja uno.
+ * Si pasa msSinRealimentacion sin que llegue ninguna (la pasarela ya no oye lo bastante
+ * para conectarse), sube un nivel cada vez. Los niveles son los que admite el nRF52840
+ * de la placa hasta +4 dBm (puede llegar a +8, pero gasta el doble), entre el mínimo y el
+ * máximo que se le den.
+ *
+ * La energía de cada anuncio se estima con la corriente de emisión del nivel y lo que dura
+ * la radio encendida en los tres canales (sin la respuesta de escaneo ni la recepción).
+ *
+ * @section ejemplos Ejemplo de uso
+ * @code
+ * ControlPotencia control( -20, 4, 10, 60000 );
+ * if ( control.evaluar( realimentacion, millis(), eventosPorTrama ) ) {
+ *   emisora.ajustarPotencia( control.getPotencia() );
+ * }
+ * @endcode
+ */
+class ControlPotencia {
+public:
+
+  static const uint8_t NUM_NIVELES = 9;
+  static const int8_t SENSIBILIDAD_DBM = -90;     ///< De la pasarela, con algo de margen.
+  static const uint8_t HISTERESIS_DB = 3;
+  static const uint8_t ENTREGA_MINIMA = 80;       ///< % de las copias emitidas que se tienen que oír.
+  static const uint16_t US_RADIO_POR_CANAL = 500; ///< Paquete de 31 bytes (376 us) más el arranque del transmisor.
+  static const uint8_t CANALES = 3;
+  static const uint16_t MV_ALIMENTACION = 3000;
+
+  /**
+   * @return La potencia (dBm) del nivel i (0 el más bajo).
+   */
+  static int8_t nivel( uint8_t i ) {
+	static const int8_t niveles[NUM_NIVELES] = { -40, -20, -16, -12, -8, -4, 0, 3, 4 };
+	return niveles[ i < NUM_NIVELES ? i : NUM_NIVELES - 1 ];
+  } // ()
+
+  /**
+   * @return La corriente (uA) al emitir en el nivel i: la del nRF52840 con el DC/DC a 3 V
+   * (hoja de datos); la de +3 dBm, interpolada entre 0 y +4 dBm.
+   */
+  static uint16_t corriente( uint8_t i ) {
+	static const uint16_t corrientes[NUM_NIVELES] = { 2300, 2700, 2800, 3000, 3300, 3800, 4800, 8400, 9600 };
+	return corrientes[ i < NUM_NIVELES ? i : NUM_NIVELES - 1 ];
+  } // ()
+
+  /**
+   * @return El nivel más alto que no pasa de dBm (el más bajo si todos pasan).
+   */
+  static uint8_t indiceDe( int8_t dBm ) {
+	uint8_t i = 0;
+	while ( i + 1 < NUM_NIVELES && nivel( i + 1 ) <= dBm ) {
+	  i++;
+	}
+	return i;
+  } // ()
+
+  /**
+   * @return La energía (nJ) de un anuncio (los tres canales) en el nivel i.
+   */
+  static uint32_t energiaAnuncio( uint8_t i ) {
+	// us * uA * mV = 1e-3 nJ
+	return (uint32_t) ( (uint64_t) CANALES * US_RADIO_POR_CANAL * corriente( i ) * MV_ALIMENTACION / 1000000 );
+  } // ()
+
+private:
+
+  uint8_t minimo;
+  uint8_t maximo;
+  uint8_t indice;
+  uint8_t margenObjetivo;
+  uint32_t msSinRealimentacion;
+
+  bool hayRealimentacion = false;
+  uint32_t msUltima = 0;       ///< millis() de la última realimentación (o de la última subida sin ella).
+  int16_t ultimoMargen = 0;
+  uint8_t ultimaEntrega = 100; ///< % de copias oídas en la última realimentación.
+  uint32_t cambios = 0;
+
+  // lo emitido desde la última realimentación y desde el arranque
+  uint64_t energiaVentana = 0; ///< nJ
+  uint32_t tramasVentana = 0;
+  uint64_t energiaTotal = 0;
+  uint32_t tramasTotal = 0;
+  uint32_t energiaPorTrama = 0; ///< nJ por trama entregada, de la última ventana cerrada.
+
+  bool cambiar( int8_t paso ) {
+	if ( paso > 0 && (*this).indice < (*this).maximo ) {
+	  (*this).indice++;
+	} else if ( paso < 0 && (*this).indice > (*this).minimo ) {
+	  (*this).indice--;
+	} else {
+	  return false;
+	}
+	(*this).cambios++;
+	return true;
+  } // ()
+
+public:
+
+  // .........................................................
+  /**
+   * @brief Constructor. Empieza en el máximo.
+   *
+   * @param minimoDBm Potencia mínima (se redondea al nivel que no pasa de ella).
+   * @param maximoDBm Potencia máxima (ídem).
+   * @param margenObjetivo_ dB que se quieren por encima de SENSIBILIDAD_DBM.
+   * @param msSinRealimentacion_ Sin realimentación durante esto, se sube un nivel.
+   */
+  ControlPotencia( int8_t minimoDBm, int8_t maximoDBm, uint8_t margenObjetivo_, uint32_t msSinRealimentacion_ ) :
+	minimo( indiceDe( minimoDBm ) ), maximo( indiceDe( maximoDBm ) ), margenObjetivo( margenObjetivo_ ),
+	msSinRealimentacion( msSinRealimentacion_ )
+  {
+	if ( (*this).minimo > (*this).maximo ) {
+	  (*this).minimo = (*this).maximo;
+	}
+	(*this).indice = (*this).maximo;
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Decide con una realimentación de la pasarela.
+   *
+   * @param r La realimentación.
+   * @param ms millis() ahora.
+   * @param eventosPorTrama Anuncios que se emiten de cada trama (duración / intervalo).
+   * @return true si ha cambiado la potencia.
+   */
+  bool evaluar( const Realimentacion & r, uint32_t ms, uint32_t eventosPorTrama ) {
+	(*this).hayRealimentacion = true;
+	(*this).msUltima = ms;
+
+	uint32_t emitidas = (uint32_t) r.tramas * ( eventosPorTrama > 0 ? eventosPorTrama : 1 );
+	uint32_t entrega = emitidas > 0 ? (uint32_t) r.copias * 100 / emitidas : 0;
+	(*this).ultimaEntrega = (uint8_t) ( entrega > 100 ? 100 : entrega );
+
+	// la energía por trama entregada: lo emitido desde la vez anterior, entre lo que ha llegado
+	if ( (*this).tramasVentana > 0 && (*this).ultimaEntrega > 0 ) {
+	  uint64_t porTrama = (*this).energiaVentana / (*this).tramasVentana;
+	  (*this).energiaPorTrama = (uint32_t) ( porTrama * 100 / (*this).ultimaEntrega );
+	}
+	(*this).energiaVentana = 0;
+	(*this).tramasVentana = 0;
+
+	if ( r.tramas == 0 ) {
+	  return false; // no dice nada del enlace
+	}
+	int16_t rssi = (int16_t) ( r.rssi + ( getPotencia() - r.potencia ) );
+	int16_t margen = (int16_t) ( rssi - SENSIBILIDAD_DBM );
+	(*this).ultimoMargen = margen;
+
+	if ( (*this).ultimaEntrega < ENTREGA_MINIMA || margen < (*this).margenObjetivo ) {
+	  return cambiar( +1 );
+	}
+	if ( (*this).indice > (*this).minimo ) {
+	  int16_t margenBajando = (int16_t) ( margen - ( getPotencia() - nivel( (*this).indice - 1 ) ) );
+	  if ( margenBajando >= (*this).margenObjetivo + HISTERESIS_DB ) {
+		return cambiar( -1 );
+	  }
+	}
+	return false;
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Sube un nivel si hace msSinRealimentacion que no llega ninguna (una vez que ha llegado alguna).
+   *
+   * @param ms millis() ahora.
+   * @return true si ha cambiado la potencia.
+   */
+  bool vigilar( uint32_t ms ) {
+	if ( ! (*this).hayRealimentacion || ms - (*this).msUltima < (*this).msSinRealimentacion ) {
+	  return false;
+	}
+	(*this).msUltima = ms; // la siguiente subida, dentro de otro tanto
+	return cambiar( +1 );
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Apunta un anuncio que ya ha acabado.
+   *
+   * @param eventos Veces que se ha emitido (duración / intervalo).
+   */
+  void anotarAnuncio( uint32_t eventos ) {
+	uint64_t e = (uint64_t) eventos * energiaAnuncio( (*this).indice );
+	(*this).energiaVentana += e;
+	(*this).tramasVentana++;
+	(*this).energiaTotal += e;
+	(*this).tramasTotal++;
+  } // ()
+
+  int8_t getPotencia() const { return nivel( (*this).indice ); }
+  int8_t getMinimo() const { return nivel( (*this).minimo ); }
+  int8_t getMaximo() const { return nivel( (*this).maximo ); }
+  uint32_t getCambios() const { return (*this).cambios; }
+  int16_t getMargen() const { return (*this).ultimoMargen; }
+  uint8_t getEntrega() const { return (*this).ultimaEntrega; }
+
+  /// nJ por trama entregada en la última ventana (0 si aún no hay).
+  uint32_t getEnergiaPorTrama() const { return (*this).energiaPorTrama; }
+
+  /// nJ emitidos desde el arranque.
+  uint64_t getEnergiaTotal() const { return (*this).energiaTotal; }
+  uint32_t getTramas() const { return (*this).tramasTotal; }
+
+}; // class
+
+#endif
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
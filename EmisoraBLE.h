@@ -43,6 +43,8 @@
  */
 
 #include "ServicioEnEmisora.h"
+#include "GestorConexiones.h"
+#include "TramaIBeacon.h"
 
 // ----------------------------------------------------------
 /**
@@ -54,9 +56,96 @@ private:
 
     const char * nombreEmisora; ///< Nombre de la emisora BLE.
     const uint16_t fabricanteID; ///< ID del fabricante de la emisora.
-    const int8_t txPower;        ///< Potencia de transmisión en dBm.
+    int8_t txPower;              ///< Potencia de transmisión en dBm.
+    bool potenciaPorAplicar = true;        ///< txPower aún no se ha pasado a Bluefruit.
+    uint32_t potenciasAplicadas = 0;
+    GestorConexiones * elGestor = nullptr; ///< Si no es nullptr, lleva las conexiones.
+    uint16_t intervaloAnuncio = 100;       ///< En unidades de 0.625 ms.
+    bool hayAnunciado = false;
+    unsigned long usPrimerAnuncio = 0;     ///< micros() al empezar el primer anuncio.
+    unsigned long usUltimoAnuncio = 0;     ///< micros() al empezar el último anuncio.
+    uint8_t datosRespuesta[TramaIBeacon::LONGITUD_MAXIMA_ANUNCIO]; ///< Lo que va tras el id de fabricante en la respuesta de escaneo.
+    uint8_t longitudRespuesta = 0;         ///< 0 = la respuesta de escaneo lleva sólo el nombre.
+    bool respuestaCambiada = true;         ///< Hay que rehacer Bluefruit.ScanResponse.
+    uint32_t cambiosRespuesta = 0;
+    bool enlaceRapido = false;             ///< Ver permitirEnlaceRapido().
+
+  // .........................................................
+  // rehace la respuesta de escaneo, sólo si ha cambiado: primero los datos
+  // (id de fabricante y lo de ajustarRespuestaEscaneo()) y luego el nombre,
+  // que es lo que se recorta si no cabe entero
+  // .........................................................
+  void prepararRespuestaEscaneo() {
+	if ( ! (*this).respuestaCambiada ) {
+	  return;
+	}
+	Bluefruit.ScanResponse.clearData();
+	if ( (*this).longitudRespuesta > 0 ) {
+	  uint8_t datos[2 + sizeof( (*this).datosRespuesta )];
+	  datos[0] = (uint8_t) ( (*this).fabricanteID & 0xff ); // el id de fabricante va en little endian
+	  datos[1] = (uint8_t) ( (*this).fabricanteID >> 8 );
+	  memcpy( &datos[2], (*this).datosRespuesta, (*this).longitudRespuesta );
+	  Bluefruit.ScanResponse.addData( BLE_GAP_AD_TYPE_MANUFACTURER_SPECIFIC_DATA, datos, 2 + (*this).longitudRespuesta );
+	}
+	Bluefruit.ScanResponse.addName();
+	(*this).respuestaCambiada = false;
+  } // ()
+
+  // .........................................................
+  // pasa la potencia a Bluefruit, sólo si ha cambiado
+  // .........................................................
+  void aplicarPotencia() {
+	if ( ! (*this).potenciaPorAplicar ) {
+	  return;
+	}
+	Bluefruit.setTxPower( (*this).txPower );
+	(*this).potenciaPorAplicar = false;
+	(*this).potenciasAplicadas++;
+  } // ()
+
+  // .........................................................
+  // empieza el anuncio ya configurado y apunta cuándo fue el primero
+  // .........................................................
+  void empezarAnuncio() {
+	//
+	// empieza el anuncio, 0 = tiempo indefinido (ya lo pararán)
+	//
+	Bluefruit.Advertising.start( 0 ); 
+
+	(*this).usUltimoAnuncio = micros();
+	if ( ! (*this).hayAnunciado ) {
+	  (*this).usPrimerAnuncio = micros();
+	  (*this).hayAnunciado = true;
+	}
+  } // ()
 public:
 
+  /// Intervalo de anuncio más corto que admite la SoftDevice (20 ms), en unidades de 0.625 ms.
+  static const uint16_t INTERVALO_MINIMO = 32;
+
+  /// Lo más que se puede poner en la respuesta de escaneo con ajustarRespuestaEscaneo()
+  /// (31 bytes menos la cabecera de la estructura AD y el id de fabricante).
+  static const uint8_t LONGITUD_MAXIMA_RESPUESTA = TramaIBeacon::LONGITUD_MAXIMA_ANUNCIO - 2 - 2;
+
+  // perfiles del enlace (ver pedirPerfilRendimiento() y pedirPerfilBajoConsumo())
+  static const uint8_t LONGITUD_EVENTO_RAPIDO = 6;       ///< Tiempo de radio por intervalo: 7.5 ms (x 1.25 ms).
+  static const uint8_t PAQUETES_EN_VUELO_RAPIDO = 8;     ///< Cola de notificaciones en la SoftDevice.
+  static const uint16_t INTERVALO_CONEXION_RAPIDO = 6;   ///< 7.5 ms, el más corto (x 1.25 ms).
+  static const uint16_t INTERVALO_CONEXION_BAJO_CONSUMO = 80; ///< 100 ms.
+  static const uint16_t LATENCIA_BAJO_CONSUMO = 4;       ///< Intervalos que se puede saltar sin nada que enviar.
+  static const uint16_t SUPERVISION_CONEXION = 400;      ///< 4 s (x 10 ms): más que (1 + latencia) * intervalo * 2.
+
+  /**
+   * @brief Lo negociado con una central (ver getParametrosEnlace()).
+   */
+  struct ParametrosEnlace {
+	uint8_t phy;             ///< BLE_GAP_PHY_1MBPS o BLE_GAP_PHY_2MBPS.
+	uint16_t longitudDatos;  ///< Bytes de datos por paquete del enlace (27 .. 251).
+	uint16_t mtu;            ///< MTU de ATT.
+	uint16_t intervalo;      ///< Intervalo de conexión (x 1.25 ms).
+	uint16_t latencia;       ///< Latencia del periférico (intervalos).
+  };
+
   // .........................................................
   /// @brief Tipo de callback para conexión establecida.
   using CallbackConexionEstablecida = void ( uint16_t connHandle );
@@ -114,6 +203,7 @@ public:
   void encenderEmisora() {
 	// Serial.println ( "Bluefruit.begin() " );
 	 Bluefruit.begin(); 
+	 (*this).potenciaPorAplicar = true;
 
 	 // por si acaso:
 	 (*this).detenerAnuncio();
@@ -137,6 +227,208 @@ public:
 
   } // ()
 
+ // ......................................................... 
+    /**
+     * @brief Enciende la emisora para atender a varias centrales a la vez.
+     * 
+     * Reserva GestorConexiones::MAX_CONEXIONES conexiones y una cola de
+     * GestorConexiones::PAQUETES_EN_VUELO notificaciones en la SoftDevice, y deja que
+     * el gestor lleve las conexiones. Los callbacks de conexión que se instalen
+     * después los llama el gestor.
+     * 
+     * @param gestor Gestor de conexiones.
+     * @param car Característica por la que el gestor notifica.
+     * @return void
+     */
+  void encenderEmisora( GestorConexiones & gestor, ServicioEnEmisora::Caracteristica & car ) {
+	// tiene que ir antes de begin(); con el enlace rápido, la SoftDevice reserva
+	// lo necesario para la MTU máxima, eventos largos y más paquetes en vuelo
+	uint8_t paquetes = (*this).enlaceRapido ? PAQUETES_EN_VUELO_RAPIDO : GestorConexiones::PAQUETES_EN_VUELO;
+	if ( (*this).enlaceRapido ) {
+	  Bluefruit.configPrphConn( BLE_GATT_ATT_MTU_MAX, LONGITUD_EVENTO_RAPIDO,
+								paquetes, BLE_GATTC_WRITE_CMD_TX_QUEUE_SIZE_DEFAULT );
+	} else {
+	  Bluefruit.configPrphConn( BLE_GATT_ATT_MTU_DEFAULT, BLE_GAP_EVENT_LENGTH_DEFAULT,
+								paquetes, BLE_GATTC_WRITE_CMD_TX_QUEUE_SIZE_DEFAULT );
+	}
+	Bluefruit.begin( GestorConexiones::MAX_CONEXIONES, 0 );
+	(*this).potenciaPorAplicar = true;
+
+	(*this).detenerAnuncio();
+
+	(*this).elGestor = &gestor;
+	gestor.iniciar( car, paquetes );
+  } // ()
+
+ // ......................................................... 
+    /**
+     * @brief Reserva en la SoftDevice lo que necesita el perfil de rendimiento.
+     * 
+     * Hay que llamarlo antes de encenderEmisora( GestorConexiones &, ... ). Sin esto,
+     * pedirPerfilRendimiento() no puede pasar de la MTU por defecto ni de 3.75 ms de
+     * radio por intervalo. Cuesta RAM de la SoftDevice por cada conexión.
+     * 
+     * @return void
+     */
+  void permitirEnlaceRapido() {
+	(*this).enlaceRapido = true;
+  } // ()
+
+ // ......................................................... 
+    /**
+     * @brief Pide a una central el perfil de rendimiento: para transferir mucho.
+     * 
+     * PHY de 2 Mbps, paquetes del enlace de 251 bytes (data length extension), la MTU
+     * máxima y el intervalo de conexión más corto, sin latencia. La central puede
+     * quedarse en menos (lo que no admita); lo negociado llega un poco después, se ve con
+     * getParametrosEnlace(). Vale con cualquier central: las peticiones que no admita se
+     * rechazan y el enlace se queda como estaba.
+     * 
+     * @param connHandle La conexión.
+     * @return false si no hay conexión con ese handle.
+     */
+  bool pedirPerfilRendimiento( uint16_t connHandle ) {
+	BLEConnection * conexion = Bluefruit.Connection( connHandle );
+	if ( conexion == nullptr ) {
+	  return false;
+	}
+	conexion->requestPHY( BLE_GAP_PHY_2MBPS );
+	conexion->requestDataLengthUpdate();
+	conexion->requestMtuExchange( (*this).enlaceRapido ? BLE_GATT_ATT_MTU_MAX : BLE_GATT_ATT_MTU_DEFAULT );
+	conexion->requestConnectionParameter( INTERVALO_CONEXION_RAPIDO, 0, SUPERVISION_CONEXION );
+	return true;
+  } // ()
+
+ // ......................................................... 
+    /**
+     * @brief Pide a una central el perfil de bajo consumo: para cuando no hay nada que transferir.
+     * 
+     * Intervalo de conexión largo y latencia del periférico: la radio sólo se despierta
+     * cada LATENCIA_BAJO_CONSUMO + 1 intervalos si no tiene nada que enviar (una notificación
+     * sale en el intervalo siguiente). La PHY, los paquetes y la MTU se quedan como estén:
+     * sin tráfico no gastan.
+     * 
+     * @param connHandle La conexión.
+     * @return false si no hay conexión con ese handle.
+     */
+  bool pedirPerfilBajoConsumo( uint16_t connHandle ) {
+	BLEConnection * conexion = Bluefruit.Connection( connHandle );
+	if ( conexion == nullptr ) {
+	  return false;
+	}
+	return conexion->requestConnectionParameter( INTERVALO_CONEXION_BAJO_CONSUMO, LATENCIA_BAJO_CONSUMO,
+												 SUPERVISION_CONEXION );
+  } // ()
+
+ // ......................................................... 
+    /**
+     * @brief Lo negociado ahora mismo con una central.
+     * 
+     * @param connHandle La conexión.
+     * @param p Donde se deja.
+     * @return false si no hay conexión con ese handle.
+     */
+  bool getParametrosEnlace( uint16_t connHandle, ParametrosEnlace & p ) {
+	BLEConnection * conexion = Bluefruit.Connection( connHandle );
+	if ( conexion == nullptr ) {
+	  return false;
+	}
+	p.phy = conexion->getPHY();
+	p.longitudDatos = conexion->getDataLength();
+	p.mtu = conexion->getMtu();
+	p.intervalo = conexion->getConnectionInterval();
+	p.latencia = conexion->getSlaveLatency();
+	return true;
+  } // ()
+
+  // ......................................................... 
+    /**
+     * @brief Cambia el intervalo de los anuncios. Vale para el siguiente que se emita.
+     * 
+     * @param intervalo En unidades de 0.625 ms (32 .. 16384).
+     * @return void
+     */
+  void ajustarIntervaloAnuncio( uint16_t intervalo ) {
+	(*this).intervaloAnuncio = intervalo;
+  } // ()
+
+  // ......................................................... 
+    /**
+     * @return El intervalo de los anuncios, en unidades de 0.625 ms.
+     */
+  uint16_t getIntervaloAnuncio() const {
+	return (*this).intervaloAnuncio;
+  } // ()
+
+  // ......................................................... 
+    /**
+     * @brief Cambia la potencia de emisión. Vale para el siguiente anuncio que se emita.
+     * 
+     * Bluefruit.setTxPower() sólo se llama al emitir si ha cambiado.
+     * 
+     * @param dBm Uno de los niveles de la radio (ControlPotencia::nivel()).
+     * @return true si ha cambiado.
+     */
+  bool ajustarPotencia( int8_t dBm ) {
+	if ( dBm == (*this).txPower ) {
+	  return false;
+	}
+	(*this).txPower = dBm;
+	(*this).potenciaPorAplicar = true;
+	return true;
+  } // ()
+
+  // ......................................................... 
+    /**
+     * @return La potencia de emisión en dBm.
+     */
+  int8_t getPotencia() const {
+	return (*this).txPower;
+  } // ()
+
+  // ......................................................... 
+    /**
+     * @return Veces que se ha llamado a Bluefruit.setTxPower().
+     */
+  uint32_t getPotenciasAplicadas() const {
+	return (*this).potenciasAplicadas;
+  } // ()
+
+  // ......................................................... 
+    /**
+     * @brief Cambia los datos de fabricante de la respuesta de escaneo (p.ej. la telemetría).
+     * 
+     * Los escáneres activos la piden de todas formas, así que no cuesta anuncios ni
+     * conexiones de más. Si los datos son los mismos no se toca nada; si cambian, la
+     * respuesta se rehace al emitir el siguiente anuncio (como el intervalo). Lo que
+     * no quepa con el nombre detrás, se queda sin nombre (o con él recortado).
+     * 
+     * @param datos Lo que va detrás del id de fabricante.
+     * @param longitud Bytes (hasta LONGITUD_MAXIMA_RESPUESTA; 0 = sólo el nombre).
+     * @return true si ha cambiado.
+     */
+  bool ajustarRespuestaEscaneo( const uint8_t * datos, uint8_t longitud ) {
+	if ( longitud > LONGITUD_MAXIMA_RESPUESTA ) {
+	  longitud = LONGITUD_MAXIMA_RESPUESTA;
+	}
+	if ( longitud == (*this).longitudRespuesta && memcmp( datos, (*this).datosRespuesta, longitud ) == 0 ) {
+	  return false;
+	}
+	memcpy( (*this).datosRespuesta, datos, longitud );
+	(*this).longitudRespuesta = longitud;
+	(*this).respuestaCambiada = true;
+	(*this).cambiosRespuesta++;
+	return true;
+  } // ()
+
+  // ......................................................... 
+    /**
+     * @return Veces que han cambiado los datos de la respuesta de escaneo.
+     */
+  uint32_t getCambiosRespuestaEscaneo() const {
+	return (*this).cambiosRespuesta;
+  } // ()
+
   // ......................................................... 
     /**
      * @brief Detiene la emisión de anuncios.
@@ -180,35 +472,32 @@ public:
 	//
 	(*this).detenerAnuncio();
 	
-	//
-	// creo el beacon 
-	//
-	BLEBeacon elBeacon( beaconUUID, major, minor, rssi );
-	elBeacon.setManufacturer( (*this).fabricanteID );
-
 	//
 	// parece que esto debe ponerse todo aquí
 	//
 
-	Bluefruit.setTxPower( (*this).txPower );
+	(*this).aplicarPotencia(); // sólo si ha cambiado
 	Bluefruit.setName( (*this).nombreEmisora );
-	Bluefruit.ScanResponse.addName(); // para que envíe el nombre de emisora (?!)
+	(*this).prepararRespuestaEscaneo(); // el nombre de emisora (?!) y lo de ajustarRespuestaEscaneo()
 
 	//
-	// pongo el beacon
+	// pongo el beacon: lo mismo que haría BLEBeacon, pero con TramaIBeacon.h
+	// (el formato que decodifica la pasarela)
 	//
-	Bluefruit.Advertising.setBeacon( elBeacon );
+	uint8_t datosFabricante[4+TramaIBeacon::LONGITUD_CARGA];
+	TramaIBeacon::codificarDatosFabricante( &datosFabricante[0], (*this).fabricanteID, beaconUUID,
+											(uint16_t) major, (uint16_t) minor, (int8_t) rssi );
+	Bluefruit.Advertising.clearData();
+	Bluefruit.Advertising.addFlags( BLE_GAP_ADV_FLAGS_LE_ONLY_GENERAL_DISC_MODE );
+	Bluefruit.Advertising.addData( BLE_GAP_AD_TYPE_MANUFACTURER_SPECIFIC_DATA, &datosFabricante[0], sizeof(datosFabricante) );
 
 	//
 	// ? qué valorers poner aquí
 	//
 	Bluefruit.Advertising.restartOnDisconnect(true); // no hace falta, pero lo pongo
-	Bluefruit.Advertising.setInterval(100, 100);    // in unit of 0.625 ms
+	Bluefruit.Advertising.setInterval( (*this).intervaloAnuncio, (*this).intervaloAnuncio );    // in unit of 0.625 ms
 
-	//
-	// empieza el anuncio, 0 = tiempo indefinido (ya lo pararán)
-	//
-	Bluefruit.Advertising.start( 0 ); 
+	(*this).empezarAnuncio();
 	
   } // ()
 
@@ -278,11 +567,10 @@ public:
 	(*this).detenerAnuncio(); 
 
 	Bluefruit.Advertising.clearData();
-	Bluefruit.ScanResponse.clearData(); // hace falta?
 
 	// Bluefruit.setTxPower( (*this).txPower ); creo que no lo pongo porque es uno de los bytes de la parte de carga que utilizo
 	Bluefruit.setName( (*this).nombreEmisora );
-	Bluefruit.ScanResponse.addName();
+	(*this).prepararRespuestaEscaneo(); // sólo se rehace si ha cambiado
 
 	Bluefruit.Advertising.addFlags(BLE_GAP_ADV_FLAGS_LE_ONLY_GENERAL_DISC_MODE);
 
@@ -291,42 +579,27 @@ public:
 
 	//
 	// hasta ahora habrá, supongo, ya puestos los 5 primeros bytes. Efectivamente.
-	// Falta poner 4 bytes fijos (company ID, beacon type, longitud) y 21 de carga
+	// Falta poner 4 bytes fijos (company ID, beacon type, longitud) y 21 de carga.
+	// addData() hay que usarlo sólo una vez. Por eso el prefijo y la carga se
+	// copian juntos (TramaIBeacon.h, el mismo formato que decodifica la pasarela)
 	//
-	uint8_t restoPrefijoYCarga[4+21] = {
-	  0x4c, 0x00, // companyID 2
-	  0x02, // ibeacon type 1byte
-	  21, // ibeacon length 1byte (dec=21)  longitud del resto // 0x15 // ibeacon length 1byte (dec=21)  longitud del resto
-	  '-', '-', '-', '-', 
-	  '-', '-', '-', '-', 
-	  '-', '-', '-', '-', 
-	  '-', '-', '-', '-', 
-	  '-', '-', '-', '-', 
-	  '-'
-	};
-
-	//
-	// addData() hay que usarlo sólo una vez. Por eso copio la carga
-	// en el anterior array, donde he dejado 21 sitios libres
-	//
-	memcpy( &restoPrefijoYCarga[4], &carga[0], ( tamanyoCarga > 21 ? 21 : tamanyoCarga ) ); 
+	uint8_t restoPrefijoYCarga[4+TramaIBeacon::LONGITUD_CARGA];
+	TramaIBeacon::codificarDatosFabricanteLibre( &restoPrefijoYCarga[0], carga, tamanyoCarga );
 
 	//
 	// copio la carga para emitir
 	//
-	Bluefruit.Advertising.addData( BLE_GAP_AD_TYPE_MANUFACTURER_SPECIFIC_DATA, &restoPrefijoYCarga[0], 4+21 );
+	Bluefruit.Advertising.addData( BLE_GAP_AD_TYPE_MANUFACTURER_SPECIFIC_DATA, &restoPrefijoYCarga[0], 4+TramaIBeacon::LONGITUD_CARGA );
 
 	//
 	// ? qué valores poner aquí ?
 	//
 	Bluefruit.Advertising.restartOnDisconnect(true);
-	Bluefruit.Advertising.setInterval(100, 100);    // in unit of 0.625 ms
+	Bluefruit.Advertising.setInterval( (*this).intervaloAnuncio, (*this).intervaloAnuncio );    // in unit of 0.625 ms
 
 	Bluefruit.Advertising.setFastTimeout( 1 );      // number of seconds in fast mode
-	//
-	// empieza el anuncio, 0 = tiempo indefinido (ya lo pararán)
-	//
-	Bluefruit.Advertising.start( 0 ); 
+
+	(*this).empezarAnuncio();
 
 	Globales::elPuerto.escribir( "emitiriBeacon libre  Bluefruit.Advertising.start( 0 );  \n");
   } // ()
@@ -419,6 +692,10 @@ public:
      */
 
   void instalarCallbackConexionEstablecida( CallbackConexionEstablecida cb ) {
+	if ( (*this).elGestor != nullptr ) {
+	  (*this).elGestor->instalarCallbackConexionEstablecida( cb );
+	  return;
+	}
 	Bluefruit.Periph.setConnectCallback( cb );
   } // ()
   
@@ -431,6 +708,10 @@ public:
      */
      
   void instalarCallbackConexionTerminada( CallbackConexionTerminada cb ) {
+	if ( (*this).elGestor != nullptr ) {
+	  (*this).elGestor->instalarCallbackConexionTerminada( cb );
+	  return;
+	}
 	Bluefruit.Periph.setDisconnectCallback( cb );
   } // ()
 
@@ -446,6 +727,36 @@ public:
 	return Bluefruit.Connection( connHandle );
   } // ()
 
+  // .........................................................
+    /**
+     * @brief Momento del primer anuncio desde que arrancó la placa.
+     * 
+     * @return micros() cuando empezó el primer anuncio (0 si aún no ha habido ninguno).
+     */
+  unsigned long getTiempoPrimerAnuncio() const {
+	return (*this).usPrimerAnuncio;
+  } // ()
+
+  // .........................................................
+    /**
+     * @return micros() cuando empezó el último anuncio (0 si aún no ha habido ninguno).
+     */
+  unsigned long getTiempoUltimoAnuncio() const {
+	return (*this).usUltimoAnuncio;
+  } // ()
+
+  bool haAnunciado() const {
+	return (*this).hayAnunciado;
+  } // ()
+
+  // .........................................................
+    /**
+     * @return El gestor de conexiones (nullptr si se ha encendido sin él).
+     */
+  GestorConexiones * getGestorConexiones() {
+	return (*this).elGestor;
+  } // ()
+
 }; // class
 
 #endif
@@ -0,0 +1,235 @@
+/*
+ * Nombre del fichero: EncendidoSensor.h
+ * Descripción: Cuánto hay que esperar a que el frontal analógico del sensor se asiente tras encenderlo.
+ * Autores: agent
+ * Fecha: 18 de octubre de 2026
+ *
+ * Este archivo ha sido realizado por agent.
+ * Contiene la clase EncendidoSensor. Con la alimentación conmutada (Medidor::
+ * usarAlimentacionConmutada()) el frontal del sensor sólo se enciende para medir; sus
+ * salidas tardan en llegar a su valor, y medir antes da un error. El tiempo de espera se
+ * fija o se aprende: de tarde en tarde se leen vgas y vref desde el encendido hasta
+ * que las lecturas convergen, y lo que haya tardado (más un margen) es lo que se
+ * espera las demás veces. También cuenta el tiempo encendido y las lecturas del ADC, para
+ * la energía. No depende de Arduino.
+ *
+ * Todos los derechos reservados.
+ */
+
+#ifndef ENCENDIDO_SENSOR_H_INCLUIDO
+#define ENCENDIDO_SENSOR_H_INCLUIDO
+
+#include <stdint.h>
+
+// ----------------------------------------------------------
+/**
+ * @brief Espera de asentamiento del frontal, fija o aprendida.
+ *
+ * Al aprender se miran vgas y vref por separado (su diferencia no tiene por qué ir
+ * derecha a su valor: si vref sube antes, primero se aleja) y se leen cada vez más
+ * espaciadas (un octavo de lo que lleva encendido, y al menos msEntreLecturas), para
+ * que cada cambio siga por encima del ruido hasta el final aunque el frontal sea lento.
+ * Un canal está asentado si el último cambio no pasa del umbral y, además:
+ * - cambia de signo con el anterior, que tampoco pasaba del umbral: ya sólo es ruido;
+ * - o va a menos: si sigue como una exponencial, cada cambio es el anterior por
+ *   r < 1 y lo que falta es el último por r / (1 - r), que tampoco puede pasar del umbral.
+ * Si el cambio no va a menos y no cambia de signo, aún está subiendo (o bajando).
+ * Si a msMaximo no ha convergido, se da por asentado (y se cuenta).
+ *
+ * Uso, en cada medida:
+ * @code
+ * encender();
+ * if ( e.tocaAprender() ) {
+ *   do { esperar( e.getMsHastaLectura() ); } while ( ! e.anyadir( msDesdeEncendido(), vgas, vref ) );
+ * } else {
+ *   esperar( e.getMsAsentamiento() );
+ * }
+ * leerRafaga(); apagar();
+ * e.apuntarEncendido( msDesdeEncendido(), lecturasADC );
+ * @endcode
+ */
+class EncendidoSensor {
+private:
+
+  /// Lo que se recuerda de cada canal mientras se aprende.
+  struct Canal {
+	double anterior = 0;
+	double diferencia = 0;
+  }; // struct
+
+  uint16_t msAsentamiento;      ///< Lo que se espera antes de la ráfaga.
+  bool aprender;                ///< Si msAsentamiento se aprende.
+  double umbral;                ///< Cuentas del ADC que pueden faltar para darlo por asentado.
+  uint16_t msEntreLecturas;     ///< Lo menos entre dos lecturas al aprender.
+  uint16_t msMaximo;
+  uint16_t periodoAprendizaje;  ///< Medidas entre dos aprendizajes (se vuelve a aprender por si cambia).
+  uint8_t margen;               ///< % que se añade a lo aprendido.
+
+  // el aprendizaje en curso
+  uint8_t lecturasAprendizaje = 0;
+  uint16_t msUltimaLectura = 0;
+  Canal gas;
+  Canal ref;
+  uint16_t medidasDesdeAprendizaje = 0;
+  bool hayAprendido = false;
+
+  uint16_t ultimoAsentamiento = 0; ///< ms que tardó en converger la última vez que se aprendió.
+  uint32_t aprendizajes = 0;
+  uint32_t sinConverger = 0;
+  uint32_t encendidos = 0;
+  uint64_t msEncendido = 0;
+  uint64_t lecturasADC = 0;
+
+  static double absoluto( double x ) {
+	return x < 0 ? -x : x;
+  }
+
+  // .........................................................
+  /**
+   * @brief Apunta una lectura de un canal.
+   *
+   * @param c El canal.
+   * @param lectura En cuentas del ADC.
+   * @return true si con ella el canal parece asentado (desde la tercera lectura).
+   */
+  bool converge( Canal & c, double lectura ) {
+	double d = lectura - c.anterior;
+	double dAnterior = c.diferencia;
+	c.anterior = lectura;
+	c.diferencia = d;
+	if ( (*this).lecturasAprendizaje < 3 ) {
+	  return false;
+	}
+
+	double a = absoluto( d );
+	double b = absoluto( dAnterior );
+	if ( a > (*this).umbral ) {
+	  return false;
+	}
+	if ( ( d > 0 ) != ( dAnterior > 0 ) ) {
+	  return b <= (*this).umbral; // ya sólo ruido
+	}
+	if ( a >= b ) {
+	  return a == 0; // aún no va a menos, salvo que ya no se mueva
+	}
+	double r = a / b;
+	return a * r / ( 1 - r ) <= (*this).umbral; // lo que falta, si sigue igual
+  } // ()
+
+public:
+
+  // .........................................................
+  /**
+   * @brief Constructor.
+   *
+   * @param msAsentamiento_ Espera fija; 0 para aprenderla.
+   * @param umbral_ Cuentas del ADC que pueden faltar en cada canal (al aprender).
+   * @param msEntreLecturas_ Lo menos entre dos lecturas al aprender.
+   * @param msMaximo_ Lo más que se espera (y que se aprende).
+   * @param periodoAprendizaje_ Medidas entre dos aprendizajes.
+   * @param margen_ % que se añade a lo aprendido.
+   */
+  EncendidoSensor( uint16_t msAsentamiento_ = 0, double umbral_ = 1.0, uint16_t msEntreLecturas_ = 4,
+				   uint16_t msMaximo_ = 2000, uint16_t periodoAprendizaje_ = 64, uint8_t margen_ = 25 )
+	: msAsentamiento( msAsentamiento_ ), aprender( msAsentamiento_ == 0 ), umbral( umbral_ ),
+	  msEntreLecturas( msEntreLecturas_ > 0 ? msEntreLecturas_ : 1 ), msMaximo( msMaximo_ ),
+	  periodoAprendizaje( periodoAprendizaje_ > 0 ? periodoAprendizaje_ : 1 ), margen( margen_ ) {
+	if ( (*this).aprender ) {
+	  (*this).msAsentamiento = (*this).msMaximo; // hasta que se aprenda
+	}
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Pasa de la espera fija a aprenderla: aprende la siguiente medida. Lo apuntado
+   * (encendidos, tiempo encendido y lecturas del ADC) se queda.
+   */
+  void empezarAprender() {
+	(*this).aprender = true;
+	(*this).hayAprendido = false;
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Dice si esta medida aprende (llamar una vez por medida, al encender).
+   */
+  bool tocaAprender() {
+	if ( ! (*this).aprender ) {
+	  return false;
+	}
+	if ( (*this).hayAprendido && ++(*this).medidasDesdeAprendizaje < (*this).periodoAprendizaje ) {
+	  return false;
+	}
+	(*this).medidasDesdeAprendizaje = 0;
+	(*this).lecturasAprendizaje = 0;
+	(*this).msUltimaLectura = 0;
+	return true;
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Lo que hay que esperar, mientras se aprende, hasta la siguiente lectura.
+   */
+  uint16_t getMsHastaLectura() const {
+	uint16_t ms = (*this).msUltimaLectura / 8;
+	return ms > (*this).msEntreLecturas ? ms : (*this).msEntreLecturas;
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Una lectura mientras se aprende.
+   *
+   * @param ms Desde el encendido.
+   * @param lecturaGas vgas en cuentas del ADC (mejor la media de unas pocas).
+   * @param lecturaRef vref, igual.
+   * @return true si ya está asentado: entonces se ha aprendido la espera.
+   */
+  bool anyadir( uint16_t ms, double lecturaGas, double lecturaRef ) {
+	(*this).lecturasAprendizaje++;
+	(*this).msUltimaLectura = ms;
+	bool asentado = converge( (*this).gas, lecturaGas );
+	asentado = converge( (*this).ref, lecturaRef ) && asentado;
+	if ( ! asentado && ms < (*this).msMaximo ) {
+	  return false;
+	}
+	if ( ! asentado ) {
+	  (*this).sinConverger++;
+	}
+	uint32_t espera = (uint32_t) ms * ( 100 + (*this).margen ) / 100;
+	(*this).msAsentamiento = (uint16_t) ( espera < (*this).msMaximo ? espera : (*this).msMaximo );
+	(*this).ultimoAsentamiento = ms;
+	(*this).hayAprendido = true;
+	(*this).aprendizajes++;
+	return true;
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Apunta un encendido que ya ha acabado.
+   *
+   * @param ms Tiempo encendido.
+   * @param lecturas Lecturas del ADC hechas (las de aprender también).
+   */
+  void apuntarEncendido( uint32_t ms, uint32_t lecturas ) {
+	(*this).encendidos++;
+	(*this).msEncendido += ms;
+	(*this).lecturasADC += lecturas;
+  } // ()
+
+  uint16_t getMsAsentamiento() const { return (*this).msAsentamiento; }
+  bool getAprende() const { return (*this).aprender; }
+  uint16_t getUltimoAsentamiento() const { return (*this).ultimoAsentamiento; }
+  uint32_t getAprendizajes() const { return (*this).aprendizajes; }
+  uint32_t getSinConverger() const { return (*this).sinConverger; }
+  uint32_t getEncendidos() const { return (*this).encendidos; }
+  uint64_t getMsEncendido() const { return (*this).msEncendido; }
+  uint64_t getLecturasADC() const { return (*this).lecturasADC; }
+
+}; // class
+
+#endif
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
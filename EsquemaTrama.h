@@ -0,0 +1,215 @@
+/*
+ * Nombre del fichero: EsquemaTrama.h
+ * Descripción: Plantillas para declarar una vez el formato de una trama y obtener su codificador y su decodificador.
+ * Autores: agent
+ * Fecha: 18 de octubre de 2026
+ *
+ * Este archivo ha sido realizado por agent.
+ * Contiene las plantillas Campo y Trama. Una trama es una lista de campos, cada uno con su
+ * tamaño en bytes, si lleva signo, su escala y su orden de bytes. Con esa declaración el
+ * compilador calcula el tamaño de la trama y genera el codificador (firmware) y el
+ * decodificador (herramientas del ordenador). Los valores que no caben se saturan al máximo
+ * o al mínimo del campo y se avisa de ello. No reserva memoria ni depende de Arduino
+ * (vale C++11, el del núcleo nRF52).
+ *
+ * Todos los derechos reservados.
+ */
+
+#ifndef ESQUEMA_TRAMA_H_INCLUIDO
+#define ESQUEMA_TRAMA_H_INCLUIDO
+
+#include <stdint.h>
+
+namespace EsquemaTrama {
+
+  /// Orden de los bytes de un campo.
+  enum OrdenBytes {
+	MAYOR_PRIMERO, ///< Big endian (el de major y minor del iBeacon).
+	MENOR_PRIMERO  ///< Little endian.
+  };
+
+  // ----------------------------------------------------------
+  /**
+   * @brief Un campo de una trama.
+   *
+   * El valor que se guarda es round( valor * MULTIPLICADOR ), así que la resolución es
+   * 1 / MULTIPLICADOR. Por ejemplo Campo<2, false, 1000> guarda de 0 a 65.535 con tres
+   * decimales.
+   *
+   * @tparam BYTES Tamaño en bytes (1 a 4).
+   * @tparam CON_SIGNO Si el campo admite negativos (complemento a 2).
+   * @tparam MULTIPLICADOR Factor por el que se multiplica el valor antes de guardarlo.
+   * @tparam ORDEN Orden de los bytes.
+   */
+  template< uint8_t BYTES, bool CON_SIGNO = false, uint32_t MULTIPLICADOR = 1, OrdenBytes ORDEN = MAYOR_PRIMERO >
+  struct Campo {
+
+	static_assert( BYTES >= 1 && BYTES <= 4, "un campo tiene de 1 a 4 bytes" );
+	static_assert( MULTIPLICADOR >= 1, "el multiplicador tiene que ser al menos 1" );
+
+	static const uint8_t TAM = BYTES;
+
+	/// Valor en crudo más pequeño que cabe.
+	static constexpr int64_t minimo() {
+	  return CON_SIGNO ? - ( (int64_t) 1 << ( 8 * BYTES - 1 ) ) : 0;
+	}
+
+	/// Valor en crudo más grande que cabe.
+	static constexpr int64_t maximo() {
+	  return CON_SIGNO ? ( (int64_t) 1 << ( 8 * BYTES - 1 ) ) - 1 : ( (int64_t) 1 << ( 8 * BYTES ) ) - 1;
+	}
+
+	/// Valor más pequeño representable.
+	static constexpr double valorMinimo() {
+	  return (double) minimo() / MULTIPLICADOR;
+	}
+
+	/// Valor más grande representable.
+	static constexpr double valorMaximo() {
+	  return (double) maximo() / MULTIPLICADOR;
+	}
+
+	// .........................................................
+	/**
+	 * @brief Escribe el valor en destino (TAM bytes).
+	 *
+	 * @return true si no cabía (o no era un número) y se ha saturado.
+	 */
+	static bool escribir( uint8_t * destino, double valor ) {
+	  double escalado = valor * MULTIPLICADOR;
+	  int64_t crudo;
+	  bool saturado = false;
+
+	  if ( escalado != escalado ) {
+		crudo = 0; // NaN
+		saturado = true;
+	  } else if ( escalado >= (double) maximo() + 0.5 ) {
+		crudo = maximo();
+		saturado = true;
+	  } else if ( escalado <= (double) minimo() - 0.5 ) {
+		crudo = minimo();
+		saturado = true;
+	  } else {
+		// redondeo al más cercano (sin llround(), que no siempre está en la placa)
+		crudo = escalado >= 0 ? (int64_t) ( escalado + 0.5 ) : - (int64_t) ( - escalado + 0.5 );
+		if ( crudo > maximo() ) crudo = maximo();
+		if ( crudo < minimo() ) crudo = minimo();
+	  }
+
+	  uint32_t bits = (uint32_t) crudo;
+	  for ( uint8_t k = 0; k < BYTES; k++ ) {
+		uint8_t byte = (uint8_t) ( bits >> ( 8 * k ) );
+		destino[ ORDEN == MAYOR_PRIMERO ? BYTES - 1 - k : k ] = byte;
+	  }
+	  return saturado;
+	} // ()
+
+	// .........................................................
+	/**
+	 * @brief Lee el valor en crudo (sin dividir por el multiplicador).
+	 */
+	static int64_t leerCrudo( const uint8_t * origen ) {
+	  uint32_t bits = 0;
+	  for ( uint8_t k = 0; k < BYTES; k++ ) {
+		bits |= (uint32_t) origen[ ORDEN == MAYOR_PRIMERO ? BYTES - 1 - k : k ] << ( 8 * k );
+	  }
+	  if ( CON_SIGNO && BYTES < 4 && ( bits & ( (uint32_t) 1 << ( 8 * BYTES - 1 ) ) ) ) {
+		bits |= ~( ( (uint32_t) 1 << ( 8 * BYTES ) ) - 1 ); // extensión de signo
+	  }
+	  return CON_SIGNO ? (int64_t) (int32_t) bits : (int64_t) bits;
+	} // ()
+
+	/**
+	 * @brief Lee el valor.
+	 */
+	static double leer( const uint8_t * origen ) {
+	  return (double) leerCrudo( origen ) / MULTIPLICADOR;
+	} // ()
+
+  }; // struct
+
+  // ----------------------------------------------------------
+  /**
+   * @brief Una trama: los campos uno detrás de otro, sin huecos.
+   *
+   * Ejemplo:
+   * @code
+   * typedef Trama< Campo<1>, Campo<2, true, 100> > MiTrama; // MiTrama::TAM == 3
+   * uint8_t bytes[MiTrama::TAM];
+   * uint32_t saturados = MiTrama::codificar( bytes, 7, -12.345 );
+   * double valores[MiTrama::NUM_CAMPOS];
+   * MiTrama::decodificar( bytes, valores ); // 7, -12.35
+   * @endcode
+   */
+  template< typename ... Campos >
+  struct Trama;
+
+  template<>
+  struct Trama<> {
+	static const uint8_t TAM = 0;
+	static const uint8_t NUM_CAMPOS = 0;
+
+	static uint32_t codificarDesde( uint8_t *, uint8_t ) {
+	  return 0;
+	}
+
+	static void decodificarDesde( const uint8_t *, double * ) {
+	}
+  }; // struct
+
+  template< typename C, typename ... Resto >
+  struct Trama< C, Resto ... > {
+
+	static const uint8_t TAM = C::TAM + Trama< Resto ... >::TAM;               ///< Bytes de la trama.
+	static const uint8_t NUM_CAMPOS = 1 + Trama< Resto ... >::NUM_CAMPOS;     ///< Número de campos.
+
+	static_assert( 1 + sizeof...( Resto ) <= 32, "como mucho 32 campos (máscara de saturados)" );
+
+	// .........................................................
+	/**
+	 * @brief Codifica los valores, uno por campo y en orden.
+	 *
+	 * @param destino TAM bytes.
+	 * @return Máscara con un 1 en el bit i si el campo i se ha saturado (0 = todo cabía).
+	 */
+	template< typename ... Valores >
+	static uint32_t codificar( uint8_t * destino, Valores ... valores ) {
+	  static_assert( sizeof...( Valores ) == NUM_CAMPOS, "hace falta un valor por campo" );
+	  return codificarDesde( destino, 0, valores ... );
+	} // ()
+
+	// .........................................................
+	/**
+	 * @brief Decodifica todos los campos.
+	 *
+	 * @param origen TAM bytes.
+	 * @param valores Un valor por campo.
+	 */
+	static void decodificar( const uint8_t * origen, double ( &valores )[NUM_CAMPOS] ) {
+	  decodificarDesde( origen, valores );
+	} // ()
+
+	// .........................................................
+	// (recursión: el primer campo y después el resto)
+	// .........................................................
+	template< typename V, typename ... Vs >
+	static uint32_t codificarDesde( uint8_t * destino, uint8_t indice, V valor, Vs ... resto ) {
+	  uint32_t saturado = C::escribir( destino, (double) valor ) ? ( (uint32_t) 1 << indice ) : 0;
+	  return saturado | Trama< Resto ... >::codificarDesde( destino + C::TAM, indice + 1, resto ... );
+	} // ()
+
+	static void decodificarDesde( const uint8_t * origen, double * valores ) {
+	  valores[0] = C::leer( origen );
+	  Trama< Resto ... >::decodificarDesde( origen + C::TAM, valores + 1 );
+	} // ()
+
+  }; // struct
+
+}; // namespace
+
+#endif
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
@@ -0,0 +1,268 @@
+/*
+ * Nombre del fichero: EstadisticasVentana.h
+ * Descripción: Estadísticas de una ventana de medidas calculadas al vuelo (mínimo, máximo, media, desviación y percentiles).
+ * Autores: agent
+ * Fecha: 18 de octubre de 2026
+ *
+ * Este archivo ha sido realizado por agent.
+ * Contiene la clase CuantilP2, que estima un percentil con el algoritmo P² (Jain y
+ * Chlamtac, 1985) sin guardar las muestras, la clase EstadisticasVentana, que acumula
+ * las medidas de un canal durante una ventana, y la estructura ResumenVentana con lo que
+ * se publica al cerrarla. Memoria fija y tiempo fijo por muestra. No depende de Arduino.
+ *
+ * Todos los derechos reservados.
+ */
+
+#ifndef ESTADISTICAS_VENTANA_H_INCLUIDO
+#define ESTADISTICAS_VENTANA_H_INCLUIDO
+
+#include <stdint.h>
+#include <math.h>
+
+// ----------------------------------------------------------
+/**
+ * @brief Resumen de una ventana cerrada.
+ *
+ * Mínimo, máximo, media y desviación son exactos; los percentiles son estimaciones.
+ */
+struct ResumenVentana {
+  uint32_t numero = 0;     ///< Muestras de la ventana.
+  uint32_t duracionMs = 0; ///< Lo que ha durado la ventana.
+  double minimo = 0;
+  double maximo = 0;
+  double media = 0;
+  double desviacion = 0;   ///< Desviación típica muestral (n - 1).
+  double p50 = 0;          ///< Mediana.
+  double p90 = 0;
+  double p99 = 0;
+}; // struct
+
+// ----------------------------------------------------------
+/**
+ * @brief Estimador P² de un percentil.
+ *
+ * Guarda 5 marcadores: el mínimo, el percentil p/2, el p, el (1+p)/2 y el máximo
+ * visto. Con cada muestra los marcadores se mueven hacia la posición que les toca
+ * y su altura se corrige con una parábola por los vecinos. Hasta la quinta muestra
+ * (incluida) el percentil es exacto.
+ */
+class CuantilP2 {
+private:
+
+  double p;
+  double altura[5];   ///< Alturas de los marcadores (las 5 primeras muestras al empezar).
+  uint32_t posicion[5]; ///< Posición de cada marcador (empieza en 1).
+  uint32_t n = 0;
+
+  // .........................................................
+  // posición en la que debería estar el marcador i con n muestras
+  // .........................................................
+  double deseada( uint8_t i ) const {
+	const double fraccion[5] = { 0, (*this).p / 2, (*this).p, ( 1 + (*this).p ) / 2, 1 };
+	return 1 + ( (*this).n - 1 ) * fraccion[i];
+  } // ()
+
+  // .........................................................
+  // altura del marcador i si se mueve d (+1 o -1) posiciones: parábola y,
+  // si se sale de los vecinos, recta
+  // .........................................................
+  double nuevaAltura( uint8_t i, int d ) const {
+	double q = altura[i], qa = altura[i-1], qs = altura[i+1];
+	double na = posicion[i-1], ni = posicion[i], ns = posicion[i+1];
+
+	double parabola = q + d / ( ns - na )
+	  * ( ( ni - na + d ) * ( qs - q ) / ( ns - ni ) + ( ns - ni - d ) * ( q - qa ) / ( ni - na ) );
+	if ( qa < parabola && parabola < qs ) {
+	  return parabola;
+	}
+	return q + d * ( altura[i+d] - q ) / ( (double) posicion[i+d] - ni );
+  } // ()
+
+public:
+
+  // .........................................................
+  /**
+   * @brief Constructor.
+   *
+   * @param p_ Percentil entre 0 y 1 (0.5 es la mediana).
+   */
+  explicit CuantilP2( double p_ ) : p( p_ ) {
+  } // ()
+
+  /**
+   * @brief Olvida todas las muestras.
+   */
+  void reiniciar() {
+	(*this).n = 0;
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Añade una muestra.
+   */
+  void anyadir( double x ) {
+	if ( (*this).n < 5 ) {
+	  // las 5 primeras se guardan ordenadas
+	  uint8_t i = (uint8_t) (*this).n;
+	  while ( i > 0 && altura[i-1] > x ) {
+		altura[i] = altura[i-1];
+		i--;
+	  }
+	  altura[i] = x;
+	  (*this).n++;
+	  if ( (*this).n == 5 ) {
+		for ( uint8_t k = 0; k < 5; k++ ) {
+		  posicion[k] = k + 1;
+		}
+	  }
+	  return;
+	}
+
+	// celda en la que cae x (los extremos se estiran si hace falta)
+	uint8_t k;
+	if ( x < altura[0] ) {
+	  altura[0] = x;
+	  k = 0;
+	} else if ( x >= altura[4] ) {
+	  altura[4] = x;
+	  k = 3;
+	} else {
+	  k = 0;
+	  while ( x >= altura[k+1] ) {
+		k++;
+	  }
+	}
+	for ( uint8_t i = k + 1; i < 5; i++ ) {
+	  posicion[i]++;
+	}
+	(*this).n++;
+
+	// los tres marcadores de en medio se acercan a donde deberían estar
+	for ( uint8_t i = 1; i <= 3; i++ ) {
+	  double d = deseada( i ) - posicion[i];
+	  if ( ( d >= 1 && posicion[i+1] - posicion[i] > 1 ) || ( d <= -1 && posicion[i] - posicion[i-1] > 1 ) ) {
+		int paso = d > 0 ? 1 : -1;
+		altura[i] = nuevaAltura( i, paso );
+		posicion[i] += paso;
+	  }
+	} // for
+  } // ()
+
+  // .........................................................
+  /**
+   * @return El percentil estimado (0 si no hay muestras).
+   */
+  double valor() const {
+	if ( (*this).n == 0 ) {
+	  return 0;
+	}
+	if ( (*this).n <= 5 ) {
+	  // exacto: la muestra más cercana en las ordenadas
+	  return altura[ (uint8_t) ( (*this).p * ( (*this).n - 1 ) + 0.5 ) ];
+	}
+	return altura[2];
+  } // ()
+
+}; // class
+
+// ----------------------------------------------------------
+/**
+ * @brief Estadísticas de las medidas de un canal durante una ventana.
+ *
+ * La media y la varianza se acumulan con el método de Welford (una pasada y sin
+ * restar números grandes parecidos). Los percentiles 50, 90 y 99 con CuantilP2.
+ * El que la usa decide cuándo se cierra la ventana: resumir() y reiniciar().
+ */
+class EstadisticasVentana {
+private:
+
+  uint32_t n = 0;
+  double minimo = 0;
+  double maximo = 0;
+  double media = 0;
+  double m2 = 0; ///< Suma de los cuadrados de las diferencias con la media.
+
+  CuantilP2 mediana { 0.5 };
+  CuantilP2 percentil90 { 0.9 };
+  CuantilP2 percentil99 { 0.99 };
+
+public:
+
+  // .........................................................
+  /**
+   * @brief Añade una medida a la ventana. Se descartan las que no son un número.
+   */
+  void anyadir( double x ) {
+	if ( x != x ) {
+	  return; // NaN
+	}
+	(*this).n++;
+	if ( (*this).n == 1 ) {
+	  (*this).minimo = x;
+	  (*this).maximo = x;
+	} else if ( x < (*this).minimo ) {
+	  (*this).minimo = x;
+	} else if ( x > (*this).maximo ) {
+	  (*this).maximo = x;
+	}
+	double delta = x - (*this).media;
+	(*this).media += delta / (*this).n;
+	(*this).m2 += delta * ( x - (*this).media );
+
+	(*this).mediana.anyadir( x );
+	(*this).percentil90.anyadir( x );
+	(*this).percentil99.anyadir( x );
+  } // ()
+
+  /**
+   * @brief Vacía la ventana para empezar la siguiente.
+   */
+  void reiniciar() {
+	(*this).n = 0;
+	(*this).media = 0;
+	(*this).m2 = 0;
+	(*this).mediana.reiniciar();
+	(*this).percentil90.reiniciar();
+	(*this).percentil99.reiniciar();
+  } // ()
+
+  uint32_t getNumero() const { return (*this).n; }
+  double getMedia() const { return (*this).media; }
+
+  /**
+   * @return Varianza muestral (0 con menos de 2 medidas).
+   */
+  double getVarianza() const {
+	return (*this).n > 1 ? (*this).m2 / ( (*this).n - 1 ) : 0;
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Resumen de lo que lleva la ventana.
+   *
+   * @param duracionMs Lo que ha durado (lo pone el que cierra la ventana).
+   */
+  ResumenVentana resumir( uint32_t duracionMs ) const {
+	ResumenVentana r;
+	r.numero = (*this).n;
+	r.duracionMs = duracionMs;
+	if ( (*this).n > 0 ) {
+	  r.minimo = (*this).minimo;
+	  r.maximo = (*this).maximo;
+	  r.media = (*this).media;
+	  r.desviacion = sqrt( getVarianza() );
+	  r.p50 = (*this).mediana.valor();
+	  r.p90 = (*this).percentil90.valor();
+	  r.p99 = (*this).percentil99.valor();
+	}
+	return r;
+  } // ()
+
+}; // class
+
+#endif
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
@@ -0,0 +1,268 @@
+/*
+ * Nombre del fichero: FiltroBloques.h
+ * Descripción: Filtro paso bajo FIR, diezmado y mediana de bloques de muestras del ADC, en coma fija.
+ * Autores: agent
+ * Fecha: 18 de octubre de 2026
+ *
+ * Este archivo ha sido realizado por agent.
+ * Contiene la clase FiltroBloques, que limpia un canal (gas o referencia) bloque a bloque:
+ * FIR paso bajo de 16 coeficientes Q15, se queda con una de cada DECIMACION muestras y
+ * quita los picos sueltos con una mediana de VENTANA_MEDIANA. En la placa el FIR y el
+ * diezmado son arm_fir_decimate_q15 de CMSIS-DSP (dos productos por instrucción con SMLALD);
+ * en el ordenador, o con SIN_CMSIS_DSP, la misma cuenta en C. Las dos suman los productos
+ * exactos en 64 bits y redondean igual, así que dan los mismos bits. Contiene también
+ * FiltroMuestra, lo mismo muestra a muestra, que es la referencia con la que se comparan
+ * (simulacion/medirFiltroBloques.cpp). No depende de Arduino.
+ *
+ * Todos los derechos reservados.
+ */
+
+#ifndef FILTRO_BLOQUES_H_INCLUIDO
+#define FILTRO_BLOQUES_H_INCLUIDO
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined( ARDUINO_ARCH_NRF52 ) && ! defined( SIN_CMSIS_DSP )
+#include <arm_math.h>
+#define FILTRO_BLOQUES_CON_CMSIS
+#endif
+
+// ----------------------------------------------------------
+/**
+ * @brief Lo que comparten FiltroBloques y FiltroMuestra: coeficientes, tamaños y mediana.
+ */
+class FiltroADC {
+public:
+
+  static const uint8_t COEFICIENTES = 16;
+  static const uint8_t DECIMACION = 4;      ///< Sale una muestra de cada 4.
+  static const uint8_t VENTANA_MEDIANA = 5; ///< Impar.
+
+protected:
+
+  /// Paso bajo con ventana de Hamming hasta 0.1125 de la frecuencia de muestreo
+  /// (-8 dB a la mitad de la frecuencia de salida, -30 dB desde 0.2). Simétrico, así que da igual
+  /// que CMSIS los quiera al revés. Suman 32768: la continua pasa sin cambiar ni un bit.
+  static const int16_t * coeficientes() {
+	static const int16_t c[COEFICIENTES] = {
+	  -93, -192, -300, -36, 1091, 3167, 5563, 7184,
+	  7184, 5563, 3167, 1091, -36, -300, -192, -93
+	};
+	return c;
+  } // ()
+
+  // .........................................................
+  // suma de productos en Q30 (64 bits) -> Q15 saturado, como arm_fir_decimate_q15
+  // .........................................................
+  static int16_t aQ15( int64_t acc ) {
+	acc >>= 15;
+	if ( acc > 32767 ) {
+	  return 32767;
+	}
+	if ( acc < -32768 ) {
+	  return -32768;
+	}
+	return (int16_t) acc;
+  } // ()
+
+  int16_t ultimas[VENTANA_MEDIANA]; ///< Últimas salidas del FIR, para la mediana.
+  uint8_t siguiente = 0;            ///< Dónde va la próxima en ultimas[].
+
+  // .........................................................
+  // mete una salida del FIR y devuelve la mediana de las últimas VENTANA_MEDIANA
+  // .........................................................
+  int16_t mediana( int16_t nueva ) {
+	(*this).ultimas[ (*this).siguiente ] = nueva;
+	(*this).siguiente = (*this).siguiente + 1 == VENTANA_MEDIANA ? 0 : (*this).siguiente + 1;
+	int16_t v[VENTANA_MEDIANA];
+	memcpy( v, (*this).ultimas, sizeof(v) );
+	for ( uint8_t i = 1; i < VENTANA_MEDIANA; i++ ) { // inserción: son 5
+	  int16_t x = v[i];
+	  int8_t j = i - 1;
+	  while ( j >= 0 && v[j] > x ) {
+		v[j + 1] = v[j];
+		j--;
+	  }
+	  v[j + 1] = x;
+	}
+	return v[ VENTANA_MEDIANA / 2 ];
+  } // ()
+
+  // .........................................................
+  // sin historia: como si siempre hubiera llegado el valor inicial
+  // .........................................................
+  void reiniciarMediana( int16_t inicial ) {
+	for ( uint8_t i = 0; i < VENTANA_MEDIANA; i++ ) {
+	  (*this).ultimas[i] = inicial;
+	}
+	(*this).siguiente = 0;
+  } // ()
+
+}; // class
+
+// ----------------------------------------------------------
+/**
+ * @brief FIR, diezmado y mediana de un canal, por bloques.
+ *
+ * Los bloques se tienen que pasar en orden (el filtro sigue de uno a otro) y su
+ * tamaño tiene que ser múltiplo de DECIMACION y como mucho MAXIMO_MUESTRAS.
+ *
+ * @section ejemplos Ejemplo de uso
+ * @code
+ * FiltroBloques filtro;
+ * filtro.reiniciar( primeraMuestra );
+ * int16_t salida[FiltroBloques::MAXIMO_MUESTRAS / FiltroBloques::DECIMACION];
+ * uint16_t n = filtro.procesar( bloque, 64, salida ); // n = 16
+ * @endcode
+ */
+class FiltroBloques : public FiltroADC {
+public:
+
+  static const uint16_t MAXIMO_MUESTRAS = 64; ///< Un bloque de AdquisicionSAADC.
+
+private:
+
+  int16_t estado[ COEFICIENTES - 1 + MAXIMO_MUESTRAS ]; ///< Las COEFICIENTES - 1 anteriores y el bloque.
+
+#ifdef FILTRO_BLOQUES_CON_CMSIS
+  arm_fir_decimate_instance_q15 fir;
+#else
+  // .........................................................
+  // arm_fir_decimate_q15 (la versión exacta, no la _fast), sin desenrollar
+  // .........................................................
+  void firDiezmado( const int16_t * entrada, int16_t * salida, uint16_t n ) {
+	const int16_t * c = coeficientes();
+	memcpy( &(*this).estado[ COEFICIENTES - 1 ], entrada, n * sizeof(int16_t) );
+	for ( uint16_t i = 0; i < n / DECIMACION; i++ ) {
+	  const int16_t * x = &(*this).estado[ i * DECIMACION ];
+	  int64_t acc = 0;
+	  for ( uint8_t k = 0; k < COEFICIENTES; k++ ) {
+		acc += (int32_t) x[k] * c[k];
+	  }
+	  salida[i] = aQ15( acc );
+	}
+	memmove( (*this).estado, &(*this).estado[n], ( COEFICIENTES - 1 ) * sizeof(int16_t) );
+  } // ()
+#endif
+
+public:
+
+  FiltroBloques() {
+	reiniciar( 0 );
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Olvida la historia: el filtro hace como si la entrada hubiera valido siempre inicial.
+   *
+   * Así la primera salida no arrastra ceros (con lecturas del ADC, que nunca son 0).
+   */
+  void reiniciar( int16_t inicial ) {
+	for ( uint16_t i = 0; i < COEFICIENTES - 1 + MAXIMO_MUESTRAS; i++ ) {
+	  (*this).estado[i] = inicial;
+	}
+	reiniciarMediana( inicial );
+#ifdef FILTRO_BLOQUES_CON_CMSIS
+	// init pone el estado a 0: las COEFICIENTES - 1 anteriores vuelven a ser inicial
+	arm_fir_decimate_init_q15( &(*this).fir, COEFICIENTES, DECIMACION, (q15_t *) coeficientes(),
+							   (*this).estado, MAXIMO_MUESTRAS );
+	for ( uint16_t i = 0; i < COEFICIENTES - 1; i++ ) {
+	  (*this).estado[i] = inicial;
+	}
+#endif
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Filtra un bloque.
+   *
+   * @param entrada Muestras del canal.
+   * @param n Cuántas (múltiplo de DECIMACION, como mucho MAXIMO_MUESTRAS).
+   * @param salida Sitio para n / DECIMACION muestras (ya con la mediana).
+   * @return Cuántas muestras ha dejado en salida.
+   */
+  uint16_t procesar( const int16_t * entrada, uint16_t n, int16_t * salida ) {
+	if ( n > MAXIMO_MUESTRAS ) {
+	  n = MAXIMO_MUESTRAS;
+	}
+	n -= n % DECIMACION;
+#ifdef FILTRO_BLOQUES_CON_CMSIS
+	arm_fir_decimate_q15( &(*this).fir, (q15_t *) entrada, salida, n );
+#else
+	firDiezmado( entrada, salida, n );
+#endif
+	uint16_t m = n / DECIMACION;
+	for ( uint16_t i = 0; i < m; i++ ) {
+	  salida[i] = mediana( salida[i] );
+	}
+	return m;
+  } // ()
+
+}; // class
+
+// ----------------------------------------------------------
+/**
+ * @brief Lo mismo que FiltroBloques, muestra a muestra (la referencia).
+ *
+ * Es la forma escalar de siempre: un buffer circular con las últimas COEFICIENTES
+ * muestras y la suma de productos cada DECIMACION muestras.
+ */
+class FiltroMuestra : public FiltroADC {
+private:
+
+  int16_t historia[COEFICIENTES]; ///< Circular: historia[posicion] es la más antigua.
+  uint8_t posicion = 0;
+  uint8_t fase = 0;               ///< Posición de la muestra en su grupo de DECIMACION.
+
+public:
+
+  FiltroMuestra() {
+	reiniciar( 0 );
+  } // ()
+
+  /**
+   * @brief Como FiltroBloques::reiniciar().
+   */
+  void reiniciar( int16_t inicial ) {
+	for ( uint8_t i = 0; i < COEFICIENTES; i++ ) {
+	  (*this).historia[i] = inicial;
+	}
+	(*this).posicion = 0;
+	(*this).fase = 0;
+	reiniciarMediana( inicial );
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Mete una muestra.
+   *
+   * @param x La muestra.
+   * @param salida Donde deja la muestra filtrada, si toca.
+   * @return true si ha salido una (con la primera muestra y luego una de cada DECIMACION).
+   */
+  bool meter( int16_t x, int16_t & salida ) {
+	(*this).historia[ (*this).posicion ] = x;
+	(*this).posicion = ( (*this).posicion + 1 ) % COEFICIENTES;
+	bool toca = (*this).fase == 0; // la primera de cada DECIMACION, como CMSIS
+	(*this).fase = ( (*this).fase + 1 ) % DECIMACION;
+	if ( ! toca ) {
+	  return false;
+	}
+	const int16_t * c = coeficientes();
+	int64_t acc = 0;
+	for ( uint8_t k = 0; k < COEFICIENTES; k++ ) {
+	  acc += (int32_t) (*this).historia[ ( (*this).posicion + k ) % COEFICIENTES ] * c[k];
+	}
+	salida = mediana( aQ15( acc ) );
+	return true;
+  } // ()
+
+}; // class
+
+#endif
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
@@ -0,0 +1,495 @@
+/*
+ * Nombre del fichero: GestorConexiones.h
+ * Descripción: Definición de la clase GestorConexiones para atender a varias centrales BLE a la vez.
+ * Autores: agent
+ * Fecha: 18 de octubre de 2026
+ *
+ * Este archivo ha sido realizado por agent.
+ * Contiene la clase GestorConexiones, que lleva la cuenta de las centrales conectadas (su
+ * connHandle, su MTU y si están suscritas a las notificaciones) y tiene para cada una una
+ * cola acotada de mensajes pendientes que se reparte por turnos, de forma que una central
+ * lenta no retrasa a las demás. Opcionalmente, vuelca a la central que lo pida (suscribiéndose
+ * a una segunda característica) todo lo que dé una fuente, a trozos tan largos como su MTU.
+ *
+ * Todos los derechos reservados.
+ */
+
+#ifndef GESTOR_CONEXIONES_H_INCLUIDO
+#define GESTOR_CONEXIONES_H_INCLUIDO
+
+#include <atomic>
+
+#include "ServicioEnEmisora.h"
+
+/**
+ * @brief Conexiones con varias centrales y colas de notificaciones por central.
+ *
+ * Los callbacks de conexión, desconexión, suscripción y fin de envío los llama la tarea de
+ * Bluefruit y sólo tocan variables atómicas. Las colas sólo las tocan encolar() y
+ * despachar(), que se llaman desde loop().
+ *
+ * Para no bloquear nunca en notify() (Bluefruit espera a que haya sitio en la cola de
+ * la SoftDevice), cada conexión tiene unos créditos: tantos como paquetes caben en esa
+ * cola (PAQUETES_EN_VUELO). Se gasta uno por notificación y se recuperan con el evento
+ * BLE_GATTS_EVT_HVN_TX_COMPLETE. Una central sin créditos simplemente se salta en ese turno.
+ *
+ * Si la cola de una central se llena se descarta el mensaje más antiguo: interesa más la
+ * última medida que una que ya ha perdido su sentido.
+ *
+ * El volcado (ver iniciarVolcado()) sólo usa los créditos que dejan los mensajes: una
+ * medida o una alarma sale antes que el trozo siguiente.
+ */
+class GestorConexiones {
+public:
+
+  static const uint8_t MAX_CONEXIONES = 4;           ///< Centrales a la vez (Bluefruit.begin()).
+  static const uint8_t CAPACIDAD_COLA = 8;           ///< Mensajes pendientes por central.
+  static const uint8_t LONGITUD_MAXIMA_MENSAJE = 20; ///< MTU por defecto (23) - 3 de cabecera ATT.
+  static const uint8_t PAQUETES_EN_VUELO = 3;        ///< Cola de notificaciones en la SoftDevice.
+  static const uint16_t MTU_POR_DEFECTO = 23;
+  static const uint8_t LONGITUD_MAXIMA_TROZO = 244;  ///< De un volcado: MTU máxima (247) - 3.
+
+  /**
+   * @brief De dónde salen los bytes de un volcado.
+   *
+   * Copia en destino el trozo que sigue al cursor (como mucho maximo bytes) y avanza el
+   * cursor, que vale 0 al empezar cada volcado. Devuelve los bytes copiados; 0 = se acabó.
+   * Si al final no se notifica (p.ej. la central se ha ido), el cursor no se guarda.
+   */
+  using FuenteVolcado = uint16_t ( uint32_t & cursor, uint8_t * destino, uint16_t maximo );
+
+  /// @brief Tipo de callback para conexión establecida.
+  using CallbackConexionEstablecida = void ( uint16_t connHandle );
+
+  /// @brief Tipo de callback para conexión terminada.
+  using CallbackConexionTerminada = void ( uint16_t connHandle, uint8_t reason );
+
+  /**
+   * @brief Estado y contadores de una conexión (copia para consultarlos).
+   */
+  struct EstadoConexion {
+	uint16_t connHandle;   ///< BLE_CONN_HANDLE_INVALID si el hueco está libre.
+	uint16_t mtu;          ///< MTU negociada.
+	bool suscrita;         ///< La central ha activado las notificaciones.
+	uint8_t pendientes;    ///< Mensajes en la cola.
+	uint32_t enviados;     ///< Notificaciones entregadas a la SoftDevice.
+	uint32_t descartados;  ///< Mensajes perdidos por tener la cola llena.
+	bool volcando;         ///< Tiene un volcado en curso.
+	uint32_t bytesVolcados; ///< Del último volcado (o del que está en curso).
+  };
+
+private:
+
+  // .........................................................
+  // hueco para una conexión
+  // .........................................................
+  struct Hueco {
+	// escritos por la tarea de Bluefruit
+	std::atomic<uint16_t> connHandle { BLE_CONN_HANDLE_INVALID };
+	std::atomic<bool> suscrita { false };
+	std::atomic<uint8_t> creditos { 0 };
+	std::atomic<uint8_t> generacion { 0 }; ///< Cambia en cada conexión (los handles se reutilizan).
+	std::atomic<bool> volcadoPedido { false }; ///< Suscrita a la característica del volcado.
+
+	// sólo desde loop()
+	uint16_t handleVisto = BLE_CONN_HANDLE_INVALID;
+	uint8_t generacionVista = 0; ///< Para notar que la conexión es otra.
+	uint16_t mtu = MTU_POR_DEFECTO;
+	uint8_t mensajes[CAPACIDAD_COLA][LONGITUD_MAXIMA_MENSAJE];
+	uint8_t longitudes[CAPACIDAD_COLA];
+	uint8_t primero = 0;
+	uint8_t cuantos = 0;
+	uint32_t enviados = 0;
+	uint32_t descartados = 0;
+	bool volcando = false;
+	bool volcadoHecho = false; ///< No se repite hasta que se vuelva a suscribir.
+	uint32_t cursorVolcado = 0;
+	uint32_t bytesVolcados = 0;
+  };
+
+  Hueco huecos[MAX_CONEXIONES];
+  uint8_t turno = 0; ///< Hueco por el que empieza el siguiente reparto.
+
+  ServicioEnEmisora::Caracteristica * laCaracteristica = nullptr;
+  uint8_t paquetesEnVuelo = PAQUETES_EN_VUELO; ///< Créditos de cada conexión.
+
+  ServicioEnEmisora::Caracteristica * laCaracteristicaVolcado = nullptr;
+  FuenteVolcado * fuenteVolcado = nullptr;
+
+  CallbackConexionEstablecida * cbEstablecida = nullptr;
+  CallbackConexionTerminada * cbTerminada = nullptr;
+
+  // los callbacks de Bluefruit son funciones sueltas: sólo puede haber un gestor activo
+  static GestorConexiones * activo;
+
+  // .........................................................
+  // .........................................................
+  Hueco * buscar( uint16_t connHandle ) {
+	for ( Hueco & h : (*this).huecos ) {
+	  if ( h.connHandle.load() == connHandle ) {
+		return &h;
+	  }
+	}
+	return nullptr;
+  } // ()
+
+  // .........................................................
+  // si el hueco es de una conexión nueva (o ya no hay conexión) se vacía la cola
+  // .........................................................
+  void sincronizar( Hueco & h ) {
+	uint16_t handle = h.connHandle.load( std::memory_order_acquire );
+	uint8_t generacion = h.generacion.load( std::memory_order_acquire );
+	if ( handle == h.handleVisto && generacion == h.generacionVista ) {
+	  return;
+	}
+	h.handleVisto = handle;
+	h.generacionVista = generacion;
+	h.primero = 0;
+	h.cuantos = 0;
+	h.mtu = MTU_POR_DEFECTO;
+	h.enviados = 0;
+	h.descartados = 0;
+	h.volcando = false;
+	h.volcadoHecho = false;
+	h.bytesVolcados = 0;
+  } // ()
+
+  // .........................................................
+  // .........................................................
+  void actualizarMtu( Hueco & h ) {
+	BLEConnection * conexion = Bluefruit.Connection( h.handleVisto );
+	if ( conexion != nullptr ) {
+	  h.mtu = conexion->getMtu();
+	}
+  } // ()
+
+  // .........................................................
+  // el siguiente trozo del volcado de esa central, si lo tiene pedido y le
+  // quedan créditos; true si ha salido
+  // .........................................................
+  bool volcarTrozo( Hueco & h ) {
+	if ( (*this).laCaracteristicaVolcado == nullptr ) {
+	  return false;
+	}
+	if ( ! h.volcadoPedido.load() ) {
+	  // se ha desuscrito (a medias o no): el siguiente volcado, cuando se vuelva a suscribir
+	  h.volcando = false;
+	  h.volcadoHecho = false;
+	  return false;
+	}
+	if ( h.volcadoHecho ) {
+	  return false;
+	}
+	if ( ! h.volcando ) {
+	  h.volcando = true;
+	  h.cursorVolcado = 0;
+	  h.bytesVolcados = 0;
+	}
+	if ( h.creditos.load() == 0 ) {
+	  return false;
+	}
+
+	actualizarMtu( h );
+	uint8_t trozo[LONGITUD_MAXIMA_TROZO];
+	uint16_t maximo = h.mtu - 3 < LONGITUD_MAXIMA_TROZO ? h.mtu - 3 : LONGITUD_MAXIMA_TROZO;
+	uint32_t cursor = h.cursorVolcado;
+	uint16_t n = (*this).fuenteVolcado( cursor, trozo, maximo );
+	if ( n == 0 ) {
+	  h.volcando = false;
+	  h.volcadoHecho = true;
+	  return false;
+	}
+	if ( ! (*this).laCaracteristicaVolcado->notificarDatos( h.handleVisto, trozo, n ) ) {
+	  return false; // se ha desconectado o desuscrito entretanto
+	}
+	h.cursorVolcado = cursor;
+	h.creditos.fetch_sub( 1 );
+	h.bytesVolcados += n;
+	return true;
+  } // ()
+
+  // .........................................................
+  // .........................................................
+  void meter( Hueco & h, const uint8_t * datos, uint8_t longitud ) {
+	if ( h.cuantos == CAPACIDAD_COLA ) {
+	  // llena: se pierde el más antiguo
+	  h.primero = ( h.primero + 1 ) % CAPACIDAD_COLA;
+	  h.cuantos--;
+	  h.descartados++;
+	}
+	uint8_t pos = ( h.primero + h.cuantos ) % CAPACIDAD_COLA;
+	uint8_t n = longitud > LONGITUD_MAXIMA_MENSAJE ? LONGITUD_MAXIMA_MENSAJE : longitud;
+	memcpy( h.mensajes[pos], datos, n );
+	h.longitudes[pos] = n;
+	h.cuantos++;
+  } // ()
+
+  // .........................................................
+  // callbacks de Bluefruit (tarea BLE)
+  // .........................................................
+  static void alConectar( uint16_t connHandle ) {
+	GestorConexiones * g = activo;
+	for ( Hueco & h : g->huecos ) {
+	  if ( h.connHandle.load() == BLE_CONN_HANDLE_INVALID ) {
+		h.suscrita.store( false );
+		h.volcadoPedido.store( false );
+		h.creditos.store( g->paquetesEnVuelo );
+		h.generacion.fetch_add( 1 );
+		h.connHandle.store( connHandle, std::memory_order_release );
+		break;
+	  }
+	}
+	if ( g->cbEstablecida != nullptr ) {
+	  g->cbEstablecida( connHandle );
+	}
+  } // ()
+
+  static void alDesconectar( uint16_t connHandle, uint8_t razon ) {
+	GestorConexiones * g = activo;
+	Hueco * h = g->buscar( connHandle );
+	if ( h != nullptr ) {
+	  h->suscrita.store( false );
+	  h->volcadoPedido.store( false );
+	  h->connHandle.store( BLE_CONN_HANDLE_INVALID, std::memory_order_release );
+	}
+	if ( g->cbTerminada != nullptr ) {
+	  g->cbTerminada( connHandle, razon );
+	}
+  } // ()
+
+  static void alCambiarSuscripcion( uint16_t connHandle, BLECharacteristic *, uint16_t valorCCCD ) {
+	Hueco * h = activo->buscar( connHandle );
+	if ( h != nullptr ) {
+	  h->suscrita.store( ( valorCCCD & BLE_GATT_HVX_NOTIFICATION ) != 0 );
+	}
+  } // ()
+
+  static void alCambiarSuscripcionVolcado( uint16_t connHandle, BLECharacteristic *, uint16_t valorCCCD ) {
+	Hueco * h = activo->buscar( connHandle );
+	if ( h != nullptr ) {
+	  h->volcadoPedido.store( ( valorCCCD & BLE_GATT_HVX_NOTIFICATION ) != 0 );
+	}
+  } // ()
+
+  static void alEvento( ble_evt_t * evento ) {
+	if ( evento->header.evt_id != BLE_GATTS_EVT_HVN_TX_COMPLETE ) {
+	  return;
+	}
+	Hueco * h = activo->buscar( evento->evt.gatts_evt.conn_handle );
+	if ( h != nullptr ) {
+	  h->creditos.fetch_add( evento->evt.gatts_evt.params.hvn_tx_complete.count );
+	}
+  } // ()
+
+public:
+
+  // .........................................................
+  /**
+   * @brief Se engancha a los callbacks de Bluefruit.
+   *
+   * Lo llama EmisoraBLE::encenderEmisora( GestorConexiones &, ... ) después de Bluefruit.begin().
+   *
+   * @param car Característica por la que se notifica (tiene que tener CHR_PROPS_NOTIFY).
+   * @param paquetes Créditos de cada conexión: el hvn_tx_queue_size de configPrphConn().
+   */
+  void iniciar( ServicioEnEmisora::Caracteristica & car, uint8_t paquetes = PAQUETES_EN_VUELO ) {
+	activo = this;
+	(*this).laCaracteristica = &car;
+	(*this).paquetesEnVuelo = paquetes;
+	car.instalarCallbackSuscripcion( alCambiarSuscripcion );
+	Bluefruit.Periph.setConnectCallback( alConectar );
+	Bluefruit.Periph.setDisconnectCallback( alDesconectar );
+	Bluefruit.setEventCallback( alEvento );
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Activa el volcado: la central que se suscriba a car recibe todo lo que dé la
+   * fuente, una vez por suscripción, con lo que sobre de sus créditos.
+   *
+   * @param car Característica del volcado (CHR_PROPS_NOTIFY, LONGITUD_MAXIMA_TROZO).
+   * @param fuente De dónde salen los trozos.
+   */
+  void iniciarVolcado( ServicioEnEmisora::Caracteristica & car, FuenteVolcado fuente ) {
+	(*this).laCaracteristicaVolcado = &car;
+	(*this).fuenteVolcado = fuente;
+	car.instalarCallbackSuscripcion( alCambiarSuscripcionVolcado );
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Callbacks que se llaman además al conectar y desconectar.
+   */
+  void instalarCallbackConexionEstablecida( CallbackConexionEstablecida cb ) {
+	(*this).cbEstablecida = cb;
+  } // ()
+
+  void instalarCallbackConexionTerminada( CallbackConexionTerminada cb ) {
+	(*this).cbTerminada = cb;
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Encola un mensaje para todas las centrales suscritas. No bloquea.
+   *
+   * @param datos Bytes del mensaje (se copian).
+   * @param longitud Hasta LONGITUD_MAXIMA_MENSAJE bytes (se recorta).
+   * @return Número de centrales a las que se ha encolado.
+   */
+  uint8_t encolar( const uint8_t * datos, uint8_t longitud ) {
+	uint8_t n = 0;
+	for ( Hueco & h : (*this).huecos ) {
+	  sincronizar( h );
+	  if ( h.handleVisto != BLE_CONN_HANDLE_INVALID && h.suscrita.load() ) {
+		meter( h, datos, longitud );
+		n++;
+	  }
+	}
+	return n;
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Como encolar(), pero el mensaje se pone el primero de cada cola.
+   *
+   * Para las alarmas: sale en el siguiente despachar() aunque haya medidas esperando.
+   *
+   * @return Número de centrales a las que se ha encolado.
+   */
+  uint8_t encolarUrgente( const uint8_t * datos, uint8_t longitud ) {
+	uint8_t n = 0;
+	for ( Hueco & h : (*this).huecos ) {
+	  sincronizar( h );
+	  if ( h.handleVisto != BLE_CONN_HANDLE_INVALID && h.suscrita.load() ) {
+		meter( h, datos, longitud );
+		// el que acaba de entrar (el último) pasa a ser el primero
+		if ( h.cuantos > 1 ) {
+		  uint8_t ultimo = ( h.primero + h.cuantos - 1 ) % CAPACIDAD_COLA;
+		  uint8_t delante = ( h.primero + CAPACIDAD_COLA - 1 ) % CAPACIDAD_COLA;
+		  if ( delante != ultimo ) {
+			memcpy( h.mensajes[delante], h.mensajes[ultimo], h.longitudes[ultimo] );
+			h.longitudes[delante] = h.longitudes[ultimo];
+		  }
+		  h.primero = delante;
+		}
+		n++;
+	  }
+	}
+	return n;
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Encola un mensaje para una central. No bloquea.
+   *
+   * @return false si esa central no está conectada.
+   */
+  bool encolar( uint16_t connHandle, const uint8_t * datos, uint8_t longitud ) {
+	for ( Hueco & h : (*this).huecos ) {
+	  sincronizar( h );
+	  if ( h.handleVisto == connHandle && connHandle != BLE_CONN_HANDLE_INVALID ) {
+		meter( h, datos, longitud );
+		return true;
+	  }
+	}
+	return false;
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Entrega a la SoftDevice todo lo que se pueda sin esperar.
+   *
+   * Reparte por turnos: un mensaje por central y vuelta, empezando cada vez por una
+   * central distinta, hasta que ninguna tenga a la vez mensajes y créditos. Una central
+   * sin mensajes pendientes recibe en su lugar el siguiente trozo de su volcado.
+   *
+   * @param maximo Notificaciones como mucho en esta llamada (acota lo que tarda).
+   * @return Notificaciones enviadas.
+   */
+  uint16_t despachar( uint16_t maximo = 0xffff ) {
+	if ( (*this).laCaracteristica == nullptr ) {
+	  return 0;
+	}
+
+	uint16_t total = 0;
+	bool algo = true;
+	while ( algo && total < maximo ) {
+	  algo = false;
+	  for ( uint8_t k = 0; k < MAX_CONEXIONES && total < maximo; k++ ) {
+		Hueco & h = (*this).huecos[ ( (*this).turno + k ) % MAX_CONEXIONES ];
+		sincronizar( h );
+		if ( h.handleVisto == BLE_CONN_HANDLE_INVALID ) {
+		  continue;
+		}
+		if ( h.cuantos == 0 ) {
+		  if ( volcarTrozo( h ) ) {
+			total++;
+			algo = true;
+		  }
+		  continue;
+		}
+		if ( ! h.suscrita.load() ) {
+		  // ha desactivado las notificaciones: lo pendiente ya no lo quiere
+		  h.descartados += h.cuantos;
+		  h.cuantos = 0;
+		  continue;
+		}
+		if ( h.creditos.load() == 0 ) {
+		  continue; // central lenta: no se la espera
+		}
+
+		actualizarMtu( h );
+		uint8_t n = h.longitudes[h.primero];
+		if ( n > h.mtu - 3 ) {
+		  n = h.mtu - 3;
+		}
+		if ( ! (*this).laCaracteristica->notificarDatos( h.handleVisto, h.mensajes[h.primero], n ) ) {
+		  continue; // se ha desconectado o desuscrito entretanto
+		}
+		h.creditos.fetch_sub( 1 );
+		h.primero = ( h.primero + 1 ) % CAPACIDAD_COLA;
+		h.cuantos--;
+		h.enviados++;
+		total++;
+		algo = true;
+	  } // for
+	  (*this).turno = ( (*this).turno + 1 ) % MAX_CONEXIONES;
+	} // while
+	return total;
+  } // ()
+
+  // .........................................................
+  /**
+   * @return Número de centrales conectadas.
+   */
+  uint8_t conectadas() const {
+	uint8_t n = 0;
+	for ( const Hueco & h : (*this).huecos ) {
+	  if ( h.connHandle.load() != BLE_CONN_HANDLE_INVALID ) {
+		n++;
+	  }
+	}
+	return n;
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Estado del hueco i (0 .. MAX_CONEXIONES-1). Sólo desde loop().
+   */
+  EstadoConexion estado( uint8_t i ) {
+	Hueco & h = (*this).huecos[i];
+	sincronizar( h );
+	return EstadoConexion { h.handleVisto, h.mtu, h.suscrita.load(), h.cuantos, h.enviados, h.descartados,
+							h.volcando, h.bytesVolcados };
+  } // ()
+
+}; // class
+
+GestorConexiones * GestorConexiones::activo = nullptr;
+
+#endif
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
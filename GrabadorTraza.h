@@ -0,0 +1,97 @@
+/*
+ * Nombre del fichero: GrabadorTraza.h
+ * Descripción: Definición de la clase GrabadorTraza para grabar las lecturas en bruto del ADC.
+ * Autores: agent
+ * Fecha: 18 de octubre de 2026
+ *
+ * Este archivo ha sido realizado por agent.
+ * Contiene la clase GrabadorTraza, que codifica las muestras (tiempo, Agas, Aref) con el
+ * formato de TrazaADC.h y las saca por el puerto serie para reproducirlas después en el
+ * ordenador (simulacion/reproducirTraza.cpp).
+ *
+ * Todos los derechos reservados.
+ */
+
+#ifndef GRABADOR_TRAZA_H_INCLUIDO
+#define GRABADOR_TRAZA_H_INCLUIDO
+
+#include "TrazaADC.h"
+
+/**
+ * @brief Graba la traza de muestras del ADC por el puerto serie.
+ *
+ * Como por el mismo puerto salen también los mensajes de texto, cada trozo de la traza
+ * va en su propia línea con el prefijo "TADC:" y en hexadecimal. Juntando en orden los
+ * bytes de todas las líneas "TADC:" se obtiene la traza binaria.
+ */
+class GrabadorTraza {
+private:
+
+  TrazaADC::Codificador codificador;
+  bool cabeceraEscrita = false;
+  const uint8_t bitsADC;
+
+  // .........................................................
+  // escribe una línea "TADC:" con los bytes en hexadecimal
+  // .........................................................
+  void escribirLinea( const uint8_t * bytes, uint8_t n ) {
+	const char HEX_DIGITOS[] = "0123456789abcdef";
+	char linea[ 1 + 5 + 2*TrazaADC::TAMANYO_MAXIMO_REGISTRO + 2 ] = "\nTADC:";
+	uint8_t i = 6;
+	for ( uint8_t k = 0; k < n; k++ ) {
+	  linea[i++] = HEX_DIGITOS[ bytes[k] >> 4 ];
+	  linea[i++] = HEX_DIGITOS[ bytes[k] & 0x0f ];
+	}
+	linea[i++] = '\n';
+	linea[i] = '\0';
+	Globales::elPuerto.escribirSiempre( linea ); // es una traza, no un mensaje: sale con cualquier nivel
+  } // ()
+
+public:
+
+  /**
+   * @brief Constructor.
+   *
+   * @param bitsADC_ Resolución del ADC con el que se leen las muestras.
+   */
+  GrabadorTraza( uint8_t bitsADC_ = 10 ) : bitsADC( bitsADC_ ) {
+  } // ()
+
+  /**
+   * @brief Vuelve a empezar: la siguiente muestra irá detrás de una cabecera nueva.
+   *
+   * Así cada trozo que se graba (p.ej. desde la consola) se puede reproducir por separado.
+   */
+  void reiniciar() {
+	(*this).codificador = TrazaADC::Codificador();
+	(*this).cabeceraEscrita = false;
+  } // ()
+
+  /**
+   * @brief Graba una muestra (la primera vez escribe también la cabecera).
+   *
+   * @param tiempo micros() de la lectura.
+   * @param Agas Lectura del pin de gas.
+   * @param Aref Lectura del pin de referencia; negativa si esa vez no se leyó (referencia
+   * lenta), y entonces se graba como TrazaADC::SIN_REFERENCIA.
+   */
+  void grabar( uint32_t tiempo, int Agas, int Aref ) {
+	uint8_t bytes[TrazaADC::TAMANYO_MAXIMO_REGISTRO];
+
+	if ( ! (*this).cabeceraEscrita ) {
+	  escribirLinea( bytes, TrazaADC::escribirCabecera( bytes, (*this).bitsADC ) );
+	  (*this).cabeceraEscrita = true;
+	}
+
+	TrazaADC::Muestra m { tiempo, (uint16_t) Agas, Aref < 0 ? TrazaADC::SIN_REFERENCIA : (uint16_t) Aref };
+	escribirLinea( bytes, (*this).codificador.codificar( m, bytes ) );
+  } // ()
+
+}; // class
+
+#endif
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
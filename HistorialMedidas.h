@@ -0,0 +1,144 @@
+/*
+ * Nombre del fichero: HistorialMedidas.h
+ * Descripción: Últimas medidas del nodo, para volcarlas por BLE a una central.
+ * Autores: agent
+ * Fecha: 18 de octubre de 2026
+ *
+ * Este archivo ha sido realizado por agent.
+ * Contiene la clase HistorialMedidas: un anillo de registros de tamaño fijo con las
+ * últimas CAPACIDAD medidas (si se llena se pisan las más antiguas) y leer(), que los
+ * saca a trozos de registros enteros con un cursor, como los pide
+ * GestorConexiones::FuenteVolcado. No depende de Arduino.
+ *
+ * Todos los derechos reservados.
+ */
+
+#ifndef HISTORIAL_MEDIDAS_H_INCLUIDO
+#define HISTORIAL_MEDIDAS_H_INCLUIDO
+
+#include <stdint.h>
+#include <string.h>
+
+// ----------------------------------------------------------
+/**
+ * @brief Anillo con las últimas medidas.
+ *
+ * Cada registro ocupa TAM_REGISTRO bytes, en big endian: millis() al medir (4) y la
+ * trama de la medida (TramasPublicador.h: id, contador y valor con su escala), o sea,
+ * lo mismo que se notifica de cada medida con el instante delante. Un volcado acaba con un registro de fin (todo 0xff).
+ *
+ * El cursor de leer() empieza en 0 en cada volcado; el volcado empieza por la medida más
+ * antigua que quede y sigue hasta alcanzar a la última, aunque entretanto lleguen más.
+ * Si mientras tanto se pisan las que faltaban por salir, se salta a la más antigua.
+ *
+ * @section ejemplos Ejemplo de uso
+ * @code
+ * HistorialMedidas historial;
+ * uint8_t medida[TramasPublicador::CO2::TAM];
+ * TramasPublicador::CO2::codificar( medida, TramasPublicador::ID_CO2, cont, ppm );
+ * historial.anyadir( millis(), medida );
+ * uint32_t cursor = 0;
+ * uint8_t trozo[240];
+ * uint16_t n;
+ * while ( ( n = historial.leer( cursor, trozo, sizeof(trozo) ) ) > 0 ) { ... }
+ * @endcode
+ */
+class HistorialMedidas {
+public:
+
+  static const uint16_t CAPACIDAD = 1024;    ///< Registros que se guardan (8 kB).
+  static const uint8_t TAM_MEDIDA = 4;      ///< La trama de la medida (TramasPublicador::CO2::TAM).
+  static const uint8_t TAM_REGISTRO = 4 + TAM_MEDIDA;
+  static const uint32_t CURSOR_FIN = 0xffffffff; ///< El registro de fin ya ha salido.
+
+private:
+
+  uint8_t registros[CAPACIDAD][TAM_REGISTRO];
+  uint32_t total = 0; ///< Registros añadidos desde el arranque (el índice del siguiente).
+
+  // .........................................................
+  // índice (desde el arranque) del registro más antiguo que queda
+  // .........................................................
+  uint32_t primero() const {
+	return (*this).total > CAPACIDAD ? (*this).total - CAPACIDAD : 0;
+  } // ()
+
+public:
+
+  // .........................................................
+  /**
+   * @brief Guarda una medida (pisa la más antigua si no cabe).
+   *
+   * @param ms millis() al medir.
+   * @param medida TAM_MEDIDA bytes: la trama de la medida, como se notifica
+   *        (TramasPublicador.h: id, contador y valor).
+   */
+  void anyadir( uint32_t ms, const uint8_t * medida ) {
+	uint8_t * r = (*this).registros[ (*this).total % CAPACIDAD ];
+	r[0] = (uint8_t) ( ms >> 24 );
+	r[1] = (uint8_t) ( ms >> 16 );
+	r[2] = (uint8_t) ( ms >> 8 );
+	r[3] = (uint8_t) ms;
+	memcpy( &r[4], medida, TAM_MEDIDA );
+	(*this).total++;
+  } // ()
+
+  // .........................................................
+  /**
+   * @return Registros guardados ahora mismo (como mucho CAPACIDAD).
+   */
+  uint16_t getNumero() const {
+	return (uint16_t) ( (*this).total - primero() );
+  } // ()
+
+  // .........................................................
+  /**
+   * @return Registros añadidos desde el arranque.
+   */
+  uint32_t getTotal() const {
+	return (*this).total;
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Saca el siguiente trozo de un volcado: tantos registros enteros como quepan.
+   *
+   * @param cursor 0 al empezar; lo avanza leer() (CURSOR_FIN cuando ya ha salido el fin).
+   * @param destino Donde se copian.
+   * @param maximo Bytes que caben en destino (al menos TAM_REGISTRO).
+   * @return Bytes copiados; 0 si el volcado ya ha acabado.
+   */
+  uint16_t leer( uint32_t & cursor, uint8_t * destino, uint16_t maximo ) {
+	if ( cursor == CURSOR_FIN ) {
+	  return 0;
+	}
+	// el cursor guarda el índice del siguiente registro más 1 (0 = empezar)
+	uint32_t siguiente = cursor == 0 ? primero() : cursor - 1;
+	if ( siguiente < primero() ) {
+	  siguiente = primero(); // se han pisado mientras tanto
+	}
+
+	uint16_t n = 0;
+	while ( siguiente < (*this).total && n + TAM_REGISTRO <= maximo ) {
+	  memcpy( &destino[n], (*this).registros[ siguiente % CAPACIDAD ], TAM_REGISTRO );
+	  n += TAM_REGISTRO;
+	  siguiente++;
+	}
+	if ( siguiente == (*this).total && n + TAM_REGISTRO <= maximo ) {
+	  memset( &destino[n], 0xff, TAM_REGISTRO );
+	  n += TAM_REGISTRO;
+	  cursor = CURSOR_FIN;
+	  return n;
+	}
+	cursor = siguiente + 1;
+	return n;
+  } // ()
+
+}; // class
+
+#endif
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
@@ -26,6 +26,147 @@
 #define PIN_VGAS 28 //!< Pin para el medidor de gas
 #define PIN_VREF 29 //!< Pin para la referencia de voltaje
 
+// Descomentar para grabar por el puerto serie la traza en bruto del ADC
+// (ver GrabadorTraza.h y simulacion/reproducirTraza.cpp)
+// #define GRABAR_TRAZA_ADC
+
+// Descomentar para medir con el SAADC por bloques (EasyDMA, sin analogRead();
+// ver AdquisicionSAADC.h) en vez de con una lectura suelta en cada vuelta
+// #define ADQUISICION_SAADC
+#define FRECUENCIA_SAADC 1000 //!< Pares de muestras (gas, referencia) por segundo
+
+// Descomentar (con ADQUISICION_SAADC) para pasar cada bloque por un FIR paso bajo, diezmado
+// y mediana en la interrupción (ver FiltroBloques.h) y medir con la última muestra filtrada
+// en vez de con la media del último bloque
+// #define FILTRAR_BLOQUES
+
+// Descomentar para medir también el ruido en dB(A) con el micrófono PDM (ver CanalRuido.h)
+// y publicarlo en cada periodo, en su propio anuncio después del de la medida
+// #define CANAL_RUIDO
+#define PIN_PDM_DATOS 34 //!< DIN del micrófono (Feather nRF52840 Sense)
+#define PIN_PDM_RELOJ 35 //!< CLK del micrófono
+
+// Descomentar para leer Vref sólo una vez cada 16 medidas y usar su valor filtrado
+// (ver ReferenciaLenta.h). No se usa al grabar trazas, que tienen que llevar las dos lecturas
+// #define REFERENCIA_LENTA
+
+// Descomentar para aceptar conexiones de varias centrales a la vez y notificarles
+// cada medida por su propia cola (ver GestorConexiones.h)
+// #define GESTIONAR_CONEXIONES
+
+// Descomentar para poder cambiar la configuración (periodo, anuncio, banda muerta y
+// calibración) por BLE y guardarla en la flash (ver Configuracion.h). Para escribirla hay
+// que emparejarse con el PIN_CONFIGURACION (enlace cifrado y autenticado); leerla, no.
+// La clave (6 cifras) no va en el código: se da al compilar (-DPIN_CONFIGURACION=\"123456\") o en
+// un #define propio antes de este bloque, sin subirlo al repositorio
+// #define CONFIGURACION_REMOTA
+#if defined( CONFIGURACION_REMOTA ) && ! defined( PIN_CONFIGURACION )
+#error "CONFIGURACION_REMOTA necesita PIN_CONFIGURACION (6 cifras, propia de cada despliegue) al compilar"
+#endif
+
+// Descomentar para el arranque de producción: se anuncia la primera medida nada más
+// encender la emisora, no se espera al puerto serie más de ESPERA_SERIE_MS (sin USB
+// la placa arranca igual) y el resto se inicia con el anuncio ya en el aire
+// #define ARRANQUE_RAPIDO
+#ifndef ESPERA_SERIE_MS
+#define ESPERA_SERIE_MS 0 //!< Espera máxima al puerto serie con ARRANQUE_RAPIDO (0 = nada)
+#endif
+
+// Descomentar para repartir el trabajo de loop() en tres tareas de FreeRTOS: adquisición
+// (la de más prioridad), publicación (la única que toca la emisora) y registro (la única
+// que escribe en el puerto serie), unidas por colas de tamaño fijo (ver Tareas.h)
+// #define TAREAS_FREERTOS
+#ifndef PERIODO_INFORME_TAREAS_MS
+#define PERIODO_INFORME_TAREAS_MS 60000 //!< Cada cuánto escribe la tarea de registro su informe
+#endif
+
+// Descomentar para vigilar el ozono también mientras se espera (una lectura cada
+// PERIODO_VIGILANCIA_MS) y, en cuanto llegue a UMBRAL_ALARMA_PPM, anunciar una alarma al
+// intervalo más corto, notificarla a las centrales y poner el LED en alarma hasta que baje
+// de UMBRAL_FIN_ALARMA_PPM (ver AlarmaOzono.h). Con TAREAS_FREERTOS sólo se mira cada medida.
+// Necesita el frontal siempre encendido: sin TAREAS_FREERTOS no se compila con ALIMENTACION_CONMUTADA
+// #define ALARMA_OZONO
+#ifndef UMBRAL_ALARMA_PPM
+#define UMBRAL_ALARMA_PPM 5.0 //!< ppm que activan la alarma (5 ppm es el IDLH del ozono)
+#endif
+#ifndef UMBRAL_FIN_ALARMA_PPM
+#define UMBRAL_FIN_ALARMA_PPM 4.0 //!< ppm por debajo de las que acaba
+#endif
+#ifndef PERIODO_VIGILANCIA_MS
+#define PERIODO_VIGILANCIA_MS 50 //!< Cada cuánto se mira el gas mientras se espera
+#endif
+
+// Descomentar para poner en la respuesta de escaneo la telemetría del nodo: versión,
+// minutos encendido, periodo medio y máximo de la vuelta, muestras y líneas perdidas y
+// huella de la configuración (ver TelemetriaNodo.h). Sólo se rehace cuando cambia algo
+// #define TELEMETRIA_ESCANEO
+#ifndef VERSION_FIRMWARE
+#define VERSION_FIRMWARE 0x0100 //!< Versión del firmware: mayor en el byte alto, menor en el bajo
+#endif
+
+// Descomentar (con GESTIONAR_CONEXIONES) para guardar las últimas medidas y volcarlas a la
+// central que se suscriba a la característica de volcado (ver HistorialMedidas.h). Mientras
+// dura el volcado se pide a esa central el perfil de rendimiento del enlace (2M PHY, paquetes
+// de 251 bytes, MTU máxima e intervalo corto) y al acabar, el de bajo consumo; de cada
+// volcado se escriben los kB/s y lo negociado (ver EmisoraBLE::pedirPerfilRendimiento())
+// #define ENLACE_RAPIDO
+#if defined( ENLACE_RAPIDO ) && ! defined( GESTIONAR_CONEXIONES )
+#undef ENLACE_RAPIDO // sin el gestor no hay volcado
+#endif
+#ifndef PERIODO_VOLCADO_MS
+#define PERIODO_VOLCADO_MS 2 //!< Cada cuánto se despacha mientras dura algún volcado
+#endif
+
+// Descomentar para poder dar órdenes por el puerto serie sin parar el nodo (ver ConsolaSerie.h):
+// tiempos de la vuelta, nivel del registro, grabar un trozo de traza del ADC, cambiar el periodo
+// y el anuncio, y un banco de pruebas de la conversión y del anuncio. Se atiende mientras se
+// espera, cada PERIODO_VIGILANCIA_MS (con TAREAS_FREERTOS, en la tarea de publicación)
+// #define CONSOLA_SERIE
+
+// Descomentar para ajustar la potencia de emisión con lo que escribe la pasarela en la
+// característica de potencia: el RSSI con que oye al nodo y cuántas copias le llegan. Se
+// sube o se baja un nivel cada vez, entre POTENCIA_MINIMA_DBM y POTENCIA_MAXIMA_DBM, buscando
+// MARGEN_POTENCIA_DB sobre la sensibilidad de la pasarela (ver ControlPotencia.h)
+// #define POTENCIA_ADAPTATIVA
+#ifndef POTENCIA_MINIMA_DBM
+#define POTENCIA_MINIMA_DBM -20 //!< Por debajo, la pasarela tendría que estar a centímetros
+#endif
+#ifndef POTENCIA_MAXIMA_DBM
+#define POTENCIA_MAXIMA_DBM 4 //!< Tope elegido: el nRF52840 llega a +8 dBm pero gasta el doble
+#endif
+#ifndef MARGEN_POTENCIA_DB
+#define MARGEN_POTENCIA_DB 10 //!< dB que se quieren por encima de la sensibilidad de la pasarela
+#endif
+#ifndef SIN_REALIMENTACION_MS
+#define SIN_REALIMENTACION_MS 60000 //!< Sin realimentación durante esto, se sube un nivel
+#endif
+
+// Descomentar para encender el frontal analógico del sensor (con PIN_ALIMENTACION_SENSOR) sólo
+// para medir: se espera a que se asiente, se leen MUESTRAS_RAFAGA pares y se apaga. Con
+// MS_ASENTAMIENTO_SENSOR a 0 la espera se aprende viendo converger las lecturas tras encender,
+// y se vuelve a aprender cada tanto (ver EncendidoSensor.h y Medidor::usarAlimentacionConmutada())
+// #define ALIMENTACION_CONMUTADA
+#if defined( ALIMENTACION_CONMUTADA ) && defined( ADQUISICION_SAADC )
+#error "ALIMENTACION_CONMUTADA lee con analogRead(): no va con ADQUISICION_SAADC, que muestrea siempre"
+#endif
+#if defined( ALIMENTACION_CONMUTADA ) && defined( ALARMA_OZONO ) && ! defined( TAREAS_FREERTOS )
+// cada vigilancia tendría que encender el frontal y esperar a que se asiente (cientos de ms):
+// ni se mira cada PERIODO_VIGILANCIA_MS ni se ahorra nada (ver medirAlimentacion.cpp)
+#error "ALIMENTACION_CONMUTADA no va con la vigilancia de ALARMA_OZONO (sí con TAREAS_FREERTOS, que mira cada medida)"
+#endif
+#ifndef PIN_ALIMENTACION_SENSOR
+#define PIN_ALIMENTACION_SENSOR 27 //!< Enciende el frontal analógico (HIGH encendido)
+#endif
+#ifndef MS_ASENTAMIENTO_SENSOR
+#define MS_ASENTAMIENTO_SENSOR 0 //!< Espera tras encender el frontal (0 = aprenderla)
+#endif
+#ifndef MUESTRAS_RAFAGA
+#define MUESTRAS_RAFAGA 8 //!< Pares (gas, referencia) que se promedian en cada encendido
+#endif
+#ifndef MS_ASENTAMIENTO_ARRANQUE
+#define MS_ASENTAMIENTO_ARRANQUE 250 //!< Con ARRANQUE_RAPIDO, espera fija de la primera medida (se aprende después)
+#endif
+
 #include "LED.h" //!< Incluye la clase para controlar el LED
 #include "PuertoSerie.h" //!< Incluye la clase para la comunicación serie
 
@@ -43,6 +184,8 @@ namespace Globales {
 #include "EmisoraBLE.h"
 #include "Publicador.h"
 #include "Medidor.h"
+#include "Configuracion.h"
+#include "EstadisticasVentana.h"
 
 // --------------------------------------------------------------
 // --------------------------------------------------------------
@@ -52,8 +195,446 @@ namespace Globales {
 
   Medidor elMedidor= Medidor(PIN_VGAS, PIN_VREF);
 
+  ConfiguracionCompartida laConfiguracionCompartida; //!< La escribe el callback BLE, la lee loop()
+
+  Configuracion laConfiguracion; //!< Copia que usa esta vuelta de loop()
+
+}; // namespace
+
+#ifdef CONFIGURACION_REMOTA
+namespace Globales {
+
+  ServicioEnEmisora elServicioConfiguracion( "CONFIG-GTI-3A" ); //!< Servicio de configuración
+
+  ServicioEnEmisora::Caracteristica laCaracteristicaConfiguracion( "CONFIG-CAMPOS-3A",
+	CHR_PROPS_READ | CHR_PROPS_WRITE, SECMODE_OPEN, SECMODE_ENC_WITH_MITM, 2 * Configuracion::LONGITUD_SERIALIZADA );
+
+  uint32_t huellaEnFlash = 0; //!< Huella de la configuración guardada (para no volver a escribirla)
+
+}; // namespace
+
+/**
+ * @brief Callback de la característica de configuración (tarea BLE).
+ * @details Sólo valida y publica; se aplica en la siguiente vuelta de loop().
+ */
+void alEscribirConfiguracion( uint16_t, BLECharacteristic *, uint8_t * datos, uint16_t longitud ) {
+  Globales::laConfiguracionCompartida.proponer( datos, longitud );
+} // ()
+#endif
+
+#ifdef GESTIONAR_CONEXIONES
+namespace Globales {
+
+  ServicioEnEmisora elServicio( "EPSG-GTI-PROY-3A" ); //!< Servicio con las lecturas
+
+  ServicioEnEmisora::Caracteristica laCaracteristicaLecturas( "LECTURAS-GTI-3A",
+	CHR_PROPS_READ | CHR_PROPS_NOTIFY, SECMODE_OPEN, SECMODE_NO_ACCESS, GestorConexiones::LONGITUD_MAXIMA_MENSAJE );
+
+  GestorConexiones elGestor; //!< Conexiones y colas de notificaciones por central
+
+}; // namespace
+#endif
+
+#ifdef ENLACE_RAPIDO
+#include "HistorialMedidas.h"
+
+namespace Globales {
+
+  ServicioEnEmisora::Caracteristica laCaracteristicaVolcado( "VOLCADO-GTI-3A",
+	CHR_PROPS_NOTIFY, SECMODE_OPEN, SECMODE_NO_ACCESS, GestorConexiones::LONGITUD_MAXIMA_TROZO );
+
+  HistorialMedidas elHistorial; //!< Lo que se vuelca
+
+}; // namespace
+
+/**
+ * @brief Fuente del volcado para el gestor (ver GestorConexiones::FuenteVolcado).
+ */
+uint16_t leerVolcado( uint32_t & cursor, uint8_t * destino, uint16_t maximo ) {
+  return Globales::elHistorial.leer( cursor, destino, maximo );
+} // ()
+#endif
+
+#ifdef ADQUISICION_SAADC
+#include "AdquisicionSAADC.h"
+
+namespace Globales {
+
+  AdquisicionSAADC laAdquisicion( PIN_VGAS, PIN_VREF, FRECUENCIA_SAADC );
+
+  int16_t elBloque[AdquisicionSAADC::VALORES_POR_BLOQUE]; //!< Copia del último bloque terminado
+
+}; // namespace
+#endif
+
+#ifdef CANAL_RUIDO
+#include "CanalRuido.h"
+
+namespace Globales {
+
+  CanalRuido elCanalRuido( PIN_PDM_DATOS, PIN_PDM_RELOJ ); //!< Micrófono de -26 dBFS a 94 dB SPL
+
+}; // namespace
+#endif
+
+#ifdef ADQUISICION_SAADC
+/**
+ * @brief Mide el gas con lo que ha muestreado el SAADC desde la medida anterior.
+ * @details Sin FILTRAR_BLOQUES, con la media del último bloque terminado; con él,
+ * con la última muestra filtrada. Lo usan loop() y la tarea de adquisición.
+ * @param valorCO2 Donde deja el gas medido.
+ * @return false si esta vez no hay nada nuevo (valorCO2 queda en 0).
+ */
+bool medirGasAdquisicion( double & valorCO2 ) {
+  using namespace Globales;
+
+  valorCO2 = 0;
+#ifdef FILTRAR_BLOQUES
+  int16_t gas, ref;
+  bool hay = laAdquisicion.obtenerFiltrado( gas, ref );
+  if ( hay ) {
+    valorCO2 = elMedidor.medirGas( (double) gas, (double) ref );
+  }
+#else
+  // sólo se procesa el último bloque terminado; mientras tanto el SAADC sigue solo
+  bool hay = laAdquisicion.obtenerBloque( elBloque );
+  if ( hay ) {
+    valorCO2 = elMedidor.medirGasBloque( elBloque, AdquisicionSAADC::MUESTRAS_POR_BLOQUE );
+  }
+#endif
+  return hay;
+} // ()
+#endif
+
+#ifdef GRABAR_TRAZA_ADC
+#include "GrabadorTraza.h"
+
+namespace Globales {
+
+  GrabadorTraza elGrabador;
+
+}; // namespace
+
+/**
+ * @brief Callback de Medidor: graba cada lectura en bruto del ADC.
+ */
+void grabarMuestraCruda( uint32_t tiempo, int Agas, int Aref ) {
+  Globales::elGrabador.grabar( tiempo, Agas, Aref );
+} // ()
+#endif
+
+#ifdef ALARMA_OZONO
+#include "AlarmaOzono.h"
+
+namespace Globales {
+
+  AlarmaOzono laAlarma( UMBRAL_ALARMA_PPM, UMBRAL_FIN_ALARMA_PPM );
+
+}; // namespace
+
+/**
+ * @brief Lee el gas para vigilar la alarma sin cambiar lo que dan las medidas.
+ * @details Sin ADQUISICION_SAADC, una lectura suelta (Medidor::vigilarGas()); con él,
+ * vacía la cola de muestras y usa la media de los últimos pares que han llegado.
+ * @param ppm Donde deja el gas.
+ * @return false si no hay nada nuevo.
+ */
+bool leerGasVigilancia( double & ppm ) {
+  using namespace Globales;
+
+#ifdef ADQUISICION_SAADC
+  const uint8_t ULTIMAS = 8; // las más recientes: poco ruido y poco retraso (8 ms a 1 kHz)
+  MuestraSAADC pares[32];
+  MuestraSAADC ultimas[ULTIMAS];
+  uint32_t total = 0;
+  uint32_t n;
+  while ( ( n = laAdquisicion.sacarMuestras( pares, 32 ) ) > 0 ) {
+    for ( uint32_t i = 0; i < n; i++ ) {
+      ultimas[ total++ % ULTIMAS ] = pares[i];
+    }
+  }
+  if ( total == 0 ) {
+    return false;
+  }
+  uint8_t cuantas = total < ULTIMAS ? total : ULTIMAS;
+  int32_t sumaGas = 0;
+  int32_t sumaRef = 0;
+  for ( uint8_t i = 0; i < cuantas; i++ ) {
+    sumaGas += ultimas[i].gas;
+    sumaRef += ultimas[i].ref;
+  }
+  ppm = elMedidor.vigilarGas( (double) sumaGas / cuantas, (double) sumaRef / cuantas );
+#else
+  ppm = elMedidor.vigilarGas();
+#endif
+  return true;
+} // ()
+
+/**
+ * @brief Hace lo que toca cuando la alarma se activa o se desactiva.
+ * @details Al activarse, el anuncio de alarma sustituye en el acto al que hubiera, se
+ * notifica a las centrales por delante de lo que tengan pendiente y el LED pasa al
+ * patrón de alarma. Al desactivarse se para todo eso y el ciclo normal sigue solo.
+ * @param cambio Lo que ha devuelto AlarmaOzono::evaluar().
+ * @param ppm La lectura que lo ha provocado.
+ * @return No devuelve ningún valor.
+ */
+void atenderAlarma( AlarmaOzono::Cambio cambio, double ppm ) {
+  using namespace Globales;
+
+  if ( cambio == AlarmaOzono::ACTIVADA ) {
+    uint8_t numero = (uint8_t) laAlarma.getActivaciones();
+    elPublicador.empezarPublicarAlarma( ppm, numero );
+    laAlarma.apuntarAnuncio( elPublicador.laEmisora.getTiempoUltimoAnuncio() );
+#ifdef GESTIONAR_CONEXIONES
+    // la misma trama que el anuncio: id, número de alarma y milésimas de ppm (big endian)
+    uint8_t mensaje[TramasPublicador::Alarma::TAM];
+    TramasPublicador::Alarma::codificar( mensaje, Publicador::ALARMA, numero, ppm );
+    elGestor.encolarUrgente( mensaje, sizeof(mensaje) );
+    elGestor.despachar();
+#endif
+    elLED.reproducir( PatronesLED::ALARMA );
+
+    elPuerto.escribir( "ALARMA: ozono (ppm) = " );
+    elPuerto.escribir( ppm );
+    elPuerto.escribir( "   latencia (us) = " );
+    elPuerto.escribir( laAlarma.getLatenciaUltimaUs() );
+    elPuerto.escribir( "\n" );
+  } else if ( cambio == AlarmaOzono::DESACTIVADA ) {
+    elPublicador.laEmisora.detenerAnuncio();
+    elLED.detener( PatronesLED::ALARMA );
+
+    elPuerto.escribir( "alarma: fin, pico (ppm) = " );
+    elPuerto.escribir( laAlarma.getPico() );
+    elPuerto.escribir( "\n" );
+  }
+} // ()
+
+/**
+ * @brief Una lectura de vigilancia.
+ * @return No devuelve ningún valor.
+ */
+void vigilarAlarma() {
+  double ppm;
+  unsigned long us = micros();
+  if ( leerGasVigilancia( ppm ) ) {
+    atenderAlarma( Globales::laAlarma.evaluar( ppm, us ), ppm );
+  }
+} // ()
+
+/**
+ * @return true mientras dura una alarma (su anuncio no se para ni se sustituye).
+ */
+inline bool alarmaActiva() {
+  return Globales::laAlarma.estaActiva();
+} // ()
+#else
+inline bool alarmaActiva() {
+  return false;
+} // ()
+#endif
+
+#ifdef ENLACE_RAPIDO
+namespace Globales {
+
+  /// @brief El perfil pedido a la central de cada hueco del gestor.
+  struct PerfilEnlace {
+    uint16_t connHandle = BLE_CONN_HANDLE_INVALID;
+    bool rapido = false;        //!< Se le ha pedido el de rendimiento (tiene un volcado)
+    unsigned long msInicio = 0; //!< millis() al empezar el volcado
+    uint32_t bytes = 0;         //!< Volcados hasta la última vez que se miró
+  }; // struct
+
+  PerfilEnlace losPerfiles[GestorConexiones::MAX_CONEXIONES];
+
+}; // namespace
+
+/**
+ * @brief Escribe cómo ha ido un volcado: bytes, kB/s y lo negociado con la central.
+ * @param connHandle La conexión.
+ * @param bytes Bytes volcados.
+ * @param ms Lo que ha durado.
+ * @return No devuelve ningún valor.
+ */
+void informarVolcado( uint16_t connHandle, uint32_t bytes, unsigned long ms ) {
+  using namespace Globales;
+
+  elPuerto.escribir( "volcado (conexión " );
+  elPuerto.escribir( connHandle );
+  elPuerto.escribir( "): " );
+  elPuerto.escribir( bytes );
+  elPuerto.escribir( " B en " );
+  elPuerto.escribir( ms );
+  elPuerto.escribir( " ms, kB/s = " );
+  elPuerto.escribir( ms > 0 ? (double) bytes / ms : 0.0 );
+  EmisoraBLE::ParametrosEnlace p;
+  if ( elPublicador.laEmisora.getParametrosEnlace( connHandle, p ) ) {
+    elPuerto.escribir( "   phy = " );
+    elPuerto.escribir( p.phy == BLE_GAP_PHY_2MBPS ? "2M" : "1M" );
+    elPuerto.escribir( "   paquetes (B) = " );
+    elPuerto.escribir( p.longitudDatos );
+    elPuerto.escribir( "   mtu = " );
+    elPuerto.escribir( p.mtu );
+    elPuerto.escribir( "   intervalo (ms) = " );
+    elPuerto.escribir( p.intervalo * 1.25 );
+  } else {
+    elPuerto.escribir( "   (desconectada)" );
+  }
+  elPuerto.escribir( "\n" );
+} // ()
+
+/**
+ * @brief Despacha y cambia el perfil del enlace de las centrales que empiezan o acaban un volcado.
+ * @details Al empezar, el perfil de rendimiento; al acabar (o desuscribirse), se escribe
+ * cómo ha ido y se pide el de bajo consumo. Si se desconecta a medias, sólo se escribe.
+ * @return true si hay algún volcado en curso (entonces hay que volver pronto).
+ */
+bool atenderEnlaces() {
+  using namespace Globales;
+
+  elGestor.despachar();
+
+  bool volcando = false;
+  for ( uint8_t i = 0; i < GestorConexiones::MAX_CONEXIONES; i++ ) {
+    GestorConexiones::EstadoConexion e = elGestor.estado( i );
+    PerfilEnlace & p = losPerfiles[i];
+    bool mismaConexion = e.connHandle == p.connHandle;
+    if ( p.rapido && mismaConexion && e.volcando ) {
+      p.bytes = e.bytesVolcados;
+    } else if ( p.rapido ) {
+      // acabado, o la central se ha ido
+      informarVolcado( p.connHandle, mismaConexion ? e.bytesVolcados : p.bytes, millis() - p.msInicio );
+      if ( mismaConexion ) {
+        elPublicador.laEmisora.pedirPerfilBajoConsumo( p.connHandle );
+      }
+      p.rapido = false;
+    }
+    if ( ! p.rapido && e.volcando ) {
+      elPublicador.laEmisora.pedirPerfilRendimiento( e.connHandle );
+      p.connHandle = e.connHandle;
+      p.rapido = true;
+      p.msInicio = millis();
+      p.bytes = e.bytesVolcados;
+    }
+    volcando = volcando || p.rapido;
+  }
+  return volcando;
+} // ()
+#endif
+
+#ifdef CONSOLA_SERIE
+void atenderConsola(); // mientras se espera
+#endif
+
+#if defined( ALARMA_OZONO ) || defined( ENLACE_RAPIDO ) || defined( CONSOLA_SERIE )
+/**
+ * @brief Como esperar(), pero mirando el gas cada PERIODO_VIGILANCIA_MS (con ALARMA_OZONO),
+ * atendiendo los volcados (con ENLACE_RAPIDO) y la consola (con CONSOLA_SERIE).
+ * @details Es lo que hace que una subida se anuncie sin esperar a la siguiente vuelta.
+ * Mientras dura algún volcado se despacha cada PERIODO_VOLCADO_MS, para que la cola de
+ * la SoftDevice no se quede vacía; si no, cada PERIODO_VIGILANCIA_MS basta para ver que
+ * una central lo ha pedido.
+ * @param ms Tiempo a esperar.
+ * @return No devuelve ningún valor.
+ */
+void esperarVigilando( unsigned long ms ) {
+  unsigned long desde = millis();
+#ifdef ALARMA_OZONO
+  unsigned long ultimaVigilancia = desde;
+  bool vigilada = false;
+#endif
+  for ( ;; ) {
+#ifdef ALARMA_OZONO
+    // la primera vez, cada PERIODO_VIGILANCIA_MS y al acabar (aunque se despache más a menudo)
+    if ( ! vigilada || millis() - ultimaVigilancia >= PERIODO_VIGILANCIA_MS || millis() - desde >= ms ) {
+      ultimaVigilancia = millis();
+      vigilada = true;
+      vigilarAlarma();
+    }
+#endif
+#ifdef CONSOLA_SERIE
+    atenderConsola();
+#endif
+    unsigned long paso = PERIODO_VIGILANCIA_MS;
+#ifdef ENLACE_RAPIDO
+    if ( atenderEnlaces() ) {
+      paso = PERIODO_VOLCADO_MS;
+    }
+#endif
+    unsigned long transcurrido = millis() - desde;
+    if ( transcurrido >= ms ) {
+      return;
+    }
+    unsigned long falta = ms - transcurrido;
+    esperar( falta < paso ? falta : paso );
+  }
+} // ()
+#else
+inline void esperarVigilando( unsigned long ms ) {
+  esperar( ms );
+} // ()
+#endif
+
+namespace Globales {
+
+  unsigned long usFinSetup = 0; //!< micros() al acabar setup()
+
+  bool arranqueInformado = false; //!< Ya se ha escrito el informe de arranque
+
 }; // namespace
 
+/**
+ * @brief Escribe cuánto ha tardado el arranque.
+ * @details Con ARRANQUE_RAPIDO puede que al acabar setup() aún no haya nadie
+ * escuchando; entonces se escribe en la primera vuelta de loop() en que lo haya.
+ * @return No devuelve ningún valor.
+ */
+void informarArranque() {
+  using namespace Globales;
+
+  elPuerto.escribir( "arranque: primer anuncio a los (us) " );
+  elPuerto.escribir( elPublicador.laEmisora.getTiempoPrimerAnuncio() );
+  elPuerto.escribir( ", fin de setup() a los (us) " );
+  elPuerto.escribir( usFinSetup );
+  elPuerto.escribir( "\n" );
+  arranqueInformado = true;
+} // ()
+
+/**
+ * @brief Enciende la emisora BLE (con el gestor de conexiones si se usa).
+ * @return No devuelve ningún valor.
+ */
+void encenderBLE() {
+#ifdef GESTIONAR_CONEXIONES
+#ifdef ENLACE_RAPIDO
+  Globales::elPublicador.laEmisora.permitirEnlaceRapido(); // MTU máxima y más paquetes en vuelo
+#endif
+  Globales::elPublicador.laEmisora.encenderEmisora( Globales::elGestor, Globales::laCaracteristicaLecturas ); // Emisora para varias centrales
+  Globales::elServicio.anyadirCaracteristica( Globales::laCaracteristicaLecturas );
+#ifdef ENLACE_RAPIDO
+  Globales::elServicio.anyadirCaracteristica( Globales::laCaracteristicaVolcado );
+  Globales::elGestor.iniciarVolcado( Globales::laCaracteristicaVolcado, leerVolcado );
+#endif
+  Globales::elServicio.activarServicio();
+#else
+  Globales::elPublicador.encenderEmisora(); // Enciende la emisora BLE
+#endif
+} // ()
+
+#ifdef TAREAS_FREERTOS
+void arrancarTareas(); // al final de setup()
+#endif
+
+#ifdef POTENCIA_ADAPTATIVA
+void iniciarPotencia(); // en setup()
+#endif
+
+#ifdef CONSOLA_SERIE
+void iniciarConsola(); // en setup()
+#endif
+
+void actualizarTelemetria( unsigned long periodoMs ); // antes de publicar cada medida
+
 /**
  * @brief Inicializa la placa 
  * @details Esta función se utiliza para realizar configuraciones iniciales
@@ -68,6 +649,20 @@ void inicializarPlaquita () {
 
 } // ()
 
+#ifdef CONFIGURACION_REMOTA
+/**
+ * @brief Publica la configuración guardada en la flash, si la hay (la que había antes de reiniciar).
+ */
+void cargarConfiguracionGuardada() {
+  InternalFS.begin();
+  Configuracion guardada;
+  if ( AlmacenConfiguracion::cargar( guardada ) ) {
+    Globales::laConfiguracionCompartida.publicar( guardada );
+    Globales::huellaEnFlash = guardada.huella();
+  }
+} // ()
+#endif
+
 /**
  * @brief Función de configuración inicial
  * details Esta función se llama una vez al inicio del programa. 
@@ -78,43 +673,1076 @@ void inicializarPlaquita () {
 
 
 void setup() {
+#ifdef ARRANQUE_RAPIDO
+  // Lo primero, anunciar: emisora, una medida y su anuncio, que sigue solo mientras se inicia lo demás
+  encenderBLE();
+  Globales::elMedidor.iniciarMedidor();
+#ifdef CONFIGURACION_REMOTA
+  cargarConfiguracionGuardada(); // el primer anuncio ya con la calibración guardada
+#endif
+  Configuracion laPrimera = Globales::laConfiguracionCompartida.leer();
+  Globales::elMedidor.ajustarCalibracion( laPrimera.getPendiente(), laPrimera.getOrdenada() ); // loop() aún no la ha aplicado
+#ifdef ALIMENTACION_CONMUTADA
+  // aprender la espera puede llevar hasta msMaximo: la primera medida no aprende
+  Globales::elMedidor.usarAlimentacionConmutada( PIN_ALIMENTACION_SENSOR,
+    EncendidoSensor( MS_ASENTAMIENTO_SENSOR > 0 ? MS_ASENTAMIENTO_SENSOR : MS_ASENTAMIENTO_ARRANQUE ), MUESTRAS_RAFAGA );
+#endif
+  Globales::elPublicador.empezarPublicarCO2( Globales::elMedidor.medirGas(), 0 );
+#if defined( ALIMENTACION_CONMUTADA ) && MS_ASENTAMIENTO_SENSOR == 0
+  Globales::elMedidor.aprenderAsentamiento(); // desde la siguiente medida, sin perder lo apuntado de esta
+#endif
+
+  Globales::elPuerto.esperarDisponible( ESPERA_SERIE_MS ); // Sin USB no se queda aquí
+#else
   Globales::elPuerto.esperarDisponible(); // Espera a que el puerto esté disponible
+#endif
 
   inicializarPlaquita(); // Llama a la función de inicialización
 
-  Globales::elPublicador.encenderEmisora(); // Enciende la emisora BLE
+#if defined( CONFIGURACION_REMOTA ) && ! defined( ARRANQUE_RAPIDO )
+  cargarConfiguracionGuardada();
+#endif
+
+#ifndef ARRANQUE_RAPIDO
+  encenderBLE(); // Enciende la emisora BLE
 
   Globales::elMedidor.iniciarMedidor(); // Inicia el medidor de gas y temperatura
+#ifdef ALIMENTACION_CONMUTADA
+  Globales::elMedidor.usarAlimentacionConmutada( PIN_ALIMENTACION_SENSOR, EncendidoSensor( MS_ASENTAMIENTO_SENSOR ), MUESTRAS_RAFAGA );
+#endif
+#endif
+
+  Globales::elLED.iniciarPatrones(); // El LED parpadea solo a partir de ahora
+
+#if defined( REFERENCIA_LENTA ) && ! defined( GRABAR_TRAZA_ADC )
+  Globales::elMedidor.usarReferenciaLenta( /* periodo = */ 16, /* desplazamiento = */ 4, /* umbralSalto = */ 8 );
+#endif
 
+#ifdef CONFIGURACION_REMOTA
+  Bluefruit.Security.setPIN( PIN_CONFIGURACION ); // lo que se escribe acaba en la flash: sólo emparejados
+  Globales::laCaracteristicaConfiguracion.instalarCallbackCaracteristicaEscrita( alEscribirConfiguracion );
+  Globales::elServicioConfiguracion.anyadirCaracteristica( Globales::laCaracteristicaConfiguracion );
+  Globales::elServicioConfiguracion.activarServicio();
+#endif
+
+#ifdef GRABAR_TRAZA_ADC
+  Globales::elMedidor.instalarCallbackMuestraCruda( grabarMuestraCruda ); // Graba la traza del ADC
+#endif
+
+#ifdef ADQUISICION_SAADC
+#ifdef FILTRAR_BLOQUES
+  Globales::laAdquisicion.filtrar( true ); // FIR, diezmado y mediana de cada bloque
+#endif
+  Globales::laAdquisicion.iniciar(); // Empieza a muestrear por bloques
+#endif
+
+#ifdef CANAL_RUIDO
+  Globales::elCanalRuido.iniciar(); // El nivel se acumula desde ya, en la interrupción del PDM
+#endif
+
+#ifdef POTENCIA_ADAPTATIVA
+  iniciarPotencia(); // La pasarela ya puede mandar realimentación
+#endif
+
+#ifdef CONSOLA_SERIE
+  iniciarConsola(); // Se atiende mientras se espera
+#endif
+
+#ifndef ARRANQUE_RAPIDO
   esperar( 1000 ); // Espera 1 segundo
+#endif
+
+  Globales::usFinSetup = micros();
 
   Globales::elPuerto.escribir( "---- setup(): fin ---- \n " ); // Indica el fin de la configuración
+
+  if ( Globales::elPuerto.disponible() ) {
+    informarArranque();
+  }
+
+#ifdef TAREAS_FREERTOS
+  arrancarTareas(); // a partir de aquí loop() no hace nada
+#endif
 } // setup ()
 
 /**
  * @brief Función para controlar el parpadeo del LED
- * @details Esta función enciende y apaga el LED en diferentes patrones 
- * para indicar actividad del programa.
+ * @details Pide el patrón de "anunciando" (tres destellos cortos y uno largo)
+ * para indicar actividad del programa. No bloquea: el patrón lo hace avanzar
+ * el temporizador del LED mientras se mide y se anuncia.
  * @return No devuelve ningún valor.
  */
 
 inline void lucecitas() {
-  using namespace Globales;
-
-  elLED.brillar( 100 ); // 100 encendido
-  esperar ( 400 ); //  100 apagado
-  elLED.brillar( 100 ); // 100 encendido
-  esperar ( 400 ); //  100 apagado
-  Globales::elLED.brillar( 100 ); // 100 encendido
-  esperar ( 400 ); //  100 apagado
-  Globales::elLED.brillar( 1000 ); // 1000 encendido
-  esperar ( 1000 ); //  100 apagado
+  Globales::elLED.reproducir( PatronesLED::ANUNCIANDO ); // si ya suena, no hace nada
 } // ()
 
 namespace Loop {
   uint8_t cont = 0;
+  unsigned long inicioAnterior = 0; //!< millis() al empezar la vuelta anterior
+  uint32_t versionConfiguracion = 0xffffffff; //!< Versión de la configuración aplicada
+  bool hayPublicado = false;
+  double ultimoPublicado = 0; //!< Para la banda muerta
+  uint8_t contPublicado = 0; //!< Contador de la última medida publicada
+
+  EstadisticasVentana ventanaGas; //!< Medidas de gas de la ventana en curso
+  EstadisticasVentana ventanaTemperatura; //!< Medidas de temperatura de la ventana en curso
+  bool ventanaAbierta = false;
+  unsigned long inicioVentana = 0; //!< millis() al abrir la ventana en curso
+  uint8_t numeroVentana = 0; //!< Ventanas cerradas (va en el resumen)
+  bool hayResumen = false; //!< Ya se ha cerrado alguna ventana
+  ResumenVentana resumenGas; //!< Resumen de la última ventana cerrada
+  ResumenVentana resumenTemperatura;
 };
 
+/**
+ * @brief Cierra la ventana de estadísticas si ya ha durado lo configurado.
+ * @details Se guarda el resumen de cada canal, que es lo que se publica
+ * hasta que se cierre la siguiente.
+ * @param ahora millis() al empezar la vuelta.
+ * @return true si hay un resumen para publicar.
+ */
+bool cerrarVentanaSiToca( unsigned long ahora ) {
+  using namespace Loop;
+
+  if ( ! ventanaAbierta ) {
+    ventanaAbierta = true;
+    inicioVentana = ahora;
+  }
+  unsigned long duracion = ahora - inicioVentana;
+  if ( duracion >= Globales::laConfiguracion.duracionVentanaMs && ventanaGas.getNumero() > 0 ) {
+    resumenGas = ventanaGas.resumir( duracion );
+    resumenTemperatura = ventanaTemperatura.resumir( duracion );
+    ventanaGas.reiniciar();
+    ventanaTemperatura.reiniciar();
+    inicioVentana = ahora;
+    numeroVentana++;
+    hayResumen = true;
+  }
+  return hayResumen;
+} // ()
+
+/**
+ * @brief Descarta la ventana en curso y el último resumen (al quitar las ventanas).
+ * @return No devuelve ningún valor.
+ */
+void olvidarVentana() {
+  using namespace Loop;
+
+  ventanaGas.reiniciar();
+  ventanaTemperatura.reiniciar();
+  ventanaAbierta = false;
+  hayResumen = false;
+} // ()
+
+/**
+ * @brief Aplica la configuración si ha cambiado desde la vuelta anterior.
+ * @details Se lee una copia entera (nunca a medias) y se pasa al medidor y a la
+ * emisora; el anuncio en curso no se toca, el cambio vale para el siguiente.
+ * @return No devuelve ningún valor.
+ */
+void aplicarConfiguracion() {
+  using namespace Globales;
+
+  uint32_t version;
+  Configuracion c = laConfiguracionCompartida.leer( &version );
+  if ( version == Loop::versionConfiguracion ) {
+    return;
+  }
+  Loop::versionConfiguracion = version;
+  laConfiguracion = c;
+
+#ifndef TAREAS_FREERTOS
+  elMedidor.ajustarCalibracion( c.getPendiente(), c.getOrdenada() ); // con tareas, la aplica adquisición
+#endif
+  elPublicador.laEmisora.ajustarIntervaloAnuncio( c.intervaloAnuncio );
+
+#ifdef CONFIGURACION_REMOTA
+  uint8_t bytes[Configuracion::LONGITUD_SERIALIZADA];
+  laCaracteristicaConfiguracion.escribirDatos( bytes, c.serializar( bytes ) ); // lo que leen las centrales
+
+  uint32_t huella = c.huella();
+  if ( version != 0 && huella != huellaEnFlash ) {
+    AlmacenConfiguracion::guardar( c ); // aquí se puede tardar; en el callback BLE no
+    huellaEnFlash = huella;
+  }
+#endif
+
+  elPuerto.escribir( "configuración: periodo (ms) = " );
+  elPuerto.escribir( c.periodoPublicacionMs );
+  elPuerto.escribir( "\n" );
+} // ()
+
+/**
+ * @brief Empieza a publicar una medida y la apunta en la ventana.
+ * @details Con ventanas, el resumen de la última cerrada (gas y temperatura, una
+ * vuelta cada uno); sin ellas, el gas si se sale de la banda muerta. Lo usan
+ * loop() y la tarea de publicación, que son los que paran el anuncio.
+ * @param cont Contador de la medida.
+ * @param valorCO2 Gas medido.
+ * @param hayMedidaGas false si esta vez no hay gas (SAADC sin bloque terminado): entonces
+ * no se publica ni se notifica el gas (valorCO2 no vale nada).
+ * @param valorTemperatura Temperatura medida.
+ * @param inicio millis() al medir.
+ * @return true si ha empezado un anuncio.
+ */
+bool empezarPublicarMedida( uint8_t cont, double valorCO2, bool hayMedidaGas, int valorTemperatura, unsigned long inicio ) {
+  using namespace Loop;
+  using namespace Globales;
+
+  bool anunciando = false;
+  bool conVentanas = laConfiguracion.duracionVentanaMs != 0;
+  if ( ! conVentanas && ventanaAbierta ) {
+    olvidarVentana();
+  }
+#ifdef ALARMA_OZONO
+  if ( alarmaActiva() ) {
+    // La alarma sigue en el aire hasta que el gas baje: se actualiza con la medida
+    if ( hayMedidaGas ) {
+      elPublicador.empezarPublicarAlarma( valorCO2, (uint8_t) laAlarma.getActivaciones() );
+    }
+    anunciando = true;
+  } else
+#endif
+  if ( conVentanas && cerrarVentanaSiToca( inicio ) ) {
+    // Publica el resumen de la última ventana: gas y temperatura, una vuelta cada uno
+    if ( cont % 2 == 1 ) {
+      elPublicador.empezarPublicarResumen( Publicador::CO2, numeroVentana, resumenGas );
+    } else {
+      elPublicador.empezarPublicarResumen( Publicador::TEMPERATURA, numeroVentana, resumenTemperatura );
+    }
+    anunciando = true;
+  } else if ( hayMedidaGas && ( ! hayPublicado || fabs( valorCO2 - ultimoPublicado ) >= laConfiguracion.getBandaMuerta() ) ) {
+    // Publica el valor de CO2 si se sale de la banda muerta (y, con ventanas, hasta que se cierre la primera)
+    elPublicador.empezarPublicarCO2( valorCO2, cont );
+    hayPublicado = true;
+    ultimoPublicado = valorCO2;
+    contPublicado = cont;
+    anunciando = true;
+  }
+
+#ifdef GESTIONAR_CONEXIONES
+  if ( hayMedidaGas ) {
+    // y a las centrales conectadas: la misma trama que el anuncio (id, contador y milésimas de ppm)
+    uint8_t mensaje[TramasPublicador::CO2::TAM];
+    TramasPublicador::CO2::codificar( mensaje, Publicador::CO2, cont, valorCO2 );
+    elGestor.encolar( mensaje, sizeof(mensaje) );
+    elGestor.despachar();
+#ifdef ENLACE_RAPIDO
+    elHistorial.anyadir( inicio, mensaje ); // para el próximo volcado
+#endif
+  }
+#endif
+
+  if ( conVentanas ) {
+    if ( hayMedidaGas ) {
+      ventanaGas.anyadir( valorCO2 ); // cuentan para la ventana que sigue abierta
+    }
+    ventanaTemperatura.anyadir( valorTemperatura );
+  }
+  return anunciando;
+} // ()
+
+#ifdef CANAL_RUIDO
+/**
+ * @brief Empieza a publicar el nivel de ruido desde la publicación anterior.
+ * @details Lo usan loop() y la tarea de publicación, después del anuncio de la medida.
+ * @param cont Contador de la medida.
+ * @return true si ha empezado un anuncio (false si no ha terminado ningún bloque de audio).
+ */
+bool empezarPublicarRuido( uint8_t cont ) {
+  using namespace Globales;
+
+  double db;
+  if ( ! elCanalRuido.tomarNivel( db ) ) {
+    return false;
+  }
+  elPublicador.empezarPublicarRuido( db, cont );
+
+  elPuerto.escribir( "ruido (dBA) = " );
+  elPuerto.escribir( db );
+  elPuerto.escribir( "\n" );
+  return true;
+} // ()
+#endif
+
+#ifdef POTENCIA_ADAPTATIVA
+#include "ControlPotencia.h"
+
+namespace Globales {
+
+  ServicioEnEmisora elServicioPotencia( "POTENCIA-GTI-3A" ); //!< Servicio de la realimentación de potencia
+
+  ServicioEnEmisora::Caracteristica laCaracteristicaPotencia( "REALIM-POT-3A",
+	CHR_PROPS_WRITE, SECMODE_NO_ACCESS, SECMODE_OPEN, Realimentacion::LONGITUD );
+
+  BuzonRealimentacion elBuzonPotencia; //!< La deja el callback BLE, la recoge quien publica
+
+  ControlPotencia elControlPotencia( POTENCIA_MINIMA_DBM, POTENCIA_MAXIMA_DBM, MARGEN_POTENCIA_DB,
+									 SIN_REALIMENTACION_MS );
+
+}; // namespace
+
+/**
+ * @brief Callback de la característica de potencia (tarea BLE).
+ * @details Sólo la deja en el buzón; se decide con ella en la siguiente vuelta.
+ */
+void alEscribirRealimentacion( uint16_t, BLECharacteristic *, uint8_t * datos, uint16_t longitud ) {
+  Globales::elBuzonPotencia.dejar( datos, longitud );
+} // ()
+
+/**
+ * @brief Añade el servicio de la realimentación de potencia.
+ * @return No devuelve ningún valor.
+ */
+void iniciarPotencia() {
+  Globales::laCaracteristicaPotencia.instalarCallbackCaracteristicaEscrita( alEscribirRealimentacion );
+  Globales::elServicioPotencia.anyadirCaracteristica( Globales::laCaracteristicaPotencia );
+  Globales::elServicioPotencia.activarServicio();
+} // ()
+
+/**
+ * @return Anuncios que se emiten de cada trama con la configuración actual.
+ */
+uint32_t eventosPorTrama() {
+  const Configuracion & c = Globales::laConfiguracion;
+  uint32_t us = (uint32_t) c.intervaloAnuncio * 625;
+  return us > 0 ? (uint32_t) c.duracionAnuncioMs * 1000 / us : 1;
+} // ()
+
+/**
+ * @brief Decide la potencia con la realimentación que haya llegado (o con su falta).
+ * @details Lo que cambie se aplica al siguiente anuncio. Lo usan loop() y la tarea de
+ * publicación, que son los que tocan la emisora.
+ * @return No devuelve ningún valor.
+ */
+void atenderPotencia() {
+  using namespace Globales;
+
+  Realimentacion r;
+  bool cambiada;
+  if ( elBuzonPotencia.tomar( r ) ) {
+    cambiada = elControlPotencia.evaluar( r, millis(), eventosPorTrama() );
+
+    elPuerto.escribir( "potencia: rssi (dBm) = " );
+    elPuerto.escribir( (int) r.rssi );
+    elPuerto.escribir( "   oídas (%) = " );
+    elPuerto.escribir( (int) elControlPotencia.getEntrega() );
+    elPuerto.escribir( "   nivel (dBm) = " );
+    elPuerto.escribir( (int) elControlPotencia.getPotencia() );
+    elPuerto.escribir( "   uJ por trama entregada = " );
+    elPuerto.escribir( elControlPotencia.getEnergiaPorTrama() / 1000.0 );
+    elPuerto.escribir( "\n" );
+  } else {
+    cambiada = elControlPotencia.vigilar( millis() );
+  }
+  if ( cambiada ) {
+    elPublicador.laEmisora.ajustarPotencia( elControlPotencia.getPotencia() );
+  }
+} // ()
+
+/**
+ * @brief Apunta, para la energía por trama, un anuncio que se acaba de parar.
+ * @return No devuelve ningún valor.
+ */
+void anotarAnuncio() {
+  Globales::elControlPotencia.anotarAnuncio( eventosPorTrama() );
+} // ()
+#else
+inline void atenderPotencia() {
+} // ()
+
+inline void anotarAnuncio() {
+} // ()
+#endif
+
+#ifdef CONSOLA_SERIE
+#include "ConsolaSerie.h"
+#include "GrabadorTraza.h"
+
+void escribirConsola( const char * texto );
+
+namespace Globales {
+
+  ConsolaSerie laConsola( escribirConsola );
+
+  EstadisticaTiempo tiempoVuelta;      //!< ms entre medidas
+  EstadisticaTiempo tiempoMedida;      //!< us de medir el gas y la temperatura
+  EstadisticaTiempo tiempoPublicacion; //!< us de empezar a publicar una medida
+  EstadisticaTiempo tiempoConsola;     //!< us de atender la consola sin ejecutar ninguna orden
+
+#if ! defined( GRABAR_TRAZA_ADC ) && ! defined( ADQUISICION_SAADC )
+  GrabadorTraza elGrabadorConsola;
+  std::atomic<uint32_t> muestrasTrazaPedidas { 0 }; //!< Las pide la consola; las recoge el callback
+  uint32_t muestrasTrazaQuedan = 0;                 //!< Sólo las toca el callback
+#endif
+
+}; // namespace
+
+/**
+ * @brief Por donde contesta la consola: siempre sale, sea cual sea el nivel del registro.
+ */
+void escribirConsola( const char * texto ) {
+  Globales::elPuerto.escribirSiempre( texto );
+} // ()
+
+/**
+ * @brief De donde lee la consola: el siguiente byte recibido, o -1.
+ */
+int leerConsola() {
+  return Globales::elPuerto.leer();
+} // ()
+
+#if ! defined( GRABAR_TRAZA_ADC ) && ! defined( ADQUISICION_SAADC )
+/**
+ * @brief Callback de Medidor: graba las lecturas en bruto que haya pedido la orden traza.
+ * @details La petición se recoge aquí, en la tarea que mide, para que la cabecera y las
+ * muestras salgan de un solo sitio.
+ */
+void grabarMuestraConsola( uint32_t tiempo, int Agas, int Aref ) {
+  using namespace Globales;
+
+  uint32_t pedidas = muestrasTrazaPedidas.exchange( 0, std::memory_order_relaxed );
+  if ( pedidas > 0 ) {
+    elGrabadorConsola.reiniciar(); // una traza nueva, con su cabecera
+    muestrasTrazaQuedan = pedidas;
+  }
+  if ( muestrasTrazaQuedan > 0 ) {
+    elGrabadorConsola.grabar( tiempo, Agas, Aref );
+    muestrasTrazaQuedan--;
+  }
+} // ()
+#endif
+
+void ordenAyuda( uint8_t, char * const * ) {
+  escribirConsola( "órdenes:\n" );
+  Globales::laConsola.escribirAyuda();
+} // ()
+
+/**
+ * @brief Escribe una línea de la orden tiempos.
+ */
+void escribirTiempo( const char * nombre, const EstadisticaTiempo & t ) {
+  using namespace Globales;
+
+  elPuerto.escribirSiempre( "tiempos: " );
+  elPuerto.escribirSiempre( nombre );
+  elPuerto.escribirSiempre( "   n = " );
+  elPuerto.escribirSiempre( t.getNumero() );
+  elPuerto.escribirSiempre( "   media = " );
+  elPuerto.escribirSiempre( t.getMedia() );
+  elPuerto.escribirSiempre( "   mín = " );
+  elPuerto.escribirSiempre( t.getMinimo() );
+  elPuerto.escribirSiempre( "   máx = " );
+  elPuerto.escribirSiempre( t.getMaximo() );
+  elPuerto.escribirSiempre( "\n" );
+} // ()
+
+void ordenTiempos( uint8_t n, char * const * argumentos ) {
+  using namespace Globales;
+
+  if ( n >= 1 && strcmp( argumentos[0], "borrar" ) == 0 ) {
+    tiempoVuelta.reiniciar();
+    tiempoMedida.reiniciar();
+    tiempoPublicacion.reiniciar();
+    tiempoConsola.reiniciar();
+    escribirConsola( "tiempos: borrados\n" );
+    return;
+  }
+  escribirTiempo( "vuelta (ms)", tiempoVuelta );
+  escribirTiempo( "medida (us)", tiempoMedida );
+  escribirTiempo( "publicación (us)", tiempoPublicacion );
+  escribirTiempo( "consola (us)", tiempoConsola );
+  elPuerto.escribirSiempre( "tiempos: órdenes = " );
+  elPuerto.escribirSiempre( laConsola.getLineas() );
+  elPuerto.escribirSiempre( "   desconocidas = " );
+  elPuerto.escribirSiempre( laConsola.getDesconocidas() );
+  elPuerto.escribirSiempre( "   largas = " );
+  elPuerto.escribirSiempre( laConsola.getLargas() );
+  elPuerto.escribirSiempre( "\n" );
+} // ()
+
+void ordenRegistro( uint8_t n, char * const * argumentos ) {
+  using namespace Globales;
+
+  if ( n >= 1 ) {
+    uint32_t nivel;
+    if ( ! ConsolaSerie::leerNumero( argumentos[0], nivel ) || nivel > PuertoSerie::TODO ) {
+      escribirConsola( "registro: [0 nada, 1 avisos, 2 todo]\n" );
+      return;
+    }
+    elPuerto.ajustarNivel( (uint8_t) nivel );
+#ifndef TAREAS_FREERTOS
+    elMedidor.silenciar( nivel < PuertoSerie::TODO ); // con tareas ya está callado
+#endif
+  }
+  elPuerto.escribirSiempre( "registro: nivel = " );
+  elPuerto.escribirSiempre( elPuerto.getNivel() );
+  elPuerto.escribirSiempre( "\n" );
+} // ()
+
+#if defined( GRABAR_TRAZA_ADC )
+void ordenTraza( uint8_t, char * const * ) {
+  escribirConsola( "traza: con GRABAR_TRAZA_ADC ya se graba entera\n" );
+} // ()
+#elif defined( ADQUISICION_SAADC )
+void ordenTraza( uint8_t, char * const * ) {
+  escribirConsola( "traza: con ADQUISICION_SAADC no hay lecturas sueltas que grabar\n" );
+} // ()
+#else
+void ordenTraza( uint8_t n, char * const * argumentos ) {
+  uint32_t muestras;
+  if ( n < 1 || ! ConsolaSerie::leerNumero( argumentos[0], muestras ) || muestras == 0 ) {
+    escribirConsola( "traza: <muestras> (una por medida)\n" );
+    return;
+  }
+  Globales::muestrasTrazaPedidas.store( muestras, std::memory_order_relaxed );
+  Globales::elPuerto.escribirSiempre( "traza: " );
+  Globales::elPuerto.escribirSiempre( muestras );
+  Globales::elPuerto.escribirSiempre( " muestras en las líneas TADC: (reproducirTraza)\n" );
+} // ()
+#endif
+
+/**
+ * @brief Cambia un campo de la configuración como si llegara por BLE.
+ * @details Pasa por ConfiguracionCompartida::proponer(), que la valida entera; si
+ * justo entonces está proponiendo el callback BLE, no vale y hay que repetirla.
+ * @param nombre El de la orden, para la contestación.
+ * @param campo Configuracion::Campo.
+ * @param tam Bytes del campo (2 o 4).
+ */
+void proponerCampo( const char * nombre, uint8_t campo, uint8_t tam, uint8_t n, char * const * argumentos ) {
+  using namespace Globales;
+
+  uint32_t v;
+  if ( n < 1 || ! ConsolaSerie::leerNumero( argumentos[0], v ) || ( tam == 2 && v > 0xffff ) ) {
+    elPuerto.escribirSiempre( nombre );
+    elPuerto.escribirSiempre( ": falta el valor, o no cabe\n" );
+    return;
+  }
+  uint8_t datos[5] = { campo, (uint8_t) v, (uint8_t) ( v >> 8 ), (uint8_t) ( v >> 16 ), (uint8_t) ( v >> 24 ) };
+  bool vale = laConfiguracionCompartida.proponer( datos, 1 + tam );
+  elPuerto.escribirSiempre( nombre );
+  elPuerto.escribirSiempre( vale ? ": vale, desde la vuelta siguiente\n" : ": no vale\n" );
+} // ()
+
+void ordenPeriodo( uint8_t n, char * const * argumentos ) {
+  proponerCampo( "periodo", Configuracion::PERIODO_PUBLICACION, 4, n, argumentos );
+} // ()
+
+void ordenAnuncio( uint8_t n, char * const * argumentos ) {
+  proponerCampo( "anuncio", Configuracion::DURACION_ANUNCIO, 2, n, argumentos );
+} // ()
+
+void ordenIntervalo( uint8_t n, char * const * argumentos ) {
+  proponerCampo( "intervalo", Configuracion::INTERVALO_ANUNCIO, 2, n, argumentos );
+} // ()
+
+/**
+ * @brief Escribe una línea de la orden banco.
+ */
+void escribirBanco( const char * nombre, unsigned long us, uint32_t veces ) {
+  using namespace Globales;
+
+  elPuerto.escribirSiempre( "banco: " );
+  elPuerto.escribirSiempre( nombre );
+  elPuerto.escribirSiempre( "   veces = " );
+  elPuerto.escribirSiempre( veces );
+  elPuerto.escribirSiempre( "   us = " );
+  elPuerto.escribirSiempre( us );
+  elPuerto.escribirSiempre( "   us por vez = " );
+  elPuerto.escribirSiempre( (double) us / veces );
+  elPuerto.escribirSiempre( "\n" );
+} // ()
+
+const uint32_t MAXIMO_ANUNCIOS_BANCO = 20; //!< Cada anuncio reiniciado es una repetición en el aire
+
+/**
+ * @brief Banco de pruebas: cronometra la conversión, la trama y el anuncio.
+ * @details La conversión, con una copia callada del medidor y lecturas inventadas (sin
+ * tocar el ADC); la trama, codificando la del CO2; el anuncio, parándolo y volviéndolo a
+ * empezar con la última medida publicada (mismo contador: la pasarela lo toma por una
+ * repetición), sólo entre anuncios y sin alarma, y como mucho MAXIMO_ANUNCIOS_BANCO veces.
+ */
+void ordenBanco( uint8_t n, char * const * argumentos ) {
+  using namespace Globales;
+
+  uint32_t veces = 1000;
+  if ( n >= 1 && ( ! ConsolaSerie::leerNumero( argumentos[0], veces ) || veces == 0 || veces > 100000 ) ) {
+    escribirConsola( "banco: [veces] (de 1 a 100000)\n" );
+    return;
+  }
+
+  Medidor copia = elMedidor;
+  copia.silenciar( true );
+  volatile double suma = 0;
+  unsigned long desde = micros();
+  for ( uint32_t i = 0; i < veces; i++ ) {
+    suma = suma + copia.medirGas( 400.0 + ( i & 63 ), 600.0 );
+  }
+  escribirBanco( "conversión", micros() - desde, veces );
+
+  uint8_t trama[TramasPublicador::CO2::TAM];
+  desde = micros();
+  for ( uint32_t i = 0; i < veces; i++ ) {
+    TramasPublicador::CO2::codificar( trama, Publicador::CO2, (uint8_t) i, ( i & 1023 ) / 100.0 );
+    suma = suma + trama[3];
+  }
+  escribirBanco( "trama", micros() - desde, veces );
+
+  if ( ! Loop::hayPublicado || alarmaActiva() || elPublicador.laEmisora.estaAnunciando() ) {
+    escribirConsola( "banco: el anuncio, sólo entre anuncios (y con alguna medida publicada)\n" );
+    return;
+  }
+  uint32_t anuncios = veces < MAXIMO_ANUNCIOS_BANCO ? veces : MAXIMO_ANUNCIOS_BANCO;
+  desde = micros();
+  for ( uint32_t i = 0; i < anuncios; i++ ) {
+    elPublicador.empezarPublicarCO2( Loop::ultimoPublicado, Loop::contPublicado );
+    elPublicador.laEmisora.detenerAnuncio();
+  }
+  escribirBanco( "anuncio", micros() - desde, anuncios );
+} // ()
+
+#ifdef POTENCIA_ADAPTATIVA
+void ordenPotencia( uint8_t, char * const * ) {
+  using namespace Globales;
+
+  const ControlPotencia & c = elControlPotencia;
+  elPuerto.escribirSiempre( "potencia: nivel (dBm) = " );
+  elPuerto.escribirSiempre( (int) c.getPotencia() );
+  elPuerto.escribirSiempre( " de " );
+  elPuerto.escribirSiempre( (int) c.getMinimo() );
+  elPuerto.escribirSiempre( " a " );
+  elPuerto.escribirSiempre( (int) c.getMaximo() );
+  elPuerto.escribirSiempre( "   cambios = " );
+  elPuerto.escribirSiempre( c.getCambios() );
+  elPuerto.escribirSiempre( "   setTxPower() = " );
+  elPuerto.escribirSiempre( elPublicador.laEmisora.getPotenciasAplicadas() );
+  elPuerto.escribirSiempre( "\npotencia: margen (dB) = " );
+  elPuerto.escribirSiempre( (int) c.getMargen() );
+  elPuerto.escribirSiempre( "   oídas (%) = " );
+  elPuerto.escribirSiempre( (int) c.getEntrega() );
+  elPuerto.escribirSiempre( "   uJ por trama entregada = " );
+  elPuerto.escribirSiempre( c.getEnergiaPorTrama() / 1000.0 );
+  elPuerto.escribirSiempre( "   mJ en " );
+  elPuerto.escribirSiempre( c.getTramas() );
+  elPuerto.escribirSiempre( " tramas = " );
+  elPuerto.escribirSiempre( c.getEnergiaTotal() / 1000000.0 );
+  elPuerto.escribirSiempre( "\n" );
+} // ()
+#endif
+
+#ifdef ALIMENTACION_CONMUTADA
+void ordenSensor( uint8_t, char * const * ) {
+  using namespace Globales;
+
+  const EncendidoSensor & e = elMedidor.getEncendido();
+  elPuerto.escribirSiempre( "sensor: espera (ms) = " );
+  elPuerto.escribirSiempre( e.getMsAsentamiento() );
+  if ( e.getAprende() ) {
+    elPuerto.escribirSiempre( "   aprendida de " );
+    elPuerto.escribirSiempre( e.getUltimoAsentamiento() );
+    elPuerto.escribirSiempre( " ms   aprendizajes = " );
+    elPuerto.escribirSiempre( e.getAprendizajes() );
+    elPuerto.escribirSiempre( "   sin converger = " );
+    elPuerto.escribirSiempre( e.getSinConverger() );
+  }
+  elPuerto.escribirSiempre( "\nsensor: encendidos = " );
+  elPuerto.escribirSiempre( e.getEncendidos() );
+  elPuerto.escribirSiempre( "   ms por encendido = " );
+  elPuerto.escribirSiempre( e.getEncendidos() > 0 ? (double) e.getMsEncendido() / e.getEncendidos() : 0.0 );
+  elPuerto.escribirSiempre( "   encendido (%) = " );
+  elPuerto.escribirSiempre( millis() > 0 ? 100.0 * e.getMsEncendido() / millis() : 0.0 );
+  elPuerto.escribirSiempre( "\n" );
+} // ()
+#endif
+
+/**
+ * @brief Atiende la consola sin esperar (mientras se espera en loop() o en la tarea de publicación).
+ * @details Sólo se apunta lo que tarda cuando no acaba ninguna línea: es lo que le
+ * cuesta a cada vuelta tenerla puesta.
+ * @return No devuelve ningún valor.
+ */
+void atenderConsola() {
+  unsigned long desde = micros();
+  if ( ! Globales::laConsola.atender( leerConsola ) ) {
+    Globales::tiempoConsola.anyadir( micros() - desde );
+  }
+} // ()
+
+/**
+ * @brief Pone las órdenes de la consola (en setup()).
+ * @return No devuelve ningún valor.
+ */
+void iniciarConsola() {
+  using namespace Globales;
+
+  laConsola.anyadirOrden( "ayuda", "            estas órdenes", ordenAyuda );
+  laConsola.anyadirOrden( "tiempos", "[borrar]  vuelta, medida, publicación y consola", ordenTiempos );
+  laConsola.anyadirOrden( "registro", "[0-2]    nivel del registro: nada, avisos o todo", ordenRegistro );
+  laConsola.anyadirOrden( "traza", "<n>         graba n lecturas en bruto del ADC", ordenTraza );
+  laConsola.anyadirOrden( "periodo", "<ms>      periodo de publicación", ordenPeriodo );
+  laConsola.anyadirOrden( "anuncio", "<ms>      duración de cada anuncio", ordenAnuncio );
+  laConsola.anyadirOrden( "intervalo", "<n>     intervalo del anuncio (n x 0.625 ms)", ordenIntervalo );
+  laConsola.anyadirOrden( "banco", "[veces]     cronometra la conversión, la trama y el anuncio", ordenBanco );
+#ifdef POTENCIA_ADAPTATIVA
+  laConsola.anyadirOrden( "potencia", "          nivel, margen y energía por trama entregada", ordenPotencia );
+#endif
+#ifdef ALIMENTACION_CONMUTADA
+  laConsola.anyadirOrden( "sensor", "           espera del frontal y tiempo encendido", ordenSensor );
+#endif
+
+#if ! defined( GRABAR_TRAZA_ADC ) && ! defined( ADQUISICION_SAADC )
+  elMedidor.instalarCallbackMuestraCruda( grabarMuestraConsola ); // no graba nada hasta que se pida
+#endif
+} // ()
+#endif
+
+#ifdef TAREAS_FREERTOS
+#include "Tareas.h"
+
+/// @brief Lo que pasa la tarea de adquisición a la de publicación.
+struct Medida {
+  unsigned long ms;     //!< millis() al medir
+  unsigned long us;     //!< micros() al medir (para la latencia de la alarma)
+  uint8_t cont;
+  double gas;
+  bool hayMedidaGas;
+  int temperatura;
+}; // struct
+
+/// @brief Un trozo de texto para la tarea de registro.
+struct LineaRegistro {
+  char texto[48];
+}; // struct
+
+void tareaAdquisicion( Tarea & yo );
+void tareaPublicacion( Tarea & yo );
+void tareaRegistro( Tarea & yo );
+
+namespace Globales {
+
+  // Presupuestos: prioridad y pila (palabras de 4 bytes) de cada tarea. La de loop(),
+  // que queda suspendida, es TASK_PRIO_LOW con 1024; la de Bluefruit, TASK_PRIO_HIGH.
+  // Publicación hereda lo que hacía loop() con la emisora y la flash: la pila más grande
+  Tarea laTareaAdquisicion( "adquisicion", TASK_PRIO_NORMAL, 384, tareaAdquisicion );
+  Tarea laTareaPublicacion( "publicacion", TASK_PRIO_LOW, 1024, tareaPublicacion );
+  Tarea laTareaRegistro( "registro", TASK_PRIO_LOWEST, 384, tareaRegistro );
+
+  ColaTareas< Medida, 8 > laColaMedidas;          //!< adquisición -> publicación
+  ColaTareas< LineaRegistro, 16 > laColaRegistro; //!< cualquiera -> registro
+
+}; // namespace
+
+/**
+ * @brief Redirección de elPuerto: el texto va a la tarea de registro a trozos.
+ * @details Nunca espera; si la cola está llena el trozo se pierde (y se cuenta).
+ * @param texto Lo que se quería escribir.
+ */
+void registrar( const char * texto ) {
+  LineaRegistro linea;
+  do {
+    size_t n = strlen( texto );
+    if ( n > sizeof(linea.texto) - 1 ) {
+      n = sizeof(linea.texto) - 1;
+    }
+    memcpy( linea.texto, texto, n );
+    linea.texto[n] = '\0';
+    Globales::laColaRegistro.meter( linea );
+    texto += n;
+  } while ( *texto != '\0' );
+} // ()
+
+/**
+ * @brief Tarea de adquisición: mide al ritmo del periodo configurado.
+ * @details Sólo mide y encola: no escribe en el puerto serie ni toca la emisora,
+ * así que ni un Serial.print() lento ni un anuncio que se reinicia la retrasan.
+ * vTaskDelayUntil() la despierta a intervalos fijos aunque la vuelta tarde algo.
+ * @param yo La tarea.
+ */
+void tareaAdquisicion( Tarea & yo ) {
+  using namespace Globales;
+
+  uint32_t versionConfiguracion = 0xffffffff;
+  Configuracion c;
+  uint8_t cont = 0;
+  TickType_t despertar = xTaskGetTickCount();
+
+  for ( ;; ) {
+    yo.empezarTrabajo();
+
+    // la configuración, con su propia copia: loop() ya no la lee
+    uint32_t version;
+    Configuracion leida = laConfiguracionCompartida.leer( &version );
+    if ( version != versionConfiguracion ) {
+      versionConfiguracion = version;
+      c = leida;
+      elMedidor.ajustarCalibracion( c.getPendiente(), c.getOrdenada() );
+    }
+
+    Medida m;
+    m.ms = millis();
+    m.us = micros();
+    m.cont = ++cont;
+#ifdef ADQUISICION_SAADC
+    m.hayMedidaGas = medirGasAdquisicion( m.gas );
+#else
+    m.gas = elMedidor.medirGas();
+    m.hayMedidaGas = true;
+#endif
+    m.temperatura = elMedidor.medirTemperatura();
+#ifdef CONSOLA_SERIE
+    tiempoMedida.anyadir( micros() - m.us );
+#endif
+    laColaMedidas.meter( m ); // si publicación no da abasto, se pierde (y se cuenta)
+
+    yo.acabarTrabajo();
+    vTaskDelayUntil( &despertar, pdMS_TO_TICKS( c.periodoPublicacionMs ) );
+  } // for
+} // ()
+
+#if defined( ENLACE_RAPIDO ) || defined( CONSOLA_SERIE )
+/**
+ * @brief Lo que atiende la tarea de publicación mientras no publica: volcados y consola.
+ * @return Cada cuánto hay que volver (ms).
+ */
+uint32_t atenderPublicacion() {
+#ifdef CONSOLA_SERIE
+  atenderConsola();
+#endif
+#ifdef ENLACE_RAPIDO
+  if ( atenderEnlaces() ) {
+    return PERIODO_VOLCADO_MS;
+  }
+#endif
+  return PERIODO_VIGILANCIA_MS;
+} // ()
+#endif
+
+/**
+ * @brief vTaskDelay() para la tarea de publicación.
+ * @details Con ENLACE_RAPIDO o CONSOLA_SERIE sigue atendiendo los volcados y la consola
+ * mientras espera, como esperarVigilando() en loop().
+ * @param ms Tiempo a esperar.
+ * @return No devuelve ningún valor.
+ */
+void dormirPublicacion( unsigned long ms ) {
+#if defined( ENLACE_RAPIDO ) || defined( CONSOLA_SERIE )
+  unsigned long desde = millis();
+  for ( ;; ) {
+    unsigned long paso = atenderPublicacion();
+    unsigned long transcurrido = millis() - desde;
+    if ( transcurrido >= ms ) {
+      return;
+    }
+    unsigned long falta = ms - transcurrido;
+    vTaskDelay( pdMS_TO_TICKS( falta < paso ? falta : paso ) );
+  }
+#else
+  vTaskDelay( pdMS_TO_TICKS( ms ) );
+#endif
+} // ()
+
+/**
+ * @brief Tarea de publicación: la única que toca la emisora.
+ * @details Espera cada medida, aplica la configuración, la anuncia el tiempo
+ * configurado y para el anuncio. Lo que escribe va a la tarea de registro.
+ * Con ENLACE_RAPIDO o CONSOLA_SERIE, mientras espera la medida atiende los volcados y la consola.
+ * @param yo La tarea.
+ */
+void tareaPublicacion( Tarea & yo ) {
+  using namespace Globales;
+
+  Medida m;
+  unsigned long msAnterior = 0;
+  bool hayAnterior = false;
+  for ( ;; ) {
+#if defined( ENLACE_RAPIDO ) || defined( CONSOLA_SERIE )
+    uint32_t espera = atenderPublicacion();
+#else
+    uint32_t espera = ColaTareas< Medida, 8 >::ESPERAR_SIEMPRE;
+#endif
+    if ( ! laColaMedidas.sacar( m, espera ) ) {
+      continue;
+    }
+    yo.empezarTrabajo();
+
+    aplicarConfiguracion();
+    atenderPotencia();
+    actualizarTelemetria( hayAnterior ? m.ms - msAnterior : 0 ); // el periodo, el de adquisición
+#ifdef CONSOLA_SERIE
+    if ( hayAnterior ) {
+      tiempoVuelta.anyadir( m.ms - msAnterior );
+    }
+#endif
+    msAnterior = m.ms;
+    hayAnterior = true;
+#ifdef ALARMA_OZONO
+    if ( m.hayMedidaGas ) {
+      atenderAlarma( laAlarma.evaluar( m.gas, m.us ), m.gas ); // aquí, una vez por medida
+    }
+#endif
+    lucecitas();
+#ifdef CONSOLA_SERIE
+    unsigned long usPublicacion = micros();
+    bool anunciando = empezarPublicarMedida( m.cont, m.gas, m.hayMedidaGas, m.temperatura, m.ms );
+    tiempoPublicacion.anyadir( micros() - usPublicacion );
+#else
+    bool anunciando = empezarPublicarMedida( m.cont, m.gas, m.hayMedidaGas, m.temperatura, m.ms );
+#endif
+
+    if ( elPuerto.muestra( PuertoSerie::TODO ) ) {
+      elPuerto.escribir( "medida " );
+      elPuerto.escribir( m.cont );
+      elPuerto.escribir( ": gas = " );
+      elPuerto.escribir( m.gas );
+      elPuerto.escribir( "\n" );
+    }
+
+    yo.acabarTrabajo();
+
+    if ( anunciando && ! alarmaActiva() ) {
+      dormirPublicacion( laConfiguracion.duracionAnuncioMs );
+      elPublicador.laEmisora.detenerAnuncio();
+      anotarAnuncio();
+    }
+
+#ifdef CANAL_RUIDO
+    yo.empezarTrabajo();
+    anunciando = ! alarmaActiva() && empezarPublicarRuido( m.cont );
+    yo.acabarTrabajo();
+    if ( anunciando ) {
+      dormirPublicacion( laConfiguracion.duracionAnuncioMs );
+      elPublicador.laEmisora.detenerAnuncio();
+      anotarAnuncio();
+    }
+#endif
+  } // for
+} // ()
+
+/**
+ * @brief Escribe en el puerto serie cómo va una tarea (desde la tarea de registro).
+ * @param t La tarea.
+ * @param msInforme Tiempo desde el informe anterior.
+ * @return No devuelve ningún valor.
+ */
+void informarTarea( Tarea & t, unsigned long msInforme ) {
+  using namespace Globales;
+
+  uint32_t us = t.tomarUsOcupada();
+  elPuerto.escribirYa( "tarea " );
+  elPuerto.escribirYa( t.getNombre() );
+  elPuerto.escribirYa( ": ocupada (%) = " ); // tiempo de reloj trabajando, no CPU (ver Tarea)
+  elPuerto.escribirYa( msInforme > 0 ? us / ( 10.0 * msInforme ) : 0.0 );
+  elPuerto.escribirYa( "   pila libre (B) = " );
+  elPuerto.escribirYa( t.getPilaLibre() );
+  elPuerto.escribirYa( " de " );
+  elPuerto.escribirYa( t.getPila() );
+  elPuerto.escribirYa( "\n" );
+} // ()
+
+/**
+ * @brief Tarea de registro: la única que escribe en el puerto serie.
+ * @details Tiene la prioridad más baja: si Serial va lento, sólo se retrasa ella
+ * (y, si su cola se llena, se pierden líneas, que se cuentan en el informe).
+ * Cada PERIODO_INFORME_TAREAS_MS escribe el tiempo ocupado y la pila de cada tarea.
+ * @param yo La tarea.
+ */
+void tareaRegistro( Tarea & yo ) {
+  using namespace Globales;
+
+  LineaRegistro linea;
+  bool aMitadDeLinea = false; //!< El informe espera a que acabe la línea en curso
+  unsigned long ultimoInforme = millis();
+  for ( ;; ) {
+    if ( laColaRegistro.sacar( linea, 100 ) ) {
+      yo.empezarTrabajo();
+      elPuerto.escribirYa( linea.texto );
+      size_t n = strlen( linea.texto );
+      aMitadDeLinea = n > 0 ? linea.texto[n-1] != '\n' : aMitadDeLinea;
+      yo.acabarTrabajo();
+    }
+
+    unsigned long ahora = millis();
+    if ( ! aMitadDeLinea && ahora - ultimoInforme >= PERIODO_INFORME_TAREAS_MS && elPuerto.muestra( PuertoSerie::AVISOS ) ) {
+      unsigned long msInforme = ahora - ultimoInforme;
+      ultimoInforme = ahora;
+      informarTarea( laTareaAdquisicion, msInforme );
+      informarTarea( laTareaPublicacion, msInforme );
+      informarTarea( yo, msInforme );
+      elPuerto.escribirYa( "colas: medidas perdidas = " );
+      elPuerto.escribirYa( laColaMedidas.getPerdidos() );
+      elPuerto.escribirYa( "   líneas perdidas = " );
+      elPuerto.escribirYa( laColaRegistro.getPerdidos() );
+      elPuerto.escribirYa( "\n" );
+    }
+  } // for
+} // ()
+
+/**
+ * @brief Crea las colas y arranca las tareas (al final de setup()).
+ * @details El medidor se calla: lo que se escribe desde ahora pasa por la tarea de registro.
+ * @return No devuelve ningún valor.
+ */
+void arrancarTareas() {
+  using namespace Globales;
+
+  laColaMedidas.crear();
+  laColaRegistro.crear();
+  elMedidor.silenciar( true );
+  elPuerto.redirigir( registrar );
+
+  laTareaRegistro.arrancar();
+  laTareaPublicacion.arrancar();
+  laTareaAdquisicion.arrancar();
+} // ()
+#endif
+
+#ifdef TELEMETRIA_ESCANEO
+namespace Globales {
+
+  TelemetriaNodo laTelemetria( VERSION_FIRMWARE >> 8, VERSION_FIRMWARE & 0xff );
+
+}; // namespace
+
+/**
+ * @brief Apunta el periodo de la vuelta y pone la telemetría en la respuesta de escaneo.
+ * @details Las muestras perdidas son las medidas que no han cabido en la cola de
+ * publicación (con TAREAS_FREERTOS) y los pares del SAADC que no han cabido en su cola
+ * (sólo cuando alguien la vacía: la vigilancia de ALARMA_OZONO sin tareas; los bloques
+ * que no se leen entre medida y medida no son pérdidas, se saltan a propósito). Las
+ * líneas, las que no han cabido en la cola de registro. La emisora sólo la rehace si
+ * ha cambiado.
+ * @param periodoMs Desde la vuelta (o la medida) anterior; 0 si aún no hay.
+ * @return No devuelve ningún valor.
+ */
+void actualizarTelemetria( unsigned long periodoMs ) {
+  using namespace Globales;
+
+  if ( periodoMs > 0 ) {
+    laTelemetria.anyadirPeriodo( periodoMs );
+  }
+
+  uint32_t muestrasPerdidas = 0;
+  uint32_t lineasPerdidas = 0;
+#ifdef TAREAS_FREERTOS
+  muestrasPerdidas += laColaMedidas.getPerdidos();
+  lineasPerdidas += laColaRegistro.getPerdidos();
+#endif
+#if defined( ADQUISICION_SAADC ) && defined( ALARMA_OZONO ) && ! defined( TAREAS_FREERTOS )
+  muestrasPerdidas += laAdquisicion.getMuestrasPerdidas();
+#endif
+
+  uint8_t trama[TramasPublicador::Telemetria::TAM];
+  TramasPublicador::codificarTelemetria( trama, laTelemetria.datos( millis(), muestrasPerdidas, lineasPerdidas,
+                                                                    laConfiguracion.huella() ) );
+  elPublicador.laEmisora.ajustarRespuestaEscaneo( trama, sizeof(trama) );
+} // ()
+#else
+void actualizarTelemetria( unsigned long ) {
+} // ()
+#endif
+
 /**
  * @brief Función principal del ciclo de ejecución
  * @details Esta función se ejecuta repetidamente y contiene la lógica 
@@ -127,20 +1755,90 @@ namespace Loop {
   using namespace Loop;
   using namespace Globales;
 
+#ifdef TAREAS_FREERTOS
+  suspendLoop(); // el trabajo lo hacen las tareas
+  return;
+#endif
+
 cont++; // Incrementa el contador
 
-  elPuerto.escribir( "\n---- loop(): empieza " ); // Inicia el registro del ciclo
-  elPuerto.escribir( cont ); // Muestra el contador
-  elPuerto.escribir( "\n" );
+  unsigned long inicio = millis();
+  unsigned long periodo = cont > 1 ? inicio - inicioAnterior : 0; // Duración de la vuelta anterior completa
 
-  lucecitas(); // Llama a la función de parpadeo del LED
+  if ( elPuerto.muestra( PuertoSerie::TODO ) ) {
+    elPuerto.escribir( "\n---- loop(): empieza " ); // Inicia el registro del ciclo
+    elPuerto.escribir( cont ); // Muestra el contador
+    if ( cont > 1 ) {
+      elPuerto.escribir( "   periodo (ms) = " );
+      elPuerto.escribir( periodo );
+    }
+    elPuerto.escribir( "\n" );
+  }
+  inicioAnterior = inicio;
+#ifdef CONSOLA_SERIE
+  if ( periodo > 0 ) {
+    tiempoVuelta.anyadir( periodo );
+  }
+#endif
+
+  if ( ! arranqueInformado && elPuerto.disponible() ) {
+    informarArranque(); // El ordenador se ha conectado después de setup()
+  }
 
-  // Mido y publico
-  int valorCO2 = elMedidor.medirGas(); // Mide el valor de CO2
-  elPublicador.publicarCO2( valorCO2, cont, 1000 ); // Publica el valor de CO2
+  aplicarConfiguracion(); // Lo que haya llegado por BLE vale a partir de esta vuelta
 
-  // Mido y publico
+  atenderPotencia(); // Y la potencia, a partir del anuncio de esta vuelta
+
+  actualizarTelemetria( periodo ); // Va en la respuesta de escaneo del anuncio de esta vuelta
+
+  lucecitas(); // Llama a la función de parpadeo del LED
+
+  // Mido
+#ifdef CONSOLA_SERIE
+  unsigned long usMedida = micros();
+#endif
+#ifdef ADQUISICION_SAADC
+  double valorCO2;
+  bool hayMedidaGas = medirGasAdquisicion( valorCO2 );
+#else
+  double valorCO2 = elMedidor.medirGas(); // Mide el valor de CO2 (en ppm, con decimales)
+  bool hayMedidaGas = true;
+#endif
   int valorTemperatura = elMedidor.medirTemperatura(); // Mide la temperatura
+#ifdef CONSOLA_SERIE
+  tiempoMedida.anyadir( micros() - usMedida );
+#endif
+#ifdef ALARMA_OZONO
+  if ( hayMedidaGas ) {
+    atenderAlarma( laAlarma.evaluar( valorCO2, micros() ), valorCO2 ); // antes que el anuncio normal
+  }
+#endif
+
+  // y publico (mientras se espera se sigue vigilando el gas, si hay alarma)
+#ifdef CONSOLA_SERIE
+  unsigned long usPublicacion = micros();
+  bool anunciando = empezarPublicarMedida( cont, valorCO2, hayMedidaGas, valorTemperatura, inicio );
+  tiempoPublicacion.anyadir( micros() - usPublicacion );
+#else
+  bool anunciando = empezarPublicarMedida( cont, valorCO2, hayMedidaGas, valorTemperatura, inicio );
+#endif
+  if ( anunciando ) {
+    esperarVigilando( laConfiguracion.duracionAnuncioMs );
+    if ( ! alarmaActiva() ) {
+      elPublicador.laEmisora.detenerAnuncio();
+      anotarAnuncio();
+    }
+  }
+#ifdef CANAL_RUIDO
+  // y el ruido del periodo, en su propio anuncio (no durante una alarma)
+  if ( ! alarmaActiva() && empezarPublicarRuido( cont ) ) {
+    esperarVigilando( laConfiguracion.duracionAnuncioMs );
+    if ( ! alarmaActiva() ) {
+      elPublicador.laEmisora.detenerAnuncio();
+      anotarAnuncio();
+    }
+  }
+#endif
   // elPublicador.publicarTemperatura( valorTemperatura, cont, 10002);
 
   // Prueba para emitir un iBeacon y poner en la carga (21 bytes = uuid 16 major 2 minor 2 txPower 1 )
@@ -156,13 +1854,21 @@ cont++; // Incrementa el contador
   // elPublicador.laEmisora.emitirAnuncioIBeaconLibre ( &datos[0], 21 );
   // elPublicador.laEmisora.emitirAnuncioIBeaconLibre ( "ELENAELENAELENAELENAE", 21 );
 
-  esperar( 2000 ); // Espera 2 segundos
+  // Espera lo que falte para completar el periodo de publicación
+  unsigned long transcurrido = millis() - inicio;
+  if ( transcurrido < laConfiguracion.periodoPublicacionMs ) {
+    esperarVigilando( laConfiguracion.periodoPublicacionMs - transcurrido );
+  }
 
-  elPublicador.laEmisora.detenerAnuncio(); // Detiene la emisión
+  if ( ! alarmaActiva() ) {
+    elPublicador.laEmisora.detenerAnuncio(); // Detiene la emisión
+  }
 
-  elPuerto.escribir( "---- loop(): acaba ** " ); // Indica el fin del ciclo
-  elPuerto.escribir( cont ); // Muestra el contador final
-  elPuerto.escribir( "\n" );
+  if ( elPuerto.muestra( PuertoSerie::TODO ) ) {
+    elPuerto.escribir( "---- loop(): acaba ** " ); // Indica el fin del ciclo
+    elPuerto.escribir( cont ); // Muestra el contador final
+    elPuerto.escribir( "\n" );
+  }
 } // loop ()
 // --------------------------------------------------------------
 // --------------------------------------------------------------
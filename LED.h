@@ -5,7 +5,8 @@
  * Fecha: 30 de septiembre de 2024
  *
  * Este archivo ha sido realizado por Carla Rumeu Montesinos y Elena Ruiz de la Blanca el 30 de septiembre de 2024.
- * Contiene la implementación de la clase LED, que permite encender, apagar y hacer brillar un LED.
+ * Contiene la implementación de la clase LED, que permite encender, apagar y hacer brillar un LED,
+ * y reproducir patrones de parpadeo sin bloquear el programa (ver LED::reproducir()).
  * 
  * Todos los derechos reservados.
  */
@@ -13,6 +14,8 @@
 #ifndef LED_H_INCLUIDO
 #define LED_H_INCLUIDO
 
+#include <atomic>
+
 /** 
  * Espera un tiempo determinado en milisegundos.
  * 
@@ -22,16 +25,104 @@ void esperar (long tiempo) {
   delay (tiempo);
 }
 
+/** 
+ * Un paso de un patrón de parpadeo: tiempo encendido y después tiempo apagado.
+ */
+struct PasoPatron {
+  uint16_t encendidoMs; ///< Milisegundos encendido.
+  uint16_t apagadoMs;   ///< Milisegundos apagado.
+};
+
+/** 
+ * Patrón de parpadeo declarativo.
+ * 
+ * Un patrón con repeticiones = 0 se repite siempre y queda de fondo: cuando
+ * termina un patrón finito se vuelve a él.
+ */
+struct Patron {
+  const PasoPatron * pasos; ///< Secuencia de pasos.
+  uint8_t numPasos;         ///< Número de pasos.
+  uint8_t repeticiones;     ///< Veces que se repite la secuencia (0 = siempre).
+  uint8_t prioridad;        ///< Sólo lo interrumpe un patrón de prioridad igual o mayor.
+};
+
+/** 
+ * Patrones de estado del nodo.
+ */
+namespace PatronesLED {
+
+  // tres destellos cortos y uno largo (lo que antes hacía lucecitas() bloqueando)
+  const PasoPatron PASOS_ANUNCIANDO[] = { {100, 400}, {100, 400}, {100, 400}, {1000, 1000} };
+  const PasoPatron PASOS_CONECTADO[] = { {1000, 200} };
+  const PasoPatron PASOS_ALARMA[] = { {100, 100} };
+  const PasoPatron PASOS_BATERIA_BAJA[] = { {50, 200}, {50, 2000} };
+
+  const Patron ANUNCIANDO = { PASOS_ANUNCIANDO, 4, 0, 0 };     ///< Funcionando y anunciando (de fondo).
+  const Patron CONECTADO = { PASOS_CONECTADO, 1, 3, 1 };       ///< Se ha conectado una central.
+  const Patron BATERIA_BAJA = { PASOS_BATERIA_BAJA, 2, 3, 2 }; ///< Batería baja.
+  const Patron ALARMA = { PASOS_ALARMA, 1, 0, 3 };             ///< Alarma: hasta que se detenga.
+
+}; // namespace
+
 /** 
  * Clase LED para controlar un LED.
  * 
- * Esta clase permite encender, apagar y hacer brillar un LED.
+ * Esta clase permite encender, apagar y hacer brillar un LED, y reproducir
+ * patrones de parpadeo en segundo plano.
+ * 
+ * Los patrones avanzan en actualizar(). En la placa lo llama un temporizador de
+ * FreeRTOS (iniciarPatrones()) cada MS_POR_TICK; en la simulación lo tiene que llamar
+ * quien mueva el reloj virtual. reproducir() y detener() sólo dejan la petición en una
+ * variable atómica, así que se pueden llamar desde cualquier tarea o callback. Si en el
+ * mismo tick llegan dos peticiones de reproducir(), se queda la de más prioridad (con la
+ * misma, la última).
  */
 class LED {
+public:
+  static const uint16_t MS_POR_TICK = 10; ///< Resolución de los patrones en milisegundos.
+
 private:
   int numeroLED;  ///< Número del pin del LED.
   bool encendido; ///< Estado del LED: verdadero si está encendido, falso si está apagado.
 
+  // ..........................................................
+  // estado del patrón (sólo lo toca actualizar())
+  // ..........................................................
+  std::atomic<const Patron *> solicitado { nullptr }; ///< Petición pendiente de reproducir() (la de más prioridad).
+  std::atomic<const Patron *> aDetener { nullptr };   ///< Petición pendiente de detener().
+  const Patron * actual = nullptr;   ///< Patrón que suena ahora.
+  const Patron * fondo = nullptr;    ///< Patrón infinito al que se vuelve.
+  uint8_t paso = 0;                  ///< Paso en curso del patrón actual.
+  uint8_t repeticionesHechas = 0;
+  bool faseEncendido = false;
+  unsigned long siguienteCambio = 0; ///< millis() del siguiente cambio.
+
+#ifdef ARDUINO_ARCH_NRF52
+  SoftwareTimer temporizador;
+
+  static void alVencerTemporizador( TimerHandle_t t ) {
+	LED * led = (LED *) pvTimerGetTimerID( t );
+	led->actualizar();
+  } // ()
+#endif
+
+  // ..........................................................
+  // empieza un patrón desde su primer paso
+  // ..........................................................
+  void empezar( const Patron * p, unsigned long ahora ) {
+	actual = p;
+	paso = 0;
+	repeticionesHechas = 0;
+	if ( p == nullptr || p->numPasos == 0 ) {
+	  actual = nullptr;
+	  apagar();
+	  return;
+	}
+	faseEncendido = true;
+	encender();
+	siguienteCambio = ahora + p->pasos[0].encendidoMs;
+  } // ()
+
 public:
 
   /** 
@@ -81,6 +172,96 @@ public:
 	esperar(tiempo); 
 	apagar ();
   }
+
+  /** 
+   * Arranca el temporizador que hace avanzar los patrones (sólo en la placa).
+   * Se llama una vez desde setup().
+   */
+  void iniciarPatrones () {
+#ifdef ARDUINO_ARCH_NRF52
+	temporizador.begin( MS_POR_TICK, alVencerTemporizador, this, true );
+	temporizador.start();
+#endif
+  }
+
+  /** 
+   * Pide reproducir un patrón sin bloquear.
+   * 
+   * Se reproduce si su prioridad es igual o mayor que la del patrón que suena;
+   * si ya está sonando no vuelve a empezar. Si aún no se ha atendido otra petición de
+   * más prioridad, ésta se descarta (no la pisa).
+   * 
+   * @param p Patrón a reproducir (tiene que vivir mientras suene, p.ej. los de PatronesLED).
+   */
+  void reproducir (const Patron & p) {
+	const Patron * pendiente = solicitado.load();
+	do {
+	  if ( pendiente != nullptr && pendiente->prioridad > p.prioridad ) {
+		return;
+	  }
+	} while ( ! solicitado.compare_exchange_weak( pendiente, &p ) );
+  }
+
+  /** 
+   * Pide parar un patrón (si está sonando o de fondo). Se vuelve al de fondo, o se apaga.
+   * 
+   * @param p Patrón a detener.
+   */
+  void detener (const Patron & p) {
+	aDetener.store( &p );
+  }
+
+  /** 
+   * @return true si hay algún patrón sonando.
+   */
+  bool reproduciendo () const {
+	return actual != nullptr;
+  }
+
+  /** 
+   * Hace avanzar el patrón hasta el instante actual. Nunca bloquea.
+   */
+  void actualizar () {
+	unsigned long ahora = millis();
+
+	const Patron * parar = aDetener.exchange( nullptr );
+	if ( parar != nullptr ) {
+	  if ( fondo == parar ) {
+		fondo = nullptr;
+	  }
+	  if ( actual == parar ) {
+		empezar( fondo, ahora );
+	  }
+	}
+
+	const Patron * p = solicitado.exchange( nullptr );
+	if ( p != nullptr && p != actual && ( actual == nullptr || p->prioridad >= actual->prioridad ) ) {
+	  if ( p->repeticiones == 0 ) {
+		fondo = p;
+	  }
+	  empezar( p, ahora );
+	}
+
+	// (long) para que funcione aunque millis() dé la vuelta
+	while ( actual != nullptr && (long) ( ahora - siguienteCambio ) >= 0 ) {
+	  if ( faseEncendido ) {
+		faseEncendido = false;
+		apagar();
+		siguienteCambio += actual->pasos[paso].apagadoMs;
+		continue;
+	  }
+	  if ( ++paso == actual->numPasos ) {
+		paso = 0;
+		if ( actual->repeticiones != 0 && ++repeticionesHechas >= actual->repeticiones ) {
+		  empezar( fondo, ahora );
+		  continue;
+		}
+	  }
+	  faseEncendido = true;
+	  encender();
+	  siguienteCambio += actual->pasos[paso].encendidoMs;
+	} // while
+  }
 }; // class
 
 // ----------------------------------------------------------
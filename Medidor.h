@@ -16,6 +16,9 @@
 
 #include <Arduino.h> // Incluir la librería de Arduino para funciones como analogRead, pinMode, etc.
 
+#include "ReferenciaLenta.h"
+#include "EncendidoSensor.h"
+
 /**
  * ------------------------------------------------------
  * Clase Medidor para medir gas y temperatura
@@ -26,21 +29,41 @@
  */
 class Medidor {
 
+public:
+
+    /// @brief Tipo de callback que recibe cada lectura en bruto del ADC (para grabar trazas).
+    /// Aref es -1 si con la referencia lenta esa vez no se ha leído (GrabadorTraza lo graba
+    /// como TrazaADC::SIN_REFERENCIA).
+    using CallbackMuestraCruda = void ( uint32_t tiempo, int Agas, int Aref );
+
 private:
     uint8_t pinVref;    ///< Pin para referencia de voltaje.
     uint8_t pinVgas;    ///< Pin para leer el voltaje del gas.
     double ppmOzono;    ///< Partes por millón de Ozono (O3).
     float vref;         ///< Voltaje de referencia.
     float vgas;         ///< Voltaje del gas.
+    CallbackMuestraCruda * callbackMuestraCruda = nullptr; ///< Se llama con cada lectura en bruto.
+    double pendienteCalibracion = 0.3;  ///< Pendiente de la recta, se cambia con ajustarCalibracion().
+    double ordenadaCalibracion = -1.5;  ///< Intersección de la recta, se cambia con ajustarCalibracion().
+    ReferenciaLenta referenciaLenta;    ///< Vref guardada (ver usarReferenciaLenta()).
+    bool conReferenciaLenta = false;    ///< Si medirGas() lee Vref sólo de tarde en tarde.
+    bool silencioso = false;            ///< Si medirGas() no escribe por el puerto serie.
+    EncendidoSensor encendido;          ///< Espera tras encender el frontal (ver usarAlimentacionConmutada()).
+    bool conAlimentacionConmutada = false; ///< Si el frontal sólo se enciende para medir.
+    uint8_t pinAlimentacion = 0;        ///< Pin que enciende el frontal analógico.
+    uint8_t muestrasRafaga = 1;         ///< Pares (gas, referencia) que se leen en cada encendido.
+
+    /// Pares que se promedian en cada lectura mientras se aprende la espera.
+    static const uint8_t LECTURAS_APRENDIZAJE = 16;
 
     /**
      * ------------------------------------------------------
      * Convierte un valor digital a voltios.
      * 
-     * @param Vin Valor digital a convertir.
+     * @param Vin Valor digital a convertir (o media de varios).
      * @return Valor en voltios.
      */
-    float digToVolt(int Vin) { 
+    float digToVolt(double Vin) { 
         return ((Vin * 3.3) / 1024);
     }
     
@@ -56,15 +79,61 @@ private:
      * @return Valor calibrado.
      */
     double calibrarLectura(double valorMedido, double &m) {
-        // Ajuste manual basado en los datos proporcionados por las pruebas
-        m = 0.3;  ///< Pendiente de la recta, ajustar según sea necesario.
-        const double b = -1.5; ///< Intersección de la recta, ajustar según sea necesario.
+        // Ajuste basado en los datos proporcionados por las pruebas (ver ajustarCalibracion())
+        m = pendienteCalibracion;
+        const double b = ordenadaCalibracion;
         double valorCalibrado = m * valorMedido + b; // Calcula el valor calibrado
 
         // Si el valor calibrado es negativo, devuelve 0
         return valorCalibrado > 0 ? valorCalibrado : 0;
     }
 
+    /**
+     * ------------------------------------------------------
+     * Lee n pares (gas, referencia) seguidos y deja sus medias.
+     */
+    void leerRafaga(uint8_t n, double &Agas, double &Aref) {
+        int32_t sumaGas = 0;
+        int32_t sumaRef = 0;
+        for (uint8_t i = 0; i < n; i++) {
+            sumaGas += analogRead(pinVgas);
+            sumaRef += analogRead(pinVref);
+        }
+        Agas = (double) sumaGas / n;
+        Aref = (double) sumaRef / n;
+    }
+
+    /**
+     * ------------------------------------------------------
+     * Enciende el frontal, espera a que se asiente (aprendiendo la espera si toca),
+     * lee una ráfaga y lo vuelve a apagar.
+     *
+     * @param Agas Media de la ráfaga del pin de gas.
+     * @param Aref Media de la ráfaga del pin de referencia.
+     * @param esMedida false en las vigilancias: esperan lo aprendido, sin aprender ni
+     * contar para el próximo aprendizaje (que va por medidas).
+     */
+    void leerConmutado(double &Agas, double &Aref, bool esMedida = true) {
+        uint32_t lecturas = 0;
+        unsigned long inicio = millis();
+        digitalWrite(pinAlimentacion, HIGH);
+        if (esMedida && encendido.tocaAprender()) {
+            bool asentado;
+            do {
+                delay(encendido.getMsHastaLectura());
+                leerRafaga(LECTURAS_APRENDIZAJE, Agas, Aref);
+                lecturas += 2 * LECTURAS_APRENDIZAJE;
+                asentado = encendido.anyadir((uint16_t) (millis() - inicio), Agas, Aref);
+            } while (!asentado);
+        } else {
+            delay(encendido.getMsAsentamiento());
+        }
+        leerRafaga(muestrasRafaga, Agas, Aref);
+        lecturas += 2 * muestrasRafaga;
+        digitalWrite(pinAlimentacion, LOW);
+        encendido.apuntarEncendido(millis() - inicio, lecturas);
+    }
+
 public:
 
     // Constructor vacío
@@ -90,16 +159,208 @@ public:
         pinMode(pinVgas, INPUT);
     }
 
+    /**
+     * Instala un callback que recibe cada lectura en bruto del ADC.
+     *
+     * @param cb Callback a instalar (nullptr para quitarlo).
+     */
+    void instalarCallbackMuestraCruda( CallbackMuestraCruda * cb ) {
+        callbackMuestraCruda = cb;
+    }
+
+    /**
+     * Cambia la recta de calibración y = m * x + b (p.ej. desde la configuración por BLE).
+     *
+     * @param m Pendiente.
+     * @param b Intersección.
+     */
+    void ajustarCalibracion( double m, double b ) {
+        pendienteCalibracion = m;
+        ordenadaCalibracion = b;
+    }
+
+    /**
+     * Pasa a leer Vref sólo de tarde en tarde y a usar su valor filtrado (ver ReferenciaLenta.h).
+     *
+     * @param periodo Una lectura de Vref cada tantas medidas.
+     * @param desplazamiento Fuerza del filtro (cada lectura cuenta 1 / 2^desplazamiento).
+     * @param umbralSalto Cuentas del ADC a partir de las que un cambio se vuelve a leer enseguida.
+     */
+    void usarReferenciaLenta( uint16_t periodo, uint8_t desplazamiento, uint16_t umbralSalto ) {
+        referenciaLenta = ReferenciaLenta( periodo, desplazamiento, umbralSalto );
+        conReferenciaLenta = true;
+    }
+
+    /**
+     * Vuelve a leer Vref en cada medida (lo de siempre).
+     */
+    void usarReferenciaDirecta() {
+        conReferenciaLenta = false;
+    }
+
+    /**
+     * Pasa a encender el frontal analógico del sensor sólo para medir (ver EncendidoSensor.h).
+     *
+     * En cada medida se enciende con pinAlimentacion, se espera a que se asiente, se leen
+     * `muestras` pares y se apaga: el frontal gasta sólo ese rato y no el periodo entero. Se usa la
+     * media de la ráfaga, y la referencia lenta no se usa (Vref también se apaga).
+     *
+     * @param pin Pin que enciende el frontal (HIGH encendido).
+     * @param e Espera, fija o aprendida.
+     * @param muestras Pares (gas, referencia) que se leen en cada encendido.
+     */
+    void usarAlimentacionConmutada( uint8_t pin, const EncendidoSensor & e, uint8_t muestras ) {
+        pinAlimentacion = pin;
+        encendido = e;
+        muestrasRafaga = muestras > 0 ? muestras : 1;
+        conAlimentacionConmutada = true;
+        pinMode(pinAlimentacion, OUTPUT);
+        digitalWrite(pinAlimentacion, LOW);
+    }
+
+    /**
+     * Con la alimentación conmutada y una espera fija, pasa a aprender la espera desde la
+     * siguiente medida, sin perder lo apuntado del frontal (ver EncendidoSensor::empezarAprender()).
+     */
+    void aprenderAsentamiento() {
+        encendido.empezarAprender();
+    }
+
+    /**
+     * Deja el frontal encendido siempre (con el pin de alimentación a HIGH).
+     */
+    void usarAlimentacionContinua() {
+        if (conAlimentacionConmutada) {
+            digitalWrite(pinAlimentacion, HIGH);
+        }
+        conAlimentacionConmutada = false;
+    }
+
+    /**
+     * @return La espera tras encender el frontal (aprendida, encendidos, tiempo encendido).
+     */
+    const EncendidoSensor & getEncendido() const {
+        return encendido;
+    }
+
+    /**
+     * Deja de escribir (o vuelve a escribir) los valores de cada medida por el puerto serie.
+     *
+     * La tarea de adquisición lo silencia: Serial.print() puede esperar y retrasaría
+     * la siguiente lectura del ADC.
+     *
+     * @param si true para no escribir.
+     */
+    void silenciar( bool si ) {
+        silencioso = si;
+    }
+
+    /**
+     * @return La referencia lenta (lecturas hechas, saltos, valor).
+     */
+    const ReferenciaLenta & getReferenciaLenta() const {
+        return referenciaLenta;
+    }
+
     /**
      * Mide el gas y devuelve el valor de ppm de ozono calibrado
      * 
      * @return Valor calibrado de ppm de ozono.
      */
     double medirGas() {
-        // Lee el valor de los pines del sensor
+        if (conAlimentacionConmutada) {
+            double mediaGas, mediaRef;
+            leerConmutado(mediaGas, mediaRef);
+            if (callbackMuestraCruda != nullptr) {
+                callbackMuestraCruda(micros(), (int) (mediaGas + 0.5), (int) (mediaRef + 0.5));
+            }
+            return medirGas(mediaGas, mediaRef);
+        }
+
+        // Lee el valor de los pines del sensor (Vref, si hay referencia lenta, sólo cuando toca)
         int Agas = analogRead(pinVgas);
-        int Aref = analogRead(pinVref);
+        int Aref = -1;
+        if (!conReferenciaLenta || referenciaLenta.tocaLeer()) {
+            Aref = analogRead(pinVref);
+            if (conReferenciaLenta) {
+                referenciaLenta.anyadir(Aref);
+            }
+        }
+
+        if (callbackMuestraCruda != nullptr) {
+            callbackMuestraCruda(micros(), Agas, Aref);
+        }
+
+        return medirGas(Agas, conReferenciaLenta ? referenciaLenta.valor() : Aref);
+    }
 
+    /**
+     * Lectura rápida del gas para vigilar la alarma entre medida y medida.
+     *
+     * Como medirGas(), pero sin escribir nada, sin pasar la lectura al callback de
+     * muestras crudas y sin tocar la referencia lenta (si se usa, vale su último
+     * valor): así las medidas de siempre y las trazas dan lo mismo con vigilancia o sin ella.
+     * Con la alimentación conmutada también enciende el frontal (y cuenta en su energía),
+     * pero no aprende la espera ni cuenta como medida para el aprendizaje.
+     *
+     * @return Valor calibrado de ppm de ozono.
+     */
+    double vigilarGas() {
+        if (conAlimentacionConmutada) {
+            double mediaGas, mediaRef;
+            leerConmutado(mediaGas, mediaRef, false);
+            return vigilarGas(mediaGas, mediaRef);
+        }
+        int Agas = analogRead(pinVgas);
+        double Aref = conReferenciaLenta ? referenciaLenta.valor() : analogRead(pinVref);
+        return vigilarGas(Agas, Aref);
+    }
+
+    /**
+     * Como medirGas(Agas, Aref), pero sin escribir nada.
+     *
+     * @param Agas Lectura del ADC del pin de gas (o media de varias).
+     * @param Aref Lectura del ADC del pin de referencia (o media de varias).
+     * @return Valor calibrado de ppm de ozono.
+     */
+    double vigilarGas(double Agas, double Aref) {
+        bool antes = silencioso;
+        silencioso = true;
+        double ppm = medirGas(Agas, Aref);
+        silencioso = antes;
+        return ppm;
+    }
+
+    /**
+     * Mide el gas a partir de un bloque de AdquisicionSAADC.
+     * 
+     * Usa la media del bloque, que tiene mucho menos ruido que una sola lectura.
+     * 
+     * @param valores Pares (gas, referencia) intercalados.
+     * @param numMuestras Número de pares.
+     * @return Valor calibrado de ppm de ozono.
+     */
+    double medirGasBloque(const int16_t * valores, uint16_t numMuestras) {
+        int32_t sumaGas = 0;
+        int32_t sumaRef = 0;
+        for (uint16_t i = 0; i < numMuestras; i++) {
+            sumaGas += valores[2*i];
+            sumaRef += valores[2*i + 1];
+        }
+        return medirGas((double) sumaGas / numMuestras, (double) sumaRef / numMuestras);
+    }
+
+    /**
+     * Calcula el valor de ppm de ozono calibrado a partir de lecturas ya hechas.
+     * 
+     * Es lo que usa medirGas() después de leer los pines, lo que usa medirGasBloque()
+     * con las medias y lo que usa la reproducción de trazas (simulacion/reproducirTraza.cpp).
+     * 
+     * @param Agas Lectura del ADC del pin de gas (o media de varias).
+     * @param Aref Lectura del ADC del pin de referencia (o media de varias).
+     * @return Valor calibrado de ppm de ozono.
+     */
+    double medirGas(double Agas, double Aref) {
         // Convierte el valor digital a voltios
         vgas = digToVolt(Agas);
         vref = digToVolt(Aref);
@@ -121,6 +382,10 @@ public:
         // Calcular el valor de ppmOzono * 10
         int ppm10 = (int)(ppmOzono * 10);
 
+        if (silencioso) {
+            return ppmCalibrado;
+        }
+
         // Imprimir valores de referencia, gas leídos, m, ppmOzono * 10 y el valor calibrado
         Serial.print("VGAS: ");
         Serial.println(vgas);
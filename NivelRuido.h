@@ -0,0 +1,205 @@
+/*
+ * Nombre del fichero: NivelRuido.h
+ * Descripción: Nivel de ruido en dB(A) de bloques de audio PCM a 16 kHz, en coma fija.
+ * Autores: agent
+ * Fecha: 18 de octubre de 2026
+ *
+ * Este archivo ha sido realizado por agent.
+ * Contiene la clase NivelRuido: cada bloque pasa por el filtro de ponderación A (tres
+ * biquads en Q31) y se suma su energía; con la energía de varios bloques se saca el nivel
+ * equivalente en dB(A). En la placa usa CMSIS-DSP (arm_biquad_cascade_df1_q31 y
+ * arm_power_q31, con las instrucciones DSP del Cortex-M4); en el ordenador, o con
+ * SIN_CMSIS_DSP, la misma cuenta escrita en C, operación por operación, así que los dos
+ * dan los mismos bits. No depende de Arduino.
+ *
+ * Todos los derechos reservados.
+ */
+
+#ifndef NIVEL_RUIDO_H_INCLUIDO
+#define NIVEL_RUIDO_H_INCLUIDO
+
+#include <stdint.h>
+#include <math.h>
+
+#if defined( ARDUINO_ARCH_NRF52 ) && ! defined( SIN_CMSIS_DSP )
+#include <arm_math.h>
+#define NIVEL_RUIDO_CON_CMSIS
+#endif
+
+// ----------------------------------------------------------
+/**
+ * @brief Nivel de ruido en dB(A) de audio a 16 kHz.
+ *
+ * El filtro A son tres biquads en forma directa I. Los dos primeros (polos de 20.6 Hz,
+ * 107.7 Hz y 737.9 Hz) salen de la transformación bilineal de la curva analógica; el
+ * tercero (polo doble de 12.2 kHz, por encima de Nyquist) está ajustado para que el
+ * conjunto siga la curva con menos de 0.1 dB de error de 20 Hz a 6.3 kHz (la bilineal
+ * se desviaría 6 dB a 6.3 kHz). Cada biquad tiene ganancia máxima 1, así que no
+ * desborda; lo que falta para que 1 kHz dé 0 dB se suma al final en dB.
+ *
+ * Las muestras entran en Q31 con 2 bits de margen (<< 14): los transitorios del
+ * filtro caben sin saturar.
+ */
+class NivelRuido {
+public:
+
+  static const uint32_t FRECUENCIA_HZ = 16000;
+  static const uint16_t MAXIMO_MUESTRAS = 256; ///< Muestras por bloque como mucho (16 ms).
+  static const uint8_t SECCIONES = 3;
+
+private:
+
+  /// b0, b1, b2, a1, a2 de cada sección, divididos por 2 (postShift = 1), en Q31.
+  /// Las a van con el signo de CMSIS: y = b0 x + b1 x1 + b2 x2 + a1 y1 + a2 y2.
+  static const int32_t * coeficientes() {
+	static const int32_t c[5 * SECCIONES] = {
+	  1065108519, -2130217039, 1065108519, 2130182185, -1056510057, // 20.6 Hz (doble)
+	  918452683, -1836905366, 918452683, 1831277025, -768785805,    // 107.7 Hz y 737.9 Hz
+	  182508024, 1084502928, 726634866, -870884189, -49018537       // 12.2 kHz (doble, ajustado)
+	};
+	return c;
+  } // ()
+
+  static const uint8_t POST_SHIFT = 1;
+
+  /// Ganancia del filtro a 1 kHz, en dB (se compensa en decibelios()).
+  static double ganancia1kHzDb() { return -1.9560708; }
+
+  /// Lo que se pierde al meter las muestras con << 14 en vez de << 16, en dB.
+  static double margenDb() { return 12.0411998; } // 20 log10( 4 )
+
+  /// 0 dBFS es un seno a fondo de escala (AES17), como en las hojas de los micrófonos.
+  static double senoFondoEscalaDb() { return 3.0103000; } // 10 log10( 2 )
+
+  double calibracionDb;
+
+  int32_t bloque[MAXIMO_MUESTRAS]; ///< El bloque en Q31, filtrado en el sitio.
+
+#ifdef NIVEL_RUIDO_CON_CMSIS
+  arm_biquad_casd_df1_inst_q31 filtro;
+  q31_t estado[4 * SECCIONES];
+#else
+  int32_t estado[4 * SECCIONES]; ///< x[n-1], x[n-2], y[n-1], y[n-2] de cada sección (como CMSIS).
+
+  // .........................................................
+  // arm_biquad_cascade_df1_q31, sin desenrollar
+  // .........................................................
+  void filtrar( int32_t * datos, uint16_t n ) {
+	const int32_t * c = coeficientes();
+	const uint32_t desplazamiento = 31 - POST_SHIFT;
+	for ( uint8_t s = 0; s < SECCIONES; s++ ) {
+	  int32_t b0 = c[5*s], b1 = c[5*s + 1], b2 = c[5*s + 2], a1 = c[5*s + 3], a2 = c[5*s + 4];
+	  int32_t * e = &(*this).estado[4*s];
+	  int32_t x1 = e[0], x2 = e[1], y1 = e[2], y2 = e[3];
+	  for ( uint16_t i = 0; i < n; i++ ) {
+		int32_t x = datos[i];
+		int64_t acc = (int64_t) b0 * x;
+		acc += (int64_t) b1 * x1;
+		acc += (int64_t) b2 * x2;
+		acc += (int64_t) a1 * y1;
+		acc += (int64_t) a2 * y2;
+		int32_t y = (int32_t) ( acc >> desplazamiento );
+		x2 = x1;
+		x1 = x;
+		y2 = y1;
+		y1 = y;
+		datos[i] = y;
+	  }
+	  e[0] = x1; e[1] = x2; e[2] = y1; e[3] = y2;
+	} // for
+  } // ()
+
+  // .........................................................
+  // arm_power_q31: suma de cuadrados en formato 16.48
+  // .........................................................
+  static int64_t potencia( const int32_t * datos, uint16_t n ) {
+	int64_t suma = 0;
+	for ( uint16_t i = 0; i < n; i++ ) {
+	  suma += ( (int64_t) datos[i] * datos[i] ) >> 14;
+	}
+	return suma;
+  } // ()
+#endif
+
+public:
+
+  // .........................................................
+  /**
+   * @brief Constructor.
+   *
+   * @param calibracionDb_ dB SPL de un seno a fondo de escala (0 dBFS). Para un
+   *                       micrófono de -26 dBFS a 94 dB SPL (p.ej. MP34DT05), 120.
+   */
+  explicit NivelRuido( double calibracionDb_ = 120.0 ) : calibracionDb( calibracionDb_ ) {
+	reiniciar();
+  } // ()
+
+  /**
+   * @brief Olvida el estado del filtro (al volver a empezar a capturar).
+   */
+  void reiniciar() {
+	for ( uint8_t i = 0; i < 4 * SECCIONES; i++ ) {
+	  (*this).estado[i] = 0;
+	}
+#ifdef NIVEL_RUIDO_CON_CMSIS
+	arm_biquad_cascade_df1_init_q31( &(*this).filtro, SECCIONES, (q31_t *) coeficientes(), (*this).estado, POST_SHIFT );
+#endif
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Filtra un bloque y devuelve su energía ponderada A.
+   *
+   * Los bloques se tienen que pasar en orden: el filtro sigue de uno a otro.
+   *
+   * @param pcm Muestras de 16 bits.
+   * @param n Cuántas (como mucho MAXIMO_MUESTRAS).
+   * @return Suma de los cuadrados, en formato 16.48 (fondo de escala = 2^48 por muestra).
+   */
+  int64_t procesarBloque( const int16_t * pcm, uint16_t n ) {
+	if ( n > MAXIMO_MUESTRAS ) {
+	  n = MAXIMO_MUESTRAS;
+	}
+	for ( uint16_t i = 0; i < n; i++ ) {
+	  (*this).bloque[i] = (int32_t) pcm[i] << 14;
+	}
+#ifdef NIVEL_RUIDO_CON_CMSIS
+	q63_t p;
+	arm_biquad_cascade_df1_q31( &(*this).filtro, (*this).bloque, (*this).bloque, n );
+	arm_power_q31( (*this).bloque, n, &p );
+	return p;
+#else
+	filtrar( (*this).bloque, n );
+	return potencia( (*this).bloque, n );
+#endif
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Nivel equivalente de una energía acumulada.
+   *
+   * @param energia Suma de lo que han devuelto procesarBloque().
+   * @param muestras Muestras que suman esos bloques.
+   * @return dB(A) SPL (con la calibración); -INFINITY si es silencio o no hay muestras.
+   */
+  double decibelios( double energia, uint32_t muestras ) const {
+	if ( muestras == 0 || energia <= 0 ) {
+	  return -INFINITY;
+	}
+	double mediaCuadrados = energia / muestras / 281474976710656.0; // 2^48
+	return 10 * log10( mediaCuadrados ) + margenDb() + senoFondoEscalaDb() - ganancia1kHzDb() + (*this).calibracionDb;
+  } // ()
+
+  /**
+   * @return dB SPL de un seno a fondo de escala.
+   */
+  double getCalibracion() const { return (*this).calibracionDb; }
+
+}; // class
+
+#endif
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
@@ -14,6 +14,8 @@
 #ifndef PUBLICADOR_H_INCLUIDO
 #define PUBLICADOR_H_INCLUIDO
 
+#include "TramasPublicador.h"
+
 /** -------------------------------------------------------------- 
  * Clase Publicador para emitir anuncios de datos ambientales.
  * 
@@ -26,7 +28,21 @@ class Publicador {
   // ............................................................
 private:
 
-  uint8_t beaconUUID[16] = { 1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16};
+  uint8_t beaconUUID[TramaIBeacon::LONGITUD_UUID]; ///< Copia de TramaIBeacon::UUID_PROYECTO.
+
+  uint32_t tramasSaturadas = 0; ///< Medidas que no cabían en su campo y se han saturado.
+
+  // ............................................................
+  // emite la trama (4 bytes) como major y minor del iBeacon
+  // ............................................................
+  void emitirTrama( const uint8_t * trama, uint32_t saturados ) {
+	if ( saturados != 0 ) {
+	  (*this).tramasSaturadas++;
+	}
+	(*this).laEmisora.emitirAnuncioIBeacon( (*this).beaconUUID,
+											TramasPublicador::major( trama ), TramasPublicador::minor( trama ),
+											TramaIBeacon::potenciaMedida( (*this).laEmisora.getPotencia() ) );
+  } // ()
 
   // ............................................................
   // ............................................................
@@ -34,10 +50,10 @@ public:
   EmisoraBLE laEmisora {
     "yesyes",   ///< Nombre de la emisora.
     0x004c,    ///< Identificación del fabricante (Apple).
-    4           ///< Potencia de transmisión (txPower).
+    4           ///< Potencia de transmisión (txPower) al arrancar.
 	  };
   
-  const int RSSI = -53; ///< Valor RSSI (Received Signal Strength Indicator).
+  // El RSSI a 1 m que va en cada trama (-53 a 4 dBm) sigue a la potencia de la emisora
 
   // ............................................................
   // ............................................................
@@ -46,12 +62,13 @@ public:
   /** --------------------------------------------------------------
    * Enumeración para las ID de las mediciones.
    * 
-   * Incluye identificadores para CO2, temperatura y ruido.
+   * Incluye identificadores para CO2, temperatura, ruido y la alarma de ozono.
    * -------------------------------------------------------------- */
   enum MedicionesID  {
-	  CO2 = 11,           ///< ID para la medición de CO2.
-    TEMPERATURA = 12,  ///< ID para la medición de temperatura.
-    RUIDO = 13         ///< ID para la medición de ruido.
+	  CO2 = TramasPublicador::ID_CO2,                 ///< ID para la medición de CO2.
+    TEMPERATURA = TramasPublicador::ID_TEMPERATURA, ///< ID para la medición de temperatura.
+    RUIDO = TramasPublicador::ID_RUIDO,             ///< ID para la medición de ruido.
+    ALARMA = TramasPublicador::ID_ALARMA            ///< ID para la alarma de ozono.
   };
 
   /** --------------------------------------------------------------
@@ -62,6 +79,7 @@ public:
    -------------------------------------------------------------- */
   
   Publicador( ) {
+	memcpy( (*this).beaconUUID, TramaIBeacon::UUID_PROYECTO, TramaIBeacon::LONGITUD_UUID );
 	// ATENCION: no hacerlo aquí. (*this).laEmisora.encenderEmisora();
 	// Pondremos un método para llamarlo desde el setup() más tarde
   } // ()
@@ -87,8 +105,7 @@ public:
 	//
 	// 1. empezamos anuncio
 	//
-	uint16_t major = (uint16_t) (valorCO2 * 10);
-	(*this).laEmisora.emitirAnuncioIBeacon( (*this).beaconUUID, major, valorCO2, (*this).RSSI);
+	(*this).empezarPublicarCO2( valorCO2, contador );
   
   /*
 	Globales::elPuerto.escribir( "   publicarCO2(): valor=" );
@@ -111,6 +128,21 @@ public:
 	(*this).laEmisora.detenerAnuncio();
   } // ()
 
+  /** --------------------------------------------------------------
+   * Empieza a anunciar el nivel de CO2 y vuelve sin esperar.
+   * 
+   * El anuncio sigue hasta que se pare (detenerAnuncio()) o empiece otro.
+   * 
+   * @param valorCO2 El valor de CO2 a publicar.
+   * @param contador Un contador que se puede utilizar para el seguimiento.
+   -------------------------------------------------------------- */
+  void empezarPublicarCO2( double valorCO2, uint8_t contador ) {
+	// major = (CO2 << 8) + contador, minor = milésimas de ppm (ver TramasPublicador.h)
+	uint8_t trama[TramasPublicador::CO2::TAM];
+	uint32_t saturados = TramasPublicador::CO2::codificar( trama, MedicionesID::CO2, contador, valorCO2 );
+	(*this).emitirTrama( trama, saturados );
+  } // ()
+
   /** --------------------------------------------------------------
    * Publica la temperatura.
    * 
@@ -121,15 +153,108 @@ public:
    * @param tiempoEspera El tiempo en milisegundos a esperar 
    *                     antes de detener el anuncio.
    -------------------------------------------------------------- */
-  void publicarTemperatura( int16_t valorTemperatura, uint8_t contador, long tiempoEspera ) {
+  void publicarTemperatura( double valorTemperatura, uint8_t contador, long tiempoEspera ) {
 
-	uint16_t major = (MedicionesID::TEMPERATURA << 8) + contador;
-	(*this).laEmisora.emitirAnuncioIBeacon( (*this).beaconUUID, major, valorTemperatura, (*this).RSSI);
+	// major = (TEMPERATURA << 8) + contador, minor = centésimas de grado (ver TramasPublicador.h)
+	uint8_t trama[TramasPublicador::Temperatura::TAM];
+	uint32_t saturados = TramasPublicador::Temperatura::codificar( trama, MedicionesID::TEMPERATURA, contador, valorTemperatura );
+	(*this).emitirTrama( trama, saturados );
 	
   esperar( tiempoEspera );
   
   (*this).laEmisora.detenerAnuncio();
   } // ()
+
+  /** --------------------------------------------------------------
+   * Empieza a anunciar el nivel de ruido y vuelve sin esperar.
+   * 
+   * @param valorRuido El nivel en dB(A), de CanalRuido::tomarNivel().
+   * @param contador Un contador que se puede utilizar para el seguimiento.
+   -------------------------------------------------------------- */
+  void empezarPublicarRuido( double valorRuido, uint8_t contador ) {
+	// major = (RUIDO << 8) + contador, minor = décimas de dB (ver TramasPublicador.h)
+	uint8_t trama[TramasPublicador::Ruido::TAM];
+	uint32_t saturados = TramasPublicador::Ruido::codificar( trama, MedicionesID::RUIDO, contador, valorRuido );
+	(*this).emitirTrama( trama, saturados );
+  } // ()
+
+  /** --------------------------------------------------------------
+   * Publica el nivel de ruido.
+   * 
+   * @param valorRuido El nivel en dB(A).
+   * @param contador Un contador que se puede utilizar para el seguimiento.
+   * @param tiempoEspera El tiempo en milisegundos a esperar 
+   *                     antes de detener el anuncio.
+   -------------------------------------------------------------- */
+  void publicarRuido( double valorRuido, uint8_t contador, long tiempoEspera ) {
+	(*this).empezarPublicarRuido( valorRuido, contador );
+
+	esperar( tiempoEspera );
+
+	(*this).laEmisora.detenerAnuncio();
+  } // ()
+
+  /** --------------------------------------------------------------
+   * Empieza a anunciar una alarma de ozono y vuelve sin esperar.
+   *
+   * Va en su propia trama (ALARMA) y al intervalo más corto que se puede
+   * (EmisoraBLE::INTERVALO_MINIMO), para que los receptores la vean cuanto antes;
+   * los anuncios que vengan después vuelven al intervalo configurado.
+   *
+   * @param valorGas Las ppm de ozono que la han disparado (o las últimas medidas).
+   * @param numeroAlarma Cuenta de alarmas, para saber si es una nueva.
+   -------------------------------------------------------------- */
+  void empezarPublicarAlarma( double valorGas, uint8_t numeroAlarma ) {
+	// major = (ALARMA << 8) + número, minor = milésimas de ppm (ver TramasPublicador.h)
+	uint8_t trama[TramasPublicador::Alarma::TAM];
+	uint32_t saturados = TramasPublicador::Alarma::codificar( trama, MedicionesID::ALARMA, numeroAlarma, valorGas );
+	uint16_t intervalo = (*this).laEmisora.getIntervaloAnuncio();
+	(*this).laEmisora.ajustarIntervaloAnuncio( EmisoraBLE::INTERVALO_MINIMO );
+	(*this).emitirTrama( trama, saturados );
+	(*this).laEmisora.ajustarIntervaloAnuncio( intervalo ); // vale para el siguiente anuncio
+  } // ()
+
+  /** --------------------------------------------------------------
+   * Empieza a anunciar el resumen de una ventana y vuelve sin esperar.
+   * 
+   * El resumen ocupa toda la carga del iBeacon (ver TramasPublicador.h),
+   * así que se emite como anuncio libre, sin el uuid del proyecto.
+   * 
+   * @param id La medida resumida (da la escala de los valores).
+   * @param ventana Número de la ventana, para saber si es un resumen nuevo.
+   * @param resumen Lo que ha dado EstadisticasVentana::resumir().
+   -------------------------------------------------------------- */
+  void empezarPublicarResumen( MedicionesID id, uint8_t ventana, const ResumenVentana & resumen ) {
+	uint8_t carga[TramaIBeacon::LONGITUD_CARGA];
+	if ( TramasPublicador::codificarResumen( carga, id, ventana, resumen ) != 0 ) {
+	  (*this).tramasSaturadas++;
+	}
+	(*this).laEmisora.emitirAnuncioIBeaconLibre( (const char *) carga, TramaIBeacon::LONGITUD_CARGA );
+  } // ()
+
+  /** --------------------------------------------------------------
+   * Publica el resumen de una ventana.
+   * 
+   * @param id La medida resumida.
+   * @param ventana Número de la ventana.
+   * @param resumen Lo que ha dado EstadisticasVentana::resumir().
+   * @param tiempoEspera El tiempo en milisegundos a esperar 
+   *                     antes de detener el anuncio.
+   -------------------------------------------------------------- */
+  void publicarResumen( MedicionesID id, uint8_t ventana, const ResumenVentana & resumen, long tiempoEspera ) {
+	(*this).empezarPublicarResumen( id, ventana, resumen );
+
+	esperar( tiempoEspera );
+
+	(*this).laEmisora.detenerAnuncio();
+  } // ()
+
+  /** --------------------------------------------------------------
+   * @return Número de medidas que se han publicado saturadas (no cabían).
+   -------------------------------------------------------------- */
+  uint32_t getTramasSaturadas() const {
+	return (*this).tramasSaturadas;
+  } // ()
 	
 }; // class
 
@@ -5,7 +5,8 @@
  * Fecha: 30 de septiembre de 2024
  *
  * Este archivo ha sido realizado por Carla Rumeu Montesinos y Elena Ruiz de la Blanca el 30 de septiembre de 2024.
- * Contiene la implementación de la clase PuertoSerie, que simplifica la inicialización y la escritura en el puerto serie
+ * Contiene la implementación de la clase PuertoSerie, que simplifica la inicialización, la escritura (por niveles)
+ * y la lectura sin esperar del puerto serie
  * de un microcontrolador como un Arduino.
  * 
  * Todos los derechos reservados.
@@ -14,6 +15,9 @@
 #ifndef PUERTO_SERIE_H_INCLUIDO
 #define PUERTO_SERIE_H_INCLUIDO
 
+#include <atomic>
+#include <type_traits>
+
 /**
  * Clase PuertoSerie para la comunicación a través del puerto serie.
  * 
@@ -23,6 +27,86 @@
 class PuertoSerie  {
 
 public:
+
+  /// @brief Función que recibe lo que se escribe mientras el puerto está redirigido.
+  using Redireccion = void ( const char * texto );
+
+  /// @brief Niveles del registro (ajustarNivel()).
+  enum Nivel {
+	NADA = 0,   ///< escribir() no saca nada (sólo escribirSiempre(), p.ej. la consola).
+	AVISOS = 1, ///< Lo que pasa de vez en cuando (configuración, alarmas, volcados...), sin lo de cada vuelta.
+	TODO = 2    ///< También lo de cada vuelta y cada medida (lo de siempre).
+  };
+
+private:
+
+  Redireccion * redireccion = nullptr;
+
+  std::atomic<uint8_t> nivel { TODO };
+
+  // .........................................................
+  // el mensaje como texto, igual que lo escribiría Serial.print()
+  // .........................................................
+  static const char * aTexto( char *, const char * mensaje ) {
+	return mensaje;
+  } // ()
+
+  static const char * aTexto( char * texto, char c ) {
+	texto[0] = c;
+	texto[1] = '\0';
+	return texto;
+  } // ()
+
+  template<typename T>
+  static const char * aTexto( char * texto, T n, typename std::enable_if< std::is_integral<T>::value >::type * = nullptr ) {
+	char cifras[21];
+	uint8_t k = 0;
+	bool negativo = n < 0;
+	unsigned long long magnitud = negativo ? 0ULL - (unsigned long long) n : (unsigned long long) n;
+	do {
+	  cifras[k++] = '0' + magnitud % 10;
+	  magnitud /= 10;
+	} while ( magnitud > 0 );
+	char * p = texto;
+	if ( negativo ) {
+	  *p++ = '-';
+	}
+	while ( k > 0 ) {
+	  *p++ = cifras[--k];
+	}
+	*p = '\0';
+	return texto;
+  } // ()
+
+  // con 2 decimales, como Serial.print( double )
+  static const char * aTexto( char * texto, double x ) {
+	if ( x != x ) {
+	  return "nan";
+	}
+	if ( x > 4294967040.0 || x < -4294967040.0 ) {
+	  return "ovf";
+	}
+	char * p = texto;
+	if ( x < 0 ) {
+	  *p++ = '-';
+	  x = -x;
+	}
+	x += 0.005;
+	unsigned long entera = (unsigned long) x;
+	unsigned long centesimas = (unsigned long) ( ( x - entera ) * 100 );
+	aTexto( p, entera );
+	while ( *p != '\0' ) {
+	  p++;
+	}
+	*p++ = '.';
+	*p++ = '0' + centesimas / 10;
+	*p++ = '0' + centesimas % 10;
+	*p = '\0';
+	return texto;
+  } // ()
+
+public:
+
   /**
    * Constructor de la clase PuertoSerie.
    * 
@@ -49,6 +133,32 @@ public:
 
   } // ()
 
+  /**
+   * Espera a que la comunicación serie esté disponible, como mucho un tiempo.
+   * 
+   * Sin ordenador conectado por USB Serial no está nunca disponible; con este
+   * método la placa arranca igualmente (lo que se escriba mientras tanto se pierde).
+   * 
+   * @param maximoMs Milisegundos como mucho (0 = no esperar).
+   * @return true si está disponible.
+   */
+  bool esperarDisponible( unsigned long maximoMs ) {
+
+	unsigned long inicio = millis();
+	while ( !Serial && millis() - inicio < maximoMs ) {
+	  delay(10);
+	}
+	return disponible();
+
+  } // ()
+
+  /**
+   * @return true si hay un ordenador escuchando en el puerto serie.
+   */
+  bool disponible() {
+	return (bool) Serial;
+  } // ()
+
   /**
    * Envía un mensaje a través del puerto serie.
    * 
@@ -60,8 +170,85 @@ public:
    */
   template<typename T>
   void escribir (T mensaje) {
+	if ( ! muestra( AVISOS ) ) {
+	  return;
+	}
+	escribirSiempre( mensaje );
+  } // ()
+
+  /**
+   * Como escribir(), pero aunque el nivel sea NADA (lo que contesta la consola, las trazas).
+   * 
+   * @tparam T Tipo del mensaje a enviar.
+   * @param mensaje Mensaje que se desea enviar al puerto serie.
+   */
+  template<typename T>
+  void escribirSiempre (T mensaje) {
+	if ( redireccion != nullptr ) {
+	  char texto[24];
+	  redireccion( aTexto( texto, mensaje ) );
+	  return;
+	}
+	Serial.print( mensaje );
+  } // ()
+
+  /**
+   * Escribe directamente en el puerto serie aunque esté redirigido.
+   * 
+   * Es lo que usa quien vacía la redirección (la tarea de registro).
+   * 
+   * @tparam T Tipo del mensaje a enviar.
+   * @param mensaje Mensaje que se desea enviar al puerto serie.
+   */
+  template<typename T>
+  void escribirYa (T mensaje) {
 	Serial.print( mensaje );
   } // ()
+
+  /**
+   * Hace que escribir() pase el texto a una función en vez de al puerto serie.
+   * 
+   * Con las tareas de FreeRTOS la función lo mete en la cola de la tarea de registro,
+   * de forma que quien escribe no espera a Serial. Los números se pasan a texto
+   * como los escribe Serial.print() (los double con 2 decimales).
+   * 
+   * @param r La función (nullptr para volver a escribir en el puerto serie).
+   */
+  void redirigir( Redireccion * r ) {
+	redireccion = r;
+  } // ()
+
+  /**
+   * Cambia lo que se escribe (lo puede cambiar una tarea mientras escriben otras).
+   * 
+   * escribir() no saca nada con NADA; lo de cada vuelta lo escribe quien llama sólo si
+   * muestra( TODO ).
+   * 
+   * @param n NADA, AVISOS o TODO.
+   */
+  void ajustarNivel( uint8_t n ) {
+	nivel.store( n > TODO ? (uint8_t) TODO : n, std::memory_order_relaxed );
+  } // ()
+
+  uint8_t getNivel() const {
+	return nivel.load( std::memory_order_relaxed );
+  } // ()
+
+  /**
+   * @return true si con el nivel actual se escribe lo de ese nivel.
+   */
+  bool muestra( uint8_t n ) const {
+	return getNivel() >= n;
+  } // ()
+
+  /**
+   * Saca el siguiente byte que ha llegado por el puerto serie, sin esperar.
+   * 
+   * @return El byte, o -1 si no ha llegado nada.
+   */
+  int leer() {
+	return Serial.available() > 0 ? Serial.read() : -1;
+  } // ()
   
 }; // class PuertoSerie
 
@@ -0,0 +1,145 @@
+/*
+ * Nombre del fichero: ReferenciaLenta.h
+ * Descripción: Estimación filtrada de la tensión de referencia del sensor, que se lee de tarde en tarde.
+ * Autores: agent
+ * Fecha: 18 de octubre de 2026
+ *
+ * Este archivo ha sido realizado por agent.
+ * Contiene la clase ReferenciaLenta. Vref es muy estable, así que no hace falta leerla en
+ * cada medida del gas: se lee una vez cada cierto número de medidas, se filtra mucho
+ * (media exponencial en coma fija) y entre lectura y lectura se usa el valor guardado.
+ * Así se hace la mitad de trabajo con el ADC y el ruido de Vref casi no llega a
+ * vgas - vref. Si una lectura se aleja de golpe, se vuelve a leer en la medida siguiente
+ * y, si se confirma el salto, la estimación se pone en el valor nuevo sin esperar al
+ * filtro. Un salto sólo se puede ver al leer Vref, así que tarda como mucho el periodo
+ * en notarse. No depende de Arduino.
+ *
+ * Todos los derechos reservados.
+ */
+
+#ifndef REFERENCIA_LENTA_H_INCLUIDO
+#define REFERENCIA_LENTA_H_INCLUIDO
+
+#include <stdint.h>
+
+// ----------------------------------------------------------
+/**
+ * @brief Vref leída de tarde en tarde y filtrada.
+ *
+ * Uso, en cada medida del gas:
+ * @code
+ * if ( ref.tocaLeer() ) {
+ *   ref.anyadir( analogRead( pinVref ) );
+ * }
+ * double aref = ref.valor();
+ * @endcode
+ */
+class ReferenciaLenta {
+private:
+
+  uint16_t periodo;        ///< Medidas entre dos lecturas de Vref.
+  uint8_t desplazamiento;  ///< El filtro se acerca 1 / 2^desplazamiento a cada lectura.
+  uint16_t umbralSalto;    ///< Cuentas del ADC a partir de las que una lectura es un salto.
+
+  int32_t estimacion = 0;  ///< En cuentas del ADC con 16 bits de decimales.
+  uint16_t desdeUltima = 0;
+  bool iniciada = false;
+  bool confirmando = false; ///< La última lectura ha saltado: se vuelve a leer ya.
+  int32_t candidato = 0;    ///< La lectura que ha saltado.
+
+  uint32_t lecturas = 0;
+  uint32_t saltos = 0;
+
+  static int32_t distancia( int32_t a, int32_t b ) {
+	return a > b ? a - b : b - a;
+  }
+
+public:
+
+  // .........................................................
+  /**
+   * @brief Constructor.
+   *
+   * @param periodo_ Una lectura de Vref cada tantas medidas (1 = siempre).
+   * @param desplazamiento_ Fuerza del filtro (4: cada lectura cuenta 1/16).
+   * @param umbralSalto_ Diferencia, en cuentas del ADC, que se toma por salto y no por ruido.
+   */
+  ReferenciaLenta( uint16_t periodo_ = 16, uint8_t desplazamiento_ = 4, uint16_t umbralSalto_ = 8 )
+	: periodo( periodo_ > 0 ? periodo_ : 1 ), desplazamiento( desplazamiento_ ), umbralSalto( umbralSalto_ ) {
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Dice si en esta medida hay que leer Vref (llamar una vez por medida).
+   */
+  bool tocaLeer() {
+	if ( ! (*this).iniciada || (*this).confirmando ) {
+	  return true;
+	}
+	if ( ++(*this).desdeUltima >= (*this).periodo ) {
+	  (*this).desdeUltima = 0;
+	  return true;
+	}
+	return false;
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Pasa una lectura de Vref por el filtro.
+   *
+   * Una lectura lejos de la estimación no se filtra: se guarda como candidata y
+   * tocaLeer() pide otra enseguida. Si la siguiente está cerca de la candidata es un
+   * salto de verdad y la estimación pasa a ser la media de las dos; si no, era ruido.
+   *
+   * @param lectura Lectura del ADC.
+   */
+  void anyadir( int lectura ) {
+	(*this).lecturas++;
+	int32_t x = (int32_t) lectura << 16;
+	if ( ! (*this).iniciada ) {
+	  (*this).estimacion = x;
+	  (*this).iniciada = true;
+	  return;
+	}
+
+	bool lejos = distancia( lectura, (int32_t) ( (*this).estimacion >> 16 ) ) > (*this).umbralSalto;
+	if ( (*this).confirmando && lejos && distancia( lectura, (*this).candidato ) <= (*this).umbralSalto ) {
+	  (*this).estimacion = ( (int32_t) ( lectura + (*this).candidato ) << 16 ) / 2;
+	  (*this).confirmando = false;
+	  (*this).desdeUltima = 0;
+	  (*this).saltos++;
+	  return;
+	}
+	(*this).confirmando = lejos;
+	if ( lejos ) {
+	  (*this).candidato = lectura;
+	  return;
+	}
+	(*this).estimacion += ( x - (*this).estimacion ) / ( (int32_t) 1 << (*this).desplazamiento );
+  } // ()
+
+  /**
+   * @return Vref estimada, en cuentas del ADC.
+   */
+  double valor() const {
+	return (*this).estimacion / 65536.0;
+  } // ()
+
+  /**
+   * @return Lecturas de Vref hechas.
+   */
+  uint32_t getLecturas() const { return (*this).lecturas; }
+
+  /**
+   * @return Saltos confirmados.
+   */
+  uint32_t getSaltos() const { return (*this).saltos; }
+
+}; // class
+
+#endif
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
@@ -75,6 +75,10 @@ public:
    * @brief Definición de un tipo para el callback de características escritas.
    */
   using CallbackCaracteristicaEscrita = void(uint16_t conn_handle, BLECharacteristic* chr, uint8_t* data, uint16_t len);
+  /**
+   * @brief Definición de un tipo para el callback de suscripción (la central escribe el CCCD).
+   */
+  using CallbackSuscripcion = void(uint16_t conn_handle, BLECharacteristic* chr, uint16_t valorCCCD);
   /**
    * @brief Clase Caracteristica para manejar características de BLE.
    */
@@ -180,6 +184,17 @@ public:
 
     }  // ()
 
+    /**
+     * @brief Escribe bytes en la característica (lo que leerán las centrales).
+     * 
+     * @param datos Bytes a escribir.
+     * @param n Número de bytes.
+     * @return Número de bytes escritos.
+     */
+    uint16_t escribirDatos(const uint8_t* datos, uint16_t n) {
+      return (*this).laCaracteristica.write(datos, n);
+    }  // ()
+
     /**
      * @brief Notifica datos a los clientes conectados.
      * 
@@ -193,6 +208,27 @@ public:
       return r;
     }  //  ()
 
+    /**
+     * @brief Notifica datos a una sola central.
+     * 
+     * @param connHandle Conexión a la que se notifica.
+     * @param datos Bytes a notificar.
+     * @param n Número de bytes.
+     * @return true si se ha entregado (la central está suscrita).
+     */
+    bool notificarDatos(uint16_t connHandle, const uint8_t* datos, uint16_t n) {
+      return (*this).laCaracteristica.notify(connHandle, datos, n);
+    }  // ()
+
+    /**
+     * @brief Instala un callback que se ejecutará cuando una central active o desactive las notificaciones.
+     * 
+     * @param cb Callback a instalar.
+     */
+    void instalarCallbackSuscripcion(CallbackSuscripcion cb) {
+      (*this).laCaracteristica.setCccdWriteCallback(cb);
+    }  // ()
+
     /**
      * @brief Instala un callback que se ejecutará cuando la característica sea escrita.
      * 
@@ -211,6 +247,13 @@ public:
       Globales::elPuerto.escribir(error);
     }  // ()
 
+    /**
+     * @brief Conversión de tipo implícita a BLECharacteristic.
+     */
+    operator BLECharacteristic&() {
+      return laCaracteristica;
+    }  // ()
+
   };  // class Caracteristica
 
   // --------------------------------------------------------
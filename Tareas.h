@@ -0,0 +1,187 @@
+/*
+ * Nombre del fichero: Tareas.h
+ * Descripción: Tareas de FreeRTOS con presupuesto de pila y cuenta del tiempo ocupado, y colas de tamaño fijo entre ellas.
+ * Autores: agent
+ * Fecha: 18 de octubre de 2026
+ *
+ * Este archivo ha sido realizado por agent.
+ * Contiene la clase Tarea, que crea una tarea de FreeRTOS con su nombre, prioridad y pila
+ * y lleva la cuenta del tiempo que trabaja, y la plantilla ColaTareas, una cola de FreeRTOS
+ * de elementos de un tipo fijo que nunca bloquea al que mete (si está llena, cuenta el
+ * elemento como perdido). En la placa FreeRTOS lo trae el núcleo nRF52 de Arduino; en el
+ * ordenador, simulacion/rtos.h.
+ *
+ * Todos los derechos reservados.
+ */
+
+#ifndef TAREAS_H_INCLUIDO
+#define TAREAS_H_INCLUIDO
+
+#include <atomic>
+
+// ----------------------------------------------------------
+/**
+ * @brief Cola de FreeRTOS de LONGITUD elementos de tipo T (se copian enteros).
+ *
+ * meter() no espera nunca: el que produce (p.ej. la tarea de adquisición) no se
+ * puede quedar parado porque el que consume vaya lento.
+ */
+template< typename T, uint8_t LONGITUD >
+class ColaTareas {
+private:
+
+  QueueHandle_t cola = nullptr;
+  std::atomic<uint32_t> perdidos { 0 }; ///< Elementos que no cabían.
+
+public:
+
+  /// Para sacar(): esperar hasta que haya algo.
+  static const uint32_t ESPERAR_SIEMPRE = 0xffffffff;
+
+  /**
+   * @brief Crea la cola (antes de arrancar las tareas que la usan).
+   * @return false si no hay memoria.
+   */
+  bool crear() {
+	(*this).cola = xQueueCreate( LONGITUD, sizeof(T) );
+	return (*this).cola != nullptr;
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Mete una copia del elemento sin esperar.
+   * @return false si estaba llena (se cuenta como perdido).
+   */
+  bool meter( const T & elemento ) {
+	if ( (*this).cola == nullptr || xQueueSend( (*this).cola, &elemento, 0 ) != pdTRUE ) {
+	  (*this).perdidos++;
+	  return false;
+	}
+	return true;
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Saca el elemento más antiguo, esperando como mucho esperaMs.
+   * @return false si no ha llegado nada.
+   */
+  bool sacar( T & elemento, uint32_t esperaMs ) {
+	TickType_t espera = esperaMs == ESPERAR_SIEMPRE ? portMAX_DELAY : pdMS_TO_TICKS( esperaMs );
+	return xQueueReceive( (*this).cola, &elemento, espera ) == pdTRUE;
+  } // ()
+
+  /**
+   * @return Elementos esperando.
+   */
+  uint8_t pendientes() const {
+	return (*this).cola != nullptr ? (uint8_t) uxQueueMessagesWaiting( (*this).cola ) : 0;
+  } // ()
+
+  /**
+   * @return Elementos que no cabían desde que se creó.
+   */
+  uint32_t getPerdidos() const { return (*this).perdidos.load(); }
+
+}; // class
+
+// ----------------------------------------------------------
+/**
+ * @brief Una tarea de FreeRTOS con su presupuesto de pila y la cuenta de su tiempo ocupado.
+ *
+ * El cuerpo es un bucle que no acaba. Rodea lo que hace de verdad (no las esperas)
+ * con empezarTrabajo() y acabarTrabajo(); con eso se sabe qué parte del tiempo está
+ * ocupada cada tarea. No es su CPU: es tiempo de reloj (micros()), e incluye lo que la
+ * tarea pasa desalojada por otra de más prioridad o bloqueada dentro del trabajo (p.ej.
+ * esperando a que Serial tenga sitio). La CPU de verdad la darían las estadísticas de
+ * FreeRTOS (ulTaskGetRunTimeCounter()), que el núcleo trae apagadas.
+ */
+class Tarea {
+public:
+
+  /// @brief Lo que hace la tarea (no vuelve).
+  using Cuerpo = void ( Tarea & yo );
+
+private:
+
+  const char * nombre;
+  UBaseType_t prioridad;
+  uint16_t pila;           ///< En palabras (StackType_t), como xTaskCreate().
+  Cuerpo * cuerpo;
+  TaskHandle_t manejador = nullptr;
+
+  unsigned long usInicioTrabajo = 0;
+  std::atomic<uint32_t> usOcupada { 0 }; ///< Desde el último tomarUsOcupada().
+
+  static void trampolin( void * parametro ) {
+	Tarea * yo = (Tarea *) parametro;
+	(*yo).cuerpo( *yo );
+	vTaskDelete( nullptr ); // por si vuelve
+  } // ()
+
+public:
+
+  // .........................................................
+  /**
+   * @brief Constructor (la tarea no empieza hasta arrancar()).
+   *
+   * @param nombre_ Nombre (lo ve FreeRTOS y sale en el informe).
+   * @param prioridad_ TASK_PRIO_LOWEST ... TASK_PRIO_HIGH.
+   * @param pila_ Pila en palabras de 4 bytes.
+   * @param cuerpo_ Lo que hace la tarea.
+   */
+  Tarea( const char * nombre_, UBaseType_t prioridad_, uint16_t pila_, Cuerpo * cuerpo_ )
+	: nombre( nombre_ ), prioridad( prioridad_ ), pila( pila_ ), cuerpo( cuerpo_ ) {
+  } // ()
+
+  /**
+   * @brief Crea la tarea de FreeRTOS, que empieza enseguida.
+   * @return false si no hay memoria para su pila.
+   */
+  bool arrancar() {
+	return xTaskCreate( trampolin, (*this).nombre, (*this).pila, this, (*this).prioridad, &(*this).manejador ) == pdPASS;
+  } // ()
+
+  /**
+   * @brief Desde la tarea: empieza un trozo de trabajo.
+   */
+  void empezarTrabajo() {
+	(*this).usInicioTrabajo = micros();
+  } // ()
+
+  /**
+   * @brief Desde la tarea: acaba el trozo de trabajo empezado.
+   */
+  void acabarTrabajo() {
+	(*this).usOcupada += (uint32_t) ( micros() - (*this).usInicioTrabajo );
+  } // ()
+
+  /**
+   * @brief Tiempo ocupado (de reloj) desde la llamada anterior (y vuelve a contar desde 0).
+   * @return us.
+   */
+  uint32_t tomarUsOcupada() {
+	return (*this).usOcupada.exchange( 0 );
+  } // ()
+
+  /**
+   * @return Lo que no ha llegado a usarse nunca de la pila, en bytes.
+   */
+  uint32_t getPilaLibre() const {
+	return (*this).manejador != nullptr ? uxTaskGetStackHighWaterMark( (*this).manejador ) * sizeof(StackType_t) : 0;
+  } // ()
+
+  /**
+   * @return La pila reservada, en bytes.
+   */
+  uint32_t getPila() const { return (*this).pila * sizeof(StackType_t); }
+
+  const char * getNombre() const { return (*this).nombre; }
+
+}; // class
+
+#endif
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
@@ -0,0 +1,182 @@
+/*
+ * Nombre del fichero: TelemetriaNodo.h
+ * Descripción: Salud y estadísticas del nodo para la respuesta de escaneo.
+ * Autores: agent
+ * Fecha: 18 de octubre de 2026
+ *
+ * Este archivo ha sido realizado por agent.
+ * Contiene DatosTelemetria (lo que se publica: versión del firmware, minutos encendido,
+ * periodo de la vuelta, muestras y líneas perdidas y huella de la configuración) y la
+ * clase TelemetriaNodo, que acumula el periodo de cada vuelta: media exponencial y máximo
+ * de las últimas vueltas. Todo va en milisegundos o minutos enteros, y los periodos con
+ * una banda muerta, para que los datos sólo cambien de verdad de vez en cuando (y no con
+ * el milisegundo arriba o abajo de cada vuelta). No depende de Arduino.
+ *
+ * Todos los derechos reservados.
+ */
+
+#ifndef TELEMETRIA_NODO_H_INCLUIDO
+#define TELEMETRIA_NODO_H_INCLUIDO
+
+#include <stdint.h>
+
+// ----------------------------------------------------------
+/**
+ * @brief Lo que publica el nodo sobre sí mismo (ver TramasPublicador::Telemetria).
+ */
+struct DatosTelemetria {
+  uint8_t versionMayor = 0;
+  uint8_t versionMenor = 0;
+  uint32_t minutosEncendido = 0;
+  uint16_t periodoMedioMs = 0;   ///< Media exponencial del periodo de la vuelta.
+  uint16_t periodoMaximoMs = 0;  ///< El más largo de las últimas vueltas.
+  uint32_t muestrasPerdidas = 0; ///< Desde el arranque.
+  uint32_t lineasPerdidas = 0;   ///< Del registro por el puerto serie, desde el arranque.
+  uint32_t huellaConfiguracion = 0; ///< Configuracion::huella() de la que se está usando.
+}; // struct
+
+// ----------------------------------------------------------
+/**
+ * @brief Acumula el periodo de las vueltas y arma los DatosTelemetria.
+ *
+ * La media es exponencial (cada vuelta cuenta 1 / 2^DESPLAZAMIENTO) y el máximo, el
+ * de la ventana de VUELTAS_VENTANA vueltas en curso o el de la anterior, el mayor:
+ * así un pico se ve durante al menos una ventana entera y luego se olvida. Los dos se
+ * publican con una banda muerta de BANDA_MUERTA_MS: hasta que no se mueven eso, se
+ * sigue publicando el valor anterior.
+ *
+ * @section ejemplos Ejemplo de uso
+ * @code
+ * TelemetriaNodo telemetria( 1, 2 );
+ * telemetria.anyadirPeriodo( ahora - antes );
+ * DatosTelemetria d = telemetria.datos( millis(), perdidas, 0, configuracion.huella() );
+ * @endcode
+ */
+class TelemetriaNodo {
+public:
+
+  static const uint8_t DESPLAZAMIENTO = 3;    ///< Media exponencial con alfa = 1/8.
+  static const uint8_t VUELTAS_VENTANA = 32;  ///< Vueltas de cada ventana del máximo.
+  static const uint16_t BANDA_MUERTA_MS = 8;  ///< Lo que tiene que moverse un periodo para publicarlo.
+
+private:
+
+  uint8_t versionMayor;
+  uint8_t versionMenor;
+
+  uint32_t mediaEscalada = 0; ///< Media del periodo en ms << DESPLAZAMIENTO.
+  bool hayPeriodo = false;
+  uint16_t maximoVentana = 0;
+  uint16_t maximoAnterior = 0;
+  uint8_t vueltasVentana = 0;
+  uint16_t medioPublicado = 0;
+  uint16_t maximoPublicado = 0;
+
+  // .........................................................
+  // el valor a publicar: el nuevo sólo si se ha salido de la banda muerta
+  // .........................................................
+  static uint16_t conBandaMuerta( uint16_t publicado, uint16_t valor ) {
+	uint16_t diferencia = valor > publicado ? valor - publicado : publicado - valor;
+	return diferencia >= BANDA_MUERTA_MS ? valor : publicado;
+  } // ()
+
+public:
+
+  // .........................................................
+  /**
+   * @brief Constructor.
+   *
+   * @param versionMayor_ Versión del firmware (mayor).
+   * @param versionMenor_ Versión del firmware (menor).
+   */
+  TelemetriaNodo( uint8_t versionMayor_, uint8_t versionMenor_ )
+	: versionMayor( versionMayor_ ), versionMenor( versionMenor_ ) {
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Apunta el periodo de una vuelta.
+   *
+   * @param ms Desde el principio de la vuelta anterior (se satura en 65535).
+   */
+  void anyadirPeriodo( uint32_t ms ) {
+	uint16_t p = ms > 0xffff ? 0xffff : (uint16_t) ms;
+	bool primero = ! (*this).hayPeriodo;
+	if ( primero ) {
+	  (*this).mediaEscalada = (uint32_t) p << DESPLAZAMIENTO;
+	  (*this).hayPeriodo = true;
+	} else {
+	  // media += ( p - media ) / 2^DESPLAZAMIENTO, en enteros (redondeando, para que no se quede corta)
+	  uint32_t media = ( (*this).mediaEscalada + ( 1u << ( DESPLAZAMIENTO - 1 ) ) ) >> DESPLAZAMIENTO;
+	  (*this).mediaEscalada = (*this).mediaEscalada - media + p;
+	}
+
+	if ( p > (*this).maximoVentana ) {
+	  (*this).maximoVentana = p;
+	}
+	if ( ++(*this).vueltasVentana >= VUELTAS_VENTANA ) {
+	  (*this).maximoAnterior = (*this).maximoVentana;
+	  (*this).maximoVentana = 0;
+	  (*this).vueltasVentana = 0;
+	}
+
+	uint16_t medio = (uint16_t) ( ( (*this).mediaEscalada + ( 1u << ( DESPLAZAMIENTO - 1 ) ) ) >> DESPLAZAMIENTO );
+	uint16_t maximo = (*this).maximoVentana > (*this).maximoAnterior ? (*this).maximoVentana : (*this).maximoAnterior;
+	(*this).medioPublicado = primero ? medio : conBandaMuerta( (*this).medioPublicado, medio );
+	(*this).maximoPublicado = primero ? maximo : conBandaMuerta( (*this).maximoPublicado, maximo );
+	if ( (*this).medioPublicado > (*this).maximoPublicado ) {
+	  // cada uno con su banda muerta, o la media que aún baja tras acortar el periodo:
+	  // lo publicado nunca dice que la media pasa del máximo
+	  (*this).medioPublicado = (*this).maximoPublicado;
+	}
+  } // ()
+
+  // .........................................................
+  /**
+   * @return Media del periodo en ms, con la banda muerta y nunca por encima de
+   * getPeriodoMaximoMs() (0 si aún no hay ninguno).
+   */
+  uint16_t getPeriodoMedioMs() const {
+	return (*this).medioPublicado;
+  } // ()
+
+  // .........................................................
+  /**
+   * @return El periodo más largo de esta ventana y de la anterior, con la banda muerta.
+   */
+  uint16_t getPeriodoMaximoMs() const {
+	return (*this).maximoPublicado;
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Arma lo que se publica.
+   *
+   * @param msEncendido millis() (se publica en minutos).
+   * @param muestrasPerdidas Muestras del gas que se han perdido desde el arranque.
+   * @param lineasPerdidas Líneas del registro que se han perdido desde el arranque.
+   * @param huellaConfiguracion Huella de la configuración en uso.
+   * @return Los datos.
+   */
+  DatosTelemetria datos( uint32_t msEncendido, uint32_t muestrasPerdidas, uint32_t lineasPerdidas,
+						 uint32_t huellaConfiguracion ) const {
+	DatosTelemetria d;
+	d.versionMayor = (*this).versionMayor;
+	d.versionMenor = (*this).versionMenor;
+	d.minutosEncendido = msEncendido / 60000;
+	d.periodoMedioMs = (*this).getPeriodoMedioMs();
+	d.periodoMaximoMs = (*this).getPeriodoMaximoMs();
+	d.muestrasPerdidas = muestrasPerdidas;
+	d.lineasPerdidas = lineasPerdidas;
+	d.huellaConfiguracion = huellaConfiguracion;
+	return d;
+  } // ()
+
+}; // class
+
+#endif
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
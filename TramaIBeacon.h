@@ -0,0 +1,168 @@
+/*
+ * Nombre del fichero: TramaIBeacon.h
+ * Descripción: Definición compartida del formato de las tramas iBeacon que emite la placa.
+ * Autores: agent
+ * Fecha: 18 de octubre de 2026
+ *
+ * Este archivo ha sido realizado por agent.
+ * Contiene las constantes y las funciones de codificación del anuncio iBeacon
+ * (prefijo 0x4c 0x00 0x02 0x15, uuid, major, minor y txPower). No depende de Arduino,
+ * de forma que el mismo fichero lo usan el firmware (EmisoraBLE, Publicador) y las
+ * herramientas de la pasarela (pasarela/DecodificadorIBeacon.h).
+ *
+ * Todos los derechos reservados.
+ */
+
+#ifndef TRAMA_IBEACON_H_INCLUIDO
+#define TRAMA_IBEACON_H_INCLUIDO
+
+#include <stdint.h>
+#include <string.h>
+
+// ----------------------------------------------------------
+// Disposición de los 30 bytes de un anuncio iBeacon
+// (ver el comentario "Ejemplo de Beacon" en EmisoraBLE.h):
+//
+//   0x02, 0x01, 0x06,        // advFlags
+//   0x1a, 0xff,              // longitud (26) y tipo: datos del fabricante
+//   0x4c, 0x00,              // companyID (Apple, little endian)
+//   0x02, 0x15,              // tipo iBeacon y longitud de la carga (21)
+//   uuid (16), major (2, big endian), minor (2, big endian), txPower (1)
+// ----------------------------------------------------------
+namespace TramaIBeacon {
+
+  const uint8_t LONGITUD_UUID = 16;   ///< Bytes del uuid.
+  const uint8_t LONGITUD_CARGA = 21;  ///< uuid 16 + major 2 + minor 2 + txPower 1.
+  const uint8_t LONGITUD_TRAMA = 30;  ///< Flags (3) + cabecera (2) + prefijo (4) + carga (21).
+  const uint8_t LONGITUD_MAXIMA_ANUNCIO = 31; ///< BLE_GAP_ADV_SET_DATA_SIZE_MAX
+
+  const uint8_t AD_TIPO_FLAGS = 0x01;      ///< BLE_GAP_AD_TYPE_FLAGS
+  const uint8_t AD_TIPO_FABRICANTE = 0xff; ///< BLE_GAP_AD_TYPE_MANUFACTURER_SPECIFIC_DATA
+  const uint8_t FLAGS_SOLO_LE = 0x06;      ///< BLE_GAP_ADV_FLAGS_LE_ONLY_GENERAL_DISC_MODE
+
+  const uint16_t ID_FABRICANTE_APPLE = 0x004c;
+
+  /// Los 4 bytes fijos que van tras el tipo 0xff: companyID, tipo iBeacon y longitud.
+  const uint8_t PREFIJO_FABRICANTE[4] = { 0x4c, 0x00, 0x02, LONGITUD_CARGA };
+
+  /// uuid con el que publican todas nuestras placas (Publicador).
+  const uint8_t UUID_PROYECTO[LONGITUD_UUID] = { 1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16 };
+
+  // posiciones dentro de la carga de 21 bytes
+  const uint8_t POS_UUID = 0;
+  const uint8_t POS_MAJOR = 16;
+  const uint8_t POS_MINOR = 18;
+  const uint8_t POS_TXPOWER = 20;
+
+  /// RSSI a 1 m emitiendo a 0 dBm: el byte txPower es esto más la potencia de emisión.
+  const int8_t RSSI_1M_0DBM = -57;
+
+  /**
+   * @brief El byte txPower (RSSI esperado a 1 m) para una potencia de emisión.
+   */
+  inline int8_t potenciaMedida( int8_t dBm ) {
+	return (int8_t) ( RSSI_1M_0DBM + dBm );
+  } // ()
+
+  /**
+   * @brief La potencia de emisión (dBm) que dice el byte txPower de una trama.
+   */
+  inline int8_t potenciaEmision( int8_t medida ) {
+	return (int8_t) ( medida - RSSI_1M_0DBM );
+  } // ()
+
+  /**
+   * @brief Escribe un entero de 16 bits en big endian (orden de red del iBeacon).
+   */
+  inline void escribirBE16( uint8_t * p, uint16_t valor ) {
+	p[0] = (uint8_t) (valor >> 8);
+	p[1] = (uint8_t) (valor & 0xff);
+  } // ()
+
+  /**
+   * @brief Lee un entero de 16 bits en big endian.
+   */
+  inline uint16_t leerBE16( const uint8_t * p ) {
+	return (uint16_t) ( (p[0] << 8) | p[1] );
+  } // ()
+
+  /**
+   * @brief Rellena la carga de 21 bytes (uuid, major, minor, txPower).
+   *
+   * @param carga Destino, al menos LONGITUD_CARGA bytes.
+   * @return Número de bytes escritos (LONGITUD_CARGA).
+   */
+  inline uint8_t codificarCarga( uint8_t * carga, const uint8_t * uuid,
+								 uint16_t major, uint16_t minor, int8_t txPower ) {
+	memcpy( &carga[POS_UUID], uuid, LONGITUD_UUID );
+	escribirBE16( &carga[POS_MAJOR], major );
+	escribirBE16( &carga[POS_MINOR], minor );
+	carga[POS_TXPOWER] = (uint8_t) txPower;
+	return LONGITUD_CARGA;
+  } // ()
+
+  /**
+   * @brief Rellena los datos de fabricante de un iBeacon (prefijo de 4 bytes + carga de 21 bytes).
+   *
+   * Es lo que emitirAnuncioIBeacon() pasa a Advertising.addData(): los mismos bytes que
+   * pondría BLEBeacon (con PREFIJO_FABRICANTE si fabricante es el de Apple, 0x004c).
+   *
+   * @param destino Destino, al menos 4 + LONGITUD_CARGA bytes.
+   * @param fabricante Id del fabricante (va en little endian).
+   * @return Número de bytes escritos (4 + LONGITUD_CARGA).
+   */
+  inline uint8_t codificarDatosFabricante( uint8_t * destino, uint16_t fabricante, const uint8_t * uuid,
+										   uint16_t major, uint16_t minor, int8_t txPower ) {
+	destino[0] = (uint8_t) ( fabricante & 0xff );
+	destino[1] = (uint8_t) ( fabricante >> 8 );
+	destino[2] = PREFIJO_FABRICANTE[2];
+	destino[3] = PREFIJO_FABRICANTE[3];
+	return 4 + codificarCarga( &destino[4], uuid, major, minor, txPower );
+  } // ()
+
+  /**
+   * @brief Rellena los datos de fabricante (prefijo de 4 bytes + carga libre de 21 bytes).
+   *
+   * Es lo que emitirAnuncioIBeaconLibre() pasa a Advertising.addData(). Si la carga
+   * es más corta que 21 bytes el resto se rellena con '-'.
+   *
+   * @param destino Destino, al menos 4 + LONGITUD_CARGA bytes.
+   * @return Número de bytes escritos (4 + LONGITUD_CARGA).
+   */
+  inline uint8_t codificarDatosFabricanteLibre( uint8_t * destino, const char * carga, uint8_t tamanyoCarga ) {
+	memcpy( &destino[0], PREFIJO_FABRICANTE, 4 );
+	memset( &destino[4], '-', LONGITUD_CARGA );
+	memcpy( &destino[4], carga, ( tamanyoCarga > LONGITUD_CARGA ? LONGITUD_CARGA : tamanyoCarga ) );
+	return 4 + LONGITUD_CARGA;
+  } // ()
+
+  /**
+   * @brief Escribe el anuncio completo (30 bytes) tal y como sale por el aire.
+   *
+   * El firmware lo construye con addData() y codificarDatosFabricante() (o
+   * codificarDatosFabricanteLibre()); esta función da exactamente los mismos bytes y la
+   * usan los simuladores y las pruebas de la pasarela.
+   *
+   * @param destino Destino, al menos LONGITUD_TRAMA bytes.
+   * @return Número de bytes escritos (LONGITUD_TRAMA).
+   */
+  inline uint8_t codificarAnuncio( uint8_t * destino, const uint8_t * uuid,
+								   uint16_t major, uint16_t minor, int8_t txPower ) {
+	destino[0] = 0x02;
+	destino[1] = AD_TIPO_FLAGS;
+	destino[2] = FLAGS_SOLO_LE;
+	destino[3] = 1 + 4 + LONGITUD_CARGA; // 0x1a
+	destino[4] = AD_TIPO_FABRICANTE;
+	memcpy( &destino[5], PREFIJO_FABRICANTE, 4 );
+	codificarCarga( &destino[9], uuid, major, minor, txPower );
+	return LONGITUD_TRAMA;
+  } // ()
+
+}; // namespace
+
+#endif
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
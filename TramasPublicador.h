@@ -0,0 +1,273 @@
+/*
+ * Nombre del fichero: TramasPublicador.h
+ * Descripción: Formato de las medidas que publica Publicador en el major y el minor del iBeacon.
+ * Autores: agent
+ * Fecha: 18 de octubre de 2026
+ *
+ * Este archivo ha sido realizado por agent.
+ * Declara con EsquemaTrama.h las tramas de cada medida y las de los resúmenes de ventana
+ * (EstadisticasVentana.h). El firmware (Publicador) las usa para codificar y la pasarela
+ * para decodificar, así que el formato está escrito en un solo sitio. No depende de Arduino.
+ *
+ * Todos los derechos reservados.
+ */
+
+#ifndef TRAMAS_PUBLICADOR_H_INCLUIDO
+#define TRAMAS_PUBLICADOR_H_INCLUIDO
+
+#include "EsquemaTrama.h"
+#include "EstadisticasVentana.h"
+#include "TelemetriaNodo.h"
+#include "TramaIBeacon.h"
+
+// ----------------------------------------------------------
+// Los 4 bytes de major (2) y minor (2), en big endian como los pone el iBeacon:
+//
+//   byte 0: id de la medida (11 CO2, 12 temperatura, 13 ruido, 14 alarma de ozono)
+//   byte 1: contador (para saber si es una medida nueva)
+//   byte 2-3: valor con signo o sin él y su escala, según la medida
+//
+// Es decir, major = (id << 8) + contador y minor = valor. La alarma lleva el gas con la
+// escala del CO2; su contador es el número de alarma, no el de la medida.
+//
+// Los resúmenes de ventana ocupan los 21 bytes de carga (anuncio libre, sin uuid):
+//
+//   byte 0: MARCA_RESUMEN
+//   byte 1: id de la medida
+//   byte 2: número de ventana (para saber si es un resumen nuevo)
+//   byte 3-4: muestras de la ventana
+//   byte 5-6: duración de la ventana en segundos
+//   byte 7-20: mínimo, máximo, media, desviación, p50, p90 y p99 (2 bytes cada uno,
+//              con la escala de la medida)
+//
+// La telemetría del nodo va en la respuesta de escaneo, detrás del id de fabricante
+// (EmisoraBLE::ajustarRespuestaEscaneo()), en 18 bytes:
+//
+//   byte 0: MARCA_TELEMETRIA
+//   byte 1-2: versión del firmware (mayor, menor)
+//   byte 3-5: minutos encendido
+//   byte 6-7: periodo medio de la vuelta en ms
+//   byte 8-9: periodo máximo de la vuelta en ms
+//   byte 10-11: muestras perdidas
+//   byte 12-13: líneas del registro perdidas
+//   byte 14-17: huella de la configuración
+// ----------------------------------------------------------
+namespace TramasPublicador {
+
+  using EsquemaTrama::Campo;
+  using EsquemaTrama::Trama;
+
+  // identificadores de las medidas (Publicador::MedicionesID)
+  const uint8_t ID_CO2 = 11;
+  const uint8_t ID_TEMPERATURA = 12;
+  const uint8_t ID_RUIDO = 13;
+  const uint8_t ID_ALARMA = 14;
+
+  /// Primer byte de la carga de un resumen (no coincide con el de UUID_PROYECTO).
+  const uint8_t MARCA_RESUMEN = 0xa5;
+
+  /// Primer byte de la telemetría en la respuesta de escaneo.
+  const uint8_t MARCA_TELEMETRIA = 0xa6;
+
+  typedef Campo<1> Id;
+  typedef Campo<1> Contador;
+
+  /// Gas (ozono): milésimas de ppm, de 0 a 65.535 ppm.
+  typedef Campo<2, false, 1000> ValorCO2;
+
+  /// Temperatura: centésimas de grado, de -327.68 a 327.67 ºC.
+  typedef Campo<2, true, 100> ValorTemperatura;
+
+  /// Ruido: décimas de dB, de 0 a 6553.5 dB.
+  typedef Campo<2, false, 10> ValorRuido;
+
+  typedef Trama< Id, Contador, ValorCO2 > CO2;
+  typedef Trama< Id, Contador, ValorTemperatura > Temperatura;
+  typedef Trama< Id, Contador, ValorRuido > Ruido;
+  typedef Trama< Id, Contador, ValorCO2 > Alarma;
+
+  static_assert( CO2::TAM == 4 && Temperatura::TAM == 4 && Ruido::TAM == 4 && Alarma::TAM == 4,
+				 "las medidas tienen que caber en major y minor" );
+
+  /// Resumen de ventana de una medida cuyos valores van en campos V.
+  template< typename V >
+  using Resumen = Trama< Campo<1>, Id, Contador, Campo<2>, Campo<2>, V, V, V, V, V, V, V >;
+
+  typedef Resumen< ValorCO2 > ResumenCO2;
+  typedef Resumen< ValorTemperatura > ResumenTemperatura;
+  typedef Resumen< ValorRuido > ResumenRuido;
+
+  static_assert( ResumenCO2::TAM == TramaIBeacon::LONGITUD_CARGA
+				 && ResumenTemperatura::TAM == TramaIBeacon::LONGITUD_CARGA
+				 && ResumenRuido::TAM == TramaIBeacon::LONGITUD_CARGA,
+				 "los resúmenes ocupan la carga del iBeacon" );
+
+  /// Telemetría del nodo (DatosTelemetria); los contadores se saturan en su campo.
+  typedef Trama< Campo<1>, Campo<1>, Campo<1>, Campo<3>, Campo<2>, Campo<2>, Campo<2>, Campo<2>, Campo<4> > Telemetria;
+
+  static_assert( 2 + 2 + Telemetria::TAM + 2 + 6 <= TramaIBeacon::LONGITUD_MAXIMA_ANUNCIO,
+				 "la telemetría y el nombre (\"yesyes\") caben en la respuesta de escaneo" );
+
+  /**
+   * @brief Major de la trama (sus 2 primeros bytes).
+   */
+  inline uint16_t major( const uint8_t * trama ) {
+	return TramaIBeacon::leerBE16( trama );
+  } // ()
+
+  /**
+   * @brief Minor de la trama (sus bytes 2 y 3).
+   */
+  inline uint16_t minor( const uint8_t * trama ) {
+	return TramaIBeacon::leerBE16( trama + 2 );
+  } // ()
+
+  /**
+   * @brief Vuelve a poner major y minor como los 4 bytes de la trama.
+   */
+  inline void desdeMajorMinor( uint8_t * trama, uint16_t major, uint16_t minor ) {
+	TramaIBeacon::escribirBE16( trama, major );
+	TramaIBeacon::escribirBE16( trama + 2, minor );
+  } // ()
+
+  /**
+   * @brief Decodifica el valor de una medida a partir de major y minor.
+   *
+   * @param id Aquí el id de la medida.
+   * @param contador Aquí el contador.
+   * @param valor Aquí el valor ya escalado.
+   * @return false si el id no es de ninguna medida conocida.
+   */
+  inline bool decodificar( uint16_t major, uint16_t minor, uint8_t & id, uint8_t & contador, double & valor ) {
+	uint8_t trama[4];
+	desdeMajorMinor( trama, major, minor );
+	double v[3];
+	switch ( trama[0] ) {
+	case ID_CO2: CO2::decodificar( trama, v ); break;
+	case ID_TEMPERATURA: Temperatura::decodificar( trama, v ); break;
+	case ID_RUIDO: Ruido::decodificar( trama, v ); break;
+	case ID_ALARMA: Alarma::decodificar( trama, v ); break;
+	default: return false;
+	}
+	id = (uint8_t) v[0];
+	contador = (uint8_t) v[1];
+	valor = v[2];
+	return true;
+  } // ()
+
+  // .........................................................
+  // (codificar y decodificar un resumen con el esquema de su medida)
+  // .........................................................
+  template< typename R >
+  uint32_t codificarResumenCon( uint8_t * carga, uint8_t id, uint8_t ventana, const ResumenVentana & r ) {
+	return R::codificar( carga, MARCA_RESUMEN, id, ventana, r.numero, r.duracionMs / 1000.0,
+						 r.minimo, r.maximo, r.media, r.desviacion, r.p50, r.p90, r.p99 );
+  } // ()
+
+  template< typename R >
+  void decodificarResumenCon( const uint8_t * carga, uint8_t & ventana, ResumenVentana & r ) {
+	double v[R::NUM_CAMPOS];
+	R::decodificar( carga, v );
+	ventana = (uint8_t) v[2];
+	r.numero = (uint32_t) v[3];
+	r.duracionMs = (uint32_t) v[4] * 1000;
+	r.minimo = v[5];
+	r.maximo = v[6];
+	r.media = v[7];
+	r.desviacion = v[8];
+	r.p50 = v[9];
+	r.p90 = v[10];
+	r.p99 = v[11];
+  } // ()
+
+  /**
+   * @brief Codifica el resumen de una ventana.
+   *
+   * @param carga LONGITUD_CARGA bytes.
+   * @param id Id de la medida (da la escala de los valores).
+   * @param ventana Número de ventana.
+   * @return Máscara de campos saturados (como Trama::codificar()); 0xffffffff si el id no se conoce.
+   */
+  inline uint32_t codificarResumen( uint8_t * carga, uint8_t id, uint8_t ventana, const ResumenVentana & r ) {
+	switch ( id ) {
+	case ID_CO2: return codificarResumenCon< ResumenCO2 >( carga, id, ventana, r );
+	case ID_TEMPERATURA: return codificarResumenCon< ResumenTemperatura >( carga, id, ventana, r );
+	case ID_RUIDO: return codificarResumenCon< ResumenRuido >( carga, id, ventana, r );
+	default: return 0xffffffff;
+	}
+  } // ()
+
+  /**
+   * @return true si los 21 bytes de carga son un resumen de una medida conocida.
+   */
+  inline bool esResumen( const uint8_t * carga ) {
+	return carga[0] == MARCA_RESUMEN
+	  && ( carga[1] == ID_CO2 || carga[1] == ID_TEMPERATURA || carga[1] == ID_RUIDO );
+  } // ()
+
+  /**
+   * @brief Decodifica un resumen de ventana.
+   *
+   * @param carga Los 21 bytes de carga.
+   * @param id Aquí el id de la medida.
+   * @param ventana Aquí el número de ventana.
+   * @param r Aquí el resumen (la duración, en segundos enteros).
+   * @return false si la carga no es un resumen.
+   */
+  inline bool decodificarResumen( const uint8_t * carga, uint8_t & id, uint8_t & ventana, ResumenVentana & r ) {
+	if ( ! esResumen( carga ) ) {
+	  return false;
+	}
+	id = carga[1];
+	switch ( id ) {
+	case ID_CO2: decodificarResumenCon< ResumenCO2 >( carga, ventana, r ); break;
+	case ID_TEMPERATURA: decodificarResumenCon< ResumenTemperatura >( carga, ventana, r ); break;
+	default: decodificarResumenCon< ResumenRuido >( carga, ventana, r ); break;
+	}
+	return true;
+  } // ()
+
+  /**
+   * @brief Codifica la telemetría del nodo.
+   *
+   * @param destino Telemetria::TAM bytes.
+   * @return Máscara de campos saturados (como Trama::codificar()).
+   */
+  inline uint32_t codificarTelemetria( uint8_t * destino, const DatosTelemetria & d ) {
+	return Telemetria::codificar( destino, MARCA_TELEMETRIA, d.versionMayor, d.versionMenor, d.minutosEncendido,
+								  d.periodoMedioMs, d.periodoMaximoMs, d.muestrasPerdidas, d.lineasPerdidas,
+								  d.huellaConfiguracion );
+  } // ()
+
+  /**
+   * @brief Decodifica la telemetría del nodo.
+   *
+   * @param origen Telemetria::TAM bytes.
+   * @param d Aquí los datos (los contadores, saturados en su campo).
+   * @return false si no empieza por MARCA_TELEMETRIA.
+   */
+  inline bool decodificarTelemetria( const uint8_t * origen, DatosTelemetria & d ) {
+	if ( origen[0] != MARCA_TELEMETRIA ) {
+	  return false;
+	}
+	double v[Telemetria::NUM_CAMPOS];
+	Telemetria::decodificar( origen, v );
+	d.versionMayor = (uint8_t) v[1];
+	d.versionMenor = (uint8_t) v[2];
+	d.minutosEncendido = (uint32_t) v[3];
+	d.periodoMedioMs = (uint16_t) v[4];
+	d.periodoMaximoMs = (uint16_t) v[5];
+	d.muestrasPerdidas = (uint32_t) v[6];
+	d.lineasPerdidas = (uint32_t) v[7];
+	d.huellaConfiguracion = (uint32_t) v[8];
+	return true;
+  } // ()
+
+}; // namespace
+
+#endif
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
@@ -0,0 +1,183 @@
+/*
+ * Nombre del fichero: TrazaADC.h
+ * Descripción: Formato binario compacto de las trazas de muestras del ADC (tiempo, Agas, Aref).
+ * Autores: agent
+ * Fecha: 18 de octubre de 2026
+ *
+ * Este archivo ha sido realizado por agent.
+ * Contiene el codificador que usa la placa para grabar las lecturas en bruto de Medidor
+ * y el decodificador con el que la simulación las vuelve a pasar por medirGas().
+ * No depende de Arduino.
+ *
+ * Formato:
+ *   cabecera: 'T', 'A', 'D', 'C', versión (1 byte), bits del ADC (1 byte)
+ *   registro: varint (1 a 5 bytes) + Agas y Aref de 12 bits (3 bytes)
+ *   - versión 2: el varint es el incremento de tiempo en us por 2, más 1 si esa vez no
+ *     se leyó Vref (referencia lenta); entonces Aref va a 0 y se decodifica como
+ *     SIN_REFERENCIA.
+ *   - versión 1 (trazas antiguas, se siguen leyendo): el varint es sólo el incremento.
+ *
+ * Todos los derechos reservados.
+ */
+
+#ifndef TRAZA_ADC_H_INCLUIDO
+#define TRAZA_ADC_H_INCLUIDO
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace TrazaADC {
+
+  const uint8_t MAGICO[4] = { 'T', 'A', 'D', 'C' };
+  const uint8_t VERSION = 2;
+  const uint8_t TAMANYO_CABECERA = 6;
+  const uint8_t TAMANYO_MAXIMO_REGISTRO = 5 + 3;
+
+  /// Aref de una muestra en la que no se leyó Vref (no cabe en 12 bits).
+  const uint16_t SIN_REFERENCIA = 0xffff;
+
+  /**
+   * @brief Una muestra en bruto del ADC.
+   */
+  struct Muestra {
+	uint32_t tiempo; ///< micros() en el momento de la lectura (da la vuelta cada ~71 minutos).
+	uint16_t agas;   ///< analogRead( pinVgas ).
+	uint16_t aref;   ///< analogRead( pinVref ), o SIN_REFERENCIA si esa vez no se leyó.
+  }; // struct
+
+  // .........................................................
+  /**
+   * @brief Escribe la cabecera de la traza.
+   *
+   * @param destino Al menos TAMANYO_CABECERA bytes.
+   * @param bitsADC Resolución con la que se han leído las muestras (10 con analogRead()).
+   * @return Bytes escritos.
+   */
+  inline uint8_t escribirCabecera( uint8_t * destino, uint8_t bitsADC ) {
+	memcpy( destino, MAGICO, 4 );
+	destino[4] = VERSION;
+	destino[5] = bitsADC;
+	return TAMANYO_CABECERA;
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Codifica muestras consecutivas como incrementos de tiempo.
+   */
+  class Codificador {
+  private:
+	uint32_t tiempoAnterior = 0;
+
+  public:
+	/**
+	 * @brief Codifica una muestra.
+	 *
+	 * @param m Muestra (los valores se recortan a 12 bits; Aref puede ser SIN_REFERENCIA).
+	 * @param destino Al menos TAMANYO_MAXIMO_REGISTRO bytes.
+	 * @return Bytes escritos.
+	 */
+	uint8_t codificar( const Muestra & m, uint8_t * destino ) {
+	  uint32_t incremento = m.tiempo - (*this).tiempoAnterior; // aritmética módulo 2^32
+	  (*this).tiempoAnterior = m.tiempo;
+	  bool sinReferencia = m.aref == SIN_REFERENCIA;
+
+	  uint64_t varint = ( (uint64_t) incremento << 1 ) | ( sinReferencia ? 1 : 0 ); // 33 bits: caben en 5 bytes
+	  uint8_t n = 0;
+	  while ( varint >= 0x80 ) {
+		destino[n++] = (uint8_t) ( varint | 0x80 );
+		varint >>= 7;
+	  }
+	  destino[n++] = (uint8_t) varint;
+
+	  uint16_t agas = m.agas & 0xfff;
+	  uint16_t aref = sinReferencia ? 0 : m.aref & 0xfff;
+	  destino[n++] = (uint8_t) agas;
+	  destino[n++] = (uint8_t) ( ( agas >> 8 ) | ( ( aref & 0x0f ) << 4 ) );
+	  destino[n++] = (uint8_t) ( aref >> 4 );
+	  return n;
+	} // ()
+  }; // class
+
+  // .........................................................
+  /**
+   * @brief Recorre una traza ya cargada en memoria.
+   */
+  class Decodificador {
+  private:
+	const uint8_t * p;
+	const uint8_t * fin;
+	uint32_t tiempoAnterior = 0;
+	uint64_t tiempoAcumulado = 0;
+	uint8_t bits = 0;
+	uint8_t version = 0;
+
+  public:
+	/**
+	 * @brief Constructor. Comprueba la cabecera.
+	 *
+	 * @param datos Traza completa (cabecera incluida).
+	 * @param longitud Bytes de la traza.
+	 */
+	Decodificador( const uint8_t * datos, size_t longitud ) : p( datos ), fin( datos + longitud ) {
+	  if ( longitud >= TAMANYO_CABECERA && memcmp( datos, MAGICO, 4 ) == 0 && datos[4] >= 1 && datos[4] <= VERSION ) {
+		(*this).version = datos[4];
+		(*this).bits = datos[5];
+		(*this).p += TAMANYO_CABECERA;
+	  } else {
+		(*this).p = (*this).fin;
+	  }
+	} // ()
+
+	/// Resolución del ADC declarada en la cabecera (0 si la cabecera no es válida).
+	uint8_t bitsADC() const { return (*this).bits; }
+
+	/// Tiempo en us desde el origen de micros(), sin dar la vuelta.
+	uint64_t tiempoAbsoluto() const { return (*this).tiempoAcumulado; }
+
+	/**
+	 * @brief Lee la siguiente muestra.
+	 * @return false al final de la traza o si el último registro está cortado.
+	 */
+	bool siguiente( Muestra & m ) {
+	  uint64_t varint = 0;
+	  uint8_t desplazamiento = 0;
+	  for ( ;; ) {
+		if ( (*this).p >= (*this).fin || desplazamiento > 28 ) {
+		  return false;
+		}
+		uint8_t b = *(*this).p++;
+		varint |= (uint64_t) ( b & 0x7f ) << desplazamiento;
+		if ( ( b & 0x80 ) == 0 ) {
+		  break;
+		}
+		desplazamiento += 7;
+	  } // for
+	  if ( (*this).fin - (*this).p < 3 ) {
+		return false;
+	  }
+	  bool sinReferencia = false;
+	  if ( (*this).version >= 2 ) {
+		sinReferencia = ( varint & 1 ) != 0;
+		varint >>= 1;
+	  }
+	  uint32_t incremento = (uint32_t) varint;
+	  m.tiempo = (*this).tiempoAnterior + incremento;
+	  m.agas = (uint16_t) ( (*this).p[0] | ( ( (*this).p[1] & 0x0f ) << 8 ) );
+	  m.aref = sinReferencia ? SIN_REFERENCIA : (uint16_t) ( ( (*this).p[1] >> 4 ) | ( (*this).p[2] << 4 ) );
+	  (*this).p += 3;
+
+	  (*this).tiempoAnterior = m.tiempo;
+	  (*this).tiempoAcumulado += incremento;
+	  return true;
+	} // ()
+  }; // class
+
+}; // namespace
+
+#endif
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
@@ -0,0 +1,1001 @@
+/*
+ * Nombre del fichero: AlmacenSeries.h
+ * Descripción: Fichero por columnas para guardar y consultar las series de las lecturas decodificadas.
+ * Autores: agent
+ * Fecha: 18 de octubre de 2026
+ *
+ * Este archivo ha sido realizado por agent.
+ * Contiene EscritorSeries, que va añadiendo puntos (tiempo, valor, secuencia) a la serie de
+ * cada nodo y canal y los escribe por bloques comprimidos columna a columna, y LectorSeries,
+ * que proyecta el fichero en memoria (mmap) y saca los puntos de una serie entre dos tiempos
+ * leyendo sólo los bloques que caen dentro, gracias al índice del final.
+ *
+ * Formato (little endian):
+ *   cabecera: "SERB" + versión (1 byte)
+ *   bloques:  "BLOQ" + su entrada del índice (EntradaIndice) y después los tiempos, valores
+ *             y secuencias de hasta puntosPorBloque puntos de una serie, cada columna en su
+ *             trozo de bits (ver codificarTiempos() y las demás). Con la entrada delante, si
+ *             se corta la escritura antes del índice, se puede rehacer recorriendo los bloques.
+ *   índice:   una entrada de TAMANYO_ENTRADA bytes por bloque (EntradaIndice), ordenadas por
+ *             nodo, canal y tiempo
+ *   pie:      posición del índice (8), número de entradas (8), "SERB" + versión
+ *
+ * Sólo para el ordenador de la pasarela (POSIX: mmap, ftruncate).
+ *
+ * Todos los derechos reservados.
+ */
+
+#ifndef ALMACEN_SERIES_H_INCLUIDO
+#define ALMACEN_SERIES_H_INCLUIDO
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace AlmacenSeries {
+  const char MAGICO[4] = { 'S', 'E', 'R', 'B' };
+  const char MAGICO_BLOQUE[4] = { 'B', 'L', 'O', 'Q' };
+  const uint8_t VERSION = 2; ///< La 1 no lleva las entradas delante de los bloques (se puede leer, no seguir).
+  const uint32_t PUNTOS_POR_BLOQUE = 256;
+  const uint32_t MAXIMO_PUNTOS_POR_BLOQUE = 65536;
+  const uint8_t MAXIMO_DECIMALES = 6;
+  const size_t TAMANYO_CABECERA = 4 + 1;
+  const size_t TAMANYO_ENTRADA = 8 + 8 + 8 + 8 + 4 + 4 + 4 + 4 + 1 + 1 + 1 + 1;
+  const size_t TAMANYO_CABECERA_BLOQUE = 4 + TAMANYO_ENTRADA;
+  const size_t TAMANYO_PIE = 8 + 8 + 4 + 1;
+
+  /// Cómo van los valores de un bloque.
+  enum Codificacion : uint8_t {
+	XOR = 0,     ///< Cada double, XOR con el anterior (sin pérdida, para cualquier valor).
+	ENTEROS = 1  ///< Múltiplos exactos de 10^-decimales: diferencias empaquetadas a un ancho fijo.
+  };
+
+  inline void ponerLE( uint8_t * p, uint64_t v, int bytes ) {
+	for ( int i = 0; i < bytes; i++ ) {
+	  p[i] = (uint8_t) ( v >> (8*i) );
+	}
+  } // ()
+
+  inline uint64_t leerLE( const uint8_t * p, int bytes ) {
+	uint64_t v = 0;
+	for ( int i = 0; i < bytes; i++ ) {
+	  v |= ( (uint64_t) p[i] ) << (8*i);
+	}
+	return v;
+  } // ()
+
+  inline uint64_t zigzag( int64_t v ) {
+	return ( (uint64_t) v << 1 ) ^ (uint64_t) ( v >> 63 );
+  } // ()
+
+  inline int64_t deszigzag( uint64_t v ) {
+	return (int64_t) ( v >> 1 ) ^ - (int64_t) ( v & 1 );
+  } // ()
+
+  inline uint64_t bitsDe( double v ) {
+	uint64_t b;
+	memcpy( &b, &v, sizeof(b) );
+	return b;
+  } // ()
+
+  inline double doubleDe( uint64_t b ) {
+	double v;
+	memcpy( &v, &b, sizeof(v) );
+	return v;
+  } // ()
+
+  /// Bits que hacen falta para v (0 para 0).
+  inline uint8_t anchura( uint64_t v ) {
+	return v == 0 ? 0 : (uint8_t) ( 64 - __builtin_clzll( v ) );
+  } // ()
+}; // namespace
+
+// ----------------------------------------------------------
+/**
+ * @brief Un punto de una serie (el nodo y el canal van en la serie).
+ */
+struct PuntoAlmacen {
+  uint64_t tiempo;   ///< ms
+  double valor;
+  uint8_t secuencia; ///< El contador de la trama (da la vuelta a los 256).
+}; // struct
+
+// ----------------------------------------------------------
+/**
+ * @brief Escribe bits de más a menos significativo al final de un vector de bytes.
+ */
+class EscritorBits {
+private:
+
+  std::vector<uint8_t> & destino;
+  uint64_t acumulado = 0;
+  uint8_t pendientes = 0; ///< Bits en acumulado que aún no forman un byte (menos de 8).
+
+public:
+
+  EscritorBits( std::vector<uint8_t> & destino_ ) : destino( destino_ ) {
+  } // ()
+
+  /**
+   * @brief Escribe los n bits de abajo de v (n de 0 a 64).
+   */
+  void poner( uint64_t v, uint8_t n ) {
+	if ( n > 32 ) {
+	  poner( v >> 32, n - 32 );
+	  n = 32;
+	}
+	if ( n == 0 ) {
+	  return;
+	}
+	v &= ~0ull >> ( 64 - n );
+	(*this).acumulado = ( (*this).acumulado << n ) | v;
+	(*this).pendientes += n;
+	while ( (*this).pendientes >= 8 ) {
+	  (*this).pendientes -= 8;
+	  (*this).destino.push_back( (uint8_t) ( (*this).acumulado >> (*this).pendientes ) );
+	}
+	(*this).acumulado &= ( 1ull << (*this).pendientes ) - 1;
+  } // ()
+
+  /**
+   * @brief Completa el último byte con ceros.
+   */
+  void vaciar() {
+	if ( (*this).pendientes > 0 ) {
+	  (*this).destino.push_back( (uint8_t) ( (*this).acumulado << ( 8 - (*this).pendientes ) ) );
+	}
+	(*this).acumulado = 0;
+	(*this).pendientes = 0;
+  } // ()
+
+}; // class
+
+// ----------------------------------------------------------
+/**
+ * @brief Lee bits de más a menos significativo. Pasado el final, lee ceros.
+ */
+class LectorBits {
+private:
+
+  const uint8_t * datos;
+  size_t bytes;
+  size_t posicion = 0; ///< En bits.
+
+public:
+
+  LectorBits( const uint8_t * datos_, size_t bytes_ ) : datos( datos_ ), bytes( bytes_ ) {
+  } // ()
+
+  /**
+   * @brief Lee n bits (de 0 a 64).
+   */
+  uint64_t sacar( uint8_t n ) {
+	if ( n > 32 ) {
+	  uint64_t alto = sacar( n - 32 );
+	  return ( alto << 32 ) | sacar( 32 );
+	}
+	if ( n == 0 ) {
+	  return 0;
+	}
+	size_t byte = (*this).posicion >> 3;
+	uint8_t desplazamiento = (uint8_t) ( (*this).posicion & 7 );
+	uint64_t ventana = 0;
+	if ( byte + 8 <= (*this).bytes ) {
+	  memcpy( &ventana, &(*this).datos[byte], 8 );
+	  ventana = __builtin_bswap64( ventana );
+	} else {
+	  for ( size_t i = 0; i < 8; i++ ) {
+		ventana = ( ventana << 8 ) | ( byte + i < (*this).bytes ? (*this).datos[byte + i] : 0 );
+	  }
+	}
+	(*this).posicion += n;
+	return ( ventana << desplazamiento ) >> ( 64 - n );
+  } // ()
+
+  /**
+   * @brief Cuenta unos seguidos (hasta un cero o hasta maximo).
+   */
+  uint8_t contarUnos( uint8_t maximo ) {
+	uint8_t n = 0;
+	while ( n < maximo && sacar( 1 ) == 1 ) {
+	  n++;
+	}
+	return n;
+  } // ()
+
+}; // class
+
+// ----------------------------------------------------------
+/**
+ * @brief Codificación de cada columna de un bloque.
+ */
+namespace ColumnasSeries {
+
+  // .........................................................
+  /**
+   * @brief Tiempos: el primero entero y luego la diferencia entre diferencias (delta de delta).
+   *
+   * Con un periodo fijo casi todas son 0 (1 bit). Las demás, en zigzag y con un prefijo:
+   *   0 -> 0 | 10 + 7 bits | 110 + 9 | 1110 + 12 | 11110 + 32 | 11111 + 64
+   */
+  inline void codificarTiempos( const uint64_t * t, uint32_t n, std::vector<uint8_t> & destino ) {
+	EscritorBits b( destino );
+	b.poner( t[0], 64 );
+	int64_t deltaAnterior = 0;
+	for ( uint32_t i = 1; i < n; i++ ) {
+	  int64_t delta = (int64_t) ( t[i] - t[i-1] );
+	  uint64_t z = AlmacenSeries::zigzag( delta - deltaAnterior );
+	  deltaAnterior = delta;
+	  if ( z == 0 ) {
+		b.poner( 0, 1 );
+	  } else if ( z < ( 1ull << 7 ) ) {
+		b.poner( 0x2, 2 );
+		b.poner( z, 7 );
+	  } else if ( z < ( 1ull << 9 ) ) {
+		b.poner( 0x6, 3 );
+		b.poner( z, 9 );
+	  } else if ( z < ( 1ull << 12 ) ) {
+		b.poner( 0xe, 4 );
+		b.poner( z, 12 );
+	  } else if ( z < ( 1ull << 32 ) ) {
+		b.poner( 0x1e, 5 );
+		b.poner( z, 32 );
+	  } else {
+		b.poner( 0x1f, 5 );
+		b.poner( z, 64 );
+	  }
+	}
+	b.vaciar();
+  } // ()
+
+  inline void decodificarTiempos( const uint8_t * datos, size_t bytes, uint32_t n, uint64_t * t ) {
+	static const uint8_t ANCHOS[6] = { 0, 7, 9, 12, 32, 64 };
+	LectorBits b( datos, bytes );
+	t[0] = b.sacar( 64 );
+	int64_t delta = 0;
+	for ( uint32_t i = 1; i < n; i++ ) {
+	  uint8_t prefijo = b.contarUnos( 5 );
+	  delta += AlmacenSeries::deszigzag( b.sacar( ANCHOS[prefijo] ) );
+	  t[i] = t[i-1] + (uint64_t) delta;
+	}
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Valores como double: cada uno, XOR con el anterior.
+   *
+   * 0 si es igual; 10 + los bits con sentido si caben en la ventana del anterior; si no,
+   * 11 + ceros por delante (5 bits) + longitud - 1 (6 bits) + los bits.
+   */
+  inline void codificarXOR( const double * v, uint32_t n, std::vector<uint8_t> & destino ) {
+	EscritorBits b( destino );
+	uint64_t anterior = AlmacenSeries::bitsDe( v[0] );
+	b.poner( anterior, 64 );
+	uint8_t cerosDelante = 0xff; // aún no hay ventana
+	uint8_t cerosDetras = 0;
+	for ( uint32_t i = 1; i < n; i++ ) {
+	  uint64_t actual = AlmacenSeries::bitsDe( v[i] );
+	  uint64_t x = actual ^ anterior;
+	  anterior = actual;
+	  if ( x == 0 ) {
+		b.poner( 0, 1 );
+		continue;
+	  }
+	  uint8_t delante = (uint8_t) std::min( __builtin_clzll( x ), 31 );
+	  uint8_t detras = (uint8_t) __builtin_ctzll( x );
+	  if ( cerosDelante != 0xff && delante >= cerosDelante && detras >= cerosDetras ) {
+		b.poner( 0x2, 2 );
+		b.poner( x >> cerosDetras, 64 - cerosDelante - cerosDetras );
+	  } else {
+		uint8_t longitud = 64 - delante - detras;
+		b.poner( 0x3, 2 );
+		b.poner( delante, 5 );
+		b.poner( longitud - 1, 6 );
+		b.poner( x >> detras, longitud );
+		cerosDelante = delante;
+		cerosDetras = detras;
+	  }
+	}
+	b.vaciar();
+  } // ()
+
+  inline void decodificarXOR( const uint8_t * datos, size_t bytes, uint32_t n, double * v ) {
+	LectorBits b( datos, bytes );
+	uint64_t anterior = b.sacar( 64 );
+	v[0] = AlmacenSeries::doubleDe( anterior );
+	uint8_t cerosDelante = 0;
+	uint8_t cerosDetras = 0;
+	for ( uint32_t i = 1; i < n; i++ ) {
+	  if ( b.sacar( 1 ) == 1 ) {
+		if ( b.sacar( 1 ) == 1 ) {
+		  cerosDelante = (uint8_t) b.sacar( 5 );
+		  uint8_t longitud = (uint8_t) ( b.sacar( 6 ) + 1 );
+		  cerosDetras = (uint8_t) ( 64 - cerosDelante - longitud );
+		}
+		anterior ^= b.sacar( 64 - cerosDelante - cerosDetras ) << cerosDetras;
+	  }
+	  v[i] = AlmacenSeries::doubleDe( anterior );
+	}
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief ¿Son todos los valores múltiplos exactos de 10^-decimales (con los menos decimales)?
+   *
+   * Exactos quiere decir que entero / 10^decimales vuelve a dar el mismo double, que es como
+   * los decodifica EsquemaTrama.
+   *
+   * @param enteros Donde se dejan los valores multiplicados.
+   */
+  inline bool comoEnteros( const double * v, uint32_t n, uint8_t & decimales, std::vector<int64_t> & enteros ) {
+	enteros.resize( n );
+	double escala = 1.0;
+	for ( uint8_t k = 0; k <= AlmacenSeries::MAXIMO_DECIMALES; k++, escala *= 10.0 ) {
+	  bool valen = true;
+	  for ( uint32_t i = 0; i < n && valen; i++ ) {
+		double e = v[i] * escala;
+		if ( ! ( std::fabs( e ) < 4503599627370496.0 ) ) { // 2^52 (y fuera NaN e infinitos)
+		  return false;
+		}
+		enteros[i] = std::llround( e );
+		valen = AlmacenSeries::bitsDe( (double) enteros[i] / escala ) == AlmacenSeries::bitsDe( v[i] );
+	  }
+	  if ( valen ) {
+		decimales = k;
+		return true;
+	  }
+	}
+	return false;
+  } // ()
+
+  /**
+   * @brief Valores enteros: el primero en zigzag (64 bits), el ancho (7 bits) y las diferencias
+   * en zigzag, todas con ese ancho.
+   */
+  inline void codificarEnteros( const int64_t * e, uint32_t n, std::vector<uint8_t> & destino ) {
+	uint64_t mayor = 0;
+	for ( uint32_t i = 1; i < n; i++ ) {
+	  mayor |= AlmacenSeries::zigzag( e[i] - e[i-1] );
+	}
+	uint8_t ancho = AlmacenSeries::anchura( mayor );
+	EscritorBits b( destino );
+	b.poner( AlmacenSeries::zigzag( e[0] ), 64 );
+	b.poner( ancho, 7 );
+	for ( uint32_t i = 1; i < n; i++ ) {
+	  b.poner( AlmacenSeries::zigzag( e[i] - e[i-1] ), ancho );
+	}
+	b.vaciar();
+  } // ()
+
+  inline void decodificarEnteros( const uint8_t * datos, size_t bytes, uint32_t n, uint8_t decimales, double * v ) {
+	double escala = 1.0;
+	for ( uint8_t k = 0; k < decimales; k++ ) {
+	  escala *= 10.0;
+	}
+	LectorBits b( datos, bytes );
+	int64_t e = AlmacenSeries::deszigzag( b.sacar( 64 ) );
+	uint8_t ancho = (uint8_t) b.sacar( 7 );
+	v[0] = (double) e / escala;
+	for ( uint32_t i = 1; i < n; i++ ) {
+	  e += AlmacenSeries::deszigzag( b.sacar( ancho ) );
+	  v[i] = (double) e / escala;
+	}
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Secuencias: la primera (8 bits) y luego 0 si es la siguiente o 1 + la secuencia.
+   */
+  inline void codificarSecuencias( const uint8_t * s, uint32_t n, std::vector<uint8_t> & destino ) {
+	EscritorBits b( destino );
+	b.poner( s[0], 8 );
+	for ( uint32_t i = 1; i < n; i++ ) {
+	  if ( s[i] == (uint8_t) ( s[i-1] + 1 ) ) {
+		b.poner( 0, 1 );
+	  } else {
+		b.poner( 1, 1 );
+		b.poner( s[i], 8 );
+	  }
+	}
+	b.vaciar();
+  } // ()
+
+  inline void decodificarSecuencias( const uint8_t * datos, size_t bytes, uint32_t n, uint8_t * s ) {
+	LectorBits b( datos, bytes );
+	s[0] = (uint8_t) b.sacar( 8 );
+	for ( uint32_t i = 1; i < n; i++ ) {
+	  s[i] = b.sacar( 1 ) == 1 ? (uint8_t) b.sacar( 8 ) : (uint8_t) ( s[i-1] + 1 );
+	}
+  } // ()
+
+}; // namespace
+
+// ----------------------------------------------------------
+/**
+ * @brief Una entrada del índice: dónde está un bloque y qué tiempos tiene.
+ */
+struct EntradaIndice {
+  uint64_t nodo;     ///< Dirección BLE (6 bytes) como en MotorIngestion.
+  uint64_t tiempoMinimo;
+  uint64_t tiempoMaximo;
+  uint64_t posicion; ///< De las columnas del bloque en el fichero (detrás de su cabecera).
+  uint32_t numPuntos;
+  uint32_t bytesTiempos;
+  uint32_t bytesValores;
+  uint32_t bytesSecuencias;
+  uint8_t canal;
+  uint8_t codificacion; ///< AlmacenSeries::Codificacion
+  uint8_t decimales;
+
+  uint64_t bytes() const {
+	return (uint64_t) (*this).bytesTiempos + (*this).bytesValores + (*this).bytesSecuencias;
+  } // ()
+
+  void codificar( uint8_t * p ) const {
+	AlmacenSeries::ponerLE( &p[0], (*this).nodo, 8 );
+	AlmacenSeries::ponerLE( &p[8], (*this).tiempoMinimo, 8 );
+	AlmacenSeries::ponerLE( &p[16], (*this).tiempoMaximo, 8 );
+	AlmacenSeries::ponerLE( &p[24], (*this).posicion, 8 );
+	AlmacenSeries::ponerLE( &p[32], (*this).numPuntos, 4 );
+	AlmacenSeries::ponerLE( &p[36], (*this).bytesTiempos, 4 );
+	AlmacenSeries::ponerLE( &p[40], (*this).bytesValores, 4 );
+	AlmacenSeries::ponerLE( &p[44], (*this).bytesSecuencias, 4 );
+	p[48] = (*this).canal;
+	p[49] = (*this).codificacion;
+	p[50] = (*this).decimales;
+	p[51] = 0;
+  } // ()
+
+  void decodificar( const uint8_t * p ) {
+	(*this).nodo = AlmacenSeries::leerLE( &p[0], 8 );
+	(*this).tiempoMinimo = AlmacenSeries::leerLE( &p[8], 8 );
+	(*this).tiempoMaximo = AlmacenSeries::leerLE( &p[16], 8 );
+	(*this).posicion = AlmacenSeries::leerLE( &p[24], 8 );
+	(*this).numPuntos = (uint32_t) AlmacenSeries::leerLE( &p[32], 4 );
+	(*this).bytesTiempos = (uint32_t) AlmacenSeries::leerLE( &p[36], 4 );
+	(*this).bytesValores = (uint32_t) AlmacenSeries::leerLE( &p[40], 4 );
+	(*this).bytesSecuencias = (uint32_t) AlmacenSeries::leerLE( &p[44], 4 );
+	(*this).canal = p[48];
+	(*this).codificacion = p[49];
+	(*this).decimales = p[50];
+  } // ()
+
+  /// ¿Tiene sentido lo que dice de su bloque (sin mirar el fichero)?
+  bool coherente() const {
+	return (*this).numPuntos > 0 && (*this).numPuntos <= AlmacenSeries::MAXIMO_PUNTOS_POR_BLOQUE
+	  && (*this).tiempoMinimo <= (*this).tiempoMaximo && (*this).codificacion <= AlmacenSeries::ENTEROS
+	  && (*this).decimales <= AlmacenSeries::MAXIMO_DECIMALES;
+  } // ()
+
+  /// Orden del índice: nodo, canal y tiempo.
+  bool operator<( const EntradaIndice & o ) const {
+	if ( (*this).nodo != o.nodo ) {
+	  return (*this).nodo < o.nodo;
+	}
+	if ( (*this).canal != o.canal ) {
+	  return (*this).canal < o.canal;
+	}
+	return (*this).tiempoMinimo < o.tiempoMinimo;
+  } // ()
+}; // struct
+
+// ----------------------------------------------------------
+/**
+ * @brief Añade puntos a las series de un fichero de AlmacenSeries.
+ *
+ * Cada serie (nodo y canal) junta sus puntos en memoria y, al llegar a puntosPorBloque,
+ * los escribe al final del fichero como un bloque. Los puntos de una serie tienen que
+ * llegar en orden de tiempo (como salen de MotorIngestion); los que no, se rechazan. El
+ * índice y el pie se escriben en cerrar(), así que hasta entonces el fichero no se puede
+ * leer. Si el fichero ya existe con su pie, se sigue añadiendo detrás: se quita el índice,
+ * que se vuelve a escribir (con los bloques nuevos) al cerrar. Si existe sin pie (se cortó
+ * la escritura: la pasarela se cayó o se quedó sin luz), se rehace el índice con las
+ * cabeceras de los bloques enteros, se quita lo que venga detrás y se sigue añadiendo; se
+ * pierde sólo lo que aún no había salido a disco (los puntos que las series tenían en
+ * memoria y lo que quedara en el búfer). getBloquesRecuperados() dice cuántos se rehicieron.
+ *
+ * @section ejemplos Ejemplo de uso
+ * @code
+ * EscritorSeries escritor( "lecturas.serb" );
+ * escritor.anyadir( nodo, TramasPublicador::ID_CO2, ms, ppm, contador );
+ * escritor.cerrar();
+ * @endcode
+ */
+class EscritorSeries {
+private:
+
+  struct Serie {
+	std::vector<uint64_t> tiempos;
+	std::vector<double> valores;
+	std::vector<uint8_t> secuencias;
+	uint64_t ultimoTiempo = 0;
+	bool hayUltimo = false;
+  }; // struct
+
+  FILE * fichero = nullptr;
+  uint32_t puntosPorBloque;
+  bool usarEnteros;
+
+  std::unordered_map<uint64_t, Serie> series; ///< Por nodo << 8 | canal.
+  std::vector<EntradaIndice> indice;
+  uint64_t posicion = AlmacenSeries::TAMANYO_CABECERA; ///< Donde va el siguiente bloque.
+
+  std::vector<uint8_t> columna; ///< Para no reservar memoria en cada bloque.
+  std::vector<int64_t> enteros;
+
+  uint64_t puntos = 0;
+  uint64_t rechazados = 0;
+  uint64_t bloquesEnteros = 0;
+  uint64_t bloquesRecuperados = 0;
+
+  static uint64_t clave( uint64_t nodo, uint8_t canal ) {
+	return ( nodo << 8 ) | canal;
+  } // ()
+
+  // .........................................................
+  // apunta el último tiempo de la serie de una entrada que ya está en el fichero
+  // .........................................................
+  void anotar( const EntradaIndice & e ) {
+	(*this).indice.push_back( e );
+	Serie & s = (*this).series[ clave( e.nodo, e.canal ) ];
+	if ( ! s.hayUltimo || e.tiempoMaximo > s.ultimoTiempo ) {
+	  s.ultimoTiempo = e.tiempoMaximo;
+	  s.hayUltimo = true;
+	}
+  } // ()
+
+  // .........................................................
+  // quita lo que haya desde posicion hasta el final y deja el fichero listo para seguir ahí
+  // .........................................................
+  bool seguirEn( uint64_t posicion ) {
+	fflush( (*this).fichero );
+	if ( ftruncate( fileno( (*this).fichero ), (off_t) posicion ) != 0
+		 || fseeko( (*this).fichero, (off_t) posicion, SEEK_SET ) != 0 ) {
+	  return false;
+	}
+	(*this).posicion = posicion;
+	return true;
+  } // ()
+
+  // .........................................................
+  // sin pie: rehace el índice recorriendo las cabeceras de los bloques, hasta el primero
+  // que no esté entero (o lo que haya detrás, como un índice a medio escribir)
+  // .........................................................
+  bool reconstruir( uint64_t tamanyo ) {
+	uint8_t cabecera[AlmacenSeries::TAMANYO_CABECERA];
+	if ( fseeko( (*this).fichero, 0, SEEK_SET ) != 0
+		 || fread( cabecera, 1, sizeof(cabecera), (*this).fichero ) != sizeof(cabecera)
+		 || memcmp( cabecera, AlmacenSeries::MAGICO, 4 ) != 0 || cabecera[4] != AlmacenSeries::VERSION ) {
+	  return false;
+	}
+	uint64_t posicion = AlmacenSeries::TAMANYO_CABECERA;
+	uint8_t bytes[AlmacenSeries::TAMANYO_CABECERA_BLOQUE];
+	while ( posicion + sizeof(bytes) <= tamanyo
+			&& fread( bytes, 1, sizeof(bytes), (*this).fichero ) == sizeof(bytes)
+			&& memcmp( bytes, AlmacenSeries::MAGICO_BLOQUE, 4 ) == 0 ) {
+	  EntradaIndice e;
+	  e.decodificar( &bytes[4] );
+	  if ( ! e.coherente() || e.posicion != posicion + sizeof(bytes) || e.posicion + e.bytes() > tamanyo
+		   || fseeko( (*this).fichero, (off_t) ( e.posicion + e.bytes() ), SEEK_SET ) != 0 ) {
+		break;
+	  }
+	  anotar( e );
+	  posicion = e.posicion + e.bytes();
+	}
+	(*this).bloquesRecuperados = (*this).indice.size();
+	return seguirEn( posicion );
+  } // ()
+
+  // .........................................................
+  // lee el índice de un fichero que ya existe (o lo rehace si no tiene pie) y lo deja
+  // listo para seguir detrás
+  // .........................................................
+  bool reabrir() {
+	uint8_t pie[AlmacenSeries::TAMANYO_PIE];
+	if ( fseeko( (*this).fichero, 0, SEEK_END ) != 0 ) {
+	  return false;
+	}
+	off_t tamanyo = ftello( (*this).fichero );
+	if ( tamanyo < (off_t) AlmacenSeries::TAMANYO_CABECERA ) {
+	  return false;
+	}
+	if ( tamanyo < (off_t) ( AlmacenSeries::TAMANYO_CABECERA + AlmacenSeries::TAMANYO_PIE )
+		 || fseeko( (*this).fichero, tamanyo - (off_t) sizeof(pie), SEEK_SET ) != 0
+		 || fread( pie, 1, sizeof(pie), (*this).fichero ) != sizeof(pie)
+		 || memcmp( &pie[16], AlmacenSeries::MAGICO, 4 ) != 0 ) {
+	  return reconstruir( (uint64_t) tamanyo );
+	}
+	uint64_t posicionIndice = AlmacenSeries::leerLE( &pie[0], 8 );
+	uint64_t numEntradas = AlmacenSeries::leerLE( &pie[8], 8 );
+	if ( pie[20] != AlmacenSeries::VERSION || posicionIndice < AlmacenSeries::TAMANYO_CABECERA
+		 || posicionIndice + numEntradas * AlmacenSeries::TAMANYO_ENTRADA + sizeof(pie) != (uint64_t) tamanyo
+		 || fseeko( (*this).fichero, (off_t) posicionIndice, SEEK_SET ) != 0 ) {
+	  return false;
+	}
+	(*this).indice.reserve( numEntradas );
+	uint8_t bytes[AlmacenSeries::TAMANYO_ENTRADA];
+	for ( uint64_t i = 0; i < numEntradas; i++ ) {
+	  if ( fread( bytes, 1, sizeof(bytes), (*this).fichero ) != sizeof(bytes) ) {
+		return false;
+	  }
+	  EntradaIndice e;
+	  e.decodificar( bytes );
+	  anotar( e );
+	}
+	return seguirEn( posicionIndice );
+  } // ()
+
+  // .........................................................
+  // escribe los puntos que tenga la serie como un bloque
+  // .........................................................
+  bool escribirBloque( uint64_t claveSerie, Serie & s ) {
+	uint32_t n = (uint32_t) s.tiempos.size();
+	if ( n == 0 ) {
+	  return true;
+	}
+	EntradaIndice e;
+	e.nodo = claveSerie >> 8;
+	e.canal = (uint8_t) claveSerie;
+	e.tiempoMinimo = s.tiempos.front();
+	e.tiempoMaximo = s.tiempos.back();
+	e.posicion = (*this).posicion + AlmacenSeries::TAMANYO_CABECERA_BLOQUE;
+	e.numPuntos = n;
+	e.decimales = 0;
+
+	std::vector<uint8_t> & c = (*this).columna;
+	c.clear();
+	ColumnasSeries::codificarTiempos( s.tiempos.data(), n, c );
+	e.bytesTiempos = (uint32_t) c.size();
+	if ( (*this).usarEnteros && ColumnasSeries::comoEnteros( s.valores.data(), n, e.decimales, (*this).enteros ) ) {
+	  e.codificacion = AlmacenSeries::ENTEROS;
+	  ColumnasSeries::codificarEnteros( (*this).enteros.data(), n, c );
+	  (*this).bloquesEnteros++;
+	} else {
+	  e.codificacion = AlmacenSeries::XOR;
+	  ColumnasSeries::codificarXOR( s.valores.data(), n, c );
+	}
+	e.bytesValores = (uint32_t) c.size() - e.bytesTiempos;
+	ColumnasSeries::codificarSecuencias( s.secuencias.data(), n, c );
+	e.bytesSecuencias = (uint32_t) c.size() - e.bytesTiempos - e.bytesValores;
+
+	s.tiempos.clear();
+	s.valores.clear();
+	s.secuencias.clear();
+	uint8_t cabecera[AlmacenSeries::TAMANYO_CABECERA_BLOQUE];
+	memcpy( cabecera, AlmacenSeries::MAGICO_BLOQUE, 4 );
+	e.codificar( &cabecera[4] );
+	if ( fwrite( cabecera, 1, sizeof(cabecera), (*this).fichero ) != sizeof(cabecera)
+		 || fwrite( c.data(), 1, c.size(), (*this).fichero ) != c.size() ) {
+	  return false;
+	}
+	(*this).posicion += sizeof(cabecera) + c.size();
+	(*this).indice.push_back( e );
+	return true;
+  } // ()
+
+public:
+
+  // .........................................................
+  /**
+   * @brief Constructor. Abre el fichero (o lo crea).
+   *
+   * @param nombre Ruta del fichero.
+   * @param puntosPorBloque_ Puntos de cada bloque (más, menos índice; menos, menos que leer por consulta).
+   * @param usarEnteros_ Con false, todos los valores van con XOR (para comparar).
+   */
+  EscritorSeries( const char * nombre, uint32_t puntosPorBloque_ = AlmacenSeries::PUNTOS_POR_BLOQUE,
+				  bool usarEnteros_ = true ) :
+	puntosPorBloque( std::max( 1u, std::min( puntosPorBloque_, AlmacenSeries::MAXIMO_PUNTOS_POR_BLOQUE ) ) ),
+	usarEnteros( usarEnteros_ )
+  {
+	(*this).fichero = fopen( nombre, "r+b" );
+	if ( (*this).fichero != nullptr ) {
+	  if ( ! reabrir() ) {
+		fclose( (*this).fichero );
+		(*this).fichero = nullptr;
+		(*this).series.clear();
+		(*this).indice.clear();
+		(*this).bloquesRecuperados = 0;
+	  }
+	  return;
+	}
+	(*this).fichero = fopen( nombre, "w+b" );
+	if ( (*this).fichero != nullptr ) {
+	  fwrite( AlmacenSeries::MAGICO, 1, 4, (*this).fichero );
+	  fputc( AlmacenSeries::VERSION, (*this).fichero );
+	}
+  } // ()
+
+  ~EscritorSeries() {
+	cerrar();
+  } // ()
+
+  EscritorSeries( const EscritorSeries & ) = delete;
+  EscritorSeries & operator=( const EscritorSeries & ) = delete;
+
+  bool abierto() const {
+	return (*this).fichero != nullptr;
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Añade un punto a la serie de un nodo y un canal.
+   *
+   * @param nodo Dirección BLE del nodo.
+   * @param canal Qué se mide (el id de TramasPublicador).
+   * @param tiempo ms.
+   * @param valor El valor decodificado.
+   * @param secuencia El contador de la trama.
+   * @return false si es anterior al último punto de la serie (o no se ha podido escribir).
+   */
+  bool anyadir( uint64_t nodo, uint8_t canal, uint64_t tiempo, double valor, uint8_t secuencia ) {
+	if ( ! abierto() ) {
+	  return false;
+	}
+	uint64_t k = clave( nodo, canal );
+	Serie & s = (*this).series[k];
+	if ( s.hayUltimo && tiempo < s.ultimoTiempo ) {
+	  (*this).rechazados++;
+	  return false;
+	}
+	s.ultimoTiempo = tiempo;
+	s.hayUltimo = true;
+	s.tiempos.push_back( tiempo );
+	s.valores.push_back( valor );
+	s.secuencias.push_back( secuencia );
+	(*this).puntos++;
+	if ( s.tiempos.size() >= (*this).puntosPorBloque ) {
+	  return escribirBloque( k, s );
+	}
+	return true;
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Escribe lo que quede en memoria, el índice y el pie, y cierra.
+   *
+   * @return false si algo no se ha podido escribir.
+   */
+  bool cerrar() {
+	if ( ! abierto() ) {
+	  return false;
+	}
+	bool bien = true;
+	for ( auto & par : (*this).series ) {
+	  bien = escribirBloque( par.first, par.second ) && bien;
+	}
+	std::stable_sort( (*this).indice.begin(), (*this).indice.end() ); // los de una serie siguen en orden de tiempo
+
+	uint8_t bytes[AlmacenSeries::TAMANYO_ENTRADA];
+	for ( const EntradaIndice & e : (*this).indice ) {
+	  e.codificar( bytes );
+	  bien = fwrite( bytes, 1, sizeof(bytes), (*this).fichero ) == sizeof(bytes) && bien;
+	}
+	uint8_t pie[AlmacenSeries::TAMANYO_PIE];
+	AlmacenSeries::ponerLE( &pie[0], (*this).posicion, 8 );
+	AlmacenSeries::ponerLE( &pie[8], (*this).indice.size(), 8 );
+	memcpy( &pie[16], AlmacenSeries::MAGICO, 4 );
+	pie[20] = AlmacenSeries::VERSION;
+	bien = fwrite( pie, 1, sizeof(pie), (*this).fichero ) == sizeof(pie) && bien;
+
+	bien = fclose( (*this).fichero ) == 0 && bien;
+	(*this).fichero = nullptr;
+	return bien;
+  } // ()
+
+  uint64_t getPuntos() const { return (*this).puntos; }
+  uint64_t getRechazados() const { return (*this).rechazados; }
+  uint64_t getBloques() const { return (*this).indice.size(); }
+  uint64_t getBloquesEnteros() const { return (*this).bloquesEnteros; }
+  uint64_t getBloquesRecuperados() const { return (*this).bloquesRecuperados; }
+
+}; // class
+
+// ----------------------------------------------------------
+/**
+ * @brief Consulta un fichero de AlmacenSeries proyectado en memoria.
+ *
+ * El índice se busca en el propio fichero (está ordenado): primero el bloque de la serie
+ * cuyo último tiempo llega al principio del intervalo y después los siguientes mientras
+ * empiecen antes del final. De cada bloque se decodifican los tiempos y, de los valores y
+ * las secuencias, sólo hasta el último punto que entra. Una consulta no lee nada de los
+ * bloques de otras series ni de otros tiempos. No es para varios hilos a la vez (reutiliza
+ * sus vectores); para eso, un LectorSeries por hilo (el sistema comparte las páginas).
+ *
+ * @section ejemplos Ejemplo de uso
+ * @code
+ * LectorSeries lector( "lecturas.serb" );
+ * std::vector<PuntoAlmacen> puntos;
+ * lector.consultar( nodo, TramasPublicador::ID_CO2, desdeMs, hastaMs, puntos );
+ * @endcode
+ */
+class LectorSeries {
+private:
+
+  int descriptor = -1;
+  const uint8_t * mapa = nullptr;
+  size_t tamanyo = 0;
+  const uint8_t * indice = nullptr;
+  uint64_t numEntradas = 0;
+  uint64_t posicionIndice = 0;
+
+  uint64_t bloquesLeidos = 0;
+  uint64_t bloquesMal = 0;
+
+  std::vector<uint64_t> tiempos;
+  std::vector<double> valores;
+  std::vector<uint8_t> secuencias;
+
+  EntradaIndice entrada( uint64_t i ) const {
+	EntradaIndice e;
+	e.decodificar( &(*this).indice[ i * AlmacenSeries::TAMANYO_ENTRADA ] );
+	return e;
+  } // ()
+
+  // ¿está la entrada i antes que (nodo, canal, con tiempo máximo >= tiempo)?
+  bool antes( uint64_t i, uint64_t nodo, uint8_t canal, uint64_t tiempo ) const {
+	const uint8_t * p = &(*this).indice[ i * AlmacenSeries::TAMANYO_ENTRADA ];
+	uint64_t n = AlmacenSeries::leerLE( &p[0], 8 );
+	if ( n != nodo ) {
+	  return n < nodo;
+	}
+	if ( p[48] != canal ) {
+	  return p[48] < canal;
+	}
+	return AlmacenSeries::leerLE( &p[16], 8 ) < tiempo;
+  } // ()
+
+  // decodifica un bloque y añade sus puntos entre desde y hasta
+  size_t leerBloque( const EntradaIndice & e, uint64_t desde, uint64_t hasta, std::vector<PuntoAlmacen> & resultado ) {
+	if ( e.numPuntos == 0 || e.numPuntos > AlmacenSeries::MAXIMO_PUNTOS_POR_BLOQUE
+		 || e.posicion < AlmacenSeries::TAMANYO_CABECERA || e.posicion + e.bytes() > (*this).posicionIndice ) {
+	  (*this).bloquesMal++;
+	  return 0;
+	}
+	(*this).bloquesLeidos++;
+	const uint8_t * t = &(*this).mapa[e.posicion];
+	const uint8_t * v = t + e.bytesTiempos;
+	const uint8_t * s = v + e.bytesValores;
+
+	(*this).tiempos.resize( e.numPuntos );
+	ColumnasSeries::decodificarTiempos( t, e.bytesTiempos, e.numPuntos, (*this).tiempos.data() );
+	auto primero = std::lower_bound( (*this).tiempos.begin(), (*this).tiempos.end(), desde );
+	auto ultimo = std::upper_bound( primero, (*this).tiempos.end(), hasta );
+	if ( primero == ultimo ) {
+	  return 0;
+	}
+	uint32_t i0 = (uint32_t) ( primero - (*this).tiempos.begin() );
+	uint32_t n = (uint32_t) ( ultimo - (*this).tiempos.begin() ); // hasta aquí hace falta decodificar
+
+	(*this).valores.resize( n );
+	if ( e.codificacion == AlmacenSeries::ENTEROS ) {
+	  ColumnasSeries::decodificarEnteros( v, e.bytesValores, n, e.decimales, (*this).valores.data() );
+	} else {
+	  ColumnasSeries::decodificarXOR( v, e.bytesValores, n, (*this).valores.data() );
+	}
+	(*this).secuencias.resize( n );
+	ColumnasSeries::decodificarSecuencias( s, e.bytesSecuencias, n, (*this).secuencias.data() );
+
+	for ( uint32_t i = i0; i < n; i++ ) {
+	  resultado.push_back( { (*this).tiempos[i], (*this).valores[i], (*this).secuencias[i] } );
+	}
+	return n - i0;
+  } // ()
+
+public:
+
+  // .........................................................
+  /**
+   * @brief Proyecta el fichero en memoria y comprueba la cabecera y el pie (de la versión 1
+   * o la 2: el índice es el mismo).
+   *
+   * @param nombre Ruta del fichero.
+   */
+  LectorSeries( const char * nombre ) {
+	(*this).descriptor = open( nombre, O_RDONLY );
+	struct stat st;
+	if ( (*this).descriptor < 0 || fstat( (*this).descriptor, &st ) != 0
+		 || (size_t) st.st_size < AlmacenSeries::TAMANYO_CABECERA + AlmacenSeries::TAMANYO_PIE ) {
+	  return;
+	}
+	void * m = mmap( nullptr, (size_t) st.st_size, PROT_READ, MAP_SHARED, (*this).descriptor, 0 );
+	if ( m == MAP_FAILED ) {
+	  return;
+	}
+	(*this).mapa = (const uint8_t *) m;
+	(*this).tamanyo = (size_t) st.st_size;
+
+	const uint8_t * pie = &(*this).mapa[ (*this).tamanyo - AlmacenSeries::TAMANYO_PIE ];
+	uint64_t posicion = AlmacenSeries::leerLE( &pie[0], 8 );
+	uint64_t n = AlmacenSeries::leerLE( &pie[8], 8 );
+	if ( memcmp( (*this).mapa, AlmacenSeries::MAGICO, 4 ) != 0 || (*this).mapa[4] < 1
+		 || (*this).mapa[4] > AlmacenSeries::VERSION
+		 || memcmp( &pie[16], AlmacenSeries::MAGICO, 4 ) != 0 || pie[20] != (*this).mapa[4]
+		 || posicion < AlmacenSeries::TAMANYO_CABECERA
+		 || n > ( (*this).tamanyo - AlmacenSeries::TAMANYO_PIE - posicion ) / AlmacenSeries::TAMANYO_ENTRADA
+		 || posicion + n * AlmacenSeries::TAMANYO_ENTRADA + AlmacenSeries::TAMANYO_PIE != (*this).tamanyo ) {
+	  return; // sin índice válido no se consulta nada
+	}
+	(*this).posicionIndice = posicion;
+	(*this).numEntradas = n;
+	(*this).indice = &(*this).mapa[posicion];
+	madvise( m, (*this).tamanyo, MADV_RANDOM );
+  } // ()
+
+  ~LectorSeries() {
+	if ( (*this).mapa != nullptr ) {
+	  munmap( (void *) (*this).mapa, (*this).tamanyo );
+	}
+	if ( (*this).descriptor >= 0 ) {
+	  close( (*this).descriptor );
+	}
+  } // ()
+
+  LectorSeries( const LectorSeries & ) = delete;
+  LectorSeries & operator=( const LectorSeries & ) = delete;
+
+  bool abierto() const {
+	return (*this).indice != nullptr;
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Añade a resultado los puntos de una serie con desde <= tiempo <= hasta, en orden.
+   *
+   * @param nodo Dirección BLE del nodo.
+   * @param canal Qué se mide.
+   * @param desde ms.
+   * @param hasta ms.
+   * @param resultado Donde se añaden.
+   * @return Puntos añadidos.
+   */
+  size_t consultar( uint64_t nodo, uint8_t canal, uint64_t desde, uint64_t hasta, std::vector<PuntoAlmacen> & resultado ) {
+	if ( ! abierto() || desde > hasta ) {
+	  return 0;
+	}
+	// el primer bloque de la serie que acaba en desde o después
+	uint64_t bajo = 0;
+	uint64_t alto = (*this).numEntradas;
+	while ( bajo < alto ) {
+	  uint64_t medio = bajo + ( alto - bajo ) / 2;
+	  if ( antes( medio, nodo, canal, desde ) ) {
+		bajo = medio + 1;
+	  } else {
+		alto = medio;
+	  }
+	}
+	size_t n = 0;
+	for ( uint64_t i = bajo; i < (*this).numEntradas; i++ ) {
+	  EntradaIndice e = entrada( i );
+	  if ( e.nodo != nodo || e.canal != canal || e.tiempoMinimo > hasta ) {
+		break;
+	  }
+	  n += leerBloque( e, desde, hasta, resultado );
+	}
+	return n;
+  } // ()
+
+  uint64_t getBloques() const { return (*this).numEntradas; }
+  uint64_t getBloquesLeidos() const { return (*this).bloquesLeidos; }
+  uint64_t getBloquesMal() const { return (*this).bloquesMal; }
+  size_t getBytes() const { return (*this).tamanyo; }
+  size_t getBytesIndice() const { return (size_t) ( (*this).numEntradas * AlmacenSeries::TAMANYO_ENTRADA ); }
+
+}; // class
+
+#endif
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
@@ -0,0 +1,190 @@
+/*
+ * Nombre del fichero: Captura.h
+ * Descripción: Formato de los ficheros de captura de anuncios de la pasarela.
+ * Autores: agent
+ * Fecha: 18 de octubre de 2026
+ *
+ * Este archivo ha sido realizado por agent.
+ * Contiene las clases EscritorCaptura y LectorCaptura para guardar y leer informes de
+ * anuncio (tiempo, dirección, RSSI y bytes en bruto) en un fichero binario.
+ *
+ * Formato: cabecera "CAPB" + versión (1 byte), y después un registro por informe:
+ *   tiempo (8 bytes, little endian, us), dirección (6), rssi (1), longitud (1), datos (longitud)
+ *
+ * Todos los derechos reservados.
+ */
+
+#ifndef CAPTURA_H_INCLUIDO
+#define CAPTURA_H_INCLUIDO
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "DecodificadorIBeacon.h"
+
+namespace Captura {
+  const char MAGICO[4] = { 'C', 'A', 'P', 'B' };
+  const uint8_t VERSION = 1;
+  const uint8_t TAMANYO_CABECERA_REGISTRO = 8 + 6 + 1 + 1;
+}; // namespace
+
+// ----------------------------------------------------------
+/**
+ * @brief Escribe informes en un fichero de captura.
+ */
+class EscritorCaptura {
+private:
+
+  FILE * fichero;
+
+public:
+
+  // .........................................................
+  /**
+   * @brief Abre (o crea) el fichero y escribe la cabecera.
+   *
+   * @param nombre Ruta del fichero.
+   */
+  EscritorCaptura( const char * nombre ) : fichero( fopen( nombre, "wb" ) ) {
+	if ( (*this).fichero != nullptr ) {
+	  fwrite( Captura::MAGICO, 1, 4, (*this).fichero );
+	  fputc( Captura::VERSION, (*this).fichero );
+	}
+  } // ()
+
+  ~EscritorCaptura() {
+	if ( (*this).fichero != nullptr ) {
+	  fclose( (*this).fichero );
+	}
+  } // ()
+
+  EscritorCaptura( const EscritorCaptura & ) = delete;
+  EscritorCaptura & operator=( const EscritorCaptura & ) = delete;
+
+  bool abierto() const {
+	return (*this).fichero != nullptr;
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Añade un informe al final del fichero.
+   */
+  bool escribir( const InformeAnuncio & informe ) {
+	uint8_t cabecera[Captura::TAMANYO_CABECERA_REGISTRO];
+	for ( int i = 0; i < 8; i++ ) {
+	  cabecera[i] = (uint8_t) ( informe.tiempo >> (8*i) );
+	}
+	memcpy( &cabecera[8], informe.direccion, 6 );
+	cabecera[14] = (uint8_t) informe.rssi;
+	cabecera[15] = informe.longitud;
+
+	return fwrite( cabecera, 1, sizeof(cabecera), (*this).fichero ) == sizeof(cabecera)
+	  && fwrite( informe.datos, 1, informe.longitud, (*this).fichero ) == informe.longitud;
+  } // ()
+
+}; // class
+
+// ----------------------------------------------------------
+/**
+ * @brief Lee secuencialmente los informes de un fichero de captura.
+ *
+ * Lee el fichero a bloques grandes para que la lectura no sea el cuello de botella
+ * de MotorIngestion.
+ */
+class LectorCaptura {
+private:
+
+  FILE * fichero;
+  bool cabeceraValida;
+
+  static const size_t TAMANYO_BUFFER = 1 << 16;
+  uint8_t buffer[TAMANYO_BUFFER];
+  size_t inicio = 0;
+  size_t fin = 0;
+
+  // .........................................................
+  // asegura que hay al menos n bytes en el buffer, false si se acaba el fichero
+  // .........................................................
+  bool asegurar( size_t n ) {
+	if ( (*this).fin - (*this).inicio >= n ) {
+	  return true;
+	}
+	memmove( (*this).buffer, &(*this).buffer[(*this).inicio], (*this).fin - (*this).inicio );
+	(*this).fin -= (*this).inicio;
+	(*this).inicio = 0;
+	(*this).fin += fread( &(*this).buffer[(*this).fin], 1, TAMANYO_BUFFER - (*this).fin, (*this).fichero );
+	return (*this).fin >= n;
+  } // ()
+
+public:
+
+  // .........................................................
+  /**
+   * @brief Abre el fichero y comprueba la cabecera.
+   *
+   * @param nombre Ruta del fichero.
+   */
+  LectorCaptura( const char * nombre ) : fichero( fopen( nombre, "rb" ) ), cabeceraValida( false ) {
+	if ( (*this).fichero == nullptr ) {
+	  return;
+	}
+	char magico[5];
+	(*this).cabeceraValida = fread( magico, 1, 5, (*this).fichero ) == 5
+	  && memcmp( magico, Captura::MAGICO, 4 ) == 0
+	  && (uint8_t) magico[4] == Captura::VERSION;
+  } // ()
+
+  ~LectorCaptura() {
+	if ( (*this).fichero != nullptr ) {
+	  fclose( (*this).fichero );
+	}
+  } // ()
+
+  LectorCaptura( const LectorCaptura & ) = delete;
+  LectorCaptura & operator=( const LectorCaptura & ) = delete;
+
+  bool abierto() const {
+	return (*this).fichero != nullptr && (*this).cabeceraValida;
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Lee el siguiente informe.
+   *
+   * @param informe Donde se deja el informe leído.
+   * @return false al llegar al final del fichero (o si el último registro está cortado).
+   */
+  bool leer( InformeAnuncio & informe ) {
+	if ( ! (*this).abierto() || ! asegurar( Captura::TAMANYO_CABECERA_REGISTRO ) ) {
+	  return false;
+	}
+	const uint8_t * p = &(*this).buffer[(*this).inicio];
+	uint8_t longitud = p[15];
+	if ( longitud > TramaIBeacon::LONGITUD_MAXIMA_ANUNCIO
+		 || ! asegurar( Captura::TAMANYO_CABECERA_REGISTRO + longitud ) ) {
+	  return false;
+	}
+	p = &(*this).buffer[(*this).inicio]; // asegurar() puede haber movido el buffer
+
+	informe.tiempo = 0;
+	for ( int i = 0; i < 8; i++ ) {
+	  informe.tiempo |= ( (uint64_t) p[i] ) << (8*i);
+	}
+	memcpy( informe.direccion, &p[8], 6 );
+	informe.rssi = (int8_t) p[14];
+	informe.longitud = longitud;
+	memcpy( informe.datos, &p[Captura::TAMANYO_CABECERA_REGISTRO], longitud );
+
+	(*this).inicio += Captura::TAMANYO_CABECERA_REGISTRO + longitud;
+	return true;
+  } // ()
+
+}; // class
+
+#endif
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
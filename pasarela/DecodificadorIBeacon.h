@@ -0,0 +1,234 @@
+/*
+ * Nombre del fichero: DecodificadorIBeacon.h
+ * Descripción: Decodificador de anuncios iBeacon para la pasarela (lado ordenador).
+ * Autores: agent
+ * Fecha: 18 de octubre de 2026
+ *
+ * Este archivo ha sido realizado por agent.
+ * Contiene la clase DecodificadorIBeacon, que interpreta los informes de anuncio en bruto
+ * que recibe una pasarela y extrae major, minor y txPower de las tramas que emiten
+ * Publicador y EmisoraBLE. Usa las mismas definiciones que el firmware (TramaIBeacon.h)
+ * y no reserva memoria: las lecturas apuntan a los bytes del propio informe.
+ *
+ * Todos los derechos reservados.
+ */
+
+#ifndef DECODIFICADOR_IBEACON_H_INCLUIDO
+#define DECODIFICADOR_IBEACON_H_INCLUIDO
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "../TramaIBeacon.h"
+#include "../TramasPublicador.h"
+
+// ----------------------------------------------------------
+/**
+ * @brief Informe de anuncio tal y como lo entrega el escáner de la pasarela.
+ *
+ * Tamaño fijo para poder tener arrays contiguos de informes y decodificarlos por lotes.
+ */
+struct InformeAnuncio {
+  uint64_t tiempo;       ///< Marca de tiempo de la recepción en microsegundos.
+  uint8_t direccion[6];  ///< Dirección BLE del emisor.
+  int8_t rssi;           ///< RSSI medido por la pasarela en dBm.
+  uint8_t longitud;      ///< Bytes válidos en datos.
+  uint8_t datos[TramaIBeacon::LONGITUD_MAXIMA_ANUNCIO]; ///< Datos de anuncio en bruto (estructuras AD).
+}; // struct
+
+// ----------------------------------------------------------
+/**
+ * @brief Resultado de decodificar un informe.
+ */
+struct LecturaIBeacon {
+  const uint8_t * carga; ///< Los 21 bytes de carga dentro del informe (uuid, major, minor, txPower).
+  uint32_t indiceInforme; ///< Posición del informe en el lote (decodificarLote()).
+  uint16_t major;
+  uint16_t minor;
+  int8_t txPower;
+  int8_t rssi;
+  bool resumen; ///< La carga es un resumen de ventana (TramasPublicador::decodificarResumen()); major y minor no valen.
+}; // struct
+
+// ----------------------------------------------------------
+/**
+ * @brief Decodifica anuncios iBeacon (normales y de carga libre) sin reservar memoria.
+ *
+ * Si se instala un uuid de filtro sólo se aceptan las tramas con ese uuid
+ * (por defecto TramaIBeacon::UUID_PROYECTO). Con filtrarUUID = false se aceptan
+ * también las tramas de emitirAnuncioIBeaconLibre(), cuya carga no empieza por un uuid.
+ * Con aceptarResumenes( true ) pasan el filtro, además, los resúmenes de ventana de
+ * Publicador, que también son tramas libres.
+ *
+ * @section ejemplos Ejemplo de uso
+ * @code
+ * DecodificadorIBeacon deco;
+ * LecturaIBeacon lecturas[256];
+ * size_t n = deco.decodificarLote( informes, numInformes, lecturas );
+ * @endcode
+ */
+class DecodificadorIBeacon {
+
+private:
+
+  uint8_t uuidFiltro[TramaIBeacon::LONGITUD_UUID];
+  bool filtrarUUID;
+  bool conResumenes = false;
+
+public:
+
+  // .........................................................
+  /**
+   * @brief Constructor. Filtra por el uuid del proyecto.
+   */
+  DecodificadorIBeacon() : filtrarUUID( true ) {
+	memcpy( (*this).uuidFiltro, TramaIBeacon::UUID_PROYECTO, TramaIBeacon::LONGITUD_UUID );
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Cambia el uuid de filtro.
+   *
+   * @param uuid Uuid a aceptar, o nullptr para aceptar cualquier carga.
+   */
+  void instalarFiltroUUID( const uint8_t * uuid ) {
+	(*this).filtrarUUID = ( uuid != nullptr );
+	if ( uuid != nullptr ) {
+	  memcpy( (*this).uuidFiltro, uuid, TramaIBeacon::LONGITUD_UUID );
+	}
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Deja pasar (o no) los resúmenes de ventana aunque se filtre por uuid.
+   */
+  void aceptarResumenes( bool si ) {
+	(*this).conResumenes = si;
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Busca los datos de fabricante iBeacon entre las estructuras AD del anuncio.
+   *
+   * @param datos Datos de anuncio en bruto.
+   * @param longitud Número de bytes en datos.
+   * @return Puntero a la carga de 21 bytes, o nullptr si el anuncio no es un iBeacon.
+   */
+  static const uint8_t * buscarCarga( const uint8_t * datos, uint8_t longitud ) {
+	uint8_t i = 0;
+	while ( i + 1 < longitud ) {
+	  uint8_t lon = datos[i];
+	  if ( lon == 0 || i + 1 + lon > longitud ) {
+		return nullptr; // estructura AD mal formada o relleno
+	  }
+	  if ( datos[i+1] == TramaIBeacon::AD_TIPO_FABRICANTE
+		   && lon == 1 + 4 + TramaIBeacon::LONGITUD_CARGA
+		   && memcmp( &datos[i+2], TramaIBeacon::PREFIJO_FABRICANTE, 4 ) == 0 ) {
+		return &datos[i+2+4];
+	  }
+	  i += 1 + lon;
+	} // while
+	return nullptr;
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Busca la telemetría del nodo entre las estructuras AD de una respuesta de escaneo.
+   *
+   * Son datos de fabricante (de cualquier fabricante) que empiezan por
+   * TramasPublicador::MARCA_TELEMETRIA (ver EmisoraBLE::ajustarRespuestaEscaneo()).
+   *
+   * @param datos Respuesta de escaneo en bruto.
+   * @param longitud Número de bytes en datos.
+   * @param telemetria Aquí lo que lleva.
+   * @return false si no lleva telemetría.
+   */
+  static bool decodificarTelemetria( const uint8_t * datos, uint8_t longitud, DatosTelemetria & telemetria ) {
+	uint8_t i = 0;
+	while ( i + 1 < longitud ) {
+	  uint8_t lon = datos[i];
+	  if ( lon == 0 || i + 1 + lon > longitud ) {
+		return false; // estructura AD mal formada o relleno
+	  }
+	  if ( datos[i+1] == TramaIBeacon::AD_TIPO_FABRICANTE
+		   && lon == 1 + 2 + TramasPublicador::Telemetria::TAM
+		   && TramasPublicador::decodificarTelemetria( &datos[i+2+2], telemetria ) ) {
+		return true;
+	  }
+	  i += 1 + lon;
+	} // while
+	return false;
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Decodifica un anuncio.
+   *
+   * @param datos Datos de anuncio en bruto.
+   * @param longitud Número de bytes en datos.
+   * @param lectura Donde se deja el resultado (su carga apunta dentro de datos).
+   * @return true si es una trama nuestra, false si no es iBeacon o no pasa el filtro.
+   */
+  bool decodificar( const uint8_t * datos, uint8_t longitud, LecturaIBeacon & lectura ) const {
+	const uint8_t * carga = buscarCarga( datos, longitud );
+	if ( carga == nullptr ) {
+	  return false;
+	}
+	lectura.resumen = (*this).conResumenes && TramasPublicador::esResumen( carga );
+	if ( (*this).filtrarUUID && ! lectura.resumen
+		 && memcmp( &carga[TramaIBeacon::POS_UUID], (*this).uuidFiltro, TramaIBeacon::LONGITUD_UUID ) != 0 ) {
+	  return false;
+	}
+	lectura.carga = carga;
+	lectura.indiceInforme = 0;
+	lectura.rssi = 0; // sin informe no se sabe; decodificar( informe, lectura ) lo pone
+	lectura.major = TramaIBeacon::leerBE16( &carga[TramaIBeacon::POS_MAJOR] );
+	lectura.minor = TramaIBeacon::leerBE16( &carga[TramaIBeacon::POS_MINOR] );
+	lectura.txPower = (int8_t) carga[TramaIBeacon::POS_TXPOWER];
+	return true;
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Decodifica un informe completo.
+   */
+  bool decodificar( const InformeAnuncio & informe, LecturaIBeacon & lectura ) const {
+	if ( ! decodificar( informe.datos, informe.longitud, lectura ) ) {
+	  return false;
+	}
+	lectura.rssi = informe.rssi;
+	return true;
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Decodifica un array de informes.
+   *
+   * Las lecturas se escriben compactadas al principio de salida; cada una guarda
+   * en indiceInforme la posición de su informe.
+   *
+   * @param informes Array de informes.
+   * @param n Número de informes.
+   * @param salida Array con sitio para n lecturas.
+   * @return Número de lecturas válidas escritas en salida.
+   */
+  size_t decodificarLote( const InformeAnuncio * informes, size_t n, LecturaIBeacon * salida ) const {
+	size_t escritas = 0;
+	for ( size_t i = 0; i < n; i++ ) {
+	  if ( decodificar( informes[i], salida[escritas] ) ) {
+		salida[escritas].indiceInforme = (uint32_t) i;
+		escritas++;
+	  }
+	} // for
+	return escritas;
+  } // ()
+
+}; // class
+
+#endif
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
@@ -0,0 +1,333 @@
+/*
+ * Nombre del fichero: MotorIngestion.h
+ * Descripción: Motor multihilo que convierte capturas de anuncios en series temporales por nodo.
+ * Autores: agent
+ * Fecha: 18 de octubre de 2026
+ *
+ * Este archivo ha sido realizado por agent.
+ * Contiene la clase MotorIngestion. Un hilo (el que llama a ingerir()) reparte los informes
+ * por nodo entre varios hilos trabajadores a través de colas ColaSPSC. Cada trabajador es
+ * el único dueño de sus nodos, así que decodifica, reordena, quita duplicados y guarda la
+ * serie de cada nodo sin ningún cerrojo.
+ *
+ * Todos los derechos reservados.
+ */
+
+#ifndef MOTOR_INGESTION_H_INCLUIDO
+#define MOTOR_INGESTION_H_INCLUIDO
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "../ColaSPSC.h"
+#include "DecodificadorIBeacon.h"
+
+// ----------------------------------------------------------
+/**
+ * @brief Un punto de la serie temporal de un nodo.
+ */
+struct PuntoSerie {
+  uint64_t tiempo;  ///< Tiempo de la primera copia recibida de esta lectura (us).
+  uint16_t major;
+  uint16_t minor;
+  int8_t rssi;      ///< Mejor RSSI entre las copias recibidas.
+  uint8_t copias;   ///< Copias de la misma lectura que se han descartado como duplicadas + 1.
+}; // struct
+
+// ----------------------------------------------------------
+/**
+ * @brief Contadores del motor (sumados de todos los trabajadores en estadisticas()).
+ */
+struct EstadisticasIngestion {
+  uint64_t recibidos = 0;   ///< Informes que han entrado en ingerir().
+  uint64_t ajenos = 0;      ///< Informes que no son tramas nuestras.
+  uint64_t duplicados = 0;  ///< Copias repetidas de una lectura ya guardada.
+  uint64_t tardios = 0;     ///< Llegados después de cerrar su ventana de reordenación.
+  uint64_t guardados = 0;   ///< Puntos añadidos a las series.
+  uint64_t colaLlena = 0;   ///< Veces que ingerir() ha tenido que esperar a un trabajador.
+}; // struct
+
+// ----------------------------------------------------------
+/**
+ * @brief Ingestión de capturas: reparto por nodo, reordenación, duplicados y series.
+ *
+ * Una lectura de Publicador se anuncia muchas veces durante su ventana de publicación
+ * (y la pueden oír varias radios), así que dos informes del mismo nodo con la misma carga
+ * separados menos de ventanaDuplicados se consideran la misma lectura.
+ *
+ * @section ejemplos Ejemplo de uso
+ * @code
+ * MotorIngestion motor( 4 );
+ * LectorCaptura lector( "captura.capb" );
+ * InformeAnuncio inf;
+ * while ( lector.leer( inf ) ) motor.ingerir( inf );
+ * motor.terminar();
+ * motor.paraCadaSerie( []( uint64_t nodo, const std::vector<PuntoSerie> & serie ) { ... } );
+ * @endcode
+ */
+class MotorIngestion {
+
+public:
+
+  static const size_t CAPACIDAD_COLA = 4096;
+
+private:
+
+  // .........................................................
+  // lo que viaja por las colas
+  // .........................................................
+  struct Entrada {
+	InformeAnuncio informe;
+	uint64_t llegadaNs;   ///< Reloj de pared al entrar en ingerir(), para la latencia.
+  }; // struct
+
+  struct Pendiente {
+	uint64_t tiempo;
+	uint64_t llegadaNs;
+	uint16_t major;
+	uint16_t minor;
+	int8_t rssi;
+	bool operator>( const Pendiente & otro ) const { return tiempo > otro.tiempo; }
+  }; // struct
+
+  struct EstadoNodo {
+	std::priority_queue< Pendiente, std::vector<Pendiente>, std::greater<Pendiente> > reordenacion;
+	uint64_t ultimoLiberado = 0;
+	std::vector<PuntoSerie> serie;
+  }; // struct
+
+  struct Trabajador {
+	ColaSPSC< Entrada, CAPACIDAD_COLA > cola;
+	std::unordered_map< uint64_t, EstadoNodo > nodos;
+	std::vector<uint64_t> latenciasNs;
+	EstadisticasIngestion estadisticas;
+	std::thread hilo;
+  }; // struct
+
+  const uint64_t ventanaDuplicados;
+  const uint64_t ventanaReordenacion;
+
+  DecodificadorIBeacon decodificador;
+  std::vector< std::unique_ptr<Trabajador> > trabajadores;
+  std::atomic<bool> acabando { false };
+  uint64_t recibidos = 0;
+  uint64_t colaLlena = 0;
+
+  // .........................................................
+  static uint64_t ahoraNs() {
+	return (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+	  std::chrono::steady_clock::now().time_since_epoch() ).count();
+  } // ()
+
+  static uint64_t claveNodo( const uint8_t * direccion ) {
+	uint64_t clave = 0;
+	memcpy( &clave, direccion, 6 );
+	return clave;
+  } // ()
+
+  // .........................................................
+  // saca de la ventana de reordenación lo que ya no puede ser adelantado
+  // por nada que llegue después y lo pasa (sin duplicados) a la serie
+  // .........................................................
+  void liberar( Trabajador & t, EstadoNodo & nodo, uint64_t hasta ) {
+	while ( ! nodo.reordenacion.empty() && nodo.reordenacion.top().tiempo <= hasta ) {
+	  Pendiente p = nodo.reordenacion.top();
+	  nodo.reordenacion.pop();
+	  nodo.ultimoLiberado = p.tiempo;
+
+	  if ( ! nodo.serie.empty() ) {
+		PuntoSerie & ultimo = nodo.serie.back();
+		if ( ultimo.major == p.major && ultimo.minor == p.minor
+			 && p.tiempo - ultimo.tiempo < (*this).ventanaDuplicados ) {
+		  ultimo.rssi = std::max( ultimo.rssi, p.rssi );
+		  if ( ultimo.copias < 255 ) {
+			ultimo.copias++;
+		  }
+		  t.estadisticas.duplicados++;
+		  continue;
+		}
+	  }
+
+	  nodo.serie.push_back( PuntoSerie { p.tiempo, p.major, p.minor, p.rssi, 1 } );
+	  t.estadisticas.guardados++;
+	  t.latenciasNs.push_back( ahoraNs() - p.llegadaNs );
+	} // while
+  } // ()
+
+  // .........................................................
+  void procesar( Trabajador & t, const Entrada & e ) {
+	LecturaIBeacon lectura;
+	if ( ! (*this).decodificador.decodificar( e.informe, lectura ) ) {
+	  t.estadisticas.ajenos++;
+	  return;
+	}
+
+	EstadoNodo & nodo = t.nodos[ claveNodo( e.informe.direccion ) ];
+	if ( e.informe.tiempo < nodo.ultimoLiberado ) {
+	  t.estadisticas.tardios++;
+	  return;
+	}
+
+	nodo.reordenacion.push( Pendiente { e.informe.tiempo, e.llegadaNs,
+										lectura.major, lectura.minor, lectura.rssi } );
+	if ( e.informe.tiempo > (*this).ventanaReordenacion ) {
+	  liberar( t, nodo, e.informe.tiempo - (*this).ventanaReordenacion );
+	}
+  } // ()
+
+  // .........................................................
+  void bucleTrabajador( Trabajador & t ) {
+	Entrada e;
+	for ( ;; ) {
+	  if ( t.cola.sacar( e ) ) {
+		procesar( t, e );
+	  } else if ( (*this).acabando.load( std::memory_order_acquire ) ) {
+		if ( ! t.cola.sacar( e ) ) {
+		  break;
+		}
+		procesar( t, e );
+	  } else {
+		std::this_thread::yield();
+	  }
+	} // for
+
+	// al acabar la captura se vacían todas las ventanas de reordenación
+	for ( auto & par : t.nodos ) {
+	  liberar( t, par.second, UINT64_MAX );
+	}
+  } // ()
+
+public:
+
+  // .........................................................
+  /**
+   * @brief Constructor. Arranca los hilos trabajadores.
+   *
+   * @param numTrabajadores Número de hilos trabajadores (al menos 1).
+   * @param ventanaDuplicados_ Tiempo (us) en el que la misma carga del mismo nodo es una copia.
+   * @param ventanaReordenacion_ Retraso (us) que se espera a informes desordenados.
+   */
+  MotorIngestion( unsigned numTrabajadores,
+				  uint64_t ventanaDuplicados_ = 1500000,
+				  uint64_t ventanaReordenacion_ = 250000 )
+	: ventanaDuplicados( ventanaDuplicados_ ), ventanaReordenacion( ventanaReordenacion_ )
+  {
+	if ( numTrabajadores == 0 ) {
+	  numTrabajadores = 1;
+	}
+	for ( unsigned i = 0; i < numTrabajadores; i++ ) {
+	  (*this).trabajadores.emplace_back( new Trabajador() );
+	}
+	for ( auto & t : (*this).trabajadores ) {
+	  Trabajador * pt = t.get();
+	  pt->hilo = std::thread( [this, pt]() { bucleTrabajador( *pt ); } );
+	}
+  } // ()
+
+  ~MotorIngestion() {
+	terminar();
+  } // ()
+
+  MotorIngestion( const MotorIngestion & ) = delete;
+  MotorIngestion & operator=( const MotorIngestion & ) = delete;
+
+  // .........................................................
+  /**
+   * @brief Entrega un informe al trabajador de su nodo. Sólo desde un hilo.
+   *
+   * Si la cola de ese trabajador está llena espera (cediendo el procesador).
+   */
+  void ingerir( const InformeAnuncio & informe ) {
+	Entrada e { informe, ahoraNs() };
+	uint64_t clave = claveNodo( informe.direccion );
+	// mezcla de la dirección para que nodos consecutivos caigan en trabajadores distintos
+	clave *= 0x9e3779b97f4a7c15ULL;
+	Trabajador & t = *(*this).trabajadores[ ( clave >> 32 ) % (*this).trabajadores.size() ];
+
+	if ( ! t.cola.meter( e ) ) {
+	  (*this).colaLlena++;
+	  while ( ! t.cola.meter( e ) ) {
+		std::this_thread::yield();
+	  }
+	}
+	(*this).recibidos++;
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Espera a que los trabajadores terminen y vacía las ventanas de reordenación.
+   */
+  void terminar() {
+	(*this).acabando.store( true, std::memory_order_release );
+	for ( auto & t : (*this).trabajadores ) {
+	  if ( t->hilo.joinable() ) {
+		t->hilo.join();
+	  }
+	}
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Recorre las series de todos los nodos (después de terminar()).
+   *
+   * @param f Función f( claveNodo, serie ).
+   */
+  void paraCadaSerie( const std::function< void( uint64_t, const std::vector<PuntoSerie> & ) > & f ) const {
+	for ( auto & t : (*this).trabajadores ) {
+	  for ( auto & par : t->nodos ) {
+		f( par.first, par.second.serie );
+	  }
+	}
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Suma de los contadores de todos los trabajadores (después de terminar()).
+   */
+  EstadisticasIngestion estadisticas() const {
+	EstadisticasIngestion total;
+	for ( auto & t : (*this).trabajadores ) {
+	  total.ajenos += t->estadisticas.ajenos;
+	  total.duplicados += t->estadisticas.duplicados;
+	  total.tardios += t->estadisticas.tardios;
+	  total.guardados += t->estadisticas.guardados;
+	}
+	total.recibidos = (*this).recibidos;
+	total.colaLlena = (*this).colaLlena;
+	return total;
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Percentil de la latencia (ns) desde ingerir() hasta que el punto entra en su serie.
+   *
+   * @param p Percentil entre 0 y 1 (0.99 para p99).
+   */
+  uint64_t percentilLatenciaNs( double p ) const {
+	std::vector<uint64_t> todas;
+	for ( auto & t : (*this).trabajadores ) {
+	  todas.insert( todas.end(), t->latenciasNs.begin(), t->latenciasNs.end() );
+	}
+	if ( todas.empty() ) {
+	  return 0;
+	}
+	size_t k = (size_t) ( p * ( todas.size() - 1 ) );
+	std::nth_element( todas.begin(), todas.begin() + k, todas.end() );
+	return todas[k];
+  } // ()
+
+}; // class
+
+#endif
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
@@ -0,0 +1,395 @@
+/*
+ * Nombre del fichero: benchmarkAlmacen.cpp
+ * Descripción: Mide AlmacenSeries con un mes de lecturas de 10000 nodos.
+ * Autores: agent
+ * Fecha: 18 de octubre de 2026
+ *
+ * Este archivo ha sido realizado por agent.
+ * Genera, en el orden en que las daría la pasarela (todos los nodos a la vez), las lecturas
+ * de ozono (milésimas de ppm) y temperatura (centésimas de ºC) de cada nodo cada periodo:
+ * el reloj de cada nodo va ±40 ppm, la pasarela oye la primera copia o alguna de las
+ * siguientes (62.5 ms más tarde cada una), con unos ms de retraso, y se pierde el 1 % de
+ * las lecturas. Las escribe con EscritorSeries y mide los puntos/s (sólo anyadir() y
+ * cerrar(), sin la generación) y los bytes por punto, frente a una línea de texto por
+ * lectura. Después consulta, con LectorSeries, series al azar en intervalos de una hora,
+ * un día, una semana y el mes entero (p50 y p99 de la latencia), y comprueba que salen,
+ * bit a bit, las lecturas generadas. Los primeros 1000 nodos se escriben también en otro
+ * fichero con todos los valores en XOR y en dos veces (cerrando y reabriendo a mitad), para
+ * comparar y para probar que se puede seguir añadiendo. A los tres cuartos se copia ese
+ * fichero como está en disco, sin índice y cortado a mitad de un bloque (como si la
+ * pasarela se hubiera caído), y se comprueba que EscritorSeries rehace el índice y que
+ * cada serie sale entera hasta donde llegó a escribirse.
+ *
+ * Compilar (desde esta carpeta):
+ *   g++ -O2 -std=c++17 benchmarkAlmacen.cpp -o benchmarkAlmacen
+ * Uso:
+ *   ./benchmarkAlmacen [fichero.serb] [nodos] [días] [periodo en s]
+ *
+ * Todos los derechos reservados.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "AlmacenSeries.h"
+#include "../TramasPublicador.h"
+
+const uint64_t T0_MS = 1790000000000ull;   // hacia 2026
+const uint64_t INTERVALO_US = 62500;       // setInterval(100, 100) = 62.5 ms
+const uint64_t US_TEMPERATURA = 1000000;   // la temperatura va detrás del anuncio del ozono
+const uint32_t NODOS_XOR = 1000;
+const double MS_DIA = 86400000.0;
+
+// ----------------------------------------------------------
+// cada nodo, con su propio azar para poder regenerar su serie sola
+// ----------------------------------------------------------
+struct Nodo {
+  uint64_t azar;
+  uint64_t desfaseUs;
+  double deriva;   ///< Del reloj (±40 ppm).
+  double fase;     ///< De la temperatura a lo largo del día.
+  double base;     ///< Ozono de fondo (ppm).
+  double ppm;
+  uint8_t contador = 0;
+
+  uint64_t siguiente() {
+	uint64_t z = ( (*this).azar += 0x9e3779b97f4a7c15ull );
+	z = ( z ^ ( z >> 30 ) ) * 0xbf58476d1ce4e5b9ull;
+	z = ( z ^ ( z >> 27 ) ) * 0x94d049bb133111ebull;
+	return z ^ ( z >> 31 );
+  } // ()
+
+  double uniforme() {
+	return ( siguiente() >> 11 ) * ( 1.0 / 9007199254740992.0 );
+  } // ()
+
+  // más o menos normal (suma de cuatro uniformes), de desviación 1
+  double normal() {
+	return ( uniforme() + uniforme() + uniforme() + uniforme() - 2.0 ) * 1.7320508;
+  } // ()
+
+  // copia que oye la pasarela (0 la primera)
+  uint64_t copia() {
+	uint64_t k = 0;
+	while ( k < 15 && uniforme() < 0.15 ) {
+	  k++;
+	}
+	return k;
+  } // ()
+
+  Nodo( uint32_t n, uint64_t periodoUs ) : azar( 0x5eed0000ull + n ) {
+	(*this).desfaseUs = siguiente() % periodoUs;
+	(*this).deriva = ( uniforme() * 80.0 - 40.0 ) * 1e-6;
+	(*this).fase = uniforme() * 6.2831853;
+	(*this).base = 0.02 + uniforme() * 0.06;
+	(*this).ppm = (*this).base;
+  } // ()
+}; // struct
+
+struct Lectura {
+  uint64_t nodo;
+  uint8_t canal;
+  uint64_t tiempo;
+  double valor;
+  uint8_t secuencia;
+}; // struct
+
+static uint64_t direccion( uint32_t n ) {
+  return 0xc00000000000ull | n;
+} // ()
+
+// ----------------------------------------------------------
+// las lecturas del nodo n en el periodo i (ninguna si se pierden)
+// ----------------------------------------------------------
+static void generar( Nodo & nodo, uint32_t n, uint64_t i, uint64_t periodoUs, std::vector<Lectura> & salida ) {
+  nodo.contador++;
+  nodo.ppm += 0.002 * nodo.normal() + 0.01 * ( nodo.base - nodo.ppm );
+  if ( nodo.ppm < 0 ) {
+	nodo.ppm = 0;
+  }
+  uint64_t us = nodo.desfaseUs + (uint64_t) ( (double) i * periodoUs * ( 1.0 + nodo.deriva ) );
+  double temperatura = 21.0 + 4.0 * sin( 6.2831853 * ( us / 1000.0 ) / MS_DIA + nodo.fase ) + 0.05 * nodo.normal();
+  bool perdida = nodo.uniforme() < 0.01;
+  uint64_t usOzono = us + nodo.copia() * INTERVALO_US + nodo.siguiente() % 3000;
+  uint64_t usTemperatura = us + US_TEMPERATURA + nodo.copia() * INTERVALO_US + nodo.siguiente() % 3000;
+  if ( perdida ) {
+	return;
+  }
+  // como llegan: redondeados a su campo y decodificados como en TramasPublicador
+  double ozono = (double) llround( nodo.ppm * 1000 ) / 1000;
+  double grados = (double) llround( temperatura * 100 ) / 100;
+  salida.push_back( { direccion( n ), TramasPublicador::ID_CO2, T0_MS + usOzono / 1000, ozono, nodo.contador } );
+  salida.push_back( { direccion( n ), TramasPublicador::ID_TEMPERATURA, T0_MS + usTemperatura / 1000, grados, nodo.contador } );
+} // ()
+
+// la serie entera de un canal de un nodo, generada otra vez
+static std::vector<Lectura> regenerar( uint32_t n, uint8_t canal, uint64_t periodos, uint64_t periodoUs ) {
+  Nodo nodo( n, periodoUs );
+  std::vector<Lectura> todas;
+  std::vector<Lectura> serie;
+  for ( uint64_t i = 0; i < periodos; i++ ) {
+	todas.clear();
+	generar( nodo, n, i, periodoUs, todas );
+	for ( const Lectura & l : todas ) {
+	  if ( l.canal == canal ) {
+		serie.push_back( l );
+	  }
+	}
+  }
+  return serie;
+} // ()
+
+static bool iguales( const std::vector<Lectura> & esperadas, const std::vector<PuntoAlmacen> & puntos ) {
+  if ( esperadas.size() != puntos.size() ) {
+	return false;
+  }
+  for ( size_t i = 0; i < puntos.size(); i++ ) {
+	if ( esperadas[i].tiempo != puntos[i].tiempo || esperadas[i].secuencia != puntos[i].secuencia
+		 || AlmacenSeries::bitsDe( esperadas[i].valor ) != AlmacenSeries::bitsDe( puntos[i].valor ) ) {
+	  return false;
+	}
+  }
+  return true;
+} // ()
+
+// copia un fichero sin sus últimos bytes
+static bool copiarCortado( const std::string & origen, const std::string & destino, long quitar ) {
+  FILE * o = fopen( origen.c_str(), "rb" );
+  FILE * d = fopen( destino.c_str(), "wb" );
+  bool bien = o != nullptr && d != nullptr && fseek( o, 0, SEEK_END ) == 0;
+  long bytes = bien ? ftell( o ) - quitar : 0;
+  bien = bien && bytes > 0 && fseek( o, 0, SEEK_SET ) == 0;
+  std::vector<uint8_t> datos( bien ? (size_t) bytes : 0 );
+  bien = bien && fread( datos.data(), 1, datos.size(), o ) == datos.size()
+	&& fwrite( datos.data(), 1, datos.size(), d ) == datos.size();
+  if ( o != nullptr ) {
+	fclose( o );
+  }
+  if ( d != nullptr ) {
+	bien = fclose( d ) == 0 && bien;
+  }
+  return bien;
+} // ()
+
+static double percentil( std::vector<double> & v, double p ) {
+  std::sort( v.begin(), v.end() );
+  return v.empty() ? 0.0 : v[ std::min( v.size() - 1, (size_t) ( v.size() * p ) ) ];
+} // ()
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+int main( int argc, char * argv[] ) {
+  std::string nombre = argc > 1 ? argv[1] : "/tmp/benchmarkAlmacen.serb";
+  std::string nombreXOR = nombre + ".xor";
+  std::string nombreCortado = nombre + ".cortado";
+  uint32_t numNodos = argc > 2 ? (uint32_t) atoi( argv[2] ) : 10000;
+  uint32_t dias = argc > 3 ? (uint32_t) atoi( argv[3] ) : 30;
+  uint32_t periodoS = argc > 4 ? (uint32_t) atoi( argv[4] ) : 60;
+  uint64_t periodoUs = (uint64_t) periodoS * 1000000;
+  uint64_t periodos = (uint64_t) dias * 86400 / periodoS;
+  uint32_t nodosXOR = std::min( numNodos, NODOS_XOR );
+  bool bien = true;
+
+  remove( nombre.c_str() );
+  remove( nombreXOR.c_str() );
+  remove( nombreCortado.c_str() );
+
+  // --- escribir ---
+  std::vector<Nodo> nodos;
+  nodos.reserve( numNodos );
+  for ( uint32_t n = 0; n < numNodos; n++ ) {
+	nodos.emplace_back( n, periodoUs );
+  }
+  EscritorSeries escritor( nombre.c_str() );
+  EscritorSeries * escritorXOR = new EscritorSeries( nombreXOR.c_str(), AlmacenSeries::PUNTOS_POR_BLOQUE, false );
+  if ( ! escritor.abierto() || ! escritorXOR->abierto() ) {
+	fprintf( stderr, "no se puede crear %s\n", nombre.c_str() );
+	return 1;
+  }
+
+  std::vector<Lectura> lecturas;
+  lecturas.reserve( (size_t) numNodos * 2 );
+  double segundosEscritura = 0;
+  uint64_t puntosXOR = 0;
+  bool copiado = false;
+  double bytesTexto = 0;
+  uint64_t lineasTexto = 0;
+  char linea[96];
+  for ( uint64_t i = 0; i < periodos; i++ ) {
+	lecturas.clear();
+	for ( uint32_t n = 0; n < numNodos; n++ ) {
+	  generar( nodos[n], n, i, periodoUs, lecturas );
+	}
+
+	auto t0 = std::chrono::steady_clock::now();
+	for ( const Lectura & l : lecturas ) {
+	  escritor.anyadir( l.nodo, l.canal, l.tiempo, l.valor, l.secuencia );
+	}
+	auto t1 = std::chrono::steady_clock::now();
+	segundosEscritura += std::chrono::duration<double>( t1 - t0 ).count();
+
+	// el mismo registro en texto (una de cada 101 líneas, para no tardar)
+	for ( size_t j = i % 101; j < lecturas.size(); j += 101 ) {
+	  const Lectura & l = lecturas[j];
+	  bytesTexto += snprintf( linea, sizeof(linea), "%012llx,%u,%llu,%.*f,%u\n", (unsigned long long) l.nodo, l.canal,
+							  (unsigned long long) l.tiempo, l.canal == TramasPublicador::ID_CO2 ? 3 : 2, l.valor, l.secuencia );
+	  lineasTexto++;
+	}
+
+	if ( i == periodos / 2 ) {
+	  delete escritorXOR; // cierra y se vuelve a abrir para seguir añadiendo
+	  escritorXOR = new EscritorSeries( nombreXOR.c_str(), AlmacenSeries::PUNTOS_POR_BLOQUE, false );
+	}
+	if ( i == periodos * 3 / 4 ) {
+	  copiado = copiarCortado( nombreXOR, nombreCortado, 100 ); // sin índice y con el último bloque a medias
+	}
+	for ( const Lectura & l : lecturas ) {
+	  if ( ( l.nodo & 0xffffffff ) < nodosXOR ) {
+		escritorXOR->anyadir( l.nodo, l.canal, l.tiempo, l.valor, l.secuencia );
+		puntosXOR++;
+	  }
+	}
+  }
+  auto t0 = std::chrono::steady_clock::now();
+  bool cerrado = escritor.cerrar();
+  auto t1 = std::chrono::steady_clock::now();
+  segundosEscritura += std::chrono::duration<double>( t1 - t0 ).count();
+  uint64_t puntos = escritor.getPuntos();
+  uint64_t bloques = escritor.getBloques();
+  uint64_t bloquesEnteros = escritor.getBloquesEnteros();
+  uint64_t rechazadosXOR = escritorXOR->getRechazados();
+  bool cerradoXOR = escritorXOR->cerrar();
+  delete escritorXOR;
+
+  LectorSeries lector( nombre.c_str() );
+  LectorSeries lectorXOR( nombreXOR.c_str() );
+  double bytesPorPunto = (double) lector.getBytes() / puntos;
+  double bytesPorPuntoXOR = (double) lectorXOR.getBytes() / puntosXOR;
+  double bytesPorLinea = bytesTexto / lineasTexto;
+
+  printf( "%u nodos, %u días cada %u s: %llu puntos en %llu bloques (%llu con enteros)\n", numNodos, dias, periodoS,
+		  (unsigned long long) puntos, (unsigned long long) bloques, (unsigned long long) bloquesEnteros );
+  printf( "escritura: %.1f Mpuntos/s (%.1f s)\n", puntos / segundosEscritura / 1e6, segundosEscritura );
+  printf( "fichero: %.1f MB, %.2f bytes/punto (índice %.2f); en texto %.1f bytes/punto (x%.0f)\n",
+		  lector.getBytes() / 1e6, bytesPorPunto, (double) lector.getBytesIndice() / puntos, bytesPorLinea,
+		  bytesPorLinea / bytesPorPunto );
+  printf( "sólo XOR (%u nodos, en dos veces): %.2f bytes/punto\n\n", nodosXOR, bytesPorPuntoXOR );
+
+  bool b = cerrado && cerradoXOR && lector.abierto() && lectorXOR.abierto() && escritor.getRechazados() == 0 && rechazadosXOR == 0;
+  bien &= b;
+  printf( "se escriben y se abren los dos ficheros: %s\n", b ? "bien" : "MAL" );
+
+  // --- recuperar el fichero cortado ---
+  EscritorSeries * recuperado = new EscritorSeries( nombreCortado.c_str(), AlmacenSeries::PUNTOS_POR_BLOQUE, false );
+  uint64_t bloquesRecuperados = recuperado->getBloquesRecuperados();
+  b = copiado && recuperado->abierto() && bloquesRecuperados > 0 && recuperado->cerrar();
+  delete recuperado;
+  LectorSeries lectorCortado( nombreCortado.c_str() );
+  uint32_t seriesCortadas = 0;
+  uint64_t puntosCortados = 0;
+  std::vector<PuntoAlmacen> recuperados;
+  for ( uint32_t k = 0; k < 8 && k / 2 < nodosXOR; k++ ) {
+	uint8_t canal = k % 2 == 0 ? TramasPublicador::ID_CO2 : TramasPublicador::ID_TEMPERATURA;
+	std::vector<Lectura> esperadas = regenerar( k / 2, canal, periodos, periodoUs );
+	recuperados.clear();
+	lectorCortado.consultar( direccion( k / 2 ), canal, 0, ~0ull, recuperados );
+	puntosCortados += recuperados.size();
+	if ( ! recuperados.empty() && recuperados.size() < esperadas.size() ) {
+	  esperadas.resize( recuperados.size() );
+	  seriesCortadas += iguales( esperadas, recuperados ) ? 1 : 0;
+	}
+  }
+  b = b && lectorCortado.abierto() && seriesCortadas == std::min( 8u, 2 * nodosXOR ) && lectorCortado.getBloquesMal() == 0;
+  bien &= b;
+  printf( "cortado sin índice: rehace %llu bloques y %u series salen enteras hasta el corte (%llu puntos): %s\n",
+		  (unsigned long long) bloquesRecuperados, seriesCortadas, (unsigned long long) puntosCortados, b ? "bien" : "MAL" );
+
+  // --- consultar ---
+  Nodo azar( 0xffffffff, periodoUs );
+  std::vector<PuntoAlmacen> resultado;
+  resultado.reserve( (size_t) periodos );
+  struct Intervalo { const char * nombre; uint64_t ms; uint32_t consultas; };
+  const Intervalo intervalos[] = { { "1 hora", 3600000ull, 5000 }, { "1 día", 86400000ull, 2000 },
+								   { "1 semana", 7 * 86400000ull, 500 }, { "el mes", (uint64_t) dias * 86400000ull, 200 } };
+  uint64_t msTotal = (uint64_t) dias * 86400000ull;
+  for ( const Intervalo & intervalo : intervalos ) {
+	std::vector<double> us;
+	uint64_t puntosLeidos = 0;
+	uint64_t bloquesAntes = lector.getBloquesLeidos();
+	for ( uint32_t c = 0; c < intervalo.consultas; c++ ) {
+	  uint32_t n = (uint32_t) ( azar.siguiente() % numNodos );
+	  uint8_t canal = azar.siguiente() % 2 == 0 ? TramasPublicador::ID_CO2 : TramasPublicador::ID_TEMPERATURA;
+	  uint64_t desde = T0_MS + ( intervalo.ms < msTotal ? azar.siguiente() % ( msTotal - intervalo.ms ) : 0 );
+	  resultado.clear();
+	  auto c0 = std::chrono::steady_clock::now();
+	  puntosLeidos += lector.consultar( direccion( n ), canal, desde, desde + intervalo.ms, resultado );
+	  auto c1 = std::chrono::steady_clock::now();
+	  us.push_back( std::chrono::duration<double, std::micro>( c1 - c0 ).count() );
+	}
+	double p50 = percentil( us, 0.5 );
+	double p99 = percentil( us, 0.99 );
+	printf( "consulta de %-9s %5u veces: p50 %7.1f us  p99 %7.1f us  %7.1f puntos y %5.1f bloques de media\n",
+			intervalo.nombre, intervalo.consultas, p50, p99, (double) puntosLeidos / intervalo.consultas,
+			(double) ( lector.getBloquesLeidos() - bloquesAntes ) / intervalo.consultas );
+  }
+  printf( "\n" );
+
+  // --- comprobar ---
+  uint32_t series = 0;
+  uint32_t seriesBien = 0;
+  for ( uint32_t k = 0; k < 12; k++ ) {
+	uint32_t n = k < 2 ? k : (uint32_t) ( azar.siguiente() % numNodos );
+	uint8_t canal = k % 2 == 0 ? TramasPublicador::ID_CO2 : TramasPublicador::ID_TEMPERATURA;
+	std::vector<Lectura> esperadas = regenerar( n, canal, periodos, periodoUs );
+
+	// entera, y un trozo al azar que corta bloques
+	resultado.clear();
+	lector.consultar( direccion( n ), canal, 0, ~0ull, resultado );
+	bool igual = iguales( esperadas, resultado );
+	if ( ! esperadas.empty() ) {
+	  uint64_t a = esperadas[ azar.siguiente() % esperadas.size() ].tiempo;
+	  uint64_t z = a + azar.siguiente() % ( 3 * 86400000ull );
+	  std::vector<Lectura> trozo;
+	  for ( const Lectura & l : esperadas ) {
+		if ( l.tiempo >= a && l.tiempo <= z ) {
+		  trozo.push_back( l );
+		}
+	  }
+	  resultado.clear();
+	  lector.consultar( direccion( n ), canal, a, z, resultado );
+	  igual = igual && iguales( trozo, resultado );
+	}
+	if ( n < nodosXOR ) {
+	  resultado.clear();
+	  lectorXOR.consultar( direccion( n ), canal, 0, ~0ull, resultado );
+	  igual = igual && iguales( esperadas, resultado );
+	}
+	series++;
+	seriesBien += igual ? 1 : 0;
+  }
+  b = seriesBien == series && lector.getBloquesMal() == 0;
+  bien &= b;
+  printf( "%u de %u series salen bit a bit como se generaron (enteras y por trozos): %s\n", seriesBien, series, b ? "bien" : "MAL" );
+
+  resultado.clear();
+  b = lector.consultar( direccion( numNodos ), TramasPublicador::ID_CO2, 0, ~0ull, resultado ) == 0
+	&& lector.consultar( direccion( 0 ), TramasPublicador::ID_RUIDO, 0, ~0ull, resultado ) == 0
+	&& lector.consultar( direccion( 0 ), TramasPublicador::ID_CO2, 0, T0_MS - 1, resultado ) == 0;
+  bien &= b;
+  printf( "un nodo, un canal o un intervalo sin nada no devuelven nada: %s\n", b ? "bien" : "MAL" );
+
+  b = bytesPorPunto < bytesPorPuntoXOR && bytesPorPunto * 10 < bytesPorLinea;
+  bien &= b;
+  printf( "ocupa menos que sólo XOR y que el texto: %s\n", b ? "bien" : "MAL" );
+
+  remove( nombreXOR.c_str() );
+  remove( nombreCortado.c_str() );
+
+  printf( "\n%s\n", bien ? "OK" : "FALLO" );
+  return bien ? 0 : 1;
+} // ()
@@ -0,0 +1,103 @@
+/*
+ * Nombre del fichero: benchmarkDecodificador.cpp
+ * Descripción: Mide cuántos informes por segundo decodifica DecodificadorIBeacon en un núcleo.
+ * Autores: agent
+ * Fecha: 18 de octubre de 2026
+ *
+ * Este archivo ha sido realizado por agent.
+ * Genera informes con TramaIBeacon::codificarAnuncio() (lo mismo que emite la placa),
+ * los decodifica por lotes y comprueba que major y minor vuelven intactos. En la medida,
+ * suma major y minor de cada lectura (y escribe la suma) para que el compilador no pueda
+ * quitar la decodificación. Las tramas, los resúmenes de ventana y la telemetría se
+ * comprueban aparte: comprobarTramas.cpp, comprobarResumenes.cpp y comprobarTelemetria.cpp.
+ *
+ * Compilar (desde esta carpeta):
+ *   g++ -O2 -std=c++17 benchmarkDecodificador.cpp -o benchmarkDecodificador
+ *
+ * Todos los derechos reservados.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#include "DecodificadorIBeacon.h"
+
+// ----------------------------------------------------------
+// Rellena los informes: 80% tramas nuestras, 10% iBeacon de otro uuid
+// y 10% anuncios que sólo llevan el nombre
+// ----------------------------------------------------------
+static void generarInformes( std::vector<InformeAnuncio> & informes ) {
+  uint8_t otroUUID[TramaIBeacon::LONGITUD_UUID];
+  memset( otroUUID, 0xaa, sizeof(otroUUID) );
+
+  for ( size_t i = 0; i < informes.size(); i++ ) {
+	InformeAnuncio & inf = informes[i];
+	memset( &inf, 0, sizeof(inf) );
+	inf.tiempo = i * 100;
+	inf.direccion[0] = (uint8_t) i;
+	inf.direccion[1] = (uint8_t) (i >> 8);
+	inf.rssi = -40 - (int8_t) (i % 50);
+
+	switch ( i % 10 ) {
+	case 8:
+	  inf.longitud = TramaIBeacon::codificarAnuncio( inf.datos, otroUUID, 1, 2, -53 );
+	  break;
+	case 9:
+	  inf.datos[0] = 7;
+	  inf.datos[1] = 0x09; // nombre completo
+	  memcpy( &inf.datos[2], "yesyes", 6 );
+	  inf.longitud = 8;
+	  break;
+	default:
+	  inf.longitud = TramaIBeacon::codificarAnuncio( inf.datos, TramaIBeacon::UUID_PROYECTO,
+													 (uint16_t) i, (uint16_t) (i * 7), -53 );
+	}
+  } // for
+} // ()
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+int main() {
+  const size_t NUM_INFORMES = 1 << 16;
+  const int REPETICIONES = 200;
+
+  std::vector<InformeAnuncio> informes( NUM_INFORMES );
+  std::vector<LecturaIBeacon> lecturas( NUM_INFORMES );
+  generarInformes( informes );
+
+  DecodificadorIBeacon deco;
+
+  // comprobación de ida y vuelta
+  size_t n = deco.decodificarLote( informes.data(), informes.size(), lecturas.data() );
+  size_t errores = 0;
+  for ( size_t i = 0; i < n; i++ ) {
+	uint32_t j = lecturas[i].indiceInforme;
+	if ( lecturas[i].major != (uint16_t) j || lecturas[i].minor != (uint16_t) (j * 7)
+		 || lecturas[i].txPower != -53 || lecturas[i].rssi != informes[j].rssi ) {
+	  errores++;
+	}
+  }
+  printf( "lecturas validas: %zu de %zu, errores ida y vuelta: %zu\n", n, NUM_INFORMES, errores );
+
+  // medida (la suma de major y minor es lo que se hace con las lecturas: que no se quite nada)
+  size_t total = 0;
+  uint64_t suma = 0;
+  auto inicio = std::chrono::steady_clock::now();
+  for ( int r = 0; r < REPETICIONES; r++ ) {
+	size_t m = deco.decodificarLote( informes.data(), informes.size(), lecturas.data() );
+	for ( size_t i = 0; i < m; i++ ) {
+	  suma += lecturas[i].major + lecturas[i].minor;
+	}
+	total += m;
+  }
+  auto fin = std::chrono::steady_clock::now();
+  volatile uint64_t sumidero = suma;
+
+  double segundos = std::chrono::duration<double>( fin - inicio ).count();
+  double millones = ( (double) NUM_INFORMES * REPETICIONES ) / segundos / 1e6;
+  printf( "%d x %zu informes en %.3f s: %.2f millones de informes/s (%zu lecturas, suma %llu)\n",
+		  REPETICIONES, NUM_INFORMES, segundos, millones, total, (unsigned long long) sumidero );
+
+  return errores == 0 ? 0 : 1;
+} // ()
@@ -0,0 +1,134 @@
+/*
+ * Nombre del fichero: benchmarkIngestion.cpp
+ * Descripción: Mide MotorIngestion sobre una captura sintética de 10000 nodos.
+ * Autores: agent
+ * Fecha: 18 de octubre de 2026
+ *
+ * Este archivo ha sido realizado por agent.
+ * Genera un fichero de captura donde cada nodo publica una lectura cada 5 s y la pasarela
+ * oye varias copias de cada una, algo desordenadas. Después lo ingiere con 1, 2, 4...
+ * trabajadores e informa de registros/s de principio a fin, p99 de latencia y de si
+ * las series salen con exactamente una muestra por lectura.
+ *
+ * Compilar (desde esta carpeta):
+ *   g++ -O2 -std=c++17 -pthread benchmarkIngestion.cpp -o benchmarkIngestion
+ * Uso:
+ *   ./benchmarkIngestion [fichero.capb] [máximo de trabajadores]
+ *
+ * Todos los derechos reservados.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "Captura.h"
+#include "MotorIngestion.h"
+
+const unsigned NUM_NODOS = 10000;
+const unsigned LECTURAS_POR_NODO = 30;
+const unsigned COPIAS_POR_LECTURA = 4;
+const uint64_t PERIODO_US = 5000000;    // una lectura cada 5 s
+const uint64_t INTERVALO_US = 62500;    // setInterval(100, 100) = 62.5 ms
+const uint64_t DESORDEN_US = 100000;    // hasta 100 ms de desorden al llegar
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+static size_t generarCaptura( const char * nombre ) {
+  std::mt19937_64 azar( 42 );
+  std::vector< std::pair<uint64_t, InformeAnuncio> > todos;
+  todos.reserve( (size_t) NUM_NODOS * LECTURAS_POR_NODO * COPIAS_POR_LECTURA );
+
+  for ( unsigned nodo = 0; nodo < NUM_NODOS; nodo++ ) {
+	uint64_t desfase = azar() % PERIODO_US;
+	for ( unsigned l = 0; l < LECTURAS_POR_NODO; l++ ) {
+	  // valores como los de publicarCO2(): major = valor * 10
+	  uint16_t valor = (uint16_t) ( ( nodo * 31 + l * 7 ) % 200 );
+	  for ( unsigned c = 0; c < COPIAS_POR_LECTURA; c++ ) {
+		InformeAnuncio inf;
+		memset( &inf, 0, sizeof(inf) );
+		inf.tiempo = desfase + l * PERIODO_US + c * INTERVALO_US;
+		inf.direccion[0] = (uint8_t) nodo;
+		inf.direccion[1] = (uint8_t) ( nodo >> 8 );
+		inf.direccion[5] = 0xc0;
+		inf.rssi = (int8_t) ( -50 - (int) ( azar() % 40 ) );
+		inf.longitud = TramaIBeacon::codificarAnuncio( inf.datos, TramaIBeacon::UUID_PROYECTO,
+													   (uint16_t) ( valor * 10 ), valor, -53 );
+		todos.emplace_back( inf.tiempo + azar() % DESORDEN_US, inf );
+	  }
+	}
+  }
+
+  std::sort( todos.begin(), todos.end(),
+			 []( const std::pair<uint64_t, InformeAnuncio> & a, const std::pair<uint64_t, InformeAnuncio> & b ) {
+			   return a.first < b.first;
+			 } );
+
+  EscritorCaptura escritor( nombre );
+  for ( auto & par : todos ) {
+	escritor.escribir( par.second );
+  }
+  return todos.size();
+} // ()
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+int main( int argc, char * argv[] ) {
+  const char * nombre = argc > 1 ? argv[1] : "/tmp/benchmarkIngestion.capb";
+
+  size_t numRegistros = generarCaptura( nombre );
+  printf( "captura: %u nodos, %zu registros\n", NUM_NODOS, numRegistros );
+
+  unsigned maxHilos = argc > 2 ? (unsigned) atoi( argv[2] ) : std::thread::hardware_concurrency();
+  maxHilos = std::max( 1u, maxHilos );
+  double base = 0;
+  bool correcto = true;
+
+  for ( unsigned hilos = 1; ; hilos = std::min( hilos * 2, maxHilos ) ) {
+	auto inicio = std::chrono::steady_clock::now();
+
+	MotorIngestion motor( hilos );
+	{
+	  LectorCaptura lector( nombre );
+	  InformeAnuncio inf;
+	  while ( lector.leer( inf ) ) {
+		motor.ingerir( inf );
+	  }
+	}
+	motor.terminar();
+
+	auto fin = std::chrono::steady_clock::now();
+	double segundos = std::chrono::duration<double>( fin - inicio ).count();
+	double porSegundo = numRegistros / segundos;
+	if ( hilos == 1 ) {
+	  base = porSegundo;
+	}
+
+	EstadisticasIngestion e = motor.estadisticas();
+	size_t nodosConLecturasExactas = 0;
+	motor.paraCadaSerie( [&]( uint64_t, const std::vector<PuntoSerie> & serie ) {
+	  if ( serie.size() == LECTURAS_POR_NODO ) {
+		nodosConLecturasExactas++;
+	  }
+	} );
+	correcto = correcto && nodosConLecturasExactas == NUM_NODOS && e.tardios == 0;
+
+	printf( "%2u trabajadores: %.2f Mregistros/s (x%.2f)  p99 latencia %.1f us  "
+			"guardados %llu duplicados %llu tardios %llu cola llena %llu  series exactas %zu/%u\n",
+			hilos, porSegundo / 1e6, porSegundo / base,
+			motor.percentilLatenciaNs( 0.99 ) / 1000.0,
+			(unsigned long long) e.guardados, (unsigned long long) e.duplicados,
+			(unsigned long long) e.tardios, (unsigned long long) e.colaLlena,
+			nodosConLecturasExactas, NUM_NODOS );
+
+	if ( hilos == maxHilos ) {
+	  break; // siempre se acaba con todos los núcleos
+	}
+  } // for
+
+  return correcto ? 0 : 1;
+} // ()
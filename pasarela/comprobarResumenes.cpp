@@ -0,0 +1,156 @@
+/*
+ * Nombre del fichero: comprobarResumenes.cpp
+ * Descripción: Comprueba EstadisticasVentana y los resúmenes de ventana que lleva el anuncio.
+ * Autores: agent
+ * Fecha: 18 de octubre de 2026
+ *
+ * Este archivo ha sido realizado por agent.
+ * Para ventanas de 1 a 20000 muestras de ozono (con picos, y cerca de un valor grande)
+ * compara el resumen de EstadisticasVentana con el cálculo exacto ordenando las muestras:
+ * mínimo, máximo, media y desviación exactos; p50, p90 y p99 (P²) exactos con menos de 5
+ * muestras y, con más, a menos de media desviación (un cuarto desde 1000). Después pasa
+ * cada resumen por la carga del anuncio (TramasPublicador::codificarResumen()) y vuelta.
+ * Por último, una ventana reiniciada con temperaturas negativas, decodificada desde un
+ * informe por DecodificadorIBeacon, que sólo la deja pasar con aceptarResumenes().
+ *
+ * Compilar (desde esta carpeta):
+ *   g++ -O2 -std=c++17 comprobarResumenes.cpp -o comprobarResumenes
+ *
+ * Todos los derechos reservados.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "DecodificadorIBeacon.h"
+#include "../TramasPublicador.h"
+
+// ----------------------------------------------------------
+// EstadisticasVentana contra el cálculo exacto (ordenando) y la ida y vuelta
+// por la carga del anuncio: devuelve el número de errores
+// ----------------------------------------------------------
+static size_t comprobarVentanas() {
+  using namespace TramasPublicador;
+  size_t errores = 0;
+  std::mt19937 azar( 35 );
+  std::normal_distribution<double> ruido( 0.0, 1.0 );
+
+  const size_t TAMANYOS[] = { 1, 2, 4, 5, 20, 1000, 20000 };
+  for ( size_t tam : TAMANYOS ) {
+	// ozono alrededor de 5 ppm con picos de vez en cuando, y muy cerca de un valor grande (Welford)
+	std::vector<double> muestras;
+	EstadisticasVentana ventana;
+	for ( size_t i = 0; i < tam; i++ ) {
+	  double x = 1000.0 + 5.0 + ruido( azar ) + ( i % 251 == 0 ? 20.0 : 0.0 );
+	  muestras.push_back( x );
+	  ventana.anyadir( x );
+	}
+	ventana.anyadir( NAN ); // no cuenta
+	ResumenVentana r = ventana.resumir( 60000 );
+
+	double suma = 0;
+	for ( double x : muestras ) suma += x;
+	double media = suma / tam;
+	double cuadrados = 0;
+	for ( double x : muestras ) cuadrados += ( x - media ) * ( x - media );
+	double desviacion = tam > 1 ? std::sqrt( cuadrados / ( tam - 1 ) ) : 0;
+	std::sort( muestras.begin(), muestras.end() );
+	auto percentil = [&]( double p ) { return muestras[ (size_t) ( p * ( tam - 1 ) + 0.5 ) ]; };
+
+	// percentiles: exactos con menos de 5 muestras; después, cerca en proporción a la dispersión
+	double tolerancia = tam <= 5 ? 1e-12 : ( tam < 1000 ? 0.5 : 0.25 ) * desviacion;
+	if ( r.numero != tam || r.minimo != muestras.front() || r.maximo != muestras.back()
+		 || std::fabs( r.media - media ) > 1e-9 || std::fabs( r.desviacion - desviacion ) > 1e-9
+		 || std::fabs( r.p50 - percentil( 0.5 ) ) > tolerancia
+		 || std::fabs( r.p90 - percentil( 0.9 ) ) > tolerancia
+		 || ( tam >= 1000 && std::fabs( r.p99 - percentil( 0.99 ) ) > 2 * tolerancia ) ) {
+	  printf( "  ventana de %zu: media %.6f/%.6f desviacion %.6f/%.6f p50 %.3f/%.3f p90 %.3f/%.3f p99 %.3f/%.3f\n",
+			  tam, r.media, media, r.desviacion, desviacion, r.p50, percentil( 0.5 ),
+			  r.p90, percentil( 0.9 ), r.p99, percentil( 0.99 ) );
+	  errores++;
+	}
+
+	// ida y vuelta por la carga (con la resolución de la trama de gas, valores menos 1000 ppm)
+	ResumenVentana enviado = r;
+	for ( double * v : { &enviado.minimo, &enviado.maximo, &enviado.media, &enviado.p50, &enviado.p90, &enviado.p99 } ) {
+	  *v -= 1000.0;
+	}
+	uint8_t carga[TramaIBeacon::LONGITUD_CARGA];
+	ResumenVentana recibido;
+	uint8_t id, numero;
+	if ( codificarResumen( carga, ID_CO2, (uint8_t) tam, enviado ) != 0
+		 || ! decodificarResumen( carga, id, numero, recibido )
+		 || id != ID_CO2 || numero != (uint8_t) tam || recibido.numero != tam || recibido.duracionMs != 60000
+		 || std::fabs( recibido.media - enviado.media ) > 0.0005 + 1e-9
+		 || std::fabs( recibido.desviacion - enviado.desviacion ) > 0.0005 + 1e-9
+		 || std::fabs( recibido.p99 - enviado.p99 ) > 0.0005 + 1e-9 ) {
+	  errores++;
+	}
+  } // for
+  return errores;
+} // ()
+
+// ----------------------------------------------------------
+// otra ventana después de reiniciar, temperatura con negativos y el decodificador
+// de la pasarela: devuelve el número de errores
+// ----------------------------------------------------------
+static size_t comprobarDecodificador() {
+  using namespace TramasPublicador;
+  size_t errores = 0;
+
+  EstadisticasVentana ventana;
+  for ( int i = -50; i <= 50; i++ ) {
+	ventana.anyadir( i / 10.0 );
+  }
+  ventana.reiniciar();
+  ventana.anyadir( -12.0 );
+  ventana.anyadir( -11.0 );
+  ResumenVentana r = ventana.resumir( 3000 );
+  InformeAnuncio informe;
+  memset( &informe, 0, sizeof(informe) );
+  informe.datos[0] = 2; informe.datos[1] = 0x01; informe.datos[2] = 0x06;
+  informe.datos[3] = 1 + 4 + TramaIBeacon::LONGITUD_CARGA;
+  informe.datos[4] = TramaIBeacon::AD_TIPO_FABRICANTE;
+  memcpy( &informe.datos[5], TramaIBeacon::PREFIJO_FABRICANTE, 4 );
+  codificarResumen( &informe.datos[9], ID_TEMPERATURA, 7, r );
+  informe.longitud = TramaIBeacon::LONGITUD_TRAMA;
+
+  DecodificadorIBeacon deco;
+  LecturaIBeacon lectura;
+  ResumenVentana recibido;
+  uint8_t id, numero;
+  if ( deco.decodificar( informe, lectura ) ) {
+	errores++; // sin aceptarResumenes() no pasa el filtro de uuid
+  }
+  deco.aceptarResumenes( true );
+  if ( ! deco.decodificar( informe, lectura ) || ! lectura.resumen
+	   || ! decodificarResumen( lectura.carga, id, numero, recibido )
+	   || id != ID_TEMPERATURA || numero != 7 || recibido.numero != 2
+	   || recibido.minimo != -12.0 || recibido.maximo != -11.0 || recibido.media != -11.5
+	   || recibido.duracionMs != 3000 ) {
+	errores++;
+  }
+  return errores;
+} // ()
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+int main() {
+  bool bien = true;
+
+  size_t errores = comprobarVentanas();
+  bien &= errores == 0;
+  printf( "estadisticas de ventana frente a las exactas, y su resumen en la carga: %s (%zu errores)\n",
+		  errores == 0 ? "bien" : "MAL", errores );
+
+  errores = comprobarDecodificador();
+  bien &= errores == 0;
+  printf( "ventana reiniciada, decodificada por la pasarela: %s (%zu errores)\n", errores == 0 ? "bien" : "MAL", errores );
+
+  printf( "\n%s\n", bien ? "OK: los resúmenes de ventana salen como los exactos" : "FALLO" );
+  return bien ? 0 : 1;
+} // ()
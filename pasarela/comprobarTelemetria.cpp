@@ -0,0 +1,117 @@
+/*
+ * Nombre del fichero: comprobarTelemetria.cpp
+ * Descripción: Comprueba TelemetriaNodo y su ida y vuelta por una respuesta de escaneo.
+ * Autores: agent
+ * Fecha: 18 de octubre de 2026
+ *
+ * Este archivo ha sido realizado por agent.
+ * Pasa periodos a TelemetriaNodo y comprueba que la media converge (hasta la banda muerta),
+ * que el máximo dura una ventana y luego se olvida, y que un milisegundo arriba o abajo no
+ * cambia lo que se publica. Después arma una respuesta de escaneo como la de EmisoraBLE
+ * (datos de fabricante con la telemetría y el nombre detrás), la decodifica como la
+ * pasarela (DecodificadorIBeacon::decodificarTelemetria()) y comprueba que no confunde
+ * una respuesta sin telemetría o con otra cosa en los datos de fabricante.
+ *
+ * Compilar (desde esta carpeta):
+ *   g++ -O2 -std=c++17 comprobarTelemetria.cpp -o comprobarTelemetria
+ *
+ * Todos los derechos reservados.
+ */
+
+#include <cstdio>
+#include <cstring>
+
+#include "DecodificadorIBeacon.h"
+#include "../TramasPublicador.h"
+
+// ----------------------------------------------------------
+// periodo: la media converge (hasta la banda muerta), el máximo dura una ventana más y
+// luego se olvida: devuelve el número de errores
+// ----------------------------------------------------------
+static size_t comprobarPeriodo( TelemetriaNodo & t ) {
+  size_t errores = 0;
+  for ( int i = 0; i < 100; i++ ) {
+	t.anyadirPeriodo( 3000 );
+  }
+  t.anyadirPeriodo( 3400 );
+  if ( t.getPeriodoMedioMs() != 3050 || t.getPeriodoMaximoMs() != 3400 ) {
+	errores++;
+  }
+  for ( int i = 0; i < 2 * TelemetriaNodo::VUELTAS_VENTANA; i++ ) {
+	t.anyadirPeriodo( 3000 );
+  }
+  if ( t.getPeriodoMedioMs() < 3000 || t.getPeriodoMedioMs() >= 3000 + TelemetriaNodo::BANDA_MUERTA_MS
+	   || t.getPeriodoMaximoMs() != 3000 ) {
+	errores++;
+  }
+  // el milisegundo arriba o abajo de cada vuelta no cambia lo que se publica
+  uint16_t medio = t.getPeriodoMedioMs();
+  for ( int i = 0; i < 200; i++ ) {
+	t.anyadirPeriodo( 3000 + i % 3 );
+	if ( t.getPeriodoMedioMs() != medio || t.getPeriodoMaximoMs() != 3000 ) {
+	  errores++;
+	  break;
+	}
+  }
+  return errores;
+} // ()
+
+// ----------------------------------------------------------
+// respuesta de escaneo como la que arma EmisoraBLE: fabricante (little endian) +
+// telemetría, y el nombre detrás: devuelve el número de errores
+// ----------------------------------------------------------
+static size_t comprobarRespuesta( const TelemetriaNodo & t ) {
+  using namespace TramasPublicador;
+  size_t errores = 0;
+
+  DatosTelemetria enviada = t.datos( 125 * 60000 + 59999, 70000, 17, 0xdeadbeef );
+  uint8_t respuesta[TramaIBeacon::LONGITUD_MAXIMA_ANUNCIO];
+  respuesta[0] = 1 + 2 + Telemetria::TAM;
+  respuesta[1] = TramaIBeacon::AD_TIPO_FABRICANTE;
+  respuesta[2] = 0x4c;
+  respuesta[3] = 0x00;
+  uint32_t saturados = codificarTelemetria( &respuesta[4], enviada );
+  uint8_t n = 4 + Telemetria::TAM;
+  respuesta[n] = 1 + 6;
+  respuesta[n+1] = 0x09; // nombre completo
+  memcpy( &respuesta[n+2], "yesyes", 6 );
+  n += 2 + 6;
+
+  DatosTelemetria recibida;
+  if ( n > TramaIBeacon::LONGITUD_MAXIMA_ANUNCIO || saturados != ( 1u << 6 )
+	   || ! DecodificadorIBeacon::decodificarTelemetria( respuesta, n, recibida )
+	   || recibida.versionMayor != 1 || recibida.versionMenor != 2 || recibida.minutosEncendido != 125
+	   || recibida.periodoMedioMs != t.getPeriodoMedioMs() || recibida.periodoMaximoMs != 3000
+	   || recibida.muestrasPerdidas != 65535 || recibida.lineasPerdidas != 17
+	   || recibida.huellaConfiguracion != 0xdeadbeef ) {
+	errores++;
+  }
+
+  // sin telemetría (sólo el nombre) o con otra cosa en los datos de fabricante
+  if ( DecodificadorIBeacon::decodificarTelemetria( &respuesta[4 + Telemetria::TAM], 8, recibida ) ) {
+	errores++;
+  }
+  respuesta[4] = MARCA_RESUMEN;
+  if ( DecodificadorIBeacon::decodificarTelemetria( respuesta, n, recibida ) ) {
+	errores++;
+  }
+  return errores;
+} // ()
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+int main() {
+  bool bien = true;
+  TelemetriaNodo t( 1, 2 );
+
+  size_t errores = comprobarPeriodo( t );
+  bien &= errores == 0;
+  printf( "periodo medio y maximo con banda muerta: %s (%zu errores)\n", errores == 0 ? "bien" : "MAL", errores );
+
+  errores = comprobarRespuesta( t );
+  bien &= errores == 0;
+  printf( "telemetria en la respuesta de escaneo: %s (%zu errores)\n", errores == 0 ? "bien" : "MAL", errores );
+
+  printf( "\n%s\n", bien ? "OK: la telemetría del nodo llega a la pasarela" : "FALLO" );
+  return bien ? 0 : 1;
+} // ()
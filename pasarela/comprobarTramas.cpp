@@ -0,0 +1,153 @@
+/*
+ * Nombre del fichero: comprobarTramas.cpp
+ * Descripción: Comprueba las tramas de TramasPublicador.h y el anuncio iBeacon que las lleva.
+ * Autores: agent
+ * Fecha: 18 de octubre de 2026
+ *
+ * Este archivo ha sido realizado por agent.
+ * Codifica como la placa y decodifica desde major y minor como la pasarela todos los
+ * valores de 16 bits de las tramas de gas y temperatura (ida y vuelta con su resolución),
+ * comprueba que los que no caben se saturan al extremo y se avisa en la máscara, prueba
+ * campos de 4 bytes y little endian de EsquemaTrama, y que el anuncio de la placa
+ * (TramaIBeacon::codificarDatosFabricante()) es el mismo que codificarAnuncio() y se
+ * decodifica sin arrastrar lo que hubiera en la lectura.
+ *
+ * Compilar (desde esta carpeta):
+ *   g++ -O2 -std=c++17 comprobarTramas.cpp -o comprobarTramas
+ *
+ * Todos los derechos reservados.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include "DecodificadorIBeacon.h"
+#include "../TramasPublicador.h"
+
+// ----------------------------------------------------------
+// ida y vuelta (codificar como la placa, decodificar desde major y minor como la pasarela)
+// ----------------------------------------------------------
+static size_t comprobarIdaYVuelta() {
+  using namespace TramasPublicador;
+  size_t errores = 0;
+  uint8_t trama[4];
+
+  for ( uint32_t i = 0; i <= 65535; i++ ) {
+	double ppm = i / 1000.0 + 0.0004 * ( (int) ( i % 3 ) - 1 ); // no siempre exacto: se redondea
+	double grados = -327.68 + i / 100.0;
+	uint8_t id, contador;
+	double valor;
+
+	if ( CO2::codificar( trama, ID_CO2, i & 0xff, ppm ) != 0
+		 || ! decodificar( major( trama ), minor( trama ), id, contador, valor )
+		 || id != ID_CO2 || contador != ( i & 0xff ) || std::fabs( valor - ppm ) > 0.0005 + 1e-12 ) {
+	  errores++;
+	}
+	if ( Temperatura::codificar( trama, ID_TEMPERATURA, i & 0xff, grados ) != 0
+		 || ! decodificar( major( trama ), minor( trama ), id, contador, valor )
+		 || id != ID_TEMPERATURA || std::fabs( valor - grados ) > 0.005 + 1e-9 ) {
+	  errores++;
+	}
+  } // for
+  return errores;
+} // ()
+
+// ----------------------------------------------------------
+// saturación: el bit del campo avisa y el valor se queda en el extremo
+// ----------------------------------------------------------
+static size_t comprobarSaturacion() {
+  using namespace TramasPublicador;
+  size_t errores = 0;
+  uint8_t trama[4];
+
+  struct Caso { double entrada; uint32_t mascara; double esperado; };
+  const Caso CASOS_CO2[] = {
+	{ -1.0, 0x4, 0.0 }, { 65.535, 0, 65.535 }, { 65.5354, 0, 65.535 },
+	{ 65.5356, 0x4, 65.535 }, { 1e9, 0x4, 65.535 }, { NAN, 0x4, 0.0 }
+  };
+  for ( const Caso & c : CASOS_CO2 ) {
+	double v[3];
+	uint32_t m = CO2::codificar( trama, ID_CO2, 0, c.entrada );
+	CO2::decodificar( trama, v );
+	if ( m != c.mascara || v[2] != c.esperado ) {
+	  errores++;
+	}
+  }
+  double v[3];
+  if ( Temperatura::codificar( trama, ID_TEMPERATURA, 300, -400.0 ) != 0x6 ) { // contador y valor
+	errores++;
+  }
+  Temperatura::decodificar( trama, v );
+  if ( v[1] != 255 || v[2] != -327.68 ) {
+	errores++;
+  }
+  return errores;
+} // ()
+
+// ----------------------------------------------------------
+// campos de 4 bytes y little endian
+// ----------------------------------------------------------
+static size_t comprobarCamposAnchos() {
+  size_t errores = 0;
+  typedef EsquemaTrama::Trama< EsquemaTrama::Campo<4, true, 1, EsquemaTrama::MENOR_PRIMERO>,
+							   EsquemaTrama::Campo<3, true> > Otra;
+  uint8_t bytes[Otra::TAM];
+  double w[Otra::NUM_CAMPOS];
+  if ( Otra::codificar( bytes, -2147483648.0, -8388608 ) != 0 || bytes[3] != 0x80 || bytes[4] != 0x80 ) {
+	errores++;
+  }
+  Otra::decodificar( bytes, w );
+  if ( w[0] != -2147483648.0 || w[1] != -8388608 || Otra::codificar( bytes, 3e9, 8388608 ) != 0x3 ) {
+	errores++;
+  }
+  return errores;
+} // ()
+
+// ----------------------------------------------------------
+// el anuncio de la placa (codificarDatosFabricante()) y el decodificado sin informe:
+// rssi e indiceInforme a 0, no lo que hubiera en la lectura
+// ----------------------------------------------------------
+static size_t comprobarAnuncio() {
+  size_t errores = 0;
+  uint8_t anuncio[TramaIBeacon::LONGITUD_TRAMA];
+  uint8_t datosFabricante[4 + TramaIBeacon::LONGITUD_CARGA];
+  TramaIBeacon::codificarAnuncio( anuncio, TramaIBeacon::UUID_PROYECTO, 0x1234, 0x5678, -59 );
+  TramaIBeacon::codificarDatosFabricante( datosFabricante, 0x004c, TramaIBeacon::UUID_PROYECTO, 0x1234, 0x5678, -59 );
+  if ( memcmp( &anuncio[5], datosFabricante, sizeof(datosFabricante) ) != 0 ) {
+	errores++;
+  }
+  DecodificadorIBeacon decodificador;
+  LecturaIBeacon lectura;
+  memset( &lectura, 0x5a, sizeof(lectura) );
+  if ( ! decodificador.decodificar( anuncio, sizeof(anuncio), lectura ) || lectura.rssi != 0 || lectura.indiceInforme != 0
+	   || lectura.major != 0x1234 || lectura.minor != 0x5678 || lectura.txPower != -59 ) {
+	errores++;
+  }
+  return errores;
+} // ()
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+int main() {
+  bool bien = true;
+
+  size_t errores = comprobarIdaYVuelta();
+  bien &= errores == 0;
+  printf( "ida y vuelta de gas y temperatura (65536 valores): %s (%zu errores)\n", errores == 0 ? "bien" : "MAL", errores );
+
+  errores = comprobarSaturacion();
+  bien &= errores == 0;
+  printf( "lo que no cabe se satura y se avisa: %s (%zu errores)\n", errores == 0 ? "bien" : "MAL", errores );
+
+  errores = comprobarCamposAnchos();
+  bien &= errores == 0;
+  printf( "campos de 4 bytes y little endian: %s (%zu errores)\n", errores == 0 ? "bien" : "MAL", errores );
+
+  errores = comprobarAnuncio();
+  bien &= errores == 0;
+  printf( "anuncio de la placa y lectura sin informe: %s (%zu errores)\n", errores == 0 ? "bien" : "MAL", errores );
+
+  printf( "\n%s\n", bien ? "OK: las tramas de Publicador van y vuelven" : "FALLO" );
+  return bien ? 0 : 1;
+} // ()
@@ -0,0 +1,249 @@
+/*
+ * Nombre del fichero: Arduino.h
+ * Descripción: Sustituto de Arduino.h para compilar el firmware en el ordenador.
+ * Autores: agent
+ * Fecha: 18 de octubre de 2026
+ *
+ * Este archivo ha sido realizado por agent.
+ * Contiene lo mínimo de la API de Arduino que usa el firmware (pines, ADC, tiempo y Serial,
+ * que también recibe lo que se teclee con Simulacion::teclear())
+ * sobre un reloj virtual, para poder ejecutar Medidor, Publicador, etc. en el ordenador
+ * mucho más rápido que en tiempo real. Con varias tareas (rtos.h) el reloj es el real,
+ * acelerado. Sólo se usa al compilar con -I simulacion.
+ *
+ * Todos los derechos reservados.
+ */
+
+#ifndef ARDUINO_SIMULADO_H_INCLUIDO
+#define ARDUINO_SIMULADO_H_INCLUIDO
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+#define LOW 0x0
+#define HIGH 0x1
+
+// ----------------------------------------------------------
+// Estado de la placa simulada
+// ----------------------------------------------------------
+namespace Simulacion {
+
+  const uint8_t NUM_PINES = 64;
+
+  /// Reloj virtual en us. Es por hilo para que cada nodo simulado lleve su propio tiempo.
+  inline thread_local uint64_t relojUs = 0;
+
+  /// Si no es nullptr, analogRead() pregunta aquí el valor del pin.
+  inline thread_local int (*fuenteADC)( uint8_t pin ) = nullptr;
+
+  /// Si no es nullptr, el micrófono PDM (CanalRuido.h) saca de aquí sus muestras:
+  /// n muestras de 16 bits, la primera en el instante usPrimera. Si es nullptr, silencio.
+  inline thread_local void (*fuentePDM)( int16_t * muestras, uint16_t n, uint64_t usPrimera ) = nullptr;
+
+  /// Valor que devuelve analogRead() si no hay fuenteADC.
+  inline thread_local int valoresADC[NUM_PINES] = { 0 };
+
+  /// Último valor escrito con digitalWrite().
+  inline thread_local uint8_t estadoPines[NUM_PINES] = { 0 };
+
+  /// Si no es nullptr, digitalWrite() avisa aquí (p.ej. para encender un frontal simulado).
+  inline thread_local void (*alEscribirPin)( uint8_t pin, uint8_t valor ) = nullptr;
+
+  /// Adónde va lo que se escribe por Serial (nullptr = a ninguna parte).
+  inline thread_local FILE * salidaSerie = stdout;
+
+  /// Instante (reloj virtual, us) en que se conecta el ordenador por USB: hasta
+  /// entonces Serial es false. UINT64_MAX = no se conecta nunca.
+  inline thread_local uint64_t usSerieDisponible = 0;
+
+  /// Si es mayor que 0, el tiempo es el real multiplicado por esto en vez del reloj
+  /// virtual (lo necesitan las tareas de rtos.h, que corren a la vez en varios hilos).
+  inline thread_local double aceleracion = 0;
+
+  /// Lo que tarda Serial en sacar cada byte (us); 87 es lo de 115200 baudios.
+  inline thread_local uint32_t usPorByteSerie = 0;
+
+  /// Lo que cabe en el buffer de recepción de Serial; lo que llega de más se pierde.
+  const uint16_t TAMANYO_ENTRADA_SERIE = 64;
+
+  /// Lo recibido por Serial y aún sin leer. No es por hilo: lo mete la simulación
+  /// (teclear()) y lo puede leer una tarea de rtos.h.
+  inline std::mutex mutexEntradaSerie;
+  inline uint8_t entradaSerie[TAMANYO_ENTRADA_SERIE];
+  inline uint16_t inicioEntradaSerie = 0;
+  inline uint16_t numEntradaSerie = 0;
+
+  /// Como si se tecleara en el monitor serie. Devuelve los bytes que han cabido.
+  inline size_t teclear( const char * texto ) {
+	std::lock_guard<std::mutex> l( mutexEntradaSerie );
+	size_t n = 0;
+	for ( ; texto[n] != '\0' && numEntradaSerie < TAMANYO_ENTRADA_SERIE; n++ ) {
+	  entradaSerie[ ( inicioEntradaSerie + numEntradaSerie++ ) % TAMANYO_ENTRADA_SERIE ] = (uint8_t) texto[n];
+	}
+	return n;
+  } // ()
+
+  /// Origen del tiempo real.
+  inline const std::chrono::steady_clock::time_point origenTiempoReal = std::chrono::steady_clock::now();
+
+  /// Tiempo actual en us (el virtual o el real acelerado).
+  inline uint64_t ahoraUs() {
+	if ( aceleracion > 0 ) {
+	  std::chrono::duration<double, std::micro> real = std::chrono::steady_clock::now() - origenTiempoReal;
+	  return (uint64_t) ( real.count() * aceleracion );
+	}
+	return relojUs;
+  } // ()
+
+  /// Si no es nullptr, se llama cada vez que avanza el reloj virtual (desde, hasta), p.ej.
+  /// para que la radio simulada entregue lo que le haya dado tiempo mientras el firmware espera.
+  inline thread_local void (*alAvanzar)( uint64_t usDesde, uint64_t usHasta ) = nullptr;
+
+  /// Avanza el reloj virtual (o duerme lo que toque con el real).
+  inline void avanzar( uint64_t us ) {
+	if ( aceleracion > 0 ) {
+	  std::this_thread::sleep_for( std::chrono::duration<double, std::micro>( us / aceleracion ) );
+	  return;
+	}
+	relojUs += us;
+	if ( alAvanzar != nullptr ) {
+	  alAvanzar( relojUs - us, relojUs );
+	}
+  } // ()
+
+}; // namespace
+
+// ----------------------------------------------------------
+// Tiempo
+// ----------------------------------------------------------
+inline unsigned long millis() {
+  return (unsigned long) ( Simulacion::ahoraUs() / 1000 );
+} // ()
+
+inline unsigned long micros() {
+  return (unsigned long) (uint32_t) Simulacion::ahoraUs();
+} // ()
+
+inline void delay( unsigned long ms ) {
+  Simulacion::avanzar( (uint64_t) ms * 1000 );
+} // ()
+
+inline void delayMicroseconds( unsigned int us ) {
+  Simulacion::avanzar( us );
+} // ()
+
+inline void yield() {
+} // ()
+
+// ----------------------------------------------------------
+// Pines
+// ----------------------------------------------------------
+inline void pinMode( uint8_t, uint8_t ) {
+} // ()
+
+inline void digitalWrite( uint8_t pin, uint8_t valor ) {
+  Simulacion::estadoPines[ pin % Simulacion::NUM_PINES ] = valor;
+  if ( Simulacion::alEscribirPin != nullptr ) {
+	Simulacion::alEscribirPin( pin, valor );
+  }
+} // ()
+
+inline int digitalRead( uint8_t pin ) {
+  return Simulacion::estadoPines[ pin % Simulacion::NUM_PINES ];
+} // ()
+
+inline int analogRead( uint8_t pin ) {
+  if ( Simulacion::fuenteADC != nullptr ) {
+	return Simulacion::fuenteADC( pin );
+  }
+  return Simulacion::valoresADC[ pin % Simulacion::NUM_PINES ];
+} // ()
+
+// ----------------------------------------------------------
+// Serial
+// ----------------------------------------------------------
+class SerialSimulado {
+private:
+
+  template< typename ... T >
+  void imprimir( const char * formato, T ... valores ) {
+	int bytes = 0;
+	if ( Simulacion::salidaSerie != nullptr ) {
+	  bytes = fprintf( Simulacion::salidaSerie, formato, valores ... );
+	} else if ( Simulacion::usPorByteSerie > 0 ) {
+	  bytes = snprintf( nullptr, 0, formato, valores ... );
+	}
+	if ( Simulacion::usPorByteSerie > 0 && bytes > 0 ) {
+	  Simulacion::avanzar( (uint64_t) bytes * Simulacion::usPorByteSerie ); // Serial.print() espera
+	}
+  } // ()
+
+public:
+
+  void begin( unsigned long ) { }
+  explicit operator bool() const { return Simulacion::ahoraUs() >= Simulacion::usSerieDisponible; }
+
+  // print() como el de Arduino: los double con 2 decimales, uint8_t como número
+  void print( const char * s ) { imprimir( "%s", s ); }
+  void print( char c ) { imprimir( "%c", c ); }
+  void print( unsigned char n ) { imprimir( "%u", (unsigned) n ); }
+  void print( signed char n ) { imprimir( "%d", (int) n ); }
+  void print( int n ) { imprimir( "%d", n ); }
+  void print( unsigned int n ) { imprimir( "%u", n ); }
+  void print( long n ) { imprimir( "%ld", n ); }
+  void print( unsigned long n ) { imprimir( "%lu", n ); }
+  void print( long long n ) { imprimir( "%lld", n ); }
+  void print( unsigned long long n ) { imprimir( "%llu", n ); }
+  void print( double x, int decimales = 2 ) { imprimir( "%.*f", decimales, x ); }
+
+  template< typename T >
+  void println( T valor ) { print( valor ); print( "\r\n" ); }
+  void println( double x, int decimales = 2 ) { print( x, decimales ); print( "\r\n" ); }
+  void println() { print( "\r\n" ); }
+
+  // lo que se ha tecleado con Simulacion::teclear()
+  int available() {
+	std::lock_guard<std::mutex> l( Simulacion::mutexEntradaSerie );
+	return Simulacion::numEntradaSerie;
+  } // ()
+  int read() {
+	std::lock_guard<std::mutex> l( Simulacion::mutexEntradaSerie );
+	if ( Simulacion::numEntradaSerie == 0 ) {
+	  return -1;
+	}
+	int c = Simulacion::entradaSerie[ Simulacion::inicioEntradaSerie ];
+	Simulacion::inicioEntradaSerie = ( Simulacion::inicioEntradaSerie + 1 ) % Simulacion::TAMANYO_ENTRADA_SERIE;
+	Simulacion::numEntradaSerie--;
+	return c;
+  } // ()
+
+  size_t write( uint8_t b ) { imprimir( "%c", (char) b ); return 1; }
+  size_t write( const uint8_t * bytes, size_t n ) {
+	for ( size_t i = 0; i < n; i++ ) {
+	  write( bytes[i] );
+	}
+	return n;
+  } // ()
+
+}; // class
+
+inline SerialSimulado Serial;
+
+#include "rtos.h"
+
+#endif
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
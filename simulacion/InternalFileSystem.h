@@ -0,0 +1,107 @@
+/*
+ * Nombre del fichero: InternalFileSystem.h
+ * Descripción: Sustituto del sistema de ficheros de la flash interna para compilar el firmware en el ordenador.
+ * Autores: agent
+ * Fecha: 18 de octubre de 2026
+ *
+ * Este archivo ha sido realizado por agent.
+ * Contiene la parte de InternalFS (LittleFS) que usa el firmware. Los ficheros se guardan
+ * en memoria (Simulacion::flash) y siguen ahí si la simulación vuelve a llamar a setup(),
+ * como la flash de la placa después de un reinicio. Sólo se usa al compilar con -I simulacion.
+ *
+ * Todos los derechos reservados.
+ */
+
+#ifndef INTERNAL_FILE_SYSTEM_SIMULADO_H_INCLUIDO
+#define INTERNAL_FILE_SYSTEM_SIMULADO_H_INCLUIDO
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Arduino.h"
+
+namespace Simulacion {
+
+  /// Contenido de la flash: nombre de fichero -> bytes. Por hilo, como el resto de la placa.
+  inline thread_local std::map< std::string, std::vector<uint8_t> > flash;
+
+}; // namespace
+
+namespace Adafruit_LittleFS_Namespace {
+
+  const uint8_t FILE_O_READ = 0;
+  const uint8_t FILE_O_WRITE = 1;
+
+  // ----------------------------------------------------------
+  class Adafruit_LittleFS {
+  public:
+	bool begin() { return true; }
+	bool exists( const char * nombre ) { return Simulacion::flash.count( nombre ) != 0; }
+	bool remove( const char * nombre ) { return Simulacion::flash.erase( nombre ) != 0; }
+	bool format() { Simulacion::flash.clear(); return true; }
+  }; // class
+
+  // ----------------------------------------------------------
+  class File {
+  private:
+	std::string nombre;
+	uint8_t modo = FILE_O_READ;
+	size_t posicion = 0;
+	bool abierto = false;
+
+  public:
+	File( Adafruit_LittleFS & ) { }
+
+	bool open( const char * nombre_, uint8_t modo_ ) {
+	  nombre = nombre_;
+	  modo = modo_;
+	  posicion = 0;
+	  if ( modo == FILE_O_READ && Simulacion::flash.count( nombre ) == 0 ) {
+		return false;
+	  }
+	  if ( modo == FILE_O_WRITE ) {
+		posicion = Simulacion::flash[nombre].size(); // como LittleFS: se añade al final
+	  }
+	  abierto = true;
+	  return true;
+	} // ()
+
+	uint32_t read( void * destino, uint32_t n ) {
+	  if ( ! abierto ) {
+		return 0;
+	  }
+	  const std::vector<uint8_t> & v = Simulacion::flash[nombre];
+	  uint32_t c = posicion + n > v.size() ? (uint32_t) ( v.size() - posicion ) : n;
+	  memcpy( destino, v.data() + posicion, c );
+	  posicion += c;
+	  return c;
+	} // ()
+
+	size_t write( const uint8_t * datos, size_t n ) {
+	  if ( ! abierto || modo != FILE_O_WRITE ) {
+		return 0;
+	  }
+	  std::vector<uint8_t> & v = Simulacion::flash[nombre];
+	  v.insert( v.end(), datos, datos + n );
+	  posicion = v.size();
+	  return n;
+	} // ()
+
+	void close() { abierto = false; }
+	operator bool() const { return abierto; }
+  }; // class
+
+}; // namespace
+
+class InternalFileSystem : public Adafruit_LittleFS_Namespace::Adafruit_LittleFS {
+}; // class
+
+inline InternalFileSystem InternalFS;
+
+#endif
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
@@ -0,0 +1,96 @@
+/*
+ * Nombre del fichero: LectorTraza.h
+ * Descripción: Carga de un fichero una traza del ADC grabada en la placa.
+ * Autores: agent
+ * Fecha: 18 de octubre de 2026
+ *
+ * Este archivo ha sido realizado por agent.
+ * La usan las herramientas que reproducen trazas (reproducirTraza.cpp, medirReferencia.cpp).
+ * La traza puede ser el fichero binario (TrazaADC.h) o el registro del puerto serie con
+ * las líneas "TADC:" que escribe GrabadorTraza. En el registro puede haber varias trazas
+ * (cada orden traza de la consola empieza otra, con su cabecera): se carga la que se pida.
+ *
+ * Todos los derechos reservados.
+ */
+
+#ifndef LECTOR_TRAZA_H_INCLUIDO
+#define LECTOR_TRAZA_H_INCLUIDO
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "../TrazaADC.h"
+
+// ----------------------------------------------------------
+// Carga la traza: si no empieza por "TADC" binario, se buscan
+// las líneas "TADC:" del registro del puerto serie y se juntan
+// las de la traza numero (1 la primera): cada línea con una
+// cabecera empieza otra
+// ----------------------------------------------------------
+inline bool cargarTraza( const char * nombre, std::vector<uint8_t> & traza, unsigned numero = 1 ) {
+  FILE * f = fopen( nombre, "rb" );
+  if ( f == nullptr ) {
+	return false;
+  }
+  std::vector<uint8_t> contenido;
+  uint8_t bloque[4096];
+  size_t n;
+  while ( ( n = fread( bloque, 1, sizeof(bloque), f ) ) > 0 ) {
+	contenido.insert( contenido.end(), bloque, bloque + n );
+  }
+  fclose( f );
+
+  if ( contenido.size() >= 4 && memcmp( contenido.data(), TrazaADC::MAGICO, 4 ) == 0 ) {
+	traza.swap( contenido );
+	return numero == 1; // el binario es una sola traza
+  }
+
+  auto valorHex = []( uint8_t c ) -> int {
+	if ( c >= '0' && c <= '9' ) return c - '0';
+	if ( c >= 'a' && c <= 'f' ) return c - 'a' + 10;
+	if ( c >= 'A' && c <= 'F' ) return c - 'A' + 10;
+	return -1;
+  };
+
+  unsigned actual = 0; // traza de la línea que se lee (0 antes de la primera cabecera)
+  std::vector<uint8_t> linea;
+  for ( size_t i = 0; i + 5 <= contenido.size(); i++ ) {
+	if ( memcmp( &contenido[i], "TADC:", 5 ) != 0 ) {
+	  continue;
+	}
+	i += 5;
+	linea.clear();
+	while ( i + 1 < contenido.size() && valorHex( contenido[i] ) >= 0 && valorHex( contenido[i+1] ) >= 0 ) {
+	  linea.push_back( (uint8_t) ( valorHex( contenido[i] ) * 16 + valorHex( contenido[i+1] ) ) );
+	  i += 2;
+	}
+	// un registro de 6 bytes que empiece por 'T' (0x54) no puede ser: su varint es de 1 byte
+	if ( linea.size() == TrazaADC::TAMANYO_CABECERA && memcmp( linea.data(), TrazaADC::MAGICO, 4 ) == 0 ) {
+	  actual++;
+	}
+	if ( actual == numero ) {
+	  traza.insert( traza.end(), linea.begin(), linea.end() );
+	}
+  } // for
+  return ! traza.empty();
+} // ()
+
+// ----------------------------------------------------------
+// Las muestras en las que la placa no leyó Vref (referencia lenta,
+// TrazaADC::SIN_REFERENCIA) se reproducen con la última leída
+// ----------------------------------------------------------
+inline void completarReferencia( TrazaADC::Muestra & m, uint16_t & ultimaReferencia ) {
+  if ( m.aref == TrazaADC::SIN_REFERENCIA ) {
+	m.aref = ultimaReferencia;
+  } else {
+	ultimaReferencia = m.aref;
+  }
+} // ()
+
+#endif
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
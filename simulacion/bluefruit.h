@@ -0,0 +1,533 @@
+/*
+ * Nombre del fichero: bluefruit.h
+ * Descripción: Sustituto de la biblioteca Bluefruit para compilar el firmware en el ordenador.
+ * Autores: agent
+ * Fecha: 18 de octubre de 2026
+ *
+ * Este archivo ha sido realizado por agent.
+ * Contiene la parte de la API de Bluefruit que usan EmisoraBLE y ServicioEnEmisora. Los
+ * anuncios se construyen byte a byte como lo hace Bluefruit (estructuras AD) y cada vez
+ * que empieza uno se avisa a Simulacion::alEmpezarAnuncio, así las simulaciones pueden
+ * ver exactamente lo que saldría por el aire. Las conexiones se simulan con
+ * Simulacion::conectar(), Simulacion::desconectar() y Simulacion::completarNotificaciones()
+ * (el evento de la SoftDevice que avisa de que una central ya ha recibido notificaciones).
+ * Lo que pide el periférico para el enlace (PHY, longitud de los paquetes, MTU y
+ * parámetros de conexión) se resuelve en el acto con lo que admita la central simulada;
+ * en la placa llega un poco después, cuando la central contesta.
+ * Bluefruit es una sola, como en la placa, salvo que un hilo ponga la suya en
+ * Simulacion::bluefruitDelHilo (la flota de simularFlota tiene una por nodo).
+ * Sólo se usa al compilar con -I simulacion.
+ *
+ * Todos los derechos reservados.
+ */
+
+#ifndef BLUEFRUIT_SIMULADO_H_INCLUIDO
+#define BLUEFRUIT_SIMULADO_H_INCLUIDO
+
+#include "Arduino.h"
+
+typedef uint32_t err_t;
+#define ERROR_NONE 0
+
+#define BLE_GAP_AD_TYPE_FLAGS 0x01
+#define BLE_GAP_AD_TYPE_128BIT_SERVICE_UUID_COMPLETE 0x07
+#define BLE_GAP_AD_TYPE_COMPLETE_LOCAL_NAME 0x09
+#define BLE_GAP_AD_TYPE_MANUFACTURER_SPECIFIC_DATA 0xFF
+#define BLE_GAP_ADV_FLAGS_LE_ONLY_GENERAL_DISC_MODE 0x06
+#define BLE_GAP_ADV_SET_DATA_SIZE_MAX 31
+#define BLE_CONN_HANDLE_INVALID 0xFFFF
+#define BLE_GATT_ATT_MTU_DEFAULT 23
+#define BLE_GATT_ATT_MTU_MAX 247
+#define BLE_GAP_EVENT_LENGTH_DEFAULT 3
+#define BLE_GAP_DATA_LENGTH_DEFAULT 27
+#define BLE_GAP_DATA_LENGTH_MAX 251
+#define BLE_GAP_PHY_AUTO 0x00
+#define BLE_GAP_PHY_1MBPS 0x01
+#define BLE_GAP_PHY_2MBPS 0x02
+#define BLE_GAP_CONN_SLAVE_LATENCY 0
+#define BLE_GAP_CONN_SUPERVISION_TIMEOUT_MS 2000
+#define BLE_GATTC_WRITE_CMD_TX_QUEUE_SIZE_DEFAULT 1
+#define BLE_GATTS_HVN_TX_QUEUE_SIZE_DEFAULT 1
+#define BLE_GATT_HVX_NOTIFICATION 0x01
+#define BLE_GATTS_EVT_HVN_TX_COMPLETE 0x57
+
+#define CHR_PROPS_BROADCAST 0x01
+#define CHR_PROPS_READ 0x02
+#define CHR_PROPS_WRITE_WO_RESP 0x04
+#define CHR_PROPS_WRITE 0x08
+#define CHR_PROPS_NOTIFY 0x10
+#define CHR_PROPS_INDICATE 0x20
+
+enum SecureMode_t {
+  SECMODE_NO_ACCESS = 0x00,
+  SECMODE_OPEN = 0x11,
+  SECMODE_ENC_NO_MITM = 0x21,
+  SECMODE_ENC_WITH_MITM = 0x31
+};
+
+class BLECharacteristic;
+
+// ----------------------------------------------------------
+// Evento de la SoftDevice (sólo lo que usa el firmware)
+// ----------------------------------------------------------
+struct ble_evt_hdr_t {
+  uint16_t evt_id;
+  uint16_t evt_len;
+};
+
+struct ble_gatts_evt_hvn_tx_complete_t {
+  uint8_t count;
+};
+
+struct ble_gatts_evt_t {
+  uint16_t conn_handle;
+  union {
+	ble_gatts_evt_hvn_tx_complete_t hvn_tx_complete;
+  } params;
+};
+
+struct ble_evt_t {
+  ble_evt_hdr_t header;
+  union {
+	ble_gatts_evt_t gatts_evt;
+  } evt;
+};
+
+// ----------------------------------------------------------
+// Enganches para las simulaciones
+// ----------------------------------------------------------
+namespace Simulacion {
+
+  /// Se llama cada vez que empieza un anuncio, con los datos tal y como salen por el aire.
+  using CallbackAnuncio = void ( const uint8_t * datos, uint8_t longitud, int8_t txPower );
+
+  inline thread_local CallbackAnuncio * alEmpezarAnuncio = nullptr;
+
+  /// Se llama cada vez que una característica notifica (conn_handle, datos, longitud).
+  using CallbackNotificacion = void ( uint16_t connHandle, const uint8_t * datos, uint16_t longitud );
+
+  inline thread_local CallbackNotificacion * alNotificar = nullptr;
+
+}; // namespace
+
+// ----------------------------------------------------------
+// Datos de anuncio (estructuras AD longitud-tipo-datos)
+// ----------------------------------------------------------
+class BLEAdvertisingData {
+protected:
+
+  uint8_t datos[BLE_GAP_ADV_SET_DATA_SIZE_MAX];
+  uint8_t cuenta = 0;
+
+public:
+
+  bool addData( uint8_t tipo, const void * dato, uint8_t longitud ) {
+	if ( cuenta + 2 + longitud > BLE_GAP_ADV_SET_DATA_SIZE_MAX ) {
+	  return false;
+	}
+	datos[cuenta] = longitud + 1;
+	datos[cuenta+1] = tipo;
+	memcpy( &datos[cuenta+2], dato, longitud );
+	cuenta += 2 + longitud;
+	return true;
+  } // ()
+
+  bool addFlags( uint8_t flags ) {
+	return addData( BLE_GAP_AD_TYPE_FLAGS, &flags, 1 );
+  } // ()
+
+  bool addName();
+
+  void clearData() {
+	cuenta = 0;
+	memset( datos, 0, sizeof(datos) );
+  } // ()
+
+  uint8_t count() const { return cuenta; }
+  const uint8_t * getData() const { return datos; }
+
+}; // class
+
+// ----------------------------------------------------------
+class BLEBeacon {
+private:
+
+  uint16_t fabricante = 0x004C;
+  uint8_t uuid[16];
+  uint16_t major;
+  uint16_t minor;
+  int8_t rssi;
+
+  friend class BLEAdvertising;
+
+public:
+
+  BLEBeacon( const uint8_t uuid128[16], uint16_t major_, uint16_t minor_, int8_t rssi_ )
+	: major( major_ ), minor( minor_ ), rssi( rssi_ ) {
+	memcpy( uuid, uuid128, 16 );
+  } // ()
+
+  void setManufacturer( uint16_t id ) { fabricante = id; }
+
+}; // class
+
+// ----------------------------------------------------------
+class BLEService {
+private:
+  uint8_t uuid[16];
+  friend class BLEAdvertising;
+public:
+  BLEService( const uint8_t * uuid128 ) { memcpy( uuid, uuid128, 16 ); }
+  err_t begin() { return ERROR_NONE; }
+}; // class
+
+// ----------------------------------------------------------
+class BLEAdvertising : public BLEAdvertisingData {
+private:
+
+  bool enMarcha = false;
+  uint16_t intervaloRapido = 32;
+  uint16_t intervaloLento = 244;
+
+public:
+
+  // como BLEBeacon::start() de Bluefruit: flags + datos del fabricante (major y minor en big endian)
+  bool setBeacon( BLEBeacon & beacon ) {
+	uint8_t carga[2 + 2 + 16 + 2 + 2 + 1];
+	carga[0] = (uint8_t) ( beacon.fabricante & 0xff );
+	carga[1] = (uint8_t) ( beacon.fabricante >> 8 );
+	carga[2] = 0x02;
+	carga[3] = 0x15;
+	memcpy( &carga[4], beacon.uuid, 16 );
+	carga[20] = (uint8_t) ( beacon.major >> 8 );
+	carga[21] = (uint8_t) ( beacon.major & 0xff );
+	carga[22] = (uint8_t) ( beacon.minor >> 8 );
+	carga[23] = (uint8_t) ( beacon.minor & 0xff );
+	carga[24] = (uint8_t) beacon.rssi;
+	clearData();
+	addFlags( BLE_GAP_ADV_FLAGS_LE_ONLY_GENERAL_DISC_MODE );
+	return addData( BLE_GAP_AD_TYPE_MANUFACTURER_SPECIFIC_DATA, carga, sizeof(carga) );
+  } // ()
+
+  bool addService( BLEService & servicio ) {
+	return addData( BLE_GAP_AD_TYPE_128BIT_SERVICE_UUID_COMPLETE, servicio.uuid, 16 );
+  } // ()
+
+  void restartOnDisconnect( bool ) { }
+  void setInterval( uint16_t rapido, uint16_t lento ) { intervaloRapido = rapido; intervaloLento = lento; }
+  void setFastTimeout( uint16_t ) { }
+  uint16_t getInterval() const { return intervaloRapido; }
+
+  bool start( uint16_t timeout = 0 );
+  bool stop() { enMarcha = false; return true; }
+  bool isRunning() const { return enMarcha; }
+
+}; // class
+
+// ----------------------------------------------------------
+class BLEConnection {
+private:
+  uint16_t hdl;
+public:
+  // estado de la conexión simulada
+  uint16_t mtu = BLE_GATT_ATT_MTU_DEFAULT;
+  uint8_t enVuelo = 0;    ///< Notificaciones en la cola de la SoftDevice.
+  uint8_t colaHvn = BLE_GATTS_HVN_TX_QUEUE_SIZE_DEFAULT;
+  uint32_t bloqueos = 0;  ///< Veces que notify() habría esperado en la placa (cola llena).
+  uint8_t phy = BLE_GAP_PHY_1MBPS;
+  uint16_t longitudDatos = BLE_GAP_DATA_LENGTH_DEFAULT; ///< Bytes de datos por paquete del enlace.
+  uint16_t intervalo = 24;     ///< Intervalo de conexión, en unidades de 1.25 ms.
+  uint16_t latencia = 0;       ///< Intervalos que el periférico se puede saltar.
+  uint16_t supervision = BLE_GAP_CONN_SUPERVISION_TIMEOUT_MS / 10;
+  uint16_t mtuServidor = BLE_GATT_ATT_MTU_DEFAULT; ///< La de configPrphConn().
+
+  // lo que admite la central simulada: lo negociado no pasa de aquí
+  uint8_t physCentral = BLE_GAP_PHY_1MBPS | BLE_GAP_PHY_2MBPS;
+  uint16_t longitudDatosCentral = BLE_GAP_DATA_LENGTH_MAX;
+  uint16_t mtuCentral = BLE_GATT_ATT_MTU_MAX;
+  uint16_t intervaloMinimoCentral = 6;
+
+  BLEConnection( uint16_t h = BLE_CONN_HANDLE_INVALID ) : hdl( h ) { }
+  uint16_t handle() const { return hdl; }
+  bool connected() const { return hdl != BLE_CONN_HANDLE_INVALID; }
+  uint16_t getMtu() const { return mtu; }
+  uint8_t getPHY() const { return phy; }
+  uint16_t getDataLength() const { return longitudDatos; }
+  uint16_t getConnectionInterval() const { return intervalo; }
+  uint16_t getSlaveLatency() const { return latencia; }
+  uint16_t getSupervisionTimeout() const { return supervision; }
+
+  bool requestPHY( uint8_t phys = BLE_GAP_PHY_2MBPS ) {
+	phy = ( phys & physCentral & BLE_GAP_PHY_2MBPS ) != 0 ? BLE_GAP_PHY_2MBPS : BLE_GAP_PHY_1MBPS;
+	return true;
+  } // ()
+
+  bool requestDataLengthUpdate() {
+	longitudDatos = longitudDatosCentral < BLE_GAP_DATA_LENGTH_MAX ? longitudDatosCentral : BLE_GAP_DATA_LENGTH_MAX;
+	return true;
+  } // ()
+
+  bool requestMtuExchange( uint16_t pedida ) {
+	uint16_t m = pedida < mtuServidor ? pedida : mtuServidor;
+	mtu = m < mtuCentral ? m : mtuCentral;
+	return true;
+  } // ()
+
+  bool requestConnectionParameter( uint16_t intervalo_, uint16_t latencia_ = BLE_GAP_CONN_SLAVE_LATENCY,
+								   uint16_t supervision_ = BLE_GAP_CONN_SUPERVISION_TIMEOUT_MS / 10 ) {
+	intervalo = intervalo_ > intervaloMinimoCentral ? intervalo_ : intervaloMinimoCentral;
+	latencia = latencia_;
+	supervision = supervision_;
+	return true;
+  } // ()
+}; // class
+
+// ----------------------------------------------------------
+class BLEPeriph {
+public:
+  using connect_callback_t = void (*)( uint16_t conn_hdl );
+  using disconnect_callback_t = void (*)( uint16_t conn_hdl, uint8_t reason );
+
+  connect_callback_t alConectar = nullptr;
+  disconnect_callback_t alDesconectar = nullptr;
+
+  void setConnectCallback( connect_callback_t cb ) { alConectar = cb; }
+  void setDisconnectCallback( disconnect_callback_t cb ) { alDesconectar = cb; }
+}; // class
+
+// ----------------------------------------------------------
+// En la simulación no hay emparejamiento: sólo se recuerda el PIN
+class BLESecurity {
+public:
+  char pin[7] = "";
+
+  bool setPIN( const char * p ) {
+	if ( strlen( p ) != 6 ) {
+	  return false;
+	}
+	strcpy( pin, p );
+	return true;
+  } // ()
+}; // class
+
+// ----------------------------------------------------------
+class BLECharacteristic {
+public:
+  using write_cb_t = void (*)( uint16_t conn_hdl, BLECharacteristic * chr, uint8_t * data, uint16_t len );
+  using write_cccd_cb_t = void (*)( uint16_t conn_hdl, BLECharacteristic * chr, uint16_t value );
+
+private:
+  uint8_t uuid[16];
+  uint8_t propiedades = 0;
+  uint16_t longitudMaxima = 20;
+  uint8_t valor[247];
+  uint16_t longitud = 0;
+  write_cb_t alEscribir = nullptr;
+  write_cccd_cb_t alEscribirCCCD = nullptr;
+  uint16_t cccd[20] = { 0 };
+
+public:
+  BLECharacteristic( const uint8_t * uuid128 ) { memcpy( uuid, uuid128, 16 ); }
+
+  void setProperties( uint8_t props ) { propiedades = props; }
+  void setPermission( SecureMode_t, SecureMode_t ) { }
+  void setMaxLen( uint16_t max ) { longitudMaxima = max > sizeof(valor) ? sizeof(valor) : max; }
+  void setWriteCallback( write_cb_t cb ) { alEscribir = cb; }
+  void setCccdWriteCallback( write_cccd_cb_t cb ) { alEscribirCCCD = cb; }
+  err_t begin() { return ERROR_NONE; }
+
+  uint16_t write( const void * datos, uint16_t n ) {
+	longitud = n > longitudMaxima ? longitudMaxima : n;
+	memcpy( valor, datos, longitud );
+	return longitud;
+  } // ()
+  uint16_t write( const char * str ) { return write( str, (uint16_t) strlen( str ) ); }
+
+  bool notify( const void * datos, uint16_t n ) {
+	write( datos, n );
+	if ( Simulacion::alNotificar != nullptr ) {
+	  Simulacion::alNotificar( 0, valor, longitud );
+	}
+	return true;
+  } // ()
+  bool notify( const char * str ) { return notify( str, (uint16_t) strlen( str ) ); }
+
+  bool notifyEnabled( uint16_t connHandle ) const {
+	return connHandle < 20 && ( cccd[connHandle] & BLE_GATT_HVX_NOTIFICATION ) != 0;
+  } // ()
+
+  bool notify( uint16_t connHandle, const void * datos, uint16_t n );
+
+  uint16_t read( void * destino, uint16_t n ) {
+	uint16_t c = n < longitud ? n : longitud;
+	memcpy( destino, valor, c );
+	return c;
+  } // ()
+
+  /// Simula que una central activa (o desactiva) las notificaciones.
+  void simularSuscripcion( uint16_t connHandle, bool notificar ) {
+	cccd[connHandle % 20] = notificar ? BLE_GATT_HVX_NOTIFICATION : 0;
+	if ( alEscribirCCCD != nullptr ) {
+	  alEscribirCCCD( connHandle, this, cccd[connHandle % 20] );
+	}
+  } // ()
+
+  /// Simula que una central escribe en la característica.
+  void simularEscritura( uint16_t connHandle, const uint8_t * datos, uint16_t n ) {
+	write( datos, n );
+	if ( alEscribir != nullptr ) {
+	  alEscribir( connHandle, this, valor, longitud );
+	}
+  } // ()
+}; // class
+
+// ----------------------------------------------------------
+class AdafruitBluefruit {
+private:
+  char nombre[32] = "Bluefruit52";
+  int8_t txPower = 4;
+  BLEConnection conexiones[20];
+  uint8_t colaHvn = BLE_GATTS_HVN_TX_QUEUE_SIZE_DEFAULT;
+  uint16_t mtuMaxima = BLE_GATT_ATT_MTU_DEFAULT;
+  uint8_t longitudEvento = BLE_GAP_EVENT_LENGTH_DEFAULT;
+
+public:
+  void (*alEvento)( ble_evt_t * ) = nullptr;
+
+  BLEAdvertising Advertising;
+  BLEAdvertisingData ScanResponse;
+  BLEPeriph Periph;
+  BLESecurity Security;
+
+  bool begin( uint8_t = 1, uint8_t = 0 ) { return true; }
+
+  void configPrphConn( uint16_t mtuMax, uint8_t eventLen, uint8_t hvnQsize, uint8_t ) {
+	mtuMaxima = mtuMax;
+	longitudEvento = eventLen;
+	colaHvn = hvnQsize;
+  } // ()
+  uint8_t getHvnQsize() const { return colaHvn; }
+  uint16_t getMaxMtu() const { return mtuMaxima; }
+  uint8_t getEventLength() const { return longitudEvento; } ///< En unidades de 1.25 ms.
+
+  void setEventCallback( void (*cb)( ble_evt_t * ) ) { alEvento = cb; }
+
+  void setName( const char * n ) {
+	strncpy( nombre, n, sizeof(nombre) - 1 );
+	nombre[sizeof(nombre) - 1] = '\0';
+  } // ()
+  const char * getName() const { return nombre; }
+
+  bool setTxPower( int8_t dBm ) { txPower = dBm; return true; }
+  int8_t getTxPower() const { return txPower; }
+
+  // como en Bluefruit: nullptr si no hay conexión con ese handle
+  BLEConnection * Connection( uint16_t h ) {
+	return h < 20 && conexiones[h].connected() ? &conexiones[h] : nullptr;
+  } // ()
+
+  BLEConnection & conexionSimulada( uint16_t h ) { return conexiones[h % 20]; }
+}; // class
+
+inline AdafruitBluefruit BluefruitComun;
+
+namespace Simulacion {
+
+  /// Si no es nullptr, la Bluefruit que ve este hilo en vez de la común (una por nodo simulado).
+  inline thread_local AdafruitBluefruit * bluefruitDelHilo = nullptr;
+
+  inline AdafruitBluefruit & bluefruit() {
+	return bluefruitDelHilo != nullptr ? *bluefruitDelHilo : BluefruitComun;
+  } // ()
+
+}; // namespace
+
+// el firmware escribe Bluefruit.algo, como con la biblioteca
+#define Bluefruit ( Simulacion::bluefruit() )
+
+// ----------------------------------------------------------
+inline bool BLEAdvertisingData::addName() {
+  const char * n = Bluefruit.getName();
+  uint8_t libre = BLE_GAP_ADV_SET_DATA_SIZE_MAX - cuenta - 2;
+  uint8_t lon = (uint8_t) strlen( n );
+  return addData( BLE_GAP_AD_TYPE_COMPLETE_LOCAL_NAME, n, lon > libre ? libre : lon );
+} // ()
+
+inline bool BLEAdvertising::start( uint16_t ) {
+  enMarcha = true;
+  if ( Simulacion::alEmpezarAnuncio != nullptr ) {
+	Simulacion::alEmpezarAnuncio( datos, cuenta, Bluefruit.getTxPower() );
+  }
+  return true;
+} // ()
+
+inline bool BLECharacteristic::notify( uint16_t connHandle, const void * datos, uint16_t n ) {
+  BLEConnection * conexion = Bluefruit.Connection( connHandle );
+  if ( conexion == nullptr || ! notifyEnabled( connHandle ) ) {
+	return false;
+  }
+  uint16_t c = n > conexion->getMtu() - 3 ? conexion->getMtu() - 3 : n;
+  if ( conexion->enVuelo >= conexion->colaHvn ) {
+	conexion->bloqueos++; // en la placa notify() esperaría aquí
+  } else {
+	conexion->enVuelo++;
+  }
+  if ( Simulacion::alNotificar != nullptr ) {
+	Simulacion::alNotificar( connHandle, (const uint8_t *) datos, c );
+  }
+  return true;
+} // ()
+
+// ----------------------------------------------------------
+// Conexiones simuladas
+// ----------------------------------------------------------
+namespace Simulacion {
+
+  /// Una central se conecta con ese handle y esa MTU.
+  inline void conectar( uint16_t connHandle, uint16_t mtu = BLE_GATT_ATT_MTU_DEFAULT ) {
+	BLEConnection & c = Bluefruit.conexionSimulada( connHandle );
+	c = BLEConnection( connHandle );
+	c.mtu = mtu;
+	c.colaHvn = Bluefruit.getHvnQsize();
+	c.mtuServidor = Bluefruit.getMaxMtu();
+	if ( Bluefruit.Periph.alConectar != nullptr ) {
+	  Bluefruit.Periph.alConectar( connHandle );
+	}
+  } // ()
+
+  /// La central se desconecta.
+  inline void desconectar( uint16_t connHandle, uint8_t razon = 0x13 ) {
+	Bluefruit.conexionSimulada( connHandle ) = BLEConnection();
+	if ( Bluefruit.Periph.alDesconectar != nullptr ) {
+	  Bluefruit.Periph.alDesconectar( connHandle, razon );
+	}
+  } // ()
+
+  /// La central ha recibido hasta n notificaciones: evento BLE_GATTS_EVT_HVN_TX_COMPLETE.
+  /// Devuelve cuántas había en vuelo y se han completado.
+  inline uint8_t completarNotificaciones( uint16_t connHandle, uint8_t n ) {
+	BLEConnection * c = Bluefruit.Connection( connHandle );
+	if ( c == nullptr || c->enVuelo == 0 ) {
+	  return 0;
+	}
+	uint8_t hechas = n < c->enVuelo ? n : c->enVuelo;
+	c->enVuelo -= hechas;
+	if ( Bluefruit.alEvento != nullptr ) {
+	  ble_evt_t evento;
+	  evento.header.evt_id = BLE_GATTS_EVT_HVN_TX_COMPLETE;
+	  evento.header.evt_len = sizeof( evento );
+	  evento.evt.gatts_evt.conn_handle = connHandle;
+	  evento.evt.gatts_evt.params.hvn_tx_complete.count = hechas;
+	  Bluefruit.alEvento( &evento );
+	}
+	return hechas;
+  } // ()
+
+}; // namespace
+
+#endif
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
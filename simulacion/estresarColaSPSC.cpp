@@ -0,0 +1,202 @@
+/*
+ * Nombre del fichero: estresarColaSPSC.cpp
+ * Descripción: Prueba con dos hilos la cola ColaSPSC y mide cuántos elementos por segundo pasan por ella.
+ * Autores: agent
+ * Fecha: 18 de octubre de 2026
+ *
+ * Este archivo ha sido realizado por agent.
+ * Primero la prueba: un hilo productor mete paquetes numerados sin esperar nunca (como la
+ * interrupción del SAADC: si no caben, se pierden) y otro los saca, uno a uno o por bloques
+ * de tamaño al azar, y a ritmos que cambian. El consumidor comprueba que cada paquete llega
+ * entero (sus copias del número cuadran), que los números sólo crecen y que recibidos más
+ * desbordamientos son todos los enviados. Después la medida: el productor espera cuando la
+ * cola está llena y se cuenta cuántos millones de elementos por segundo llegan, sacando de
+ * uno en uno y por bloques.
+ *
+ * No usa Arduino.h: la cola es la misma que compila la placa.
+ *
+ * Compilar (desde esta carpeta):
+ *   g++ -O2 -std=c++17 -pthread estresarColaSPSC.cpp -o estresarColaSPSC
+ * Uso:
+ *   ./estresarColaSPSC [millones de elementos por prueba]
+ *
+ * Todos los derechos reservados.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "../ColaSPSC.h"
+
+// ----------------------------------------------------------
+// un paquete que se nota si llega a medias
+// ----------------------------------------------------------
+struct Paquete {
+  uint32_t numero;
+  uint32_t copias[3];
+}; // struct
+
+static Paquete paquete( uint32_t n ) {
+  return Paquete { n, { n * 2654435761u, ~n, n ^ 0x5a5a5a5au } };
+} // ()
+
+static bool entero( const Paquete & p ) {
+  return p.copias[0] == p.numero * 2654435761u && p.copias[1] == ~p.numero && p.copias[2] == ( p.numero ^ 0x5a5a5a5au );
+} // ()
+
+// de vez en cuando, para que los dos hilos cambien de ritmo
+static void quizaCeder( std::mt19937 & azar ) {
+  if ( ( azar() & 1023 ) == 0 ) {
+	std::this_thread::yield();
+  }
+} // ()
+
+// ----------------------------------------------------------
+// Prueba con pérdidas: el productor nunca espera
+// ----------------------------------------------------------
+template< uint32_t CAPACIDAD >
+static bool probar( const char * nombre, uint32_t total, bool porBloques ) {
+  ColaSPSC< Paquete, CAPACIDAD > cola;
+
+  std::thread productor( [&]() {
+	std::mt19937 azar( 38 );
+	std::vector<Paquete> bloque( 40 );
+	uint32_t n = 0;
+	while ( n < total ) {
+	  if ( porBloques ) {
+		uint32_t k = 1 + azar() % 40;
+		if ( k > total - n ) {
+		  k = total - n;
+		}
+		for ( uint32_t i = 0; i < k; i++ ) {
+		  bloque[i] = paquete( n + i );
+		}
+		cola.meterBloque( bloque.data(), k );
+		n += k;
+	  } else {
+		cola.meter( paquete( n ) );
+		n++;
+	  }
+	  // casi siempre deja sitio al consumidor cuando la ve casi llena; alguna vez no, y se pierden
+	  if ( cola.pendientes() > CAPACIDAD / 2 && ( azar() & 15 ) != 0 ) {
+		std::this_thread::yield();
+	  }
+	  quizaCeder( azar );
+	} // while
+  } );
+
+  std::mt19937 azar( 83 );
+  std::vector<Paquete> bloque( 100 );
+  uint64_t recibidos = 0;
+  int64_t anterior = -1;
+  bool bien = true;
+  bool productorAcabado = false;
+  for ( ;; ) {
+	uint32_t k;
+	if ( porBloques ) {
+	  k = cola.sacarBloque( bloque.data(), 1 + azar() % 100 );
+	} else {
+	  k = cola.sacar( bloque[0] ) ? 1 : 0;
+	}
+	for ( uint32_t i = 0; i < k; i++ ) {
+	  if ( ! entero( bloque[i] ) || (int64_t) bloque[i].numero <= anterior ) {
+		bien = false;
+	  }
+	  anterior = bloque[i].numero;
+	}
+	recibidos += k;
+	if ( k == 0 ) {
+	  if ( productorAcabado ) {
+		break;
+	  }
+	  // el productor ha acabado si recibidos + perdidos llegan al total
+	  productorAcabado = recibidos + cola.getDesbordamientos() == total;
+	}
+	quizaCeder( azar );
+  } // for
+  productor.join();
+
+  uint32_t perdidos = cola.getDesbordamientos();
+  bool cuadra = recibidos + perdidos == total;
+  printf( "%-28s %10llu recibidos %10u perdidos  %s\n", nombre, (unsigned long long) recibidos, perdidos,
+		  bien && cuadra ? "bien" : "MAL" );
+  return bien && cuadra;
+} // ()
+
+// ----------------------------------------------------------
+// Medida sin pérdidas: el productor espera si está llena
+// ----------------------------------------------------------
+template< uint32_t CAPACIDAD >
+static double medir( uint32_t total, uint32_t bloqueProductor, uint32_t bloqueConsumidor ) {
+  ColaSPSC< uint32_t, CAPACIDAD > cola;
+  auto inicio = std::chrono::steady_clock::now();
+
+  std::thread productor( [&]() {
+	std::vector<uint32_t> bloque( bloqueProductor );
+	uint32_t n = 0;
+	while ( n < total ) {
+	  uint32_t k = bloqueProductor < total - n ? bloqueProductor : total - n;
+	  for ( uint32_t i = 0; i < k; i++ ) {
+		bloque[i] = n + i;
+	  }
+	  uint32_t hechos = 0;
+	  while ( hechos < k ) {
+		uint32_t libres = CAPACIDAD - cola.pendientes();
+		uint32_t m = k - hechos < libres ? k - hechos : libres;
+		if ( m == 0 ) {
+		  std::this_thread::yield();
+		  continue;
+		}
+		hechos += bloqueProductor == 1 ? ( cola.meter( bloque[hechos] ) ? 1 : 0 ) : cola.meterBloque( &bloque[hechos], m );
+	  }
+	  n += k;
+	} // while
+  } );
+
+  std::vector<uint32_t> bloque( bloqueConsumidor );
+  uint64_t recibidos = 0, suma = 0;
+  while ( recibidos < total ) {
+	uint32_t k = bloqueConsumidor == 1 ? ( cola.sacar( bloque[0] ) ? 1 : 0 ) : cola.sacarBloque( bloque.data(), bloqueConsumidor );
+	if ( k == 0 ) {
+	  std::this_thread::yield();
+	  continue;
+	}
+	for ( uint32_t i = 0; i < k; i++ ) {
+	  suma += bloque[i];
+	}
+	recibidos += k;
+  } // while
+  productor.join();
+
+  double segundos = std::chrono::duration<double>( std::chrono::steady_clock::now() - inicio ).count();
+  if ( suma != (uint64_t) total * ( total - 1 ) / 2 ) {
+	printf( "MAL: la suma de lo recibido no cuadra\n" );
+	return -1;
+  }
+  return total / segundos / 1e6;
+} // ()
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+int main( int argc, char * argv[] ) {
+  uint32_t total = (uint32_t) ( ( argc > 1 ? atof( argv[1] ) : 5 ) * 1e6 );
+  printf( "%u hilos en el ordenador, %u elementos por prueba\n\n", std::thread::hardware_concurrency(), total );
+
+  bool bien = true;
+  bien &= probar<64>( "de uno en uno, capacidad 64", total, false );
+  bien &= probar<64>( "por bloques, capacidad 64", total, true );
+  bien &= probar<256>( "por bloques, capacidad 256", total, true );
+
+  printf( "\n%-28s %12s\n", "productor / consumidor", "Melementos/s" );
+  printf( "%-28s %12.1f\n", "1 / 1", medir<1024>( total, 1, 1 ) );
+  printf( "%-28s %12.1f\n", "64 / 1", medir<1024>( total, 64, 1 ) );
+  printf( "%-28s %12.1f\n", "64 / 64", medir<1024>( total, 64, 64 ) );
+  printf( "%-28s %12.1f\n", "64 / 256", medir<1024>( total, 64, 256 ) );
+
+  printf( "\n%s\n", bien ? "OK: ningún paquete a medias, desordenado ni sin contar" : "FALLO" );
+  return bien ? 0 : 1;
+} // ()
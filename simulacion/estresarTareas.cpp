@@ -0,0 +1,138 @@
+/*
+ * Nombre del fichero: estresarTareas.cpp
+ * Descripción: Mide en la simulación la regularidad de las lecturas del ADC con un puerto serie lento, con loop() o con tareas.
+ * Autores: agent
+ * Fecha: 18 de octubre de 2026
+ *
+ * Este archivo ha sido realizado por agent.
+ * Compila el firmware, hace que cada byte de Serial cueste lo que a 115200 baudios (o lo
+ * que se diga) y lo deja funcionar un tiempo con un periodo corto y un anuncio que dura
+ * todo el periodo, que es el peor caso para loop(). Escribe los intervalos entre lecturas
+ * del gas (media, mínimo y máximo y cuánto se desvían del periodo) y, con las tareas, el
+ * informe de tiempo ocupado, pila y colas que escribe la tarea de registro.
+ *
+ * Con loop() va sobre el reloj virtual. Con las tareas (TAREAS_FREERTOS), cada tarea es
+ * un hilo (rtos.h) y el tiempo es el real multiplicado por la aceleración, así que la
+ * prueba tarda segundos / aceleración de verdad y los intervalos llevan además el
+ * desorden del planificador del ordenador. Las prioridades no se respetan y la pila no se
+ * mide (sale entera libre): eso sólo se ve en la placa.
+ *
+ * Se compila dos veces para comparar:
+ *   g++ -O2 -std=c++17 -I. estresarTareas.cpp -o estresarLoop
+ *   g++ -O2 -std=c++17 -I. -pthread -DTAREAS_FREERTOS -DPERIODO_INFORME_TAREAS_MS=20000 estresarTareas.cpp -o estresarTareas
+ * Uso:
+ *   ./estresarTareas [segundos] [periodo (ms)] [us por byte de Serial] [aceleración]
+ *
+ * Todos los derechos reservados.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <Arduino.h>
+#include "../HolaMundoIBeacon.ino"
+
+// ----------------------------------------------------------
+// cuándo se lee el pin del gas
+// ----------------------------------------------------------
+namespace Estres {
+  std::vector<uint64_t> lecturasGas;
+
+  int fuente( uint8_t pin ) {
+	if ( pin == PIN_VGAS ) {
+	  lecturasGas.push_back( Simulacion::ahoraUs() );
+	  return 300;
+	}
+	return 400;
+  } // ()
+}; // namespace
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+int main( int argc, char * argv[] ) {
+  double segundos = argc > 1 ? atof( argv[1] ) : 120;
+  uint32_t periodoMs = argc > 2 ? (uint32_t) atol( argv[2] ) : 500;
+  uint32_t usPorByte = argc > 3 ? (uint32_t) atol( argv[3] ) : 87;
+  double aceleracion = argc > 4 ? atof( argv[4] ) : 10;
+
+  Configuracion c;
+  c.periodoPublicacionMs = periodoMs;
+  c.duracionAnuncioMs = (uint16_t) periodoMs; // el anuncio dura todo el periodo
+  if ( ! c.valida() ) {
+	fprintf( stderr, "periodo no válido\n" );
+	return 2;
+  }
+  Globales::laConfiguracionCompartida.publicar( c );
+
+  FILE * serie = tmpfile();
+  Simulacion::salidaSerie = serie;
+  Simulacion::usPorByteSerie = usPorByte;
+  Simulacion::fuenteADC = Estres::fuente;
+
+#ifdef TAREAS_FREERTOS
+  const char * modo = "tareas";
+  Simulacion::aceleracion = aceleracion;
+  setup();
+  uint64_t usInicio = Simulacion::ahoraUs();
+  std::this_thread::sleep_for( std::chrono::duration<double>( segundos / aceleracion ) );
+  Simulacion::pararTareas();
+#else
+  const char * modo = "loop()";
+  (void) aceleracion;
+  setup();
+  uint64_t usInicio = Simulacion::relojUs;
+  while ( Simulacion::relojUs - usInicio < (uint64_t) ( segundos * 1e6 ) ) {
+	loop();
+  }
+#endif
+
+  // los intervalos, desde la primera lectura después de setup()
+  double suma = 0, minimo = 1e300, maximo = 0, peorDesvio = 0;
+  size_t n = 0;
+  for ( size_t i = 1; i < Estres::lecturasGas.size(); i++ ) {
+	if ( Estres::lecturasGas[i-1] < usInicio ) {
+	  continue;
+	}
+	double ms = ( Estres::lecturasGas[i] - Estres::lecturasGas[i-1] ) / 1000.0;
+	suma += ms;
+	minimo = std::min( minimo, ms );
+	maximo = std::max( maximo, ms );
+	peorDesvio = std::max( peorDesvio, std::fabs( ms - periodoMs ) );
+	n++;
+  } // for
+  if ( n == 0 ) {
+	printf( "%s: no ha habido dos lecturas del gas\n", modo );
+	return 1;
+  }
+
+  printf( "%s, %.0f s, periodo %u ms, Serial %u us/byte: %zu lecturas del gas (se esperaban %.0f)\n",
+		  modo, segundos, periodoMs, usPorByte, n + 1, segundos * 1000 / periodoMs );
+  printf( "  intervalo entre lecturas (ms): media %.2f, mínimo %.2f, máximo %.2f, peor desvío del periodo %.2f\n",
+		  suma / n, minimo, maximo, peorDesvio );
+
+  // el informe de la tarea de registro (el último)
+  fflush( serie );
+  rewind( serie );
+  std::vector<std::string> informe;
+  char linea[256];
+  while ( fgets( linea, sizeof(linea), serie ) != nullptr ) {
+	if ( strncmp( linea, "tarea adquisicion", 17 ) == 0 ) {
+	  informe.clear();
+	}
+	if ( strncmp( linea, "tarea ", 6 ) == 0 || strncmp( linea, "colas: ", 7 ) == 0 ) {
+	  informe.push_back( linea );
+	}
+  } // while
+  for ( const std::string & l : informe ) {
+	printf( "  %s", l.c_str() );
+  }
+  fclose( serie );
+  return 0;
+} // ()
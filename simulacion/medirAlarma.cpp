@@ -0,0 +1,198 @@
+/*
+ * Nombre del fichero: medirAlarma.cpp
+ * Descripción: Mide en la simulación cuánto tarda una subida de ozono en salir por el aire.
+ * Autores: agent
+ * Fecha: 18 de octubre de 2026
+ *
+ * Este archivo ha sido realizado por agent.
+ * Compila el firmware (con GESTIONAR_CONEXIONES y una central conectada y suscrita),
+ * ejecuta setup() y loop() sobre el reloj virtual con Serial a 115200 baudios y, varias
+ * veces, sube el gas por encima de UMBRAL_ALARMA_PPM en un instante al azar del periodo.
+ * Para cada subida apunta cuánto tarda en empezar el primer anuncio que la avisa (el de
+ * alarma o, sin ALARMA_OZONO, el primero de CO2 con un valor por encima del umbral) y en
+ * llegar la primera notificación a la central; luego baja el gas y espera a que acabe.
+ * Escribe la latencia mínima, media y máxima. Con ALARMA_OZONO comprueba además que el
+ * anuncio de alarma va al intervalo más corto, que acaba al bajar el gas y que la
+ * latencia no pasa de PERIODO_VIGILANCIA_MS más lo que tarda en escribirse una vuelta
+ * (y, con -DADQUISICION_SAADC, más lo que dura un bloque del SAADC).
+ * En la placa el primer paquete sale después del retardo aleatorio del anuncio (0 a 10 ms).
+ *
+ * Se compila dos veces para comparar:
+ *   g++ -O2 -std=c++17 -I. medirAlarma.cpp -o medirAlarmaSin
+ *   g++ -O2 -std=c++17 -I. -DALARMA_OZONO medirAlarma.cpp -o medirAlarma
+ * Uso:
+ *   ./medirAlarma [subidas]
+ *
+ * Todos los derechos reservados.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+#define GESTIONAR_CONEXIONES
+#include <Arduino.h>
+#include "../HolaMundoIBeacon.ino"
+
+namespace Alarma {
+  const int AREF = 600;         ///< Cuentas del ADC en Vref.
+  const int AGAS_LIMPIO = 600;  ///< Gas = Vref: 0 ppm.
+  const int AGAS_PICO = 380;    ///< Unas 8.7 ppm con la calibración por defecto.
+
+  uint64_t usSubida = UINT64_MAX; ///< Desde cuándo está alto el gas (UINT64_MAX = no lo está).
+
+  bool hayAnuncio = false;
+  uint64_t usAnuncio = 0;
+  uint16_t intervaloAnuncio = 0;
+  bool anunciandoAlarma = false; ///< El último anuncio que ha empezado es de alarma.
+
+  bool hayNotificacion = false;
+  uint64_t usNotificacion = 0;
+
+  int fuente( uint8_t pin ) {
+	if ( pin == PIN_VGAS ) {
+	  return Simulacion::relojUs >= usSubida ? AGAS_PICO : AGAS_LIMPIO;
+	}
+	return AREF;
+  } // ()
+
+  // ¿avisa de la subida? una alarma, o una medida de CO2 por encima del umbral
+  bool avisa( uint8_t id, double valor ) {
+	return id == TramasPublicador::ID_ALARMA || ( id == TramasPublicador::ID_CO2 && valor >= UMBRAL_ALARMA_PPM );
+  } // ()
+
+  void alEmpezarAnuncio( const uint8_t * datos, uint8_t longitud, int8_t ) {
+	// flags (3), cabecera (2), fabricante (2), tipo y longitud (2), uuid (16), major, minor
+	if ( longitud < 29 ) {
+	  return;
+	}
+	uint8_t id, contador;
+	double valor;
+	bool esMedida = TramasPublicador::decodificar( TramaIBeacon::leerBE16( &datos[25] ), TramaIBeacon::leerBE16( &datos[27] ),
+												   id, contador, valor );
+	anunciandoAlarma = esMedida && id == TramasPublicador::ID_ALARMA;
+	if ( esMedida && ! hayAnuncio && usSubida != UINT64_MAX && avisa( id, valor ) ) {
+	  hayAnuncio = true;
+	  usAnuncio = Simulacion::relojUs;
+	  intervaloAnuncio = Bluefruit.Advertising.getInterval();
+	}
+  } // ()
+
+  void alNotificar( uint16_t connHandle, const uint8_t * datos, uint16_t longitud ) {
+	Simulacion::completarNotificaciones( connHandle, 1 ); // una central que da abasto
+	if ( longitud < 4 || hayNotificacion || usSubida == UINT64_MAX ) {
+	  return;
+	}
+	// alarma y CO2: la trama del anuncio (milésimas de ppm)
+	uint8_t id, contador;
+	double valor;
+	if ( TramasPublicador::decodificar( TramasPublicador::major( datos ), TramasPublicador::minor( datos ), id, contador, valor )
+		 && avisa( id, valor ) ) {
+	  hayNotificacion = true;
+	  usNotificacion = Simulacion::relojUs;
+	}
+  } // ()
+
+  struct Latencias {
+	double minimo = 1e18, maximo = 0, suma = 0;
+	uint32_t n = 0;
+
+	void anyadir( double ms ) {
+	  minimo = std::min( minimo, ms );
+	  maximo = std::max( maximo, ms );
+	  suma += ms;
+	  n++;
+	}
+
+	void escribir( const char * que ) const {
+	  printf( "%-28s mín %8.1f ms   media %8.1f ms   máx %8.1f ms\n", que, minimo, n > 0 ? suma / n : 0, maximo );
+	}
+  }; // struct
+}; // namespace
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+int main( int argc, char * argv[] ) {
+  uint32_t subidas = argc > 1 ? (uint32_t) atoi( argv[1] ) : 20;
+
+  Simulacion::salidaSerie = nullptr;
+  Simulacion::usPorByteSerie = 87; // 115200 baudios: lo que se escribe también cuenta
+  Simulacion::fuenteADC = Alarma::fuente;
+  Simulacion::alEmpezarAnuncio = Alarma::alEmpezarAnuncio;
+  Simulacion::alNotificar = Alarma::alNotificar;
+
+  setup();
+  Simulacion::conectar( 0 );
+  BLECharacteristic & car = Globales::laCaracteristicaLecturas;
+  car.simularSuscripcion( 0, true );
+  for ( int i = 0; i < 3; i++ ) {
+	loop();
+  }
+
+  std::mt19937 azar( 41 );
+  uint64_t usPeriodo = (uint64_t) Globales::laConfiguracion.periodoPublicacionMs * 1000;
+  Alarma::Latencias anuncio, notificacion;
+  bool bien = true;
+  uint32_t sinAviso = 0;
+  uint16_t peorIntervalo = 0;
+  uint32_t alarmasSinAcabar = 0;
+
+  for ( uint32_t k = 0; k < subidas; k++ ) {
+	// la subida, en un instante al azar de las vueltas que vienen
+	Alarma::usSubida = Simulacion::relojUs + azar() % usPeriodo;
+	Alarma::hayAnuncio = false;
+	Alarma::hayNotificacion = false;
+	for ( int vueltas = 0; vueltas < 4 && ! ( Alarma::hayAnuncio && Alarma::hayNotificacion ); vueltas++ ) {
+	  loop(); // con ALARMA_OZONO avisa desde dentro, mientras espera
+	}
+	if ( ! Alarma::hayAnuncio || ! Alarma::hayNotificacion ) {
+	  sinAviso++;
+	} else {
+	  anuncio.anyadir( ( Alarma::usAnuncio - Alarma::usSubida ) / 1000.0 );
+	  notificacion.anyadir( ( Alarma::usNotificacion - Alarma::usSubida ) / 1000.0 );
+	  peorIntervalo = std::max( peorIntervalo, Alarma::intervaloAnuncio );
+	}
+
+	// y vuelve a bajar: la alarma tiene que acabar sola
+	Alarma::usSubida = UINT64_MAX;
+	loop();
+	loop();
+	if ( Alarma::anunciandoAlarma && Bluefruit.Advertising.isRunning() ) {
+	  alarmasSinAcabar++;
+	}
+  } // for
+
+  printf( "periodo de publicación %u ms, %u subidas a unas 8.7 ppm (umbral %.1f ppm)\n",
+		  Globales::laConfiguracion.periodoPublicacionMs, subidas, (double) UMBRAL_ALARMA_PPM );
+  anuncio.escribir( "hasta el primer anuncio" );
+  notificacion.escribir( "hasta la primera notificación" );
+  bien &= sinAviso == 0;
+  printf( "subidas sin aviso: %u  %s\n", sinAviso, sinAviso == 0 ? "bien" : "MAL" );
+
+#ifdef ALARMA_OZONO
+  // de la lectura al anuncio: en la placa, lo que se tarda en calcular y empezar el anuncio
+  printf( "según el firmware: última latencia %u us, máxima %u us (aquí las cuentas no gastan tiempo), %u alarmas\n",
+		  Globales::laAlarma.getLatenciaUltimaUs(), Globales::laAlarma.getLatenciaMaximaUs(), Globales::laAlarma.getActivaciones() );
+
+  // lo que puede tardar: el periodo de vigilancia más el principio de la vuelta por el puerto serie
+  double limiteMs = PERIODO_VIGILANCIA_MS + 30;
+#ifdef ADQUISICION_SAADC
+  limiteMs += 1000.0 * AdquisicionSAADC::MUESTRAS_POR_BLOQUE / FRECUENCIA_SAADC; // las muestras llegan por bloques
+#endif
+  bool b = anuncio.maximo <= limiteMs && notificacion.maximo <= limiteMs;
+  bien &= b;
+  printf( "latencia máxima %.1f ms (hasta %.0f): %s\n", std::max( anuncio.maximo, notificacion.maximo ), limiteMs, b ? "bien" : "MAL" );
+  b = peorIntervalo == EmisoraBLE::INTERVALO_MINIMO;
+  bien &= b;
+  printf( "intervalo del anuncio de alarma %u (x 0.625 ms): %s\n", peorIntervalo, b ? "bien" : "MAL" );
+  b = alarmasSinAcabar == 0 && Globales::laAlarma.getActivaciones() == subidas;
+  bien &= b;
+  printf( "alarmas que no acaban al bajar el gas: %u  %s\n", alarmasSinAcabar, b ? "bien" : "MAL" );
+
+  printf( "\n%s\n", bien ? "OK: la alarma sale en cuanto se ve la subida y acaba sola" : "FALLO" );
+#else
+  printf( "\n%s\n", bien ? "OK (sin ALARMA_OZONO: sólo se ve en la medida siguiente)" : "FALLO" );
+#endif
+  return bien ? 0 : 1;
+} // ()
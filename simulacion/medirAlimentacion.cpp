@@ -0,0 +1,312 @@
+/*
+ * Nombre del fichero: medirAlimentacion.cpp
+ * Descripción: Compara en una traza grabada el frontal del sensor siempre encendido con la alimentación conmutada.
+ * Autores: agent
+ * Fecha: 18 de octubre de 2026
+ *
+ * Este archivo ha sido realizado por agent.
+ * Pasa cada muestra de la traza por Medidor::medirGas() (el de la placa) con el frontal
+ * siempre encendido (una lectura de cada pin, lo de siempre) y con usarAlimentacionConmutada()
+ * (ver EncendidoSensor.h): con varias esperas fijas y con la aprendida. La traza es el valor
+ * asentado; el frontal simulado sale de 0 al encenderlo y llega a él como una exponencial
+ * (vgas con la constante de tiempo que se pase, vref cuatro veces más deprisa), y cada lectura
+ * lleva ruido gaussiano. Escribe, para cada forma, el tiempo encendido y las lecturas del ADC
+ * por medida, la energía del frontal y del ADC por medida, lo que se ahorra frente a tenerlo
+ * siempre encendido y el error de las ppm frente a la traza sin ruido (sesgo, valor cuadrático
+ * medio y máximo). Con la espera aprendida, cuánto se aprende frente a lo que de verdad tarda
+ * vgas - vref en quedarse a menos de una cuenta. Por último, la aprendida con una vigilancia
+ * (Medidor::vigilarGas()) cada 50 ms entre medidas, como la de ALARMA_OZONO en loop(): cada
+ * una enciende el frontal y espera a que se asiente, así que se escribe cada cuánto sale de
+ * verdad y el tiempo encendido, y se comprueba que las vigilancias no aprenden (por eso
+ * ALARMA_OZONO sin TAREAS_FREERTOS no se compila con ALIMENTACION_CONMUTADA).
+ *
+ * Es un modelo de primer orden: un sensor electroquímico de verdad puede tardar mucho más
+ * en polarizarse al encenderlo (para eso se aprende la espera en la placa y se ve con la
+ * orden "sensor" de la consola). El consumo del micro mientras espera no se cuenta: es el
+ * mismo esperando a la siguiente medida.
+ *
+ * Compilar (desde esta carpeta):
+ *   g++ -O2 -std=c++17 -I. medirAlimentacion.cpp -o medirAlimentacion
+ * Uso:
+ *   ./medirAlimentacion traza [constante de tiempo (ms)] [ruido (cuentas)] [consumo del frontal (uA)]
+ *
+ * Todos los derechos reservados.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include <Arduino.h>
+#include "../Medidor.h"
+#include "LectorTraza.h"
+
+const uint8_t PIN_GAS = 28; // los de HolaMundoIBeacon.ino
+const uint8_t PIN_REF = 29;
+const uint8_t PIN_ALIMENTACION = 27;
+const uint8_t MUESTRAS_RAFAGA = 8;
+
+const double TENSION = 3.3;        // V
+const double US_POR_LECTURA = 20;  // lo que tarda cada analogRead() (10 bits)
+const double UA_ADC = 700;         // lo que gasta el ADC mientras convierte
+const double NJ_POR_LECTURA = TENSION * UA_ADC * US_POR_LECTURA / 1000.0;
+
+// ----------------------------------------------------------
+// el frontal simulado: lo que devuelve analogRead()
+// ----------------------------------------------------------
+namespace Frontal {
+  double agas = 0;             ///< Valor asentado (el de la traza).
+  double aref = 0;
+  double tauGasUs = 30000;
+  double ruido = 1.0;
+  bool siempreEncendido = true;
+  bool encendido = false;
+  uint64_t usEncendido = 0;
+  uint64_t lecturas = 0;
+  std::mt19937 azar( 48 );
+  std::normal_distribution<double> normal( 0.0, 1.0 );
+
+  void alEscribirPin( uint8_t pin, uint8_t valor ) {
+	if ( pin != PIN_ALIMENTACION ) {
+	  return;
+	}
+	if ( valor == HIGH && ! encendido ) {
+	  usEncendido = Simulacion::relojUs;
+	}
+	encendido = valor == HIGH;
+  } // ()
+
+  /// Lo que ve el pin si no hubiera ruido.
+  double valor( uint8_t pin, uint64_t us ) {
+	double asentado = pin == PIN_GAS ? agas : aref;
+	if ( siempreEncendido ) {
+	  return asentado;
+	}
+	if ( ! encendido ) {
+	  return 0;
+	}
+	double tau = pin == PIN_GAS ? tauGasUs : tauGasUs / 4;
+	return asentado * ( 1 - std::exp( - (double) ( us - usEncendido ) / tau ) );
+  } // ()
+
+  int fuente( uint8_t pin ) {
+	lecturas++;
+	Simulacion::relojUs += (uint64_t) US_POR_LECTURA;
+	double v = valor( pin, Simulacion::relojUs ) + ruido * normal( azar );
+	long a = std::lround( v );
+	return a < 0 ? 0 : ( a > 1023 ? 1023 : (int) a );
+  } // ()
+}; // namespace
+
+struct Resultado {
+  double msEncendido = 0;     ///< Por medida.
+  double lecturasPorMedida = 0;
+  double ujPorMedida = 0;
+  double sesgo = 0;           ///< ppm
+  double errorPpm = 0;        ///< Valor cuadrático medio, ppm.
+  double errorMaximo = 0;     ///< ppm
+  uint16_t msAprendidos = 0;
+  uint16_t ultimoAsentamiento = 0;
+  uint32_t aprendizajes = 0;
+  uint32_t sinConverger = 0;
+  uint32_t vigilancias = 0;
+  double msEntreVigilancias = 0; ///< De media, de una a la siguiente dentro de cada periodo.
+  double porcentajeEncendido = 0;
+}; // struct
+
+// ----------------------------------------------------------
+// Reproduce la traza con un Medidor nuevo
+// msAsentamiento < 0: siempre encendido; 0: espera aprendida
+// msVigilancia > 0: entre medida y medida, vigilarGas() cada msVigilancia (como esperarVigilando())
+// ----------------------------------------------------------
+static Resultado reproducir( const std::vector<TrazaADC::Muestra> & muestras, const std::vector<uint64_t> & tiempos,
+							 int msAsentamiento, double uaFrontal, uint32_t msVigilancia = 0 ) {
+  Resultado r;
+  Medidor medidor( PIN_GAS, PIN_REF );
+  Medidor limpio( PIN_GAS, PIN_REF );
+  medidor.iniciarMedidor();
+  Frontal::siempreEncendido = msAsentamiento < 0;
+  Frontal::encendido = false;
+  Frontal::lecturas = 0;
+  Frontal::azar.seed( 48 );
+  if ( msAsentamiento >= 0 ) {
+	medidor.usarAlimentacionConmutada( PIN_ALIMENTACION, EncendidoSensor( (uint16_t) msAsentamiento ), MUESTRAS_RAFAGA );
+  }
+  Simulacion::relojUs = 0;
+
+  double suma = 0, sumaCuadrados = 0;
+  uint32_t sumaIntervalos = 0;
+  for ( size_t i = 0; i < muestras.size(); i++ ) {
+	if ( Simulacion::relojUs < tiempos[i] ) {
+	  Simulacion::relojUs = tiempos[i];
+	}
+	Frontal::agas = muestras[i].agas;
+	Frontal::aref = muestras[i].aref;
+
+	double error = medidor.medirGas() - limpio.medirGas( muestras[i].agas, muestras[i].aref );
+	suma += error;
+	sumaCuadrados += error * error;
+	if ( std::fabs( error ) > r.errorMaximo ) {
+	  r.errorMaximo = std::fabs( error );
+	}
+
+	// vigilancias hasta la siguiente medida: cada una, en cuanto han pasado msVigilancia desde la anterior
+	uint64_t usAnterior = 0;
+	bool hayAnterior = false;
+	while ( msVigilancia > 0 && i + 1 < muestras.size() && Simulacion::relojUs < tiempos[i + 1] ) {
+	  uint64_t usVigilancia = Simulacion::relojUs;
+	  medidor.vigilarGas();
+	  r.vigilancias++;
+	  if ( hayAnterior ) {
+		r.msEntreVigilancias += ( usVigilancia - usAnterior ) / 1000.0;
+		sumaIntervalos++;
+	  }
+	  usAnterior = usVigilancia;
+	  hayAnterior = true;
+	  uint64_t usSiguiente = usVigilancia + (uint64_t) msVigilancia * 1000;
+	  if ( Simulacion::relojUs < usSiguiente ) {
+		Simulacion::relojUs = usSiguiente;
+	  }
+	} // while
+  } // for
+
+  size_t n = muestras.size();
+  double segundos = (double) ( tiempos.back() - tiempos.front() ) / 1e6;
+  const EncendidoSensor & e = medidor.getEncendido();
+  r.msEncendido = msAsentamiento < 0 ? segundos * 1000 / ( n - 1 ) : (double) e.getMsEncendido() / n;
+  r.lecturasPorMedida = (double) Frontal::lecturas / n;
+  r.ujPorMedida = TENSION * uaFrontal * r.msEncendido / 1000.0 + r.lecturasPorMedida * NJ_POR_LECTURA / 1000.0;
+  r.sesgo = suma / n;
+  r.errorPpm = std::sqrt( sumaCuadrados / n );
+  r.msAprendidos = e.getMsAsentamiento();
+  r.ultimoAsentamiento = e.getUltimoAsentamiento();
+  r.aprendizajes = e.getAprendizajes();
+  r.sinConverger = e.getSinConverger();
+  r.msEntreVigilancias = sumaIntervalos > 0 ? r.msEntreVigilancias / sumaIntervalos : 0;
+  r.porcentajeEncendido = 100.0 * r.msEncendido * ( n - 1 ) / ( segundos * 1000 );
+  return r;
+} // ()
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+static void comprobar( bool bien, const char * que ) {
+  printf( "  %-62s %s\n", que, bien ? "bien" : "MAL" );
+} // ()
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+int main( int argc, char * argv[] ) {
+  if ( argc < 2 ) {
+	fprintf( stderr, "uso: %s traza [constante de tiempo (ms)] [ruido (cuentas)] [consumo del frontal (uA)]\n", argv[0] );
+	return 2;
+  }
+  double tauMs = argc > 2 ? atof( argv[2] ) : 30;
+  Frontal::ruido = argc > 3 ? atof( argv[3] ) : 1.0;
+  double uaFrontal = argc > 4 ? atof( argv[4] ) : 400;
+  Frontal::tauGasUs = tauMs * 1000;
+
+  std::vector<uint8_t> traza;
+  if ( ! cargarTraza( argv[1], traza ) ) {
+	fprintf( stderr, "no se puede leer la traza %s\n", argv[1] );
+	return 1;
+  }
+  TrazaADC::Decodificador decodificador( traza.data(), traza.size() );
+  if ( decodificador.bitsADC() == 0 ) {
+	fprintf( stderr, "cabecera de traza no válida\n" );
+	return 1;
+  }
+  std::vector<TrazaADC::Muestra> muestras;
+  std::vector<uint64_t> tiempos;
+  TrazaADC::Muestra m;
+  int maximaDiferencia = 0;
+  while ( decodificador.siguiente( m ) ) {
+	if ( m.aref == TrazaADC::SIN_REFERENCIA ) {
+	  continue; // sin Vref no hay con qué comparar
+	}
+	muestras.push_back( m );
+	tiempos.push_back( decodificador.tiempoAbsoluto() );
+	maximaDiferencia = std::max( maximaDiferencia, std::abs( m.agas - m.aref ) );
+  }
+  if ( muestras.size() < 2 ) {
+	fprintf( stderr, "la traza no tiene muestras\n" );
+	return 1;
+  }
+
+  Simulacion::salidaSerie = nullptr; // medirGas() escribe por el puerto serie
+  Simulacion::fuenteADC = Frontal::fuente;
+  Simulacion::alEscribirPin = Frontal::alEscribirPin;
+
+  // lo que tarda de verdad vgas - vref en quedarse a menos de una cuenta (la peor muestra)
+  double msVerdaderos = 0;
+  for ( double ms = 0; ms < 100 * tauMs; ms += 0.1 ) {
+	double g = std::exp( - ms / tauMs ), r = std::exp( - 4 * ms / tauMs );
+	bool asentado = true;
+	for ( const TrazaADC::Muestra & s : muestras ) {
+	  if ( std::fabs( s.agas * g - s.aref * r ) > 1.0 ) {
+		asentado = false;
+		break;
+	  }
+	}
+	if ( asentado ) {
+	  msVerdaderos = ms;
+	  break;
+	}
+  } // for
+
+  printf( "%zu medidas (%.1f s entre medidas), vgas - vref hasta %d cuentas\n", muestras.size(),
+		  (double) ( tiempos.back() - tiempos.front() ) / 1e6 / ( muestras.size() - 1 ), maximaDiferencia );
+  printf( "frontal: constante de tiempo %.1f ms (vref %.1f ms), ruido %.2f cuentas, %.0f uA a %.1f V; ADC %.0f nJ por lectura\n",
+		  tauMs, tauMs / 4, Frontal::ruido, uaFrontal, TENSION, NJ_POR_LECTURA );
+  printf( "a menos de una cuenta a los %.1f ms de encender\n\n", msVerdaderos );
+  printf( "%-14s %10s %12s %10s %12s %10s %10s %12s %12s\n", "frontal", "espera ms", "ms encendido", "ADC/medida",
+		  "uJ/medida", "ahorro %", "sesgo ppm", "error ppm", "máximo ppm" );
+
+  Resultado continuo = reproducir( muestras, tiempos, -1, uaFrontal );
+  printf( "%-14s %10s %12.1f %10.2f %12.2f %10s %10.4f %12.4f %12.4f\n", "siempre", "-", continuo.msEncendido,
+		  continuo.lecturasPorMedida, continuo.ujPorMedida, "-", continuo.sesgo, continuo.errorPpm, continuo.errorMaximo );
+
+  const double FIJAS[] = { 0.5, 1, 2, 4, 8 }; // x la constante de tiempo
+  Resultado corta;
+  for ( double f : FIJAS ) {
+	int ms = (int) std::lround( f * tauMs );
+	if ( ms < 1 ) {
+	  ms = 1;
+	}
+	Resultado r = reproducir( muestras, tiempos, ms, uaFrontal );
+	if ( f == FIJAS[0] ) {
+	  corta = r;
+	}
+	printf( "%-14s %10d %12.1f %10.2f %12.2f %10.2f %10.4f %12.4f %12.4f\n", "conmutado", ms, r.msEncendido,
+			r.lecturasPorMedida, r.ujPorMedida, 100 * ( 1 - r.ujPorMedida / continuo.ujPorMedida ), r.sesgo, r.errorPpm,
+			r.errorMaximo );
+  } // for
+
+  Resultado aprendida = reproducir( muestras, tiempos, 0, uaFrontal );
+  double ahorro = 100 * ( 1 - aprendida.ujPorMedida / continuo.ujPorMedida );
+  printf( "%-14s %10u %12.1f %10.2f %12.2f %10.2f %10.4f %12.4f %12.4f\n", "aprendida", aprendida.msAprendidos,
+		  aprendida.msEncendido, aprendida.lecturasPorMedida, aprendida.ujPorMedida, ahorro, aprendida.sesgo,
+		  aprendida.errorPpm, aprendida.errorMaximo );
+  printf( "\naprendida: convergió a los %u ms la última vez (de verdad %.1f ms), %u aprendizajes, %u sin converger\n\n",
+		  aprendida.ultimoAsentamiento, msVerdaderos, aprendida.aprendizajes, aprendida.sinConverger );
+
+  comprobar( aprendida.ultimoAsentamiento >= 0.6 * msVerdaderos && aprendida.ultimoAsentamiento <= 2 * msVerdaderos + 10,
+			 "la espera aprendida se acerca a la de verdad" );
+  comprobar( aprendida.sinConverger == 0, "siempre converge antes del máximo" );
+  comprobar( aprendida.errorPpm <= continuo.errorPpm, "con la ráfaga, no más error que siempre encendido" );
+  comprobar( corta.errorPpm > 2 * aprendida.errorPpm, "esperar poco se nota (la espera importa)" );
+  comprobar( ahorro >= 90, "el frontal gasta menos de una décima parte" );
+
+  const uint32_t MS_VIGILANCIA = 50; // PERIODO_VIGILANCIA_MS
+  Resultado vigilada = reproducir( muestras, tiempos, 0, uaFrontal, MS_VIGILANCIA );
+  printf( "\naprendida y vigilando cada %u ms: encendido el %.1f %% del tiempo (sin vigilar, el %.1f %%), %.1f ms por medida,\n"
+		  "  %u vigilancias, una cada %.1f ms de media; %u aprendizajes (sin vigilar, %u)\n\n",
+		  MS_VIGILANCIA, vigilada.porcentajeEncendido, aprendida.porcentajeEncendido, vigilada.msEncendido,
+		  vigilada.vigilancias, vigilada.msEntreVigilancias, vigilada.aprendizajes, aprendida.aprendizajes );
+  comprobar( vigilada.vigilancias > 0 && vigilada.aprendizajes == aprendida.aprendizajes,
+			 "las vigilancias no aprenden ni adelantan el aprendizaje" );
+  comprobar( vigilada.msEntreVigilancias > MS_VIGILANCIA && vigilada.porcentajeEncendido > 10 * aprendida.porcentajeEncendido,
+			 "vigilar con el frontal conmutado se come el ahorro" );
+  return 0;
+} // ()
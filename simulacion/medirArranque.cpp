@@ -0,0 +1,69 @@
+/*
+ * Nombre del fichero: medirArranque.cpp
+ * Descripción: Mide en la simulación cuánto tarda el nodo en emitir su primer anuncio.
+ * Autores: agent
+ * Fecha: 18 de octubre de 2026
+ *
+ * Este archivo ha sido realizado por agent.
+ * Compila el firmware, simula que el ordenador se conecta por USB un tiempo después de
+ * encender la placa (o nunca) y ejecuta setup() y loop() sobre el reloj virtual hasta el
+ * primer anuncio. Escribe el tiempo hasta el primer anuncio y hasta el fin de setup().
+ *
+ * Se compila dos veces para comparar los dos arranques:
+ *   g++ -O2 -std=c++17 -I. medirArranque.cpp -o medirArranque
+ *   g++ -O2 -std=c++17 -I. -DARRANQUE_RAPIDO medirArranque.cpp -o medirArranqueRapido
+ * Uso:
+ *   ./medirArranque [ms hasta que se conecta el USB (-1 = nunca)]
+ *
+ * Todos los derechos reservados.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+
+#include <Arduino.h>
+#include "../HolaMundoIBeacon.ino"
+
+namespace Arranque {
+  bool hayAnuncio = false;
+  uint64_t usPrimerAnuncio = 0;
+
+  void alEmpezarAnuncio( const uint8_t *, uint8_t, int8_t ) {
+	if ( ! hayAnuncio ) {
+	  hayAnuncio = true;
+	  usPrimerAnuncio = Simulacion::relojUs;
+	}
+  } // ()
+}; // namespace
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+int main( int argc, char * argv[] ) {
+  long msUSB = argc > 1 ? atol( argv[1] ) : 500;
+
+#ifdef ARRANQUE_RAPIDO
+  const char * modo = "rápido";
+#else
+  const char * modo = "normal";
+  if ( msUSB < 0 ) {
+	// while ( !Serial ) no acabaría nunca
+	printf( "arranque normal sin USB: setup() no termina nunca y no hay ningún anuncio\n" );
+	return 1;
+  }
+#endif
+
+  Simulacion::usSerieDisponible = msUSB < 0 ? UINT64_MAX : (uint64_t) msUSB * 1000;
+  Simulacion::salidaSerie = nullptr;
+  Simulacion::alEmpezarAnuncio = Arranque::alEmpezarAnuncio;
+
+  setup();
+  uint64_t usSetup = Simulacion::relojUs;
+  while ( ! Arranque::hayAnuncio ) {
+	loop();
+  }
+
+  printf( "arranque %s, USB a los %ld ms: primer anuncio a los %.1f ms, fin de setup() a los %.1f ms\n",
+		  modo, msUSB, Arranque::usPrimerAnuncio / 1000.0, usSetup / 1000.0 );
+  printf( "(según el firmware: primer anuncio a los %lu us)\n", Globales::elPublicador.laEmisora.getTiempoPrimerAnuncio() );
+  return 0;
+} // ()
@@ -0,0 +1,278 @@
+/*
+ * Nombre del fichero: medirConsola.cpp
+ * Descripción: Comprueba en la simulación la consola serie del nodo.
+ * Autores: agent
+ * Fecha: 18 de octubre de 2026
+ *
+ * Este archivo ha sido realizado por agent.
+ * Primero pasa por ConsolaSerie un chorro de bytes (órdenes, basura y líneas demasiado
+ * largas) y mide con el reloj del ordenador lo que tarda cada atender(): cuántos bytes
+ * saca y cuántas órdenes ejecuta cada vez, y el peor tiempo. Luego compila el firmware con
+ * CONSOLA_SERIE, ejecuta setup() y loop() sobre el reloj virtual y teclea órdenes entre
+ * anuncios (Simulacion::teclear()), con lo que escribe Serial en un fichero temporal:
+ * comprueba que el periodo cambia, que "registro 0" calla el bucle, que la traza pedida
+ * se decodifica (LectorTraza.h) con las muestras pedidas y que tiempos, banco y ayuda
+ * contestan. En la simulación micros() es el reloj virtual, así que los tiempos que da el
+ * propio nodo sólo son los que avanza la simulación; los de verdad son los de la primera parte.
+ *
+ * Compilar:
+ *   g++ -O2 -std=c++17 -I. medirConsola.cpp -o medirConsola
+ * Uso:
+ *   ./medirConsola
+ *
+ * Todos los derechos reservados.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#define CONSOLA_SERIE
+#include <Arduino.h>
+#include "../HolaMundoIBeacon.ino"
+#include "../TrazaADC.h"
+#include "LectorTraza.h"
+
+// ----------------------------------------------------------
+// la consola sola, con bytes que salen de un vector
+// ----------------------------------------------------------
+namespace Banco {
+  std::string entrada;
+  size_t posicion = 0;
+  uint32_t leidosEstaVez = 0;
+  uint32_t ordenesEstaVez = 0;
+  uint32_t ordenes = 0;
+
+  int leer() {
+	if ( posicion >= entrada.size() ) {
+	  return -1;
+	}
+	leidosEstaVez++;
+	return (uint8_t) entrada[ posicion++ ];
+  } // ()
+
+  void escribir( const char * ) {
+  } // ()
+
+  void orden( uint8_t, char * const * argumentos ) {
+	uint32_t v;
+	ConsolaSerie::leerNumero( argumentos[0], v ); // algo de trabajo, como las de verdad
+	ordenesEstaVez++;
+	ordenes++;
+  } // ()
+}; // namespace
+
+// ----------------------------------------------------------
+// el firmware: órdenes tecleadas entre anuncios
+// ----------------------------------------------------------
+namespace Consola {
+  const char * pendiente = nullptr;
+
+  void alAvanzar( uint64_t, uint64_t ) {
+	if ( pendiente != nullptr && ! Globales::elPublicador.laEmisora.estaAnunciando() ) {
+	  Simulacion::teclear( pendiente );
+	  pendiente = nullptr;
+	}
+  } // ()
+
+  uint32_t atendidas() {
+	return Globales::laConsola.getLineas() + Globales::laConsola.getDesconocidas() + Globales::laConsola.getLargas();
+  } // ()
+
+  // teclea una línea y da vueltas hasta que la consola la ha atendido
+  bool teclear( const char * linea, uint32_t maximoVueltas = 3 ) {
+	uint32_t antes = atendidas();
+	pendiente = linea;
+	for ( uint32_t i = 0; i < maximoVueltas && atendidas() == antes; i++ ) {
+	  loop();
+	}
+	return atendidas() == antes + 1;
+  } // ()
+
+  void vueltas( uint32_t n ) {
+	for ( uint32_t i = 0; i < n; i++ ) {
+	  loop();
+	}
+  } // ()
+
+  // lo escrito por Serial desde la posición desde
+  std::string leerDesde( FILE * f, long desde ) {
+	fflush( f );
+	long hasta = ftell( f );
+	std::string s( (size_t) ( hasta - desde ), '\0' );
+	fseek( f, desde, SEEK_SET );
+	size_t n = fread( &s[0], 1, s.size(), f );
+	s.resize( n );
+	fseek( f, hasta, SEEK_SET );
+	return s;
+  } // ()
+
+  bool contiene( const std::string & s, const char * texto ) {
+	return s.find( texto ) != std::string::npos;
+  } // ()
+}; // namespace
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+int main() {
+  bool bien = true;
+
+  // --- la consola sola ---
+  ConsolaSerie consola( Banco::escribir );
+  consola.anyadirOrden( "periodo", "<ms>", Banco::orden );
+  consola.anyadirOrden( "registro", "<n>", Banco::orden );
+
+  uint32_t semilla = 12345;
+  auto aleatorio = [&]() { semilla = semilla * 1103515245 + 12345; return semilla >> 16; };
+  const char * trozos[] = { "periodo 3000\n", "registro 1\r\n", "nada de nada\n", "\n",
+							"periodo 123456789012345678901234567890123456789012345\n", "\xff\x01 registro\n" };
+  uint32_t esperadas = 0;
+  for ( int i = 0; i < 20000; i++ ) {
+	uint32_t k = aleatorio() % 6;
+	Banco::entrada += trozos[k];
+	esperadas += k <= 1 ? 1 : 0;
+  }
+
+  std::vector<double> ns;
+  uint32_t maxLeidos = 0;
+  uint32_t maxOrdenes = 0;
+  while ( Banco::posicion < Banco::entrada.size() ) {
+	Banco::leidosEstaVez = 0;
+	Banco::ordenesEstaVez = 0;
+	auto t0 = std::chrono::steady_clock::now();
+	consola.atender( Banco::leer );
+	auto t1 = std::chrono::steady_clock::now();
+	ns.push_back( std::chrono::duration<double, std::nano>( t1 - t0 ).count() );
+	maxLeidos = std::max( maxLeidos, Banco::leidosEstaVez );
+	maxOrdenes = std::max( maxOrdenes, Banco::ordenesEstaVez );
+  }
+  std::sort( ns.begin(), ns.end() );
+  double p50 = ns[ ns.size() / 2 ];
+  double p99 = ns[ ns.size() * 99 / 100 ];
+  printf( "consola: %zu bytes en %zu llamadas a atender(): ns p50 %.0f, p99 %.0f, máx %.0f\n",
+		  Banco::entrada.size(), ns.size(), p50, p99, ns.back() );
+
+  bool b = maxLeidos <= ConsolaSerie::MAXIMO_BYTES_POR_VUELTA && maxOrdenes <= 1;
+  bien &= b;
+  printf( "como mucho %u bytes (%u) y %u orden (1) por llamada: %s\n", maxLeidos, ConsolaSerie::MAXIMO_BYTES_POR_VUELTA,
+		  maxOrdenes, b ? "bien" : "MAL" );
+
+  b = Banco::ordenes == esperadas && consola.getLineas() == esperadas && consola.getLargas() > 0 && consola.getDesconocidas() > 0;
+  bien &= b;
+  printf( "órdenes %u de %u, desconocidas %u, largas %u: %s\n", Banco::ordenes, esperadas,
+		  consola.getDesconocidas(), consola.getLargas(), b ? "bien" : "MAL" );
+
+  b = p99 < 10000;
+  bien &= b;
+  printf( "p99 por debajo de 10 us: %s\n", b ? "bien" : "MAL" );
+
+  // --- el firmware ---
+  char nombre[] = "/tmp/medirConsolaXXXXXX";
+  int fd = mkstemp( nombre );
+  FILE * f = fd >= 0 ? fdopen( fd, "w+b" ) : nullptr;
+  if ( f == nullptr ) {
+	fprintf( stderr, "no se puede crear el fichero temporal\n" );
+	return 1;
+  }
+  Simulacion::salidaSerie = f;
+  Simulacion::alAvanzar = Consola::alAvanzar;
+
+  setup();
+  Consola::vueltas( 3 );
+
+  // el periodo
+  long desde = ftell( f );
+  b = Consola::teclear( "periodo 2000\n" ) && Consola::teclear( "tiempos borrar\n" );
+  Consola::vueltas( 4 );
+  b = b && Globales::laConfiguracion.periodoPublicacionMs == 2000
+	&& Globales::tiempoVuelta.getMinimo() >= 2000 && Globales::tiempoVuelta.getMaximo() < 2100;
+  std::string s = Consola::leerDesde( f, desde );
+  b = b && Consola::contiene( s, "periodo: vale" );
+  bien &= b;
+  printf( "periodo 2000: vueltas de %u a %u ms: %s\n", Globales::tiempoVuelta.getMinimo(),
+		  Globales::tiempoVuelta.getMaximo(), b ? "bien" : "MAL" );
+
+  // un periodo que no vale no cambia nada
+  desde = ftell( f );
+  b = Consola::teclear( "periodo 10\n" );
+  Consola::vueltas( 2 );
+  s = Consola::leerDesde( f, desde );
+  b = b && Consola::contiene( s, "periodo: no vale" ) && Globales::laConfiguracion.periodoPublicacionMs == 2000;
+  bien &= b;
+  printf( "periodo 10 rechazado: %s\n", b ? "bien" : "MAL" );
+
+  // registro 0: el bucle calla, la consola no
+  b = Consola::teclear( "registro 0\n" );
+  desde = ftell( f );
+  Consola::vueltas( 5 );
+  b = b && Consola::teclear( "tiempos\n" );
+  s = Consola::leerDesde( f, desde );
+  bool callado = ! Consola::contiene( s, "loop()" ) && ! Consola::contiene( s, "VGAS:" );
+  b = b && callado && Consola::contiene( s, "tiempos: vuelta (ms)" ) && Consola::contiene( s, "tiempos: consola (us)" );
+  bien &= b;
+  printf( "registro 0: %zu bytes en 5 vueltas, sin bucle: %s\n", s.size(), b ? "bien" : "MAL" );
+
+  // una traza de 8 lecturas (una por vuelta) y otra de 4, cada una con su cabecera
+  b = Consola::teclear( "traza 8\n" );
+  Consola::vueltas( 10 );
+  b = b && Consola::teclear( "traza 4\n" );
+  Consola::vueltas( 6 );
+  fflush( f );
+  size_t muestras[2] = { 0, 0 };
+  size_t sinReferencia = 0;
+  bool arefBien = true;
+  for ( unsigned numero = 1; numero <= 2; numero++ ) {
+	std::vector<uint8_t> traza;
+	if ( cargarTraza( nombre, traza, numero ) ) {
+	  TrazaADC::Decodificador d( traza.data(), traza.size() );
+	  TrazaADC::Muestra m;
+	  while ( d.bitsADC() > 0 && d.siguiente( m ) ) {
+		muestras[numero - 1]++;
+		if ( m.aref == TrazaADC::SIN_REFERENCIA ) {
+		  sinReferencia++;
+		} else {
+		  arefBien &= m.aref < ( 1u << d.bitsADC() );
+		}
+	  }
+	}
+  }
+  b = b && muestras[0] == 8 && muestras[1] == 4 && arefBien;
+#ifdef REFERENCIA_LENTA
+  b = b && sinReferencia > 0; // la referencia lenta no lee Vref en cada medida
+#else
+  b = b && sinReferencia == 0;
+#endif
+  bien &= b;
+  printf( "traza 8 y traza 4: %zu y %zu muestras decodificadas (%zu sin Vref): %s\n",
+		  muestras[0], muestras[1], sinReferencia, b ? "bien" : "MAL" );
+
+  // banco, ayuda, una orden que no existe y una línea demasiado larga
+  desde = ftell( f );
+  b = Consola::teclear( "banco 200\n" ) && Consola::teclear( "ayuda\n" ) && Consola::teclear( "hola\n" )
+	&& Consola::teclear( "periodo 00000000000000000000000000000000000000002000\n" );
+  s = Consola::leerDesde( f, desde );
+  b = b && Consola::contiene( s, "banco: conversión" ) && Consola::contiene( s, "banco: trama" )
+	&& Consola::contiene( s, "banco: anuncio" ) && Consola::contiene( s, "órdenes:" )
+	&& Consola::contiene( s, "no conozco la orden hola" ) && Consola::contiene( s, "demasiado larga" );
+  bien &= b;
+  printf( "banco, ayuda, orden desconocida y línea larga: %s\n", b ? "bien" : "MAL" );
+
+  // y el registro vuelve
+  b = Consola::teclear( "registro 2\n" );
+  desde = ftell( f );
+  Consola::vueltas( 2 );
+  s = Consola::leerDesde( f, desde );
+  b = b && Consola::contiene( s, "loop(): empieza" );
+  bien &= b;
+  printf( "registro 2: vuelve el bucle: %s\n", b ? "bien" : "MAL" );
+
+  fclose( f );
+  remove( nombre );
+
+  printf( "\n%s\n", bien ? "OK: la consola atiende órdenes sin parar el nodo y cada vuelta le cuesta poco" : "FALLO" );
+  return bien ? 0 : 1;
+} // ()
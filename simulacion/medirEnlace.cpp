@@ -0,0 +1,270 @@
+/*
+ * Nombre del fichero: medirEnlace.cpp
+ * Descripción: Mide en la simulación lo que tarda un volcado con una central antigua y con una moderna.
+ * Autores: agent
+ * Fecha: 18 de octubre de 2026
+ *
+ * Este archivo ha sido realizado por agent.
+ * Compila el firmware con GESTIONAR_CONEXIONES y ENLACE_RAPIDO, llena el historial y
+ * conecta, una detrás de otra, dos centrales que se suscriben al volcado: una antigua
+ * (1 Mbps, paquetes de 27 bytes, MTU 23 y 30 ms de intervalo como mínimo) y una moderna
+ * (admite todo el perfil de rendimiento). La radio se simula por eventos de conexión:
+ * en cada intervalo caben los paquetes que dé tiempo a enviar (cabeceras, 150 us entre
+ * paquete y paquete y el paquete vacío de la central) en lo que dura el evento, y al
+ * final del evento se completan las notificaciones que han salido enteras.
+ * Comprueba que las dos reciben el historial entero y en orden, que con la antigua se
+ * queda en lo que hay (sin fallar) y con la moderna se negocia todo, que la moderna
+ * va al menos 10 veces más rápido, que al acabar las dos pasan al perfil de bajo consumo
+ * y que notify() nunca habría bloqueado. Escribe también lo que ha escrito el firmware.
+ *
+ * Compilar:
+ *   g++ -O2 -std=c++17 -I. medirEnlace.cpp -o medirEnlace
+ * Uso:
+ *   ./medirEnlace
+ *
+ * Todos los derechos reservados.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+
+#define GESTIONAR_CONEXIONES
+#define ENLACE_RAPIDO
+#include <Arduino.h>
+#include "../HolaMundoIBeacon.ino"
+
+// ----------------------------------------------------------
+// una central simulada y lo que recibe del volcado
+// ----------------------------------------------------------
+struct Central {
+  const char * nombre;
+  uint16_t connHandle;
+  uint8_t phys;              ///< Las que admite.
+  uint16_t longitudDatos;    ///< Lo más que admite.
+  uint16_t mtu;
+  uint16_t intervaloMinimo;  ///< x 1.25 ms
+
+  std::deque<uint16_t> enVuelo = {};  ///< Bytes que le quedan a cada notificación por salir.
+  uint64_t usSiguienteEvento = 0;
+
+  uint32_t registros = 0;
+  uint32_t bytes = 0;
+  bool enOrden = true;
+  bool fin = false;
+  uint32_t msAnterior = 0;
+  uint64_t usPrimerTrozo = 0;
+  uint64_t usFin = 0;
+  EmisoraBLE::ParametrosEnlace duranteVolcado = {};
+};
+
+namespace Enlace {
+  Central * conectada = nullptr;
+
+  // tiempo en el aire de un paquete del enlace con p bytes de datos (preámbulo,
+  // dirección, cabecera y CRC: 10 bytes a 1 Mbps y 11 a 2 Mbps, con preámbulo de 2)
+  uint32_t usPaquete( uint8_t phy, uint16_t p ) {
+	return phy == BLE_GAP_PHY_2MBPS ? ( 11 + p ) * 4 : ( 10 + p ) * 8;
+  } // ()
+
+  // un paquete con datos, la respuesta vacía de la central y los dos huecos de 150 us
+  uint32_t usIntercambio( uint8_t phy, uint16_t p ) {
+	return usPaquete( phy, p ) + 150 + usPaquete( phy, 0 ) + 150;
+  } // ()
+
+  // un evento de conexión: salen los paquetes que caben en lo que dura
+  void evento( Central & c ) {
+	BLEConnection * conexion = Bluefruit.Connection( c.connHandle );
+	uint32_t usEvento = 1250u * std::min<uint16_t>( conexion->getConnectionInterval(), Bluefruit.getEventLength() );
+	uint32_t usGastado = 0;
+	uint8_t completas = 0;
+	while ( ! c.enVuelo.empty() ) {
+	  uint16_t p = std::min<uint16_t>( c.enVuelo.front(), conexion->getDataLength() );
+	  uint32_t us = usIntercambio( conexion->getPHY(), p );
+	  if ( usGastado + us > usEvento ) {
+		break;
+	  }
+	  usGastado += us;
+	  c.enVuelo.front() -= p;
+	  if ( c.enVuelo.front() == 0 ) {
+		c.enVuelo.pop_front();
+		completas++;
+	  }
+	}
+	if ( completas > 0 ) {
+	  Simulacion::completarNotificaciones( c.connHandle, completas );
+	}
+  } // ()
+
+  void alAvanzar( uint64_t, uint64_t usHasta ) {
+	Central * c = conectada;
+	if ( c == nullptr || Bluefruit.Connection( c->connHandle ) == nullptr ) {
+	  return;
+	}
+	while ( c->usSiguienteEvento <= usHasta ) {
+	  evento( *c );
+	  c->usSiguienteEvento += 1250u * Bluefruit.Connection( c->connHandle )->getConnectionInterval();
+	}
+  } // ()
+
+  void alNotificar( uint16_t connHandle, const uint8_t * datos, uint16_t longitud ) {
+	Central * c = conectada;
+	if ( c == nullptr || connHandle != c->connHandle ) {
+	  return;
+	}
+	c->enVuelo.push_back( longitud + 3 + 4 ); // cabeceras de ATT y de L2CAP
+	if ( longitud % HistorialMedidas::TAM_REGISTRO != 0 ) {
+	  return; // las de lecturas (4 bytes); los trozos del volcado son de registros enteros
+	}
+	if ( c->bytes == 0 ) {
+	  c->usPrimerTrozo = Simulacion::relojUs;
+	}
+	c->bytes += longitud;
+	for ( uint16_t i = 0; i < longitud; i += HistorialMedidas::TAM_REGISTRO ) {
+	  const uint8_t * r = &datos[i];
+	  uint32_t ms = TramaIBeacon::leerBE16( &r[0] ) << 16 | TramaIBeacon::leerBE16( &r[2] );
+	  if ( ms == 0xffffffff && r[4] == 0xff ) {
+		if ( c->fin ) {
+		  c->enOrden = false; // dos veces
+		}
+		c->fin = true;
+		c->usFin = Simulacion::relojUs;
+		Globales::elPublicador.laEmisora.getParametrosEnlace( connHandle, c->duranteVolcado );
+		continue;
+	  }
+	  if ( c->fin || r[4] != Publicador::CO2 || ( c->registros > 0 && ms <= c->msAnterior ) ) {
+		c->enOrden = false;
+	  }
+	  c->msAnterior = ms;
+	  c->registros++;
+	}
+  } // ()
+
+  // ¿le queda a alguna el perfil de rendimiento?
+  bool perfilRapido() {
+	for ( const Globales::PerfilEnlace & p : Globales::losPerfiles ) {
+	  if ( p.rapido ) {
+		return true;
+	  }
+	}
+	return false;
+  } // ()
+
+  // conecta la central, se suscribe a todo y espera a que acabe el volcado
+  bool volcar( Central & c ) {
+	conectada = &c;
+	Simulacion::conectar( c.connHandle, BLE_GATT_ATT_MTU_DEFAULT );
+	BLEConnection & conexion = Bluefruit.conexionSimulada( c.connHandle );
+	conexion.physCentral = c.phys;
+	conexion.longitudDatosCentral = c.longitudDatos;
+	conexion.mtuCentral = c.mtu;
+	conexion.intervaloMinimoCentral = c.intervaloMinimo;
+	c.usSiguienteEvento = Simulacion::relojUs;
+	BLECharacteristic & lecturas = Globales::laCaracteristicaLecturas;
+	BLECharacteristic & volcado = Globales::laCaracteristicaVolcado;
+	lecturas.simularSuscripcion( c.connHandle, true );
+	volcado.simularSuscripcion( c.connHandle, true );
+	for ( int vueltas = 0; vueltas < 40 && ! ( c.fin && ! perfilRapido() ); vueltas++ ) {
+	  loop();
+	}
+	return c.fin;
+  } // ()
+
+  void escribir( const Central & c ) {
+	const EmisoraBLE::ParametrosEnlace & p = c.duranteVolcado;
+	double ms = ( c.usFin - c.usPrimerTrozo ) / 1000.0;
+	printf( "%-8s %5u registros %6u B en %8.1f ms = %7.2f kB/s   phy %s, paquetes %3u B, mtu %3u, intervalo %5.2f ms\n",
+			c.nombre, c.registros, c.bytes, ms, ms > 0 ? c.bytes / ms : 0.0,
+			p.phy == BLE_GAP_PHY_2MBPS ? "2M" : "1M", p.longitudDatos, p.mtu, p.intervalo * 1.25 );
+  } // ()
+}; // namespace
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+int main() {
+  FILE * registro = tmpfile();
+  Simulacion::salidaSerie = registro;
+  Simulacion::alAvanzar = Enlace::alAvanzar;
+  Simulacion::alNotificar = Enlace::alNotificar;
+
+  setup();
+  // un historial lleno (como si llevara casi una hora midiendo)
+  for ( uint16_t i = 0; i < HistorialMedidas::CAPACIDAD; i++ ) {
+	uint8_t medida[TramasPublicador::CO2::TAM];
+	TramasPublicador::CO2::codificar( medida, Publicador::CO2, (uint8_t) i, ( i % 500 ) / 10.0 );
+	Globales::elHistorial.anyadir( millis(), medida );
+	Simulacion::avanzar( (uint64_t) Globales::laConfiguracion.periodoPublicacionMs * 1000 );
+  }
+
+  Central antigua = { "antigua", 0, BLE_GAP_PHY_1MBPS, BLE_GAP_DATA_LENGTH_DEFAULT, BLE_GATT_ATT_MTU_DEFAULT, 24 };
+  Central moderna = { "moderna", 1, BLE_GAP_PHY_1MBPS | BLE_GAP_PHY_2MBPS, BLE_GAP_DATA_LENGTH_MAX, BLE_GATT_ATT_MTU_MAX, 6 };
+
+  bool bien = true;
+  bool b = Enlace::volcar( antigua );
+  EmisoraBLE::ParametrosEnlace despuesAntigua;
+  Globales::elPublicador.laEmisora.getParametrosEnlace( antigua.connHandle, despuesAntigua );
+  uint32_t bloqueos = Bluefruit.conexionSimulada( antigua.connHandle ).bloqueos;
+  Simulacion::desconectar( antigua.connHandle );
+  loop();
+
+  b = Enlace::volcar( moderna ) && b;
+  EmisoraBLE::ParametrosEnlace despuesModerna;
+  Globales::elPublicador.laEmisora.getParametrosEnlace( moderna.connHandle, despuesModerna );
+  bloqueos += Bluefruit.conexionSimulada( moderna.connHandle ).bloqueos;
+
+  Enlace::escribir( antigua );
+  Enlace::escribir( moderna );
+
+  bien &= b;
+  printf( "volcados acabados: %s\n", b ? "bien" : "MAL" );
+
+  b = antigua.enOrden && moderna.enOrden && antigua.registros >= HistorialMedidas::CAPACIDAD
+	&& moderna.registros >= HistorialMedidas::CAPACIDAD;
+  bien &= b;
+  printf( "historial entero, en orden y con su fin: %s\n", b ? "bien" : "MAL" );
+
+  const EmisoraBLE::ParametrosEnlace & a = antigua.duranteVolcado;
+  const EmisoraBLE::ParametrosEnlace & m = moderna.duranteVolcado;
+  b = a.phy == BLE_GAP_PHY_1MBPS && a.longitudDatos == BLE_GAP_DATA_LENGTH_DEFAULT && a.mtu == BLE_GATT_ATT_MTU_DEFAULT
+	&& a.intervalo == antigua.intervaloMinimo
+	&& m.phy == BLE_GAP_PHY_2MBPS && m.longitudDatos == BLE_GAP_DATA_LENGTH_MAX && m.mtu == BLE_GATT_ATT_MTU_MAX
+	&& m.intervalo == EmisoraBLE::INTERVALO_CONEXION_RAPIDO;
+  bien &= b;
+  printf( "negociado: la antigua se queda en lo suyo, la moderna en todo el perfil: %s\n", b ? "bien" : "MAL" );
+
+  double kBsAntigua = antigua.bytes / ( ( antigua.usFin - antigua.usPrimerTrozo ) / 1000.0 );
+  double kBsModerna = moderna.bytes / ( ( moderna.usFin - moderna.usPrimerTrozo ) / 1000.0 );
+  b = kBsModerna >= 10 * kBsAntigua;
+  bien &= b;
+  printf( "la moderna %.1f veces más rápida: %s\n", kBsModerna / kBsAntigua, b ? "bien" : "MAL" );
+
+  b = despuesAntigua.intervalo == EmisoraBLE::INTERVALO_CONEXION_BAJO_CONSUMO && despuesAntigua.latencia == EmisoraBLE::LATENCIA_BAJO_CONSUMO
+	&& despuesModerna.intervalo == EmisoraBLE::INTERVALO_CONEXION_BAJO_CONSUMO && despuesModerna.latencia == EmisoraBLE::LATENCIA_BAJO_CONSUMO;
+  bien &= b;
+  printf( "después, bajo consumo: intervalo %.0f ms y latencia %u (la radio se despierta %.0f veces por segundo en vez de %.0f): %s\n",
+		  despuesModerna.intervalo * 1.25, despuesModerna.latencia,
+		  1000.0 / ( despuesModerna.intervalo * 1.25 * ( 1 + despuesModerna.latencia ) ), 1000.0 / ( m.intervalo * 1.25 ),
+		  b ? "bien" : "MAL" );
+
+  b = bloqueos == 0;
+  bien &= b;
+  printf( "veces que notify() habría bloqueado: %u  %s\n", bloqueos, b ? "bien" : "MAL" );
+
+  // lo que ha escrito el firmware de cada volcado
+  printf( "\nel firmware:\n" );
+  rewind( registro );
+  char linea[256];
+  uint8_t lineas = 0;
+  while ( fgets( linea, sizeof(linea), registro ) != nullptr ) {
+	if ( strncmp( linea, "volcado", 7 ) == 0 ) {
+	  printf( "  %s", linea );
+	  lineas++;
+	}
+  }
+  b = lineas == 2;
+  bien &= b;
+  printf( "%s\n", b ? "" : "MAL: tendría que haber una línea por volcado" );
+
+  printf( "%s\n", bien ? "OK: cada central vuelca con lo mejor que admite y luego vuelve al bajo consumo" : "FALLO" );
+  return bien ? 0 : 1;
+} // ()
@@ -0,0 +1,167 @@
+/*
+ * Nombre del fichero: medirFiltroBloques.cpp
+ * Descripción: Comprueba que FiltroBloques da lo mismo que FiltroMuestra y compara lo que tardan por muestra.
+ * Autores: agent
+ * Fecha: 18 de octubre de 2026
+ *
+ * Este archivo ha sido realizado por agent.
+ * Pasa las mismas señales por FiltroBloques (por bloques de tamaño al azar, como en la
+ * placa pero sin CMSIS) y por FiltroMuestra (muestra a muestra) y comprueba que cada
+ * salida es igual bit a bit: lecturas del ADC con ruido y picos, escalones y valores de
+ * todo el rango de int16_t, que saturan la suma. Escribe también cuánto bajan el ruido y
+ * los picos, y los ns por muestra de entrada de cada forma. En la placa lo que cuesta
+ * filtrar un bloque lo da AdquisicionSAADC::getCiclosFiltro() (contador DWT).
+ *
+ * No usa Arduino.h: los filtros son los mismos que compila la placa.
+ *
+ * Compilar (desde esta carpeta):
+ *   g++ -O2 -std=c++17 medirFiltroBloques.cpp -o medirFiltroBloques
+ * Uso:
+ *   ./medirFiltroBloques [millones de muestras para medir el tiempo]
+ *
+ * Todos los derechos reservados.
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "../FiltroBloques.h"
+
+const uint16_t N = FiltroBloques::MAXIMO_MUESTRAS;
+const uint8_t D = FiltroADC::DECIMACION;
+
+// ----------------------------------------------------------
+// las dos formas, con la misma señal
+// ----------------------------------------------------------
+static std::vector<int16_t> porBloques( const std::vector<int16_t> & x, std::mt19937 & azar ) {
+  FiltroBloques filtro;
+  filtro.reiniciar( x[0] );
+  std::vector<int16_t> y;
+  int16_t salida[N / D];
+  size_t i = 0;
+  while ( i + D <= x.size() ) {
+	uint16_t n = D * ( 1 + azar() % ( N / D ) );
+	if ( i + n > x.size() ) {
+	  n = (uint16_t) ( ( x.size() - i ) / D * D );
+	}
+	uint16_t m = filtro.procesar( &x[i], n, salida );
+	y.insert( y.end(), salida, salida + m );
+	i += n;
+  }
+  return y;
+} // ()
+
+static std::vector<int16_t> muestraAMuestra( const std::vector<int16_t> & x ) {
+  FiltroMuestra filtro;
+  filtro.reiniciar( x[0] );
+  std::vector<int16_t> y;
+  int16_t s;
+  for ( size_t i = 0; i < x.size() / D * D; i++ ) {
+	if ( filtro.meter( x[i], s ) ) {
+	  y.push_back( s );
+	}
+  }
+  return y;
+} // ()
+
+static bool probar( const char * nombre, const std::vector<int16_t> & x, uint32_t semilla ) {
+  std::mt19937 azar( semilla );
+  std::vector<int16_t> a = porBloques( x, azar );
+  std::vector<int16_t> b = muestraAMuestra( x );
+  size_t distintas = a.size() == b.size() ? 0 : a.size() + b.size();
+  for ( size_t i = 0; i < a.size() && i < b.size(); i++ ) {
+	distintas += a[i] != b[i];
+  }
+  printf( "%-34s %8zu salidas %6zu distintas  %s\n", nombre, b.size(), distintas, distintas == 0 ? "bien" : "MAL" );
+  return distintas == 0;
+} // ()
+
+static double desviacion( const std::vector<int16_t> & x, size_t desde ) {
+  double suma = 0, suma2 = 0;
+  size_t n = 0;
+  for ( size_t i = desde; i < x.size(); i++ ) {
+	suma += x[i];
+	suma2 += (double) x[i] * x[i];
+	n++;
+  }
+  double media = suma / n;
+  return sqrt( suma2 / n - media * media );
+} // ()
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+int main( int argc, char * argv[] ) {
+  uint32_t total = (uint32_t) ( ( argc > 1 ? atof( argv[1] ) : 4 ) * 1e6 );
+  std::mt19937 azar( 40 );
+  std::normal_distribution<double> normal( 0, 1 );
+  bool bien = true;
+
+  // 1. las dos formas dan lo mismo
+  std::vector<int16_t> adc( 200000 );
+  for ( size_t i = 0; i < adc.size(); i++ ) {
+	double v = 500 + 8 * normal( azar );
+	if ( azar() % 200 == 0 ) {
+	  v += ( azar() & 1 ) ? 300 : -300; // pico suelto
+	}
+	adc[i] = (int16_t) std::max( 0.0, std::min( 1023.0, std::round( v ) ) );
+  }
+  bien &= probar( "ADC con ruido y picos", adc, 1 );
+
+  std::vector<int16_t> escalones( 100000 );
+  for ( size_t i = 0; i < escalones.size(); i++ ) {
+	escalones[i] = (int16_t) ( ( i / 997 ) % 2 ? 1023 : 0 );
+  }
+  bien &= probar( "escalones de 0 a 1023", escalones, 2 );
+
+  std::vector<int16_t> extremos( 100000 );
+  for ( size_t i = 0; i < extremos.size(); i++ ) {
+	extremos[i] = (int16_t) ( ( i / 8 ) % 2 ? 32767 : -32768 ); // la suma se sale y satura
+	if ( azar() % 3 == 0 ) {
+	  extremos[i] = (int16_t) azar();
+	}
+  }
+  bien &= probar( "todo el rango (satura)", extremos, 3 );
+
+  // lo que hace el filtro con la señal del ADC
+  std::vector<int16_t> filtrada = muestraAMuestra( adc );
+  printf( "\nADC: desviación %.2f cuentas a la entrada, %.2f a la salida (1 de cada %u)\n",
+		  desviacion( adc, 0 ), desviacion( filtrada, 8 ), D );
+
+  // 2. tiempo por muestra de entrada
+  std::vector<int16_t> x( 1 << 16 );
+  for ( int16_t & v : x ) {
+	v = (int16_t) ( 500 + 8 * normal( azar ) );
+  }
+  FiltroBloques bloques;
+  FiltroMuestra muestra;
+  volatile int32_t sumidero = 0; // para que el compilador no se salte las cuentas
+  int16_t salida[N / D];
+
+  auto inicio = std::chrono::steady_clock::now();
+  for ( uint32_t i = 0; i < total; i += N ) {
+	uint16_t m = bloques.procesar( &x[ i & ( x.size() - 1 ) ], N, salida );
+	sumidero = sumidero + salida[m - 1];
+  }
+  double nsBloques = std::chrono::duration<double, std::nano>( std::chrono::steady_clock::now() - inicio ).count() / total;
+
+  inicio = std::chrono::steady_clock::now();
+  int16_t s;
+  for ( uint32_t i = 0; i < total; i++ ) {
+	if ( muestra.meter( x[ i & ( x.size() - 1 ) ], s ) ) {
+	  sumidero = sumidero + s;
+	}
+  }
+  double nsMuestra = std::chrono::duration<double, std::nano>( std::chrono::steady_clock::now() - inicio ).count() / total;
+
+  printf( "\n%-34s %10s\n", "forma", "ns/muestra" );
+  printf( "%-34s %10.2f\n", "por bloques de 64", nsBloques );
+  printf( "%-34s %10.2f\n", "muestra a muestra", nsMuestra );
+  printf( "por bloques va %.1f veces más rápido\n", nsMuestra / nsBloques );
+
+  printf( "\n%s\n", bien ? "OK: por bloques y muestra a muestra dan los mismos bits" : "FALLO" );
+  return bien ? 0 : 1;
+} // ()
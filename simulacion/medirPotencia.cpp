@@ -0,0 +1,327 @@
+/*
+ * Nombre del fichero: medirPotencia.cpp
+ * Descripción: Comprueba en la simulación la potencia de emisión adaptativa del nodo.
+ * Autores: agent
+ * Fecha: 18 de octubre de 2026
+ *
+ * Este archivo ha sido realizado por agent.
+ * Compila el firmware con POTENCIA_ADAPTATIVA y ejecuta setup() y loop() sobre el reloj
+ * virtual mientras el nodo se aleja de la pasarela (1, 2, 5, 10 y 20 m), vuelve a 2 m y
+ * salta de golpe a 20 m. Cada anuncio emitido llega a la pasarela con la pérdida de un
+ * interior (57 dB a 1 m y 25 dB por década) más un desvanecimiento gaussiano de 4 dB, y se
+ * oye si pasa de -95 dBm. La pasarela decodifica lo que oye (DecodificadorIBeacon), lee de
+ * la trama la potencia con la que se emitió y escribe la realimentación en la característica
+ * de potencia cada 10 tramas oídas (o a los 20 s si oye alguna).
+ *
+ * Con los mismos desvanecimientos calcula qué habría pasado emitiendo siempre a +4 dBm y
+ * escribe, por tramo, la potencia, las tramas entregadas (alguna copia oída) y la energía de
+ * la radio por trama entregada de las dos maneras. Comprueba que cerca baja la potencia sin
+ * perder tramas, que lejos se queda en el máximo, que tras el salto recupera, que la potencia
+ * de la trama es la de la radio, que sólo se llama a setTxPower() cuando cambia y que la
+ * energía que apunta el nodo es la que ha emitido.
+ *
+ * Compilar:
+ *   g++ -O2 -std=c++17 -I. medirPotencia.cpp -o medirPotencia
+ * Uso:
+ *   ./medirPotencia [minutosPorTramo]
+ *
+ * Todos los derechos reservados.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+#define POTENCIA_ADAPTATIVA
+#include <Arduino.h>
+#include "../HolaMundoIBeacon.ino"
+#include "../pasarela/DecodificadorIBeacon.h"
+
+// ----------------------------------------------------------
+// la radio entre el nodo y la pasarela
+// ----------------------------------------------------------
+namespace Radio {
+  const double PERDIDA_1M_DB = -TramaIBeacon::RSSI_1M_0DBM;
+  const double DB_POR_DECADA = 25.0;
+  const double DESVANECIMIENTO_DB = 4.0;
+  const double SENSIBILIDAD_DBM = -95.0;
+  const int8_t POTENCIA_FIJA = 4;
+
+  double distancia = 1.0;
+  std::mt19937 azar( 2026 );
+  std::normal_distribution<double> normal( 0.0, DESVANECIMIENTO_DB );
+
+  // el anuncio en curso
+  uint64_t usEmpieza = 0;
+  uint8_t datos[BLE_GAP_ADV_SET_DATA_SIZE_MAX];
+  uint8_t longitud = 0;
+  int8_t potencia = 0;
+  bool oidaAdaptativa = false; ///< Alguna copia de esta trama oída.
+  bool oidaFija = false;
+
+  // lo de cada tramo
+  uint32_t tramas = 0;
+  uint32_t eventos = 0;
+  uint32_t entregadas = 0;
+  uint32_t entregadasFija = 0;
+  uint64_t energia = 0;     ///< nJ
+  uint64_t energiaFija = 0;
+  int64_t sumaPotencia = 0;
+
+  // lo de toda la simulación
+  uint64_t energiaTotal = 0;
+  uint32_t potenciaMal = 0;  ///< Tramas cuya potencia medida no es la de la radio.
+  int8_t potenciaMinima = 127;
+  int8_t potenciaMaxima = -128;
+}; // namespace
+
+// ----------------------------------------------------------
+// la pasarela
+// ----------------------------------------------------------
+namespace Pasarela {
+  const uint8_t TRAMAS_POR_REALIMENTACION = 10;
+  const uint64_t US_MAXIMO_SIN_ESCRIBIR = 20000000;
+
+  DecodificadorIBeacon deco;
+  int32_t sumaRssi = 0;
+  uint32_t copias = 0;
+  uint8_t tramas = 0;
+  int8_t potencia = 0;
+  uint16_t majorAnterior = 0;
+  uint16_t minorAnterior = 0;
+  bool hayAnterior = false;
+  uint64_t usEscrita = 0;
+  uint32_t escritas = 0;
+
+  void escribir() {
+	Realimentacion r;
+	r.rssi = (int8_t) lround( (double) sumaRssi / copias );
+	r.potencia = potencia;
+	r.tramas = tramas;
+	r.copias = (uint8_t) ( copias > 255 ? 255 : copias );
+	uint8_t bytes[Realimentacion::LONGITUD];
+	r.codificar( bytes );
+	BLECharacteristic & car = Globales::laCaracteristicaPotencia;
+	car.simularEscritura( 0, bytes, sizeof(bytes) );
+	escritas++;
+	sumaRssi = 0;
+	copias = 0;
+	tramas = 0;
+	usEscrita = Simulacion::relojUs;
+  } // ()
+
+  void oir( int8_t rssi ) {
+	InformeAnuncio informe;
+	informe.tiempo = Simulacion::relojUs;
+	memset( informe.direccion, 0, sizeof(informe.direccion) );
+	informe.rssi = rssi;
+	informe.longitud = Radio::longitud;
+	memcpy( informe.datos, Radio::datos, Radio::longitud );
+	LecturaIBeacon l;
+	if ( ! deco.decodificar( informe, l ) ) {
+	  return;
+	}
+	if ( ! hayAnterior || l.major != majorAnterior || l.minor != minorAnterior ) {
+	  tramas++;
+	  majorAnterior = l.major;
+	  minorAnterior = l.minor;
+	  hayAnterior = true;
+	}
+	potencia = TramaIBeacon::potenciaEmision( l.txPower );
+	sumaRssi += rssi;
+	copias++;
+	if ( tramas >= TRAMAS_POR_REALIMENTACION
+		 || ( tramas > 0 && Simulacion::relojUs - usEscrita >= US_MAXIMO_SIN_ESCRIBIR ) ) {
+	  escribir();
+	}
+  } // ()
+}; // namespace
+
+namespace Radio {
+  void acabarTrama() {
+	if ( longitud == 0 ) {
+	  return;
+	}
+	entregadas += oidaAdaptativa ? 1 : 0;
+	entregadasFija += oidaFija ? 1 : 0;
+	longitud = 0;
+  } // ()
+
+  void alEmpezarAnuncio( const uint8_t * d, uint8_t n, int8_t txPower ) {
+	acabarTrama();
+	memcpy( datos, d, n );
+	longitud = n;
+	potencia = txPower;
+	usEmpieza = Simulacion::relojUs;
+	oidaAdaptativa = false;
+	oidaFija = false;
+	tramas++;
+	sumaPotencia += txPower;
+	potenciaMinima = txPower < potenciaMinima ? txPower : potenciaMinima;
+	potenciaMaxima = txPower > potenciaMaxima ? txPower : potenciaMaxima;
+
+	LecturaIBeacon l;
+	if ( ! Pasarela::deco.decodificar( d, n, l ) || TramaIBeacon::potenciaEmision( l.txPower ) != txPower ) {
+	  potenciaMal++;
+	}
+  } // ()
+
+  // un evento de anuncio: una copia, con el mismo desvanecimiento para las dos potencias
+  void emitir() {
+	double perdida = PERDIDA_1M_DB + DB_POR_DECADA * log10( distancia );
+	double desvanecimiento = normal( azar );
+	double rssi = potencia - perdida + desvanecimiento;
+	double rssiFija = POTENCIA_FIJA - perdida + desvanecimiento;
+
+	eventos++;
+	uint32_t e = ControlPotencia::energiaAnuncio( ControlPotencia::indiceDe( potencia ) );
+	energia += e;
+	energiaTotal += e;
+	energiaFija += ControlPotencia::energiaAnuncio( ControlPotencia::indiceDe( POTENCIA_FIJA ) );
+
+	if ( rssiFija >= SENSIBILIDAD_DBM ) {
+	  oidaFija = true;
+	}
+	if ( rssi >= SENSIBILIDAD_DBM ) {
+	  oidaAdaptativa = true;
+	  Pasarela::oir( (int8_t) lround( rssi ) );
+	}
+  } // ()
+
+  void alAvanzar( uint64_t desde, uint64_t hasta ) {
+	if ( longitud == 0 || ! Bluefruit.Advertising.isRunning() ) {
+	  return;
+	}
+	uint64_t intervalo = (uint64_t) Bluefruit.Advertising.getInterval() * 625;
+	uint64_t k = desde > usEmpieza ? ( desde - usEmpieza + intervalo - 1 ) / intervalo : 0;
+	for ( uint64_t t = usEmpieza + k * intervalo; t < hasta; t += intervalo ) {
+	  emitir();
+	}
+  } // ()
+
+  void empezarTramo( double metros ) {
+	acabarTrama();
+	distancia = metros;
+	tramas = 0;
+	eventos = 0;
+	entregadas = 0;
+	entregadasFija = 0;
+	energia = 0;
+	energiaFija = 0;
+	sumaPotencia = 0;
+  } // ()
+}; // namespace
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+namespace Tramo {
+  struct Resultado {
+	double metros;
+	int8_t potenciaFinal;
+	double potenciaMedia;
+	uint32_t tramas;
+	uint32_t entregadas;
+	uint32_t entregadasFija;
+	double ujPorTrama;
+	double ujPorTramaFija;
+  }; // struct
+
+  // da vueltas hasta que pasan los minutos
+  Resultado recorrer( double metros, uint32_t minutos ) {
+	Radio::empezarTramo( metros );
+	uint64_t hasta = Simulacion::relojUs + (uint64_t) minutos * 60000000;
+	while ( Simulacion::relojUs < hasta ) {
+	  loop();
+	}
+	Radio::acabarTrama();
+
+	Resultado r;
+	r.metros = metros;
+	r.potenciaFinal = Globales::elPublicador.laEmisora.getPotencia();
+	r.potenciaMedia = Radio::tramas > 0 ? (double) Radio::sumaPotencia / Radio::tramas : 0.0;
+	r.tramas = Radio::tramas;
+	r.entregadas = Radio::entregadas;
+	r.entregadasFija = Radio::entregadasFija;
+	r.ujPorTrama = Radio::entregadas > 0 ? Radio::energia / 1000.0 / Radio::entregadas : 0.0;
+	r.ujPorTramaFija = Radio::entregadasFija > 0 ? Radio::energiaFija / 1000.0 / Radio::entregadasFija : 0.0;
+	return r;
+  } // ()
+
+  void escribir( const char * nombre, const Resultado & r ) {
+	printf( "%-12s %5.0f m  %4d dBm (media %6.1f)  entregadas %4u/%-4u (fija %4u)  uJ/trama %7.1f (fija %7.1f, %5.1f %%)\n",
+			nombre, r.metros, r.potenciaFinal, r.potenciaMedia, r.entregadas, r.tramas, r.entregadasFija,
+			r.ujPorTrama, r.ujPorTramaFija, r.ujPorTramaFija > 0 ? 100.0 * r.ujPorTrama / r.ujPorTramaFija : 0.0 );
+  } // ()
+}; // namespace
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+int main( int argc, char * argv[] ) {
+  uint32_t minutos = argc > 1 ? (uint32_t) atoi( argv[1] ) : 10;
+  bool bien = true;
+  bool b;
+
+  Simulacion::salidaSerie = nullptr;
+  Simulacion::alEmpezarAnuncio = Radio::alEmpezarAnuncio;
+  Simulacion::alAvanzar = Radio::alAvanzar;
+
+  setup();
+
+  const double metros[] = { 1, 2, 5, 10, 20 };
+  Tramo::Resultado r[5];
+  for ( int i = 0; i < 5; i++ ) {
+	char nombre[16];
+	snprintf( nombre, sizeof(nombre), "quieto %d", i + 1 );
+	r[i] = Tramo::recorrer( metros[i], minutos );
+	Tramo::escribir( nombre, r[i] );
+  }
+  Tramo::Resultado vuelta = Tramo::recorrer( 2, minutos );
+  Tramo::escribir( "vuelve", vuelta );
+  Tramo::Resultado salto = Tramo::recorrer( 20, minutos );
+  Tramo::escribir( "salta", salto );
+  printf( "realimentaciones escritas por la pasarela: %u\n\n", Pasarela::escritas );
+
+  // cerca baja, sin perder tramas que a +4 dBm sí llegarían
+  b = r[0].potenciaFinal <= -12 && r[1].potenciaFinal <= -12 && vuelta.potenciaFinal <= -12;
+  for ( const Tramo::Resultado & t : { r[0], r[1], r[2], vuelta } ) {
+	b = b && t.entregadas * 100 >= t.entregadasFija * 99 && t.ujPorTrama < t.ujPorTramaFija;
+  }
+  bien &= b;
+  printf( "cerca baja la potencia, entrega lo mismo (99 %%) y gasta menos: %s\n", b ? "bien" : "MAL" );
+
+  // lejos, en el máximo
+  b = r[4].potenciaFinal == POTENCIA_MAXIMA_DBM && salto.potenciaFinal == POTENCIA_MAXIMA_DBM;
+  bien &= b;
+  printf( "a 20 m se queda en %d dBm: %s\n", POTENCIA_MAXIMA_DBM, b ? "bien" : "MAL" );
+
+  // tras el salto recupera: lo que pierde es poco de todo el tramo
+  b = salto.entregadas * 100 >= salto.entregadasFija * 90;
+  bien &= b;
+  printf( "tras saltar de 2 a 20 m recupera (%u de %u tramas que a +4 dBm llegarían): %s\n",
+		  salto.entregadas, salto.entregadasFija, b ? "bien" : "MAL" );
+
+  b = Radio::potenciaMal == 0;
+  bien &= b;
+  printf( "la potencia medida de cada trama es la de la radio (%u mal): %s\n", Radio::potenciaMal, b ? "bien" : "MAL" );
+
+  const ControlPotencia & c = Globales::elControlPotencia;
+  uint32_t aplicadas = Globales::elPublicador.laEmisora.getPotenciasAplicadas();
+  b = aplicadas == c.getCambios() + 1 && c.getCambios() > 0;
+  bien &= b;
+  printf( "setTxPower() %u veces para %u cambios de nivel: %s\n", aplicadas, c.getCambios(), b ? "bien" : "MAL" );
+
+  b = Radio::potenciaMinima >= POTENCIA_MINIMA_DBM && Radio::potenciaMaxima <= POTENCIA_MAXIMA_DBM;
+  bien &= b;
+  printf( "potencia entre %d y %d dBm: %s\n", Radio::potenciaMinima, Radio::potenciaMaxima, b ? "bien" : "MAL" );
+
+  double desvio = Radio::energiaTotal > 0 ? fabs( (double) c.getEnergiaTotal() / Radio::energiaTotal - 1.0 ) : 1.0;
+  b = desvio < 0.05;
+  bien &= b;
+  printf( "energía apuntada por el nodo %.1f mJ, emitida %.1f mJ: %s\n", c.getEnergiaTotal() / 1e6,
+		  Radio::energiaTotal / 1e6, b ? "bien" : "MAL" );
+
+  printf( "\n%s\n", bien ? "OK: la potencia baja cerca, sube lejos y cada trama entregada cuesta menos" : "FALLO" );
+  return bien ? 0 : 1;
+} // ()
@@ -0,0 +1,190 @@
+/*
+ * Nombre del fichero: medirReferencia.cpp
+ * Descripción: Compara en una traza grabada la referencia leída en cada medida con la referencia lenta.
+ * Autores: agent
+ * Fecha: 18 de octubre de 2026
+ *
+ * Este archivo ha sido realizado por agent.
+ * Pasa cada muestra de la traza por Medidor::medirGas() (el de la placa: analogRead() lee
+ * de la traza) dos veces, leyendo Vref en cada medida y con usarReferenciaLenta(). Escribe,
+ * para cada forma, las lecturas del ADC por medida, el tiempo por medida, el error de la
+ * referencia usada y el de las ppm frente a la referencia sin ruido, y cuántas medidas
+ * tarda en seguir un salto de Vref. El tiempo por medida es el del ordenador, donde
+ * analogRead() no cuesta nada; en la placa lo que manda es ADC/medida, porque cada
+ * analogRead() espera a su conversión.
+ *
+ * La traza se puede ensuciar: ruido gaussiano en Vref (desviación en cuentas del ADC) y un
+ * salto de Vref a mitad de la traza, para ver el filtro y la detección de saltos.
+ *
+ * Compilar (desde esta carpeta):
+ *   g++ -O2 -std=c++17 -I. medirReferencia.cpp -o medirReferencia
+ * Uso:
+ *   ./medirReferencia traza [ruido de Vref (cuentas)] [salto de Vref (cuentas)]
+ *
+ * Todos los derechos reservados.
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include <Arduino.h>
+#include "../Medidor.h"
+#include "LectorTraza.h"
+
+const uint8_t PIN_GAS = 28; // los de HolaMundoIBeacon.ino
+const uint8_t PIN_REF = 29;
+
+// ----------------------------------------------------------
+// lo que devuelve analogRead(): la muestra de la traza en curso
+// ----------------------------------------------------------
+namespace Referencia {
+  int agas = 0;
+  int aref = 0;
+  uint64_t lecturas = 0;
+
+  int fuente( uint8_t pin ) {
+	lecturas++;
+	return pin == PIN_GAS ? agas : aref;
+  } // ()
+}; // namespace
+
+struct MuestraSucia {
+  uint64_t tiempo;
+  int agas;
+  int aref;       ///< Con ruido y salto.
+  int arefLimpia; ///< La de la traza más el salto, sin ruido.
+}; // struct
+
+struct Resultado {
+  double lecturasPorMedida = 0;
+  double nsPorMedida = 0;
+  double errorReferencia = 0; ///< Valor cuadrático medio, cuentas del ADC.
+  double errorPpm = 0;        ///< Valor cuadrático medio, ppm.
+  long medidasHastaSeguirSalto = -1;
+  uint32_t saltos = 0;
+}; // struct
+
+// ----------------------------------------------------------
+// Reproduce la traza con un Medidor nuevo
+// ----------------------------------------------------------
+static Resultado reproducir( const std::vector<MuestraSucia> & muestras, bool lenta, size_t indiceSalto ) {
+  const int REPETICIONES = 50; // para que el tiempo se pueda medir
+
+  Resultado r;
+  double sumaReferencia = 0, sumaPpm = 0;
+  uint64_t lecturas = 0;
+  double segundos = 0;
+
+  for ( int rep = 0; rep < REPETICIONES; rep++ ) {
+	Medidor medidor( PIN_GAS, PIN_REF );
+	Medidor limpio( PIN_GAS, PIN_REF );
+	medidor.iniciarMedidor();
+	if ( lenta ) {
+	  medidor.usarReferenciaLenta( 16, 4, 8 ); // lo de HolaMundoIBeacon.ino
+	}
+	Referencia::lecturas = 0;
+
+	for ( size_t i = 0; i < muestras.size(); i++ ) {
+	  const MuestraSucia & m = muestras[i];
+	  Simulacion::relojUs = m.tiempo;
+	  Referencia::agas = m.agas;
+	  Referencia::aref = m.aref;
+
+	  auto inicio = std::chrono::steady_clock::now();
+	  double ppm = medidor.medirGas();
+	  segundos += std::chrono::duration<double>( std::chrono::steady_clock::now() - inicio ).count();
+
+	  if ( rep > 0 ) {
+		continue; // los errores salen iguales en todas las repeticiones
+	  }
+	  double usada = lenta ? medidor.getReferenciaLenta().valor() : m.aref;
+	  double ppmLimpia = limpio.medirGas( m.agas, m.arefLimpia );
+	  sumaReferencia += ( usada - m.arefLimpia ) * ( usada - m.arefLimpia );
+	  sumaPpm += ( ppm - ppmLimpia ) * ( ppm - ppmLimpia );
+	  if ( i >= indiceSalto && r.medidasHastaSeguirSalto < 0 && std::fabs( usada - m.arefLimpia ) <= 1.0 ) {
+		r.medidasHastaSeguirSalto = (long) ( i - indiceSalto );
+	  }
+	} // for
+	lecturas += Referencia::lecturas;
+	r.saltos = medidor.getReferenciaLenta().getSaltos();
+  } // for
+
+  size_t total = muestras.size() * REPETICIONES;
+  r.lecturasPorMedida = (double) lecturas / total;
+  r.nsPorMedida = segundos * 1e9 / total;
+  r.errorReferencia = std::sqrt( sumaReferencia / muestras.size() );
+  r.errorPpm = std::sqrt( sumaPpm / muestras.size() );
+  return r;
+} // ()
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+int main( int argc, char * argv[] ) {
+  if ( argc < 2 ) {
+	fprintf( stderr, "uso: %s traza [ruido de Vref (cuentas)] [salto de Vref (cuentas)]\n", argv[0] );
+	return 2;
+  }
+  double ruido = argc > 2 ? atof( argv[2] ) : 0;
+  int salto = argc > 3 ? atoi( argv[3] ) : 0;
+
+  std::vector<uint8_t> traza;
+  if ( ! cargarTraza( argv[1], traza ) ) {
+	fprintf( stderr, "no se puede leer la traza %s\n", argv[1] );
+	return 1;
+  }
+  TrazaADC::Decodificador decodificador( traza.data(), traza.size() );
+  if ( decodificador.bitsADC() == 0 ) {
+	fprintf( stderr, "cabecera de traza no válida\n" );
+	return 1;
+  }
+
+  std::vector<MuestraSucia> muestras;
+  TrazaADC::Muestra m;
+  uint16_t ultimaReferencia = 0;
+  while ( decodificador.siguiente( m ) ) {
+	completarReferencia( m, ultimaReferencia ); // una traza grabada con la referencia lenta
+	muestras.push_back( MuestraSucia { decodificador.tiempoAbsoluto(), m.agas, m.aref, m.aref } );
+  }
+  if ( muestras.empty() ) {
+	fprintf( stderr, "la traza no tiene muestras\n" );
+	return 1;
+  }
+
+  // ruido y salto (a mitad de la traza)
+  std::mt19937 azar( 36 );
+  std::normal_distribution<double> normal( 0.0, ruido > 0 ? ruido : 1.0 );
+  size_t indiceSalto = salto != 0 ? muestras.size() / 2 : muestras.size();
+  for ( size_t i = 0; i < muestras.size(); i++ ) {
+	if ( i >= indiceSalto ) {
+	  muestras[i].arefLimpia += salto;
+	}
+	double sucia = muestras[i].arefLimpia + ( ruido > 0 ? normal( azar ) : 0.0 );
+	muestras[i].aref = sucia < 0 ? 0 : (int) std::lround( sucia );
+  } // for
+
+  Simulacion::salidaSerie = nullptr; // medirGas() escribe por el puerto serie
+  Simulacion::fuenteADC = Referencia::fuente;
+
+  printf( "%zu medidas, ruido de Vref %.2f cuentas, salto de Vref %d cuentas\n", muestras.size(), ruido, salto );
+  printf( "%-10s %12s %12s %14s %12s %14s\n", "Vref", "ADC/medida", "ns/medida", "error Vref", "error ppm", "seguir salto" );
+
+  Resultado directa = reproducir( muestras, false, indiceSalto );
+  Resultado lenta = reproducir( muestras, true, indiceSalto );
+  const Resultado * resultados[2] = { &directa, &lenta };
+  const char * nombres[2] = { "directa", "lenta" };
+  for ( int k = 0; k < 2; k++ ) {
+	const Resultado & r = *resultados[k];
+	char seguir[32] = "-";
+	if ( salto != 0 ) {
+	  snprintf( seguir, sizeof(seguir), r.medidasHastaSeguirSalto < 0 ? "nunca" : "%ld medidas", r.medidasHastaSeguirSalto );
+	}
+	printf( "%-10s %12.3f %12.1f %14.3f %12.4f %14s\n", nombres[k],
+			r.lecturasPorMedida, r.nsPorMedida, r.errorReferencia, r.errorPpm, seguir );
+  } // for
+  printf( "saltos detectados por la referencia lenta: %u\n", lenta.saltos );
+  return 0;
+} // ()
@@ -0,0 +1,200 @@
+/*
+ * Nombre del fichero: medirRuido.cpp
+ * Descripción: Comprueba la ponderación A y la calibración del canal de ruido y mide lo que tarda por bloque.
+ * Autores: agent
+ * Fecha: 18 de octubre de 2026
+ *
+ * Este archivo ha sido realizado por agent.
+ * Hace cuatro cosas con NivelRuido (la misma cuenta que en la placa, sin CMSIS):
+ *  - la respuesta: un tono en cada tercio de octava, de 20 Hz a 6.3 kHz, comparado con la
+ *    curva A de la norma (fórmula analítica, 0 dB a 1 kHz);
+ *  - la coma fija: ruido blanco a varios niveles comparado con el mismo filtro en double;
+ *  - el canal entero: CanalRuido con Simulacion::fuentePDM dando un tono de 1 kHz a
+ *    -26 dBFS, que con la calibración por defecto tiene que dar 94 dB(A);
+ *  - el tiempo: ns por bloque de 256 muestras y qué parte es de los 16 ms que dura.
+ * En la placa el tiempo lo da CanalRuido::getCiclosUltimoBloque() (contador DWT): un
+ * bloque son 1 024 000 ciclos a 64 MHz.
+ *
+ * Compilar (desde esta carpeta):
+ *   g++ -O2 -std=c++17 -I. medirRuido.cpp -o medirRuido
+ * Uso:
+ *   ./medirRuido [bloques para medir el tiempo]
+ *
+ * Todos los derechos reservados.
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include <Arduino.h>
+#include "../CanalRuido.h"
+
+const double FS = NivelRuido::FRECUENCIA_HZ;
+const uint16_t N = CanalRuido::MUESTRAS_POR_BLOQUE;
+
+// ----------------------------------------------------------
+// curva A analítica (IEC 61672), en dB
+// ----------------------------------------------------------
+static double curvaA( double f ) {
+  double f2 = f * f;
+  double ra = 12194.0 * 12194.0 * f2 * f2
+	/ ( ( f2 + 20.6 * 20.6 ) * sqrt( ( f2 + 107.7 * 107.7 ) * ( f2 + 737.9 * 737.9 ) ) * ( f2 + 12194.0 * 12194.0 ) );
+  return 20 * log10( ra ) + 2.0;
+} // ()
+
+// ----------------------------------------------------------
+// nivel de una señal entera, por bloques, sin contar el primer cuarto de segundo
+// ----------------------------------------------------------
+static double nivelDe( const std::vector<int16_t> & senyal ) {
+  NivelRuido nivel;
+  double energia = 0;
+  uint32_t muestras = 0;
+  for ( size_t i = 0; i + N <= senyal.size(); i += N ) {
+	int64_t e = nivel.procesarBloque( &senyal[i], N );
+	if ( i >= FS / 4 ) {
+	  energia += (double) e;
+	  muestras += N;
+	}
+  }
+  return nivel.decibelios( energia, muestras );
+} // ()
+
+static std::vector<int16_t> tono( double f, double dBFS, double segundos ) {
+  std::vector<int16_t> s( (size_t) ( segundos * FS ) );
+  double amplitud = 32767 * pow( 10, dBFS / 20 );
+  for ( size_t i = 0; i < s.size(); i++ ) {
+	s[i] = (int16_t) lround( amplitud * sin( 2 * M_PI * f * i / FS ) );
+  }
+  return s;
+} // ()
+
+// ----------------------------------------------------------
+// el mismo filtro (los mismos coeficientes) en double, para ver lo que pierde la coma fija
+// ----------------------------------------------------------
+static double nivelEnDouble( const std::vector<int16_t> & senyal ) {
+  // los de NivelRuido::coeficientes(), ya como números reales (x 2 / 2^31)
+  static const double c[15] = {
+	1065108519, -2130217039, 1065108519, 2130182185, -1056510057,
+	918452683, -1836905366, 918452683, 1831277025, -768785805,
+	182508024, 1084502928, 726634866, -870884189, -49018537
+  };
+  double estado[3][4] = { { 0 } };
+  double suma = 0;
+  size_t n = 0;
+  for ( size_t i = 0; i < senyal.size(); i++ ) {
+	double x = senyal[i] / 32768.0;
+	for ( int s = 0; s < 3; s++ ) {
+	  const double * k = &c[5*s];
+	  double * e = estado[s];
+	  double y = ( k[0] * x + k[1] * e[0] + k[2] * e[1] + k[3] * e[2] + k[4] * e[3] ) * 2 / 2147483648.0;
+	  e[1] = e[0]; e[0] = x; e[3] = e[2]; e[2] = y;
+	  x = y;
+	}
+	if ( i >= FS / 4 && i < senyal.size() / N * N ) {
+	  suma += x * x;
+	  n++;
+	}
+  } // for
+  NivelRuido referencia;
+  return 10 * log10( suma / n ) + 3.0103 + 1.9560708 + referencia.getCalibracion(); // como decibelios(), sin el margen de Q31
+} // ()
+
+// ----------------------------------------------------------
+// fuente del micrófono simulado: un tono continuo
+// ----------------------------------------------------------
+namespace Microfono {
+  double frecuencia = 1000;
+  double amplitud = 0;
+
+  void fuente( int16_t * muestras, uint16_t n, uint64_t usPrimera ) {
+	uint64_t primera = usPrimera * NivelRuido::FRECUENCIA_HZ / 1000000;
+	for ( uint16_t i = 0; i < n; i++ ) {
+	  muestras[i] = (int16_t) lround( amplitud * sin( 2 * M_PI * frecuencia * ( primera + i ) / FS ) );
+	}
+  } // ()
+}; // namespace
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+int main( int argc, char * argv[] ) {
+  uint32_t bloquesTiempo = argc > 1 ? (uint32_t) atol( argv[1] ) : 20000;
+  bool todoBien = true;
+
+  // 1. respuesta en frecuencia
+  printf( "respuesta (tono a -20 dBFS, relativa a 1 kHz)\n" );
+  printf( "%10s %10s %10s %10s\n", "f (Hz)", "medida", "curva A", "error" );
+  double a1k = nivelDe( tono( 1000, -20, 1.25 ) );
+  double peorError = 0;
+  for ( int k = -17; k <= 8; k++ ) {
+	double f = 1000 * pow( 10, k / 10.0 );
+	double medida = nivelDe( tono( f, -20, 1.25 ) ) - a1k;
+	double error = medida - curvaA( f );
+	peorError = std::max( peorError, fabs( error ) );
+	printf( "%10.1f %10.2f %10.2f %10.3f\n", f, medida, curvaA( f ), error );
+  }
+  bool bien = peorError <= 0.1;
+  todoBien &= bien;
+  printf( "peor error %.3f dB (hasta 0.1): %s\n\n", peorError, bien ? "bien" : "MAL" );
+
+  // 2. coma fija frente a double
+  printf( "coma fija frente a double (ruido blanco)\n" );
+  printf( "%10s %12s %12s %10s\n", "rms (dB)", "Q31 (dBA)", "double", "error" );
+  std::mt19937 azar( 39 );
+  std::normal_distribution<double> normal( 0, 1 );
+  double peorComaFija = 0;
+  for ( int dBFS = -10; dBFS >= -70; dBFS -= 10 ) {
+	std::vector<int16_t> ruido( (size_t) ( 2 * FS ) );
+	double sigma = 32767 * pow( 10, dBFS / 20.0 );
+	for ( int16_t & m : ruido ) {
+	  double v = sigma * normal( azar );
+	  m = (int16_t) std::max( -32768.0, std::min( 32767.0, std::round( v ) ) );
+	}
+	double q31 = nivelDe( ruido );
+	double doble = nivelEnDouble( ruido );
+	peorComaFija = std::max( peorComaFija, fabs( q31 - doble ) );
+	printf( "%10d %12.3f %12.3f %10.4f\n", dBFS, q31, doble, q31 - doble );
+  }
+  bien = peorComaFija <= 0.01;
+  todoBien &= bien;
+  printf( "peor diferencia %.4f dB (hasta 0.01): %s\n\n", peorComaFija, bien ? "bien" : "MAL" );
+
+  // 3. el canal entero sobre el reloj virtual
+  CanalRuido canal( 34, 35 );
+  Simulacion::fuentePDM = Microfono::fuente;
+  Microfono::amplitud = 32767 * pow( 10, -26 / 20.0 );
+  canal.iniciar();
+  double db = 0;
+  bool sinBloques = ! canal.tomarNivel( db );
+  Simulacion::avanzar( 1000000 );
+  canal.tomarNivel( db ); // el primer segundo lleva el arranque
+  Simulacion::avanzar( 1000000 );
+  bool hay = canal.tomarNivel( db );
+  bien = sinBloques && hay && fabs( db - 94.0 ) <= 0.1;
+  todoBien &= bien;
+  printf( "canal: 1 kHz a -26 dBFS da %.2f dB(A) (94 +- 0.1), %u bloques: %s\n\n", db, canal.getBloquesTerminados(),
+		  bien ? "bien" : "MAL" );
+
+  // 4. tiempo por bloque
+  std::vector<int16_t> ruido( (size_t) N * 64 );
+  for ( int16_t & m : ruido ) {
+	m = (int16_t) ( 3000 * normal( azar ) );
+  }
+  NivelRuido nivel;
+  volatile int64_t suma = 0; // para que el compilador no se salte las cuentas
+  auto inicio = std::chrono::steady_clock::now();
+  for ( uint32_t b = 0; b < bloquesTiempo; b++ ) {
+	suma += nivel.procesarBloque( &ruido[ ( b % 64 ) * N ], N );
+  }
+  double ns = std::chrono::duration<double, std::nano>( std::chrono::steady_clock::now() - inicio ).count() / bloquesTiempo;
+  double msBloque = 1000.0 * N / FS;
+  printf( "tiempo: %.0f ns por bloque de %u muestras (%.2f ns por muestra), %.3f %% de los %.0f ms del bloque\n",
+		  ns, N, ns / N, 100 * ns / ( msBloque * 1e6 ), msBloque );
+  printf( "  en la placa: getCiclosUltimoBloque() frente a %.0f ciclos por bloque a 64 MHz\n", 64e6 * msBloque / 1000 );
+
+  printf( "\n%s\n", todoBien ? "OK: la ponderación A, la coma fija y la calibración cuadran" : "FALLO" );
+  return todoBien ? 0 : 1;
+} // ()
@@ -0,0 +1,140 @@
+/*
+ * Nombre del fichero: medirTelemetria.cpp
+ * Descripción: Comprueba en la simulación la telemetría del nodo en la respuesta de escaneo.
+ * Autores: agent
+ * Fecha: 18 de octubre de 2026
+ *
+ * Este archivo ha sido realizado por agent.
+ * Compila el firmware con TELEMETRIA_ESCANEO, ejecuta setup() y loop() sobre el reloj
+ * virtual (con Serial a 115200 baudios, para que las vueltas duren algo más que el periodo)
+ * y, a mitad, cambia la configuración. En cada anuncio decodifica la respuesta de escaneo
+ * como la pasarela (DecodificadorIBeacon::decodificarTelemetria()) y comprueba la versión,
+ * los minutos, el periodo, la huella de la configuración y que el nombre sigue detrás.
+ * Escribe cuántas veces ha cambiado la respuesta frente a cuántos anuncios ha habido.
+ *
+ * Compilar:
+ *   g++ -O2 -std=c++17 -I. medirTelemetria.cpp -o medirTelemetria
+ * Uso:
+ *   ./medirTelemetria [minutos]
+ *
+ * Todos los derechos reservados.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#define TELEMETRIA_ESCANEO
+#include <Arduino.h>
+#include "../HolaMundoIBeacon.ino"
+#include "../pasarela/DecodificadorIBeacon.h"
+
+namespace Telemetria {
+  uint32_t anuncios = 0;
+  uint32_t sinTelemetria = 0;
+  uint32_t sinNombre = 0;
+  uint32_t cambiosVistos = 0;
+  uint32_t medioPorEncima = 0; ///< Respuestas con el periodo medio por encima del máximo.
+  DatosTelemetria ultima;
+
+  // ¿lleva el nombre completo de la emisora?
+  bool llevaNombre( const uint8_t * datos, uint8_t longitud ) {
+	for ( uint8_t i = 0; i + 1 < longitud; i += 1 + datos[i] ) {
+	  if ( datos[i] == 0 ) {
+		return false;
+	  }
+	  if ( datos[i+1] == BLE_GAP_AD_TYPE_COMPLETE_LOCAL_NAME && datos[i] == 1 + 6 && memcmp( &datos[i+2], "yesyes", 6 ) == 0 ) {
+		return true;
+	  }
+	}
+	return false;
+  } // ()
+
+  void alEmpezarAnuncio( const uint8_t *, uint8_t, int8_t ) {
+	anuncios++;
+	const BLEAdvertisingData & r = Bluefruit.ScanResponse;
+	DatosTelemetria d;
+	if ( ! DecodificadorIBeacon::decodificarTelemetria( r.getData(), r.count(), d ) ) {
+	  sinTelemetria++;
+	  return;
+	}
+	if ( ! llevaNombre( r.getData(), r.count() ) ) {
+	  sinNombre++;
+	}
+	if ( d.periodoMedioMs > d.periodoMaximoMs ) {
+	  medioPorEncima++;
+	}
+	if ( d.minutosEncendido != ultima.minutosEncendido || d.periodoMedioMs != ultima.periodoMedioMs
+		 || d.periodoMaximoMs != ultima.periodoMaximoMs || d.muestrasPerdidas != ultima.muestrasPerdidas
+		 || d.lineasPerdidas != ultima.lineasPerdidas || d.huellaConfiguracion != ultima.huellaConfiguracion
+		 || d.versionMayor != ultima.versionMayor || d.versionMenor != ultima.versionMenor ) {
+	  cambiosVistos++;
+	}
+	ultima = d;
+  } // ()
+}; // namespace
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+int main( int argc, char * argv[] ) {
+  uint32_t minutos = argc > 1 ? (uint32_t) atoi( argv[1] ) : 30;
+
+  Simulacion::salidaSerie = nullptr;
+  Simulacion::usPorByteSerie = 87; // 115200 baudios: lo que se escribe también cuenta
+  Simulacion::alEmpezarAnuncio = Telemetria::alEmpezarAnuncio;
+
+  setup();
+
+  uint64_t usFin = Simulacion::relojUs + (uint64_t) minutos * 60000000;
+  uint64_t usCambio = Simulacion::relojUs + ( usFin - Simulacion::relojUs ) / 2;
+  bool cambiada = false;
+  uint32_t huellaAntes = Globales::laConfiguracion.huella();
+  while ( Simulacion::relojUs < usFin ) {
+	if ( ! cambiada && Simulacion::relojUs >= usCambio ) {
+	  // como si llegara por BLE: otro periodo
+	  Configuracion c = Globales::laConfiguracion;
+	  c.periodoPublicacionMs = 2000;
+	  Globales::laConfiguracionCompartida.publicar( c );
+	  cambiada = true;
+	}
+	loop();
+  }
+
+  const DatosTelemetria & d = Telemetria::ultima;
+  printf( "%u minutos, %u anuncios: la respuesta de escaneo ha cambiado %u veces (la emisora: %u)\n",
+		  minutos, Telemetria::anuncios, Telemetria::cambiosVistos,
+		  Globales::elPublicador.laEmisora.getCambiosRespuestaEscaneo() );
+  printf( "última: versión %u.%u, %u min, periodo medio %u ms, máximo %u ms, perdidas %u muestras y %u líneas, huella %08x\n",
+		  d.versionMayor, d.versionMenor, d.minutosEncendido, d.periodoMedioMs, d.periodoMaximoMs,
+		  d.muestrasPerdidas, d.lineasPerdidas, d.huellaConfiguracion );
+
+  bool bien = true;
+  bool b = Telemetria::sinTelemetria == 0 && Telemetria::sinNombre == 0;
+  bien &= b;
+  printf( "anuncios sin telemetría %u, sin nombre %u: %s\n", Telemetria::sinTelemetria, Telemetria::sinNombre, b ? "bien" : "MAL" );
+
+  b = d.versionMayor == ( VERSION_FIRMWARE >> 8 ) && d.versionMenor == ( VERSION_FIRMWARE & 0xff )
+	&& d.minutosEncendido + 1 >= minutos && d.minutosEncendido <= minutos + 1
+	&& d.huellaConfiguracion == Globales::laConfiguracion.huella() && d.huellaConfiguracion != huellaAntes;
+  bien &= b;
+  printf( "versión, minutos y huella de la configuración nueva: %s\n", b ? "bien" : "MAL" );
+
+  // el periodo: algo más que el configurado (lo que se tarda en escribir por el puerto serie)
+  b = d.periodoMedioMs >= 2000 && d.periodoMedioMs < 2000 + 20 + TelemetriaNodo::BANDA_MUERTA_MS
+	&& d.periodoMaximoMs >= 2000 && d.periodoMaximoMs < 2000 + 20 + TelemetriaNodo::BANDA_MUERTA_MS;
+  bien &= b;
+  printf( "periodo medio %u ms y máximo %u ms con 2000 configurados: %s\n", d.periodoMedioMs, d.periodoMaximoMs, b ? "bien" : "MAL" );
+
+  b = Telemetria::medioPorEncima == 0;
+  bien &= b;
+  printf( "respuestas con el periodo medio por encima del máximo: %u: %s\n", Telemetria::medioPorEncima, b ? "bien" : "MAL" );
+
+  // sólo cambia cuando cambia algo: una vez por minuto, más lo que tarda la media en llegar
+  // al periodo nuevo (de BANDA_MUERTA_MS en BANDA_MUERTA_MS) y el arranque
+  b = Telemetria::cambiosVistos <= minutos + 40 && Telemetria::cambiosVistos * 4 < Telemetria::anuncios;
+  bien &= b;
+  printf( "cambios %u para %u anuncios: %s\n", Telemetria::cambiosVistos, Telemetria::anuncios, b ? "bien" : "MAL" );
+
+  printf( "\n%s\n", bien ? "OK: la telemetría va en la respuesta de escaneo y sólo cambia cuando cambia algo" : "FALLO" );
+  return bien ? 0 : 1;
+} // ()
@@ -0,0 +1,166 @@
+/*
+ * Nombre del fichero: medirVentanas.cpp
+ * Descripción: Comprueba en la simulación los resúmenes de ventana que anuncia el nodo.
+ * Autores: agent
+ * Fecha: 18 de octubre de 2026
+ *
+ * Este archivo ha sido realizado por agent.
+ * Compila el firmware, le pone ventanas de estadísticas y ejecuta setup() y loop() sobre
+ * el reloj virtual con un gas que cambia en cada medida (con decimales: el ADC da cuentas
+ * enteras, pero las ppm no lo son). Apunta cada medida tal y como la calcula Medidor y,
+ * en cada anuncio, decodifica los resúmenes de gas como la pasarela
+ * (DecodificadorIBeacon y TramasPublicador::decodificarResumen()). Compara cada uno con
+ * las estadísticas exactas de las medidas de su ventana: mínimo, máximo, media y
+ * desviación, con la resolución de la trama (milésimas de ppm); la mediana y el p90
+ * (P², aproximados), con un margen.
+ *
+ * Compilar:
+ *   g++ -O2 -std=c++17 -I. medirVentanas.cpp -o medirVentanas
+ * Uso:
+ *   ./medirVentanas [minutos]
+ *
+ * Todos los derechos reservados.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include <Arduino.h>
+#include "../HolaMundoIBeacon.ino"
+#include "../pasarela/DecodificadorIBeacon.h"
+
+namespace Ventanas {
+  const uint32_t PERIODO_MS = 1000;
+  const uint32_t VENTANA_MS = 60000;
+
+  std::mt19937 azar( 35 );
+  int agas = 0;
+  std::vector<double> medidas;   ///< Las ppm de cada medida, en orden.
+  size_t usadas = 0;             ///< Medidas de las ventanas ya comprobadas.
+  Medidor limpio( PIN_VGAS, PIN_VREF );
+
+  DecodificadorIBeacon decodificador;
+  bool hayVentana = false;
+  uint8_t ultimaVentana = 0;
+  uint32_t resumenes = 0;
+  uint32_t exactosMal = 0;
+  uint32_t percentilesMal = 0;
+  double peorExacto = 0;
+  double peorPercentil = 0;
+
+  // gas: cada medida, otro valor (Vref fija); se apunta al leer Vref, que va después
+  int fuente( uint8_t pin ) {
+	if ( pin == PIN_VGAS ) {
+	  agas = 150 + (int) ( azar() % 81 );
+	  return agas;
+	}
+	medidas.push_back( limpio.vigilarGas( agas, 280 ) );
+	return 280;
+  } // ()
+
+  double percentilExacto( std::vector<double> v, double p ) {
+	std::sort( v.begin(), v.end() );
+	return v[ (size_t) std::lround( p * ( v.size() - 1 ) ) ];
+  } // ()
+
+  void comprobar( const ResumenVentana & r ) {
+	if ( r.numero == 0 || usadas + r.numero > medidas.size() ) {
+	  exactosMal++;
+	  return;
+	}
+	std::vector<double> v( medidas.begin() + usadas, medidas.begin() + usadas + r.numero );
+	usadas += r.numero;
+
+	double minimo = *std::min_element( v.begin(), v.end() );
+	double maximo = *std::max_element( v.begin(), v.end() );
+	double suma = 0;
+	for ( double x : v ) {
+	  suma += x;
+	}
+	double media = suma / v.size();
+	double cuadrados = 0;
+	for ( double x : v ) {
+	  cuadrados += ( x - media ) * ( x - media );
+	}
+	double desviacion = v.size() > 1 ? std::sqrt( cuadrados / ( v.size() - 1 ) ) : 0;
+
+	const double RESOLUCION = 0.0005 + 1e-9; // media milésima: lo que redondea la trama
+	double exacto = std::max( std::max( std::fabs( r.minimo - minimo ), std::fabs( r.maximo - maximo ) ),
+							  std::max( std::fabs( r.media - media ), std::fabs( r.desviacion - desviacion ) ) );
+	peorExacto = std::max( peorExacto, exacto );
+	if ( exacto > RESOLUCION ) {
+	  exactosMal++;
+	}
+
+	// P² con una ventana de 60 medidas: p50 y p90 a menos de media desviación (como en
+	// pasarela/comprobarResumenes.cpp); el p99 de 60 medidas casi es el máximo
+	double percentil = std::max( std::fabs( r.p50 - percentilExacto( v, 0.5 ) ),
+								 std::fabs( r.p90 - percentilExacto( v, 0.9 ) ) );
+	peorPercentil = std::max( peorPercentil, desviacion > 0 ? percentil / desviacion : 0 );
+	if ( percentil > 0.5 * desviacion + RESOLUCION ) {
+	  percentilesMal++;
+	}
+  } // ()
+
+  void alEmpezarAnuncio( const uint8_t * datos, uint8_t longitud, int8_t ) {
+	LecturaIBeacon lectura;
+	uint8_t id, ventana;
+	ResumenVentana r;
+	if ( ! decodificador.decodificar( datos, longitud, lectura ) || ! lectura.resumen
+		 || ! TramasPublicador::decodificarResumen( lectura.carga, id, ventana, r ) || id != TramasPublicador::ID_CO2 ) {
+	  return;
+	}
+	if ( hayVentana && ventana == ultimaVentana ) {
+	  return; // el mismo resumen, en otra vuelta
+	}
+	hayVentana = true;
+	ultimaVentana = ventana;
+	resumenes++;
+	comprobar( r );
+  } // ()
+}; // namespace
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+int main( int argc, char * argv[] ) {
+  uint32_t minutos = argc > 1 ? (uint32_t) atoi( argv[1] ) : 30;
+
+  Simulacion::salidaSerie = nullptr;
+  Simulacion::fuenteADC = Ventanas::fuente;
+  Simulacion::alEmpezarAnuncio = Ventanas::alEmpezarAnuncio;
+  Ventanas::decodificador.aceptarResumenes( true );
+
+  Configuracion c;
+  c.periodoPublicacionMs = Ventanas::PERIODO_MS;
+  c.duracionAnuncioMs = 500;
+  c.duracionVentanaMs = Ventanas::VENTANA_MS;
+  Globales::laConfiguracionCompartida.publicar( c );
+
+  setup();
+  uint64_t usFin = Simulacion::relojUs + (uint64_t) minutos * 60000000;
+  while ( Simulacion::relojUs < usFin ) {
+	loop();
+  }
+
+  using namespace Ventanas;
+  printf( "%u minutos, %zu medidas, %u resúmenes de gas (ventanas de %u s, una medida cada %u ms)\n",
+		  minutos, medidas.size(), resumenes, VENTANA_MS / 1000, PERIODO_MS );
+  printf( "peor diferencia de mínimo, máximo, media y desviación: %.6f ppm\n", peorExacto );
+  printf( "peor diferencia de p50 y p90: %.2f desviaciones\n", peorPercentil );
+
+  bool bien = true;
+  bool b = resumenes + 2 >= minutos * 60000 / VENTANA_MS && exactosMal == 0;
+  bien &= b;
+  printf( "mínimo, máximo, media y desviación exactos (a la milésima) en %u resúmenes: %s\n", resumenes, b ? "bien" : "MAL" );
+
+  b = percentilesMal == 0;
+  bien &= b;
+  printf( "p50 y p90 a menos de media desviación: %s\n", b ? "bien" : "MAL" );
+
+  printf( "\n%s\n", bien ? "OK: los resúmenes de ventana llevan las medidas con decimales" : "FALLO" );
+  return bien ? 0 : 1;
+} // ()
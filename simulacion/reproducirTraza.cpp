@@ -0,0 +1,106 @@
+/*
+ * Nombre del fichero: reproducirTraza.cpp
+ * Descripción: Reproduce en el ordenador una traza del ADC grabada en la placa.
+ * Autores: agent
+ * Fecha: 18 de octubre de 2026
+ *
+ * Este archivo ha sido realizado por agent.
+ * Compila el propio firmware (HolaMundoIBeacon.ino) con los sustitutos de Arduino y
+ * Bluefruit de esta carpeta y pasa cada muestra de la traza por Medidor::medirGas() y
+ * Publicador::publicarCO2(), sobre el reloj virtual (sin esperas reales). Por cada muestra
+ * escribe una línea CSV con el valor calibrado exacto y los bytes del anuncio resultante,
+ * de forma que dos versiones del firmware se pueden comparar con diff.
+ *
+ * La traza puede ser el fichero binario (TrazaADC.h) o directamente el registro del puerto
+ * serie con las líneas "TADC:" que escribe GrabadorTraza. Si se grabó con la referencia
+ * lenta, las muestras sin Vref se reproducen con la última leída.
+ *
+ * Compilar (desde esta carpeta):
+ *   g++ -O2 -std=c++17 -I. reproducirTraza.cpp -o reproducirTraza
+ * Uso:
+ *   ./reproducirTraza registro_serie.txt [número de traza] > salida.csv
+ * (con varias órdenes traza de la consola en el mismo registro, la 1 es la primera)
+ *
+ * Todos los derechos reservados.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <Arduino.h>
+#include "../HolaMundoIBeacon.ino"
+#include "../TrazaADC.h"
+#include "LectorTraza.h"
+
+// ----------------------------------------------------------
+// último anuncio que ha empezado la emisora
+// ----------------------------------------------------------
+namespace Reproduccion {
+  uint8_t anuncio[BLE_GAP_ADV_SET_DATA_SIZE_MAX];
+  uint8_t longitudAnuncio = 0;
+
+  void alEmpezarAnuncio( const uint8_t * datos, uint8_t longitud, int8_t ) {
+	memcpy( anuncio, datos, longitud );
+	longitudAnuncio = longitud;
+  } // ()
+}; // namespace
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+int main( int argc, char * argv[] ) {
+  if ( argc < 2 ) {
+	fprintf( stderr, "uso: %s traza [número de traza]\n", argv[0] );
+	return 2;
+  }
+  unsigned numero = argc > 2 ? (unsigned) atoi( argv[2] ) : 1;
+
+  std::vector<uint8_t> traza;
+  if ( ! cargarTraza( argv[1], traza, numero ) ) {
+	fprintf( stderr, "no se puede leer la traza %u de %s\n", numero, argv[1] );
+	return 1;
+  }
+  TrazaADC::Decodificador decodificador( traza.data(), traza.size() );
+  if ( decodificador.bitsADC() == 0 ) {
+	fprintf( stderr, "cabecera de traza no válida\n" );
+	return 1;
+  }
+
+  Simulacion::salidaSerie = nullptr; // los mensajes del firmware no se mezclan con el CSV
+  Simulacion::alEmpezarAnuncio = Reproduccion::alEmpezarAnuncio;
+  setup();
+
+  printf( "tiempo_us,agas,aref,ppm,anuncio\n" );
+
+  auto inicio = std::chrono::steady_clock::now();
+  TrazaADC::Muestra m;
+  uint8_t contador = 0;
+  size_t muestras = 0;
+  uint64_t primerTiempo = 0;
+  uint16_t ultimaReferencia = 0;
+
+  while ( decodificador.siguiente( m ) ) {
+	completarReferencia( m, ultimaReferencia );
+	if ( muestras == 0 ) {
+	  primerTiempo = decodificador.tiempoAbsoluto();
+	}
+	Simulacion::relojUs = decodificador.tiempoAbsoluto();
+
+	double ppm = Globales::elMedidor.medirGas( m.agas, m.aref );
+	Globales::elPublicador.publicarCO2( ppm, ++contador, 1000 );
+
+	printf( "%llu,%u,%u,%.17g,", (unsigned long long) decodificador.tiempoAbsoluto(), m.agas, m.aref, ppm );
+	for ( uint8_t i = 0; i < Reproduccion::longitudAnuncio; i++ ) {
+	  printf( "%02x", Reproduccion::anuncio[i] );
+	}
+	printf( "\n" );
+	muestras++;
+  } // while
+
+  double segundos = std::chrono::duration<double>( std::chrono::steady_clock::now() - inicio ).count();
+  double simulados = ( decodificador.tiempoAbsoluto() - primerTiempo ) / 1e6;
+  fprintf( stderr, "%zu muestras (%.1f s de traza) en %.3f s: x%.0f tiempo real\n",
+		   muestras, simulados, segundos, segundos > 0 ? simulados / segundos : 0.0 );
+  return 0;
+} // ()
@@ -0,0 +1,256 @@
+/*
+ * Nombre del fichero: rtos.h
+ * Descripción: Sustituto de las tareas y colas de FreeRTOS para compilar el firmware en el ordenador.
+ * Autores: agent
+ * Fecha: 18 de octubre de 2026
+ *
+ * Este archivo ha sido realizado por agent.
+ * Contiene la parte de FreeRTOS que usa el firmware (xTaskCreate, vTaskDelayUntil,
+ * xQueueCreate, xQueueSend, xQueueReceive...). Cada tarea es un std::thread y cada cola
+ * un buffer con mutex. Las prioridades no se respetan (el sistema operativo reparte) y la
+ * pila no se mide. Las tareas heredan la configuración de la simulación del hilo que las
+ * crea y van siempre con el reloj real acelerado (Simulacion::aceleracion, 1 si no se ha
+ * puesto). Simulacion::pararTareas() las para y espera a que acaben.
+ * En la placa esto lo trae Arduino.h. Sólo se usa al compilar con -I simulacion.
+ *
+ * Todos los derechos reservados.
+ */
+
+#ifndef RTOS_SIMULADO_H_INCLUIDO
+#define RTOS_SIMULADO_H_INCLUIDO
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+typedef uint32_t TickType_t;
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef uint32_t StackType_t;
+typedef void ( * TaskFunction_t )( void * );
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS 1
+#define portMAX_DELAY ( (TickType_t) 0xffffffff )
+#define configTICK_RATE_HZ 1024 // el del núcleo nRF52
+#define pdMS_TO_TICKS( ms ) ( (TickType_t) ( ( (uint64_t) ( ms ) * configTICK_RATE_HZ ) / 1000 ) )
+
+// prioridades del núcleo nRF52 (rtos.h)
+enum {
+  TASK_PRIO_LOWEST = 0,
+  TASK_PRIO_LOW = 1,
+  TASK_PRIO_NORMAL = 2,
+  TASK_PRIO_HIGH = 3
+};
+
+namespace Simulacion {
+
+  /// Lo que lanzan las funciones de FreeRTOS en las tareas cuando se llama a pararTareas().
+  struct FinTarea { };
+
+  struct TareaSimulada {
+	std::thread hilo;
+	const char * nombre;
+	uint32_t pila;
+	UBaseType_t prioridad;
+  }; // struct
+
+  struct ColaSimulada {
+	std::mutex cerrojo;
+	std::condition_variable cambio;
+	std::vector<uint8_t> datos;
+	UBaseType_t longitud;
+	UBaseType_t tamanyo;
+	UBaseType_t cabeza = 0;
+	UBaseType_t n = 0;
+  }; // struct
+
+  inline std::atomic<bool> acabando { false };
+  inline std::mutex cerrojoTareas;
+  inline std::condition_variable despertarTareas;
+  inline std::vector< std::unique_ptr<TareaSimulada> > tareas;
+  inline std::vector< std::unique_ptr<ColaSimulada> > colas;
+
+  /// us de reloj que son ticks ticks.
+  inline uint64_t usDeTicks( TickType_t ticks ) {
+	return (uint64_t) ticks * 1000000 / configTICK_RATE_HZ;
+  } // ()
+
+  /// Duerme la tarea us (de su reloj); sale con FinTarea si se paran las tareas.
+  inline void dormirTarea( uint64_t us ) {
+	std::unique_lock<std::mutex> l( cerrojoTareas );
+	despertarTareas.wait_for( l, std::chrono::duration<double, std::micro>( us / aceleracion ),
+							  [] { return acabando.load(); } );
+	if ( acabando.load() ) {
+	  throw FinTarea();
+	}
+  } // ()
+
+  // .........................................................
+  /**
+   * @brief Para todas las tareas y espera a que acaben (desde el hilo que las creó).
+   *
+   * Cada tarea acaba en su siguiente llamada a FreeRTOS. Se puede volver a crear otras.
+   */
+  inline void pararTareas() {
+	acabando.store( true );
+	{
+	  std::lock_guard<std::mutex> l( cerrojoTareas );
+	  despertarTareas.notify_all();
+	}
+	for ( auto & c : colas ) {
+	  std::lock_guard<std::mutex> l( c->cerrojo );
+	  c->cambio.notify_all();
+	}
+	for ( auto & t : tareas ) {
+	  t->hilo.join();
+	}
+	tareas.clear();
+	acabando.store( false );
+  } // ()
+
+}; // namespace
+
+typedef Simulacion::TareaSimulada * TaskHandle_t;
+typedef Simulacion::ColaSimulada * QueueHandle_t;
+
+// ----------------------------------------------------------
+// Tareas
+// ----------------------------------------------------------
+inline BaseType_t xTaskCreate( TaskFunction_t funcion, const char * nombre, uint32_t pila,
+							   void * parametro, UBaseType_t prioridad, TaskHandle_t * manejador ) {
+  Simulacion::TareaSimulada * t = new Simulacion::TareaSimulada();
+  t->nombre = nombre;
+  t->pila = pila;
+  t->prioridad = prioridad;
+
+  // lo que hereda del hilo que la crea
+  double aceleracion = Simulacion::aceleracion > 0 ? Simulacion::aceleracion : 1.0;
+  FILE * salida = Simulacion::salidaSerie;
+  uint32_t usPorByte = Simulacion::usPorByteSerie;
+  uint64_t usSerie = Simulacion::usSerieDisponible;
+  int ( * fuente )( uint8_t ) = Simulacion::fuenteADC;
+  void ( * fuentePDM )( int16_t *, uint16_t, uint64_t ) = Simulacion::fuentePDM;
+
+  t->hilo = std::thread( [=]() {
+	Simulacion::aceleracion = aceleracion;
+	Simulacion::salidaSerie = salida;
+	Simulacion::usPorByteSerie = usPorByte;
+	Simulacion::usSerieDisponible = usSerie;
+	Simulacion::fuenteADC = fuente;
+	Simulacion::fuentePDM = fuentePDM;
+	try {
+	  funcion( parametro );
+	} catch ( const Simulacion::FinTarea & ) {
+	}
+  } );
+
+  if ( manejador != nullptr ) {
+	*manejador = t;
+  }
+  Simulacion::tareas.emplace_back( t );
+  return pdPASS;
+} // ()
+
+inline void vTaskDelete( TaskHandle_t ) {
+  throw Simulacion::FinTarea(); // sólo se usa para que una tarea se borre a sí misma
+} // ()
+
+inline TickType_t xTaskGetTickCount() {
+  return (TickType_t) ( Simulacion::ahoraUs() * configTICK_RATE_HZ / 1000000 );
+} // ()
+
+inline void vTaskDelay( TickType_t ticks ) {
+  Simulacion::dormirTarea( Simulacion::usDeTicks( ticks ) );
+} // ()
+
+inline void vTaskDelayUntil( TickType_t * anterior, TickType_t incremento ) {
+  TickType_t objetivo = *anterior + incremento;
+  TickType_t ahora = xTaskGetTickCount();
+  if ( (int32_t) ( objetivo - ahora ) > 0 ) {
+	vTaskDelay( objetivo - ahora );
+  } else if ( Simulacion::acabando.load() ) {
+	throw Simulacion::FinTarea();
+  }
+  *anterior = objetivo;
+} // ()
+
+/// En el ordenador no se mide: devuelve toda la pila (en palabras).
+inline UBaseType_t uxTaskGetStackHighWaterMark( TaskHandle_t tarea ) {
+  return tarea != nullptr ? tarea->pila : 0;
+} // ()
+
+/// La tarea de loop(): en la simulación loop() sólo se ejecuta si se llama.
+inline void suspendLoop() {
+} // ()
+
+// ----------------------------------------------------------
+// Colas
+// ----------------------------------------------------------
+inline QueueHandle_t xQueueCreate( UBaseType_t longitud, UBaseType_t tamanyo ) {
+  Simulacion::ColaSimulada * c = new Simulacion::ColaSimulada();
+  c->datos.resize( longitud * tamanyo );
+  c->longitud = longitud;
+  c->tamanyo = tamanyo;
+  Simulacion::colas.emplace_back( c );
+  return c;
+} // ()
+
+inline BaseType_t xQueueSend( QueueHandle_t c, const void * elemento, TickType_t espera ) {
+  std::unique_lock<std::mutex> l( c->cerrojo );
+  auto hayHueco = [c] { return c->n < c->longitud || Simulacion::acabando.load(); };
+  if ( espera == portMAX_DELAY ) {
+	c->cambio.wait( l, hayHueco );
+  } else if ( espera > 0 ) {
+	c->cambio.wait_for( l, std::chrono::duration<double, std::micro>(
+						  Simulacion::usDeTicks( espera ) / Simulacion::aceleracion ), hayHueco );
+  }
+  if ( Simulacion::acabando.load() ) {
+	throw Simulacion::FinTarea();
+  }
+  if ( c->n == c->longitud ) {
+	return pdFALSE;
+  }
+  memcpy( &c->datos[ ( ( c->cabeza + c->n ) % c->longitud ) * c->tamanyo ], elemento, c->tamanyo );
+  c->n++;
+  c->cambio.notify_all();
+  return pdTRUE;
+} // ()
+
+inline BaseType_t xQueueReceive( QueueHandle_t c, void * elemento, TickType_t espera ) {
+  std::unique_lock<std::mutex> l( c->cerrojo );
+  auto hayAlgo = [c] { return c->n > 0 || Simulacion::acabando.load(); };
+  if ( espera == portMAX_DELAY ) {
+	c->cambio.wait( l, hayAlgo );
+  } else if ( espera > 0 ) {
+	c->cambio.wait_for( l, std::chrono::duration<double, std::micro>(
+						  Simulacion::usDeTicks( espera ) / Simulacion::aceleracion ), hayAlgo );
+  }
+  if ( Simulacion::acabando.load() ) {
+	throw Simulacion::FinTarea();
+  }
+  if ( c->n == 0 ) {
+	return pdFALSE;
+  }
+  memcpy( elemento, &c->datos[ c->cabeza * c->tamanyo ], c->tamanyo );
+  c->cabeza = ( c->cabeza + 1 ) % c->longitud;
+  c->n--;
+  c->cambio.notify_all();
+  return pdTRUE;
+} // ()
+
+inline UBaseType_t uxQueueMessagesWaiting( QueueHandle_t c ) {
+  std::lock_guard<std::mutex> l( c->cerrojo );
+  return c->n;
+} // ()
+
+#endif
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+// ----------------------------------------------------------
@@ -0,0 +1,140 @@
+/*
+ * Nombre del fichero: simularCentrales.cpp
+ * Descripción: Simula varias centrales BLE de distinta velocidad conectadas a la vez al nodo.
+ * Autores: agent
+ * Fecha: 18 de octubre de 2026
+ *
+ * Este archivo ha sido realizado por agent.
+ * Compila el firmware con GESTIONAR_CONEXIONES y conecta N centrales simuladas. Cada una
+ * recoge como mucho unas notificaciones por intervalo de conexión (la última es muy lenta).
+ * El nodo encola un mensaje para todas cada pocos milisegundos y llama a despachar().
+ * Al final se muestra, por central, lo recibido, lo descartado y las veces que notify()
+ * habría bloqueado en la placa (tiene que ser 0), y se comprueba que las centrales que
+ * dan abasto lo reciben todo aunque la lenta vaya perdiendo mensajes.
+ *
+ * Compilar (desde esta carpeta):
+ *   g++ -O2 -std=c++17 -I. simularCentrales.cpp -o simularCentrales
+ * Uso:
+ *   ./simularCentrales [centrales (1-4)] [segundos simulados] [ms entre mensajes]
+ *
+ * Todos los derechos reservados.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+
+#define GESTIONAR_CONEXIONES
+#include <Arduino.h>
+#include "../HolaMundoIBeacon.ino"
+
+// ----------------------------------------------------------
+// una central simulada
+// ----------------------------------------------------------
+struct Central {
+  uint16_t connHandle;
+  uint16_t intervaloMs;     ///< Intervalo de conexión.
+  uint8_t porIntervalo;     ///< Notificaciones que recoge en cada intervalo.
+  uint32_t recibidos = 0;
+  uint32_t bytes = 0;
+  uint16_t ultimoContador = 0;
+  bool enOrden = true;
+};
+
+namespace Centrales {
+  Central lista[GestorConexiones::MAX_CONEXIONES];
+  uint8_t cuantas = 0;
+
+  void alNotificar( uint16_t connHandle, const uint8_t * datos, uint16_t longitud ) {
+	for ( uint8_t i = 0; i < cuantas; i++ ) {
+	  Central & c = lista[i];
+	  if ( c.connHandle != connHandle ) {
+		continue;
+	  }
+	  uint16_t contador = ( datos[0] << 8 ) | datos[1];
+	  if ( c.recibidos > 0 && contador <= c.ultimoContador ) {
+		c.enOrden = false;
+	  }
+	  c.ultimoContador = contador;
+	  c.recibidos++;
+	  c.bytes += longitud;
+	}
+  } // ()
+}; // namespace
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+int main( int argc, char * argv[] ) {
+  using namespace Centrales;
+
+  cuantas = argc > 1 ? (uint8_t) atoi( argv[1] ) : GestorConexiones::MAX_CONEXIONES;
+  uint32_t segundos = argc > 2 ? (uint32_t) atoi( argv[2] ) : 60;
+  uint32_t msEntreMensajes = argc > 3 ? (uint32_t) atoi( argv[3] ) : 10;
+  if ( cuantas < 1 || cuantas > GestorConexiones::MAX_CONEXIONES || msEntreMensajes == 0 ) {
+	fprintf( stderr, "uso: %s [centrales 1-%u] [segundos] [ms entre mensajes]\n", argv[0], GestorConexiones::MAX_CONEXIONES );
+	return 2;
+  }
+
+  Simulacion::salidaSerie = nullptr;
+  Simulacion::alNotificar = Centrales::alNotificar;
+  setup();
+
+  // velocidades: 8 ms x 3, 15 ms x 2, 30 ms x 1 ... y la última, 500 ms x 1 (muy lenta)
+  const uint16_t INTERVALOS[] = { 8, 15, 30 };
+  const uint8_t POR_INTERVALO[] = { 3, 2, 1 };
+  for ( uint8_t i = 0; i < cuantas; i++ ) {
+	lista[i].connHandle = i;
+	bool lenta = ( i == cuantas - 1 && cuantas > 1 );
+	lista[i].intervaloMs = lenta ? 500 : INTERVALOS[i % 3];
+	lista[i].porIntervalo = lenta ? 1 : POR_INTERVALO[i % 3];
+	Simulacion::conectar( i, 23 + 20 * i );
+	BLECharacteristic & car = Globales::laCaracteristicaLecturas;
+	car.simularSuscripcion( i, true );
+  }
+
+  uint32_t producidos = 0;
+  uint16_t contador = 0;
+  for ( uint32_t ms = 0; ms < segundos * 1000; ms++ ) {
+	Simulacion::avanzar( 1000 );
+
+	if ( ms % msEntreMensajes == 0 ) {
+	  uint8_t mensaje[GestorConexiones::LONGITUD_MAXIMA_MENSAJE] = { 0 };
+	  contador++;
+	  mensaje[0] = (uint8_t) ( contador >> 8 );
+	  mensaje[1] = (uint8_t) ( contador & 0xff );
+	  Globales::elGestor.encolar( mensaje, sizeof(mensaje) );
+	  producidos++;
+	}
+
+	for ( uint8_t i = 0; i < cuantas; i++ ) {
+	  if ( ms % lista[i].intervaloMs == 0 ) {
+		Simulacion::completarNotificaciones( lista[i].connHandle, lista[i].porIntervalo );
+	  }
+	}
+
+	Globales::elGestor.despachar();
+  } // for
+
+  printf( "%u mensajes en %u s (uno cada %u ms) para %u centrales\n\n", producidos, segundos, msEntreMensajes, cuantas );
+  printf( "central  intervalo  capacidad(msg/s)  mtu  recibidos  descartados  pendientes  bloqueos  B/s\n" );
+
+  bool correcto = true;
+  for ( uint8_t i = 0; i < cuantas; i++ ) {
+	Central & c = lista[i];
+	GestorConexiones::EstadoConexion e = Globales::elGestor.estado( i );
+	uint32_t bloqueos = Bluefruit.conexionSimulada( c.connHandle ).bloqueos;
+	double capacidad = 1000.0 * c.porIntervalo / c.intervaloMs;
+	printf( "%7u  %6u ms  %16.0f  %3u  %9u  %11u  %10u  %8u  %.0f\n",
+			c.connHandle, c.intervaloMs, capacidad, e.mtu, c.recibidos, e.descartados, e.pendientes,
+			bloqueos, (double) c.bytes / segundos );
+
+	// la que da abasto tiene que recibirlo todo (salvo lo que quede en cola) y en orden
+	bool daAbasto = capacidad > 1000.0 / msEntreMensajes;
+	if ( bloqueos != 0 || ! c.enOrden || c.recibidos + e.pendientes + e.descartados != producidos ||
+		 ( daAbasto && e.descartados != 0 ) ) {
+	  correcto = false;
+	}
+  } // for
+
+  printf( "\n%s\n", correcto ? "OK: ninguna central lenta retrasa a las demás" : "FALLO" );
+  return correcto ? 0 : 1;
+} // ()
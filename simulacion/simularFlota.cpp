@@ -0,0 +1,569 @@
+/*
+ * Nombre del fichero: simularFlota.cpp
+ * Descripción: Simula miles de nodos a la vez, con los choques de sus anuncios, frente a una pasarela.
+ * Autores: agent
+ * Fecha: 18 de octubre de 2026
+ *
+ * Este archivo ha sido realizado por agent.
+ * Cada nodo es un Medidor, un Publicador (con su EmisoraBLE) y una Bluefruit propios
+ * (Simulacion::bluefruitDelHilo), con su reloj (arranque y deriva de cristal), su forma
+ * de onda del gas en el ADC y su calendario de anuncios: una medida por periodo y, durante
+ * el anuncio, un evento de anuncio cada intervalo más el retardo al azar de BLE (0 a 10 ms),
+ * con un paquete en los canales 37, 38 y 39 uno tras otro.
+ *
+ * Los nodos se reparten entre unos hilos; cada hilo lleva una agenda (cola de prioridad)
+ * con el siguiente evento de cada uno de los suyos y la recorre por ventanas de tiempo
+ * (US_VENTANA). Al acabar cada ventana se juntan los paquetes de todos por canal: un
+ * paquete se pierde si en su canal se solapa con otro (sin efecto captura: se pierden los
+ * dos). La pasarela escucha un canal cada vez y cambia cada US_ESCANEO; lo que oye entero
+ * y sin choque lo decodifica con DecodificadorIBeacon y, si se pide, lo escribe en un
+ * fichero de captura (Captura.h), el mismo que graba la pasarela, que se puede leer con
+ * LectorCaptura y meter en MotorIngestion.
+ *
+ * Para cada número de nodos escribe las horas-nodo simuladas por segundo real, la carga
+ * de cada canal, la pérdida por choques (frente a la de ALOHA puro, 1 - e^-2G) y cuántas
+ * medidas le llegan a la pasarela. Comprueba que con un solo hilo sale exactamente lo
+ * mismo y que la captura se lee entera.
+ *
+ * Compilar (desde esta carpeta):
+ *   g++ -O2 -std=c++17 -I. -pthread simularFlota.cpp -o simularFlota
+ * Uso:
+ *   ./simularFlota [minutos simulados] [hilos] [fichero de captura (de la flota de FLOTA_CAPTURA nodos)]
+ *
+ * Todos los derechos reservados.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include <Arduino.h>
+#include <bluefruit.h>
+
+#define PIN_VGAS 28
+#define PIN_VREF 29
+
+#include "../LED.h"
+#include "../PuertoSerie.h"
+
+// lo que EmisoraBLE usa del firmware (escribe poco, y Serial no va a ningún sitio)
+namespace Globales {
+  PuertoSerie elPuerto ( 115200 );
+};
+
+#include "../EmisoraBLE.h"
+#include "../Publicador.h"
+#include "../Medidor.h"
+#include "../Configuracion.h"
+#include "../pasarela/Captura.h"
+
+namespace Flota {
+  const uint64_t US_VENTANA = 1000000;  ///< Tiempo que avanza cada hilo entre dos puestas en común.
+  const uint64_t US_MARGEN = 1000;      ///< Más que el paquete más largo: lo que empieza aquí pasa a la ventana siguiente.
+  const uint64_t US_ESCANEO = 100000;   ///< La pasarela cambia de canal cada tanto (ventana = intervalo de escaneo).
+  const uint32_t US_ENTRE_CANALES = 150; ///< Del final de un paquete al principio del siguiente canal.
+  const uint32_t US_RETARDO_MAXIMO = 10000; ///< advDelay de BLE: 0 a 10 ms en cada evento.
+  const double DERIVA_MAXIMA = 40e-6;   ///< Error del cristal de cada nodo (±40 ppm).
+  const double RADIO_M = 30;            ///< Los nodos están a menos de esto de la pasarela.
+  const int AREF = 600;                 ///< Cuentas del ADC en Vref.
+  const uint8_t NUM_CANALES = 3;
+  const uint32_t FLOTA_CAPTURA = 1000;  ///< La flota que se graba, si se pide fichero.
+
+  // preámbulo (1), dirección de acceso (4), cabecera (2), AdvA (6), datos, CRC (3): a 1 Mb/s, 8 us por byte
+  uint32_t usAire( uint8_t longitud ) {
+	return ( 1 + 4 + 2 + 6 + longitud + 3 ) * 8;
+  } // ()
+
+  // splitmix64: cada nodo lleva el suyo (8 bytes) y sale lo mismo se reparta como se reparta
+  uint64_t siguienteAzar( uint64_t & estado ) {
+	uint64_t z = ( estado += 0x9e3779b97f4a7c15ULL );
+	z = ( z ^ ( z >> 30 ) ) * 0xbf58476d1ce4e5b9ULL;
+	z = ( z ^ ( z >> 27 ) ) * 0x94d049bb133111ebULL;
+	return z ^ ( z >> 31 );
+  } // ()
+
+  double azarUniforme( uint64_t & estado ) {
+	return ( siguienteAzar( estado ) >> 11 ) * ( 1.0 / 9007199254740992.0 );
+  } // ()
+
+  // ........................................................
+  // un nodo simulado
+  // ........................................................
+  struct Nodo {
+	AdafruitBluefruit radio;
+	Medidor medidor { PIN_VGAS, PIN_VREF };
+	Publicador publicador;
+
+	uint32_t id = 0;
+	uint64_t azar = 0;
+	uint8_t direccion[6];
+	int8_t rssi = 0;
+
+	// el reloj: el nodo arranca en usArranque (del tiempo de todos) y su segundo dura escala segundos
+	uint64_t usArranque = 0;
+	double escala = 1;
+
+	// el gas: cuentas por debajo de Vref = base + amplitud * (1 + sen) / 2, más ruido
+	double base = 0, amplitud = 0, usPeriodoOnda = 1, fase = 0;
+
+	// el calendario (en el tiempo de todos)
+	uint64_t usSiguienteMedida = 0;
+	uint64_t usFinAnuncio = 0;
+	bool anunciando = false;
+	uint8_t contador = 0;
+	uint32_t medidas = 0;
+
+	// lo que está saliendo por el aire
+	uint8_t datos[BLE_GAP_ADV_SET_DATA_SIZE_MAX];
+	uint8_t longitud = 0;
+
+	uint64_t usLocal( uint64_t usGlobal ) const {
+	  return (uint64_t) ( ( usGlobal - usArranque ) / escala );
+	}
+	uint64_t usGlobal( uint64_t usLocal ) const {
+	  return (uint64_t) ( usLocal * escala );
+	}
+  }; // struct
+
+  // ........................................................
+  // un paquete en el aire
+  // ........................................................
+  struct Paquete {
+	uint64_t usInicio;
+	uint64_t usFin;
+	uint32_t nodo;
+	uint8_t longitud;
+	uint8_t datos[BLE_GAP_ADV_SET_DATA_SIZE_MAX];
+
+	bool operator<( const Paquete & otro ) const {
+	  return usInicio < otro.usInicio || ( usInicio == otro.usInicio && nodo < otro.nodo );
+	}
+  }; // struct
+
+  // el nodo que está atendiendo este hilo (para fuenteADC y alEmpezarAnuncio)
+  thread_local Nodo * nodoActual = nullptr;
+
+  int leerADC( uint8_t pin ) {
+	Nodo & n = *nodoActual;
+	if ( pin != PIN_VGAS ) {
+	  return AREF;
+	}
+	double t = (double) Simulacion::relojUs;
+	double gas = n.base + n.amplitud * ( 1 + sin( 2 * M_PI * t / n.usPeriodoOnda + n.fase ) ) / 2;
+	int ruido = (int) ( siguienteAzar( n.azar ) % 5 ) - 2;
+	return AREF - (int) gas + ruido;
+  } // ()
+
+  void alEmpezarAnuncio( const uint8_t * datos, uint8_t longitud, int8_t ) {
+	memcpy( nodoActual->datos, datos, longitud );
+	nodoActual->longitud = longitud;
+  } // ()
+
+  // pone el hilo en el nodo: su Bluefruit, su reloj y su ADC
+  void entrarEn( Nodo & n, uint64_t usGlobal ) {
+	nodoActual = &n;
+	Simulacion::bluefruitDelHilo = &n.radio;
+	Simulacion::relojUs = n.usLocal( usGlobal );
+  } // ()
+
+  // ........................................................
+  // los valores de la publicación (los mismos para todos, los de la configuración por defecto)
+  // ........................................................
+  struct Calendario {
+	uint64_t usPeriodo;
+	uint64_t usDuracion;
+	uint32_t usIntervalo;
+	uint16_t intervalo;
+  }; // struct
+
+  // ........................................................
+  // crea el nodo id (sólo depende de id y de la semilla)
+  // ........................................................
+  void iniciarNodo( Nodo & n, uint32_t id, const Calendario & cal ) {
+	n.id = id;
+	n.azar = 0x5eed0000ULL + id;
+	for ( int i = 0; i < 6; i++ ) {
+	  n.direccion[i] = (uint8_t) ( id >> ( 8 * ( i % 4 ) ) );
+	}
+	n.direccion[5] = 0xc0 | (uint8_t) ( id >> 24 ); // dirección estática aleatoria
+	double d = std::max( 1.0, RADIO_M * sqrt( azarUniforme( n.azar ) ) ); // repartidos por el círculo
+	n.rssi = (int8_t) lround( 4 - 40 - 25 * log10( d ) );
+
+	n.usArranque = (uint64_t) ( azarUniforme( n.azar ) * cal.usPeriodo );
+	n.escala = 1 + ( 2 * azarUniforme( n.azar ) - 1 ) * DERIVA_MAXIMA;
+	n.base = 10 + 60 * azarUniforme( n.azar );
+	n.amplitud = 80 * azarUniforme( n.azar );
+	n.usPeriodoOnda = ( 10 + 50 * azarUniforme( n.azar ) ) * 60e6;
+	n.fase = 2 * M_PI * azarUniforme( n.azar );
+	n.usSiguienteMedida = n.usArranque;
+
+	entrarEn( n, n.usArranque );
+	n.medidor.iniciarMedidor();
+	n.medidor.silenciar( true );
+	n.publicador.encenderEmisora();
+	n.publicador.laEmisora.ajustarIntervaloAnuncio( cal.intervalo );
+  } // ()
+
+  // ........................................................
+  // un hilo: sus nodos, su agenda y lo que han emitido en la ventana
+  // ........................................................
+  struct Trabajador {
+	std::vector<uint32_t> nodos;
+	std::priority_queue< std::pair<uint64_t, uint32_t>, std::vector< std::pair<uint64_t, uint32_t> >,
+						 std::greater< std::pair<uint64_t, uint32_t> > > agenda;
+	std::vector<Paquete> aire[NUM_CANALES];
+	uint64_t eventos = 0;
+  }; // struct
+
+  // ........................................................
+  // atiende el siguiente evento del nodo y devuelve cuándo es el otro
+  // ........................................................
+  uint64_t atender( Nodo & n, uint64_t us, const Calendario & cal, Trabajador & t ) {
+	entrarEn( n, us );
+
+	if ( us >= n.usSiguienteMedida ) {
+	  // empieza la vuelta: mide y empieza a anunciar (como empezarPublicarMedida(), sin esperar)
+	  double valor = n.medidor.medirGas();
+	  n.publicador.empezarPublicarCO2( valor, n.contador );
+	  n.contador++;
+	  n.medidas++;
+	  n.anunciando = true;
+	  n.usFinAnuncio = us + n.usGlobal( cal.usDuracion );
+	  n.usSiguienteMedida += n.usGlobal( cal.usPeriodo );
+	}
+
+	if ( n.anunciando && us < n.usFinAnuncio ) {
+	  // un evento de anuncio: el mismo paquete en los tres canales, uno detrás de otro
+	  uint64_t inicio = us;
+	  uint32_t aire = usAire( n.longitud );
+	  for ( uint8_t c = 0; c < NUM_CANALES; c++ ) {
+		Paquete p;
+		p.usInicio = inicio;
+		p.usFin = inicio + aire;
+		p.nodo = n.id;
+		p.longitud = n.longitud;
+		memcpy( p.datos, n.datos, n.longitud );
+		t.aire[c].push_back( p );
+		inicio = p.usFin + US_ENTRE_CANALES;
+	  }
+	  uint64_t siguiente = us + n.usGlobal( cal.usIntervalo + siguienteAzar( n.azar ) % ( US_RETARDO_MAXIMO + 1 ) );
+	  if ( siguiente < n.usFinAnuncio ) {
+		return siguiente;
+	  }
+	}
+
+	// se acabó el anuncio: hasta la vuelta siguiente
+	if ( n.anunciando ) {
+	  n.publicador.laEmisora.detenerAnuncio();
+	  n.anunciando = false;
+	}
+	return n.usSiguienteMedida;
+  } // ()
+
+  // ........................................................
+  // lo que se cuenta de una flota
+  // ........................................................
+  struct Resultado {
+	uint32_t nodos = 0;
+	double horasNodo = 0;
+	double segundosReales = 0;
+	uint64_t enAire = 0;      ///< Paquetes emitidos (todos los canales).
+	uint64_t chocados = 0;    ///< De esos, los que se han solapado con otro.
+	uint64_t escuchados = 0;  ///< Los que han pasado enteros por el canal que escuchaba la pasarela.
+	uint64_t perdidos = 0;    ///< De esos, los chocados.
+	uint64_t decodificados = 0;
+	uint64_t medidas = 0;     ///< Publicadas por los nodos.
+	uint64_t medidasRecibidas = 0; ///< Las que han llegado al menos en un paquete.
+	uint64_t eventos = 0;
+	double usPaquete = 0;     ///< Lo que dura un paquete en el aire.
+  }; // struct
+
+  // ........................................................
+  // la pasarela: junta lo de todos los hilos, ve qué choca y qué oye
+  // ........................................................
+  class Pasarela {
+  private:
+	std::vector<Paquete> pendientes[NUM_CANALES]; ///< Empiezan al final de la ventana: se deciden en la siguiente.
+	uint64_t finMaximo[NUM_CANALES] = { 0, 0, 0 }; ///< El final más tardío de lo ya decidido en cada canal.
+	std::vector<int16_t> ultimoContador;          ///< Por nodo, el de la última medida recibida (-1 = ninguna).
+	DecodificadorIBeacon deco;
+	EscritorCaptura * captura;
+	Resultado & r;
+
+	static uint8_t canalEscuchado( uint64_t us ) {
+	  return (uint8_t) ( ( us / US_ESCANEO ) % NUM_CANALES );
+	}
+
+	void recibir( const Paquete & p, const std::vector< std::unique_ptr<Nodo> > & nodos ) {
+	  InformeAnuncio informe;
+	  informe.tiempo = p.usFin;
+	  memcpy( informe.direccion, nodos[p.nodo]->direccion, 6 );
+	  informe.rssi = nodos[p.nodo]->rssi;
+	  informe.longitud = p.longitud;
+	  memcpy( informe.datos, p.datos, p.longitud );
+	  if ( (*this).captura != nullptr ) {
+		(*this).captura->escribir( informe );
+	  }
+	  LecturaIBeacon lectura;
+	  uint8_t id, contador;
+	  double valor;
+	  if ( ! (*this).deco.decodificar( informe, lectura )
+		   || ! TramasPublicador::decodificar( lectura.major, lectura.minor, id, contador, valor ) ) {
+		return;
+	  }
+	  r.decodificados++;
+	  if ( (*this).ultimoContador[p.nodo] != contador ) {
+		(*this).ultimoContador[p.nodo] = contador;
+		r.medidasRecibidas++;
+	  }
+	} // ()
+
+  public:
+	Pasarela( uint32_t numNodos, EscritorCaptura * captura_, Resultado & r_ )
+	  : ultimoContador( numNodos, -1 ), captura( captura_ ), r( r_ ) {
+	}
+
+	// decide lo que empieza antes de usFin - US_MARGEN (lo demás puede chocar aún con la ventana siguiente)
+	void juntar( std::vector<Trabajador> & hilos, uint64_t usFin, const std::vector< std::unique_ptr<Nodo> > & nodos ) {
+	  for ( uint8_t c = 0; c < NUM_CANALES; c++ ) {
+		std::vector<Paquete> & v = (*this).pendientes[c];
+		for ( Trabajador & t : hilos ) {
+		  v.insert( v.end(), t.aire[c].begin(), t.aire[c].end() );
+		  t.aire[c].clear();
+		}
+		std::sort( v.begin(), v.end() );
+
+		size_t n = v.size();
+		size_t i = 0;
+		for ( ; i < n && v[i].usInicio + US_MARGEN < usFin; i++ ) {
+		  const Paquete & p = v[i];
+		  bool choca = p.usInicio < (*this).finMaximo[c] || ( i + 1 < n && v[i+1].usInicio < p.usFin );
+		  (*this).finMaximo[c] = std::max( (*this).finMaximo[c], p.usFin );
+		  r.enAire++;
+		  r.chocados += choca;
+		  if ( canalEscuchado( p.usInicio ) != c || canalEscuchado( p.usFin ) != c ) {
+			continue; // la pasarela estaba en otro canal
+		  }
+		  r.escuchados++;
+		  if ( choca ) {
+			r.perdidos++;
+		  } else {
+			recibir( p, nodos );
+		  }
+		} // for
+		v.erase( v.begin(), v.begin() + i );
+	  } // for
+	} // ()
+  }; // class
+
+  // ........................................................
+  // simula numNodos nodos durante usTotal con numHilos hilos
+  // ........................................................
+  Resultado simular( uint32_t numNodos, uint64_t usTotal, uint32_t numHilos, const Calendario & cal, const char * fichero ) {
+	Resultado r;
+	r.nodos = numNodos;
+	auto empiezo = std::chrono::steady_clock::now();
+
+	std::vector< std::unique_ptr<Nodo> > nodos( numNodos );
+	std::vector<Trabajador> hilos( numHilos );
+	for ( uint32_t i = 0; i < numNodos; i++ ) {
+	  nodos[i].reset( new Nodo() );
+	  iniciarNodo( *nodos[i], i, cal );
+	  Trabajador & t = hilos[i % numHilos];
+	  t.nodos.push_back( i );
+	  t.agenda.push( std::make_pair( nodos[i]->usSiguienteMedida, i ) );
+	}
+	Simulacion::bluefruitDelHilo = nullptr;
+
+	std::unique_ptr<EscritorCaptura> captura( fichero != nullptr ? new EscritorCaptura( fichero ) : nullptr );
+	Pasarela pasarela( numNodos, captura.get(), r );
+
+	// los hilos avanzan una ventana cada vez que el principal sube la generación
+	std::mutex m;
+	std::condition_variable cvHilos, cvPrincipal;
+	uint64_t generacion = 0;
+	uint64_t usFinVentana = 0;
+	uint32_t faltan = 0;
+	bool acabar = false;
+
+	auto trabajar = [&]( uint32_t h ) {
+	  Simulacion::salidaSerie = nullptr;
+	  Simulacion::fuenteADC = leerADC;
+	  Simulacion::alEmpezarAnuncio = alEmpezarAnuncio;
+	  Trabajador & t = hilos[h];
+	  uint64_t vista = 0;
+	  for ( ;; ) {
+		uint64_t hasta;
+		{
+		  std::unique_lock<std::mutex> l( m );
+		  cvHilos.wait( l, [&] { return acabar || generacion != vista; } );
+		  if ( acabar ) {
+			return;
+		  }
+		  vista = generacion;
+		  hasta = usFinVentana;
+		}
+		while ( ! t.agenda.empty() && t.agenda.top().first < hasta ) {
+		  std::pair<uint64_t, uint32_t> e = t.agenda.top();
+		  t.agenda.pop();
+		  t.agenda.push( std::make_pair( atender( *nodos[e.second], e.first, cal, t ), e.second ) );
+		  t.eventos++;
+		}
+		for ( uint8_t c = 0; c < NUM_CANALES; c++ ) {
+		  std::sort( t.aire[c].begin(), t.aire[c].end() ); // así el principal ordena trozos ya ordenados
+		}
+		std::lock_guard<std::mutex> l( m );
+		if ( --faltan == 0 ) {
+		  cvPrincipal.notify_one();
+		}
+	  } // for
+	};
+
+	std::vector<std::thread> pool;
+	for ( uint32_t h = 0; h < numHilos; h++ ) {
+	  pool.emplace_back( trabajar, h );
+	}
+
+	for ( uint64_t us = US_VENTANA; us <= usTotal + US_VENTANA; us += US_VENTANA ) {
+	  {
+		std::unique_lock<std::mutex> l( m );
+		usFinVentana = us;
+		faltan = numHilos;
+		generacion++;
+		cvHilos.notify_all();
+		cvPrincipal.wait( l, [&] { return faltan == 0; } );
+	  }
+	  pasarela.juntar( hilos, us, nodos );
+	}
+	{
+	  std::lock_guard<std::mutex> l( m );
+	  acabar = true;
+	  cvHilos.notify_all();
+	}
+	for ( std::thread & h : pool ) {
+	  h.join();
+	}
+
+	r.segundosReales = std::chrono::duration<double>( std::chrono::steady_clock::now() - empiezo ).count();
+	r.horasNodo = numNodos * ( usTotal + US_VENTANA ) / 3600e6;
+	for ( const Trabajador & t : hilos ) {
+	  r.eventos += t.eventos;
+	}
+	for ( const std::unique_ptr<Nodo> & n : nodos ) {
+	  r.medidas += n->medidas;
+	}
+	r.usPaquete = usAire( nodos.empty() ? 0 : nodos[0]->longitud );
+	return r;
+  } // ()
+
+  // G: paquetes por canal en lo que dura un paquete
+  double carga( const Resultado & r, uint64_t usTotal ) {
+	double segundos = ( usTotal + US_VENTANA ) / 1e6;
+	return r.enAire / (double) NUM_CANALES / segundos * r.usPaquete / 1e6;
+  } // ()
+
+  // ALOHA puro: un paquete sale bien si nadie empieza en el tiempo de dos paquetes
+  double perdidaAloha( const Resultado & r, uint64_t usTotal ) {
+	return 1 - exp( -2 * carga( r, usTotal ) );
+  } // ()
+
+  void escribir( const Resultado & r, uint64_t usTotal ) {
+	double segundos = ( usTotal + US_VENTANA ) / 1e6;
+	double g = carga( r, usTotal );
+	printf( "%6u %9.1f %8.2f %10.0f %9.0f %7.4f %7.2f%% %7.2f%% %7.2f%% %7.2f%%\n",
+			r.nodos, r.horasNodo, r.segundosReales, r.horasNodo / r.segundosReales,
+			r.enAire / segundos, g,
+			r.escuchados > 0 ? 100.0 * r.perdidos / r.escuchados : 0,
+			100.0 * r.chocados / std::max<uint64_t>( r.enAire, 1 ),
+			100 * perdidaAloha( r, usTotal ),
+			100.0 * r.medidasRecibidas / std::max<uint64_t>( r.medidas, 1 ) );
+  } // ()
+}; // namespace
+
+// ----------------------------------------------------------
+// ----------------------------------------------------------
+int main( int argc, char * argv[] ) {
+  uint32_t minutos = argc > 1 ? (uint32_t) atoi( argv[1] ) : 10;
+  uint32_t numHilos = argc > 2 ? (uint32_t) atoi( argv[2] ) : std::max( 1u, std::thread::hardware_concurrency() );
+  const char * fichero = argc > 3 ? argv[3] : nullptr;
+
+  Simulacion::salidaSerie = nullptr;
+  Configuracion c;
+  Flota::Calendario cal;
+  cal.usPeriodo = (uint64_t) c.periodoPublicacionMs * 1000;
+  cal.usDuracion = (uint64_t) c.duracionAnuncioMs * 1000;
+  cal.intervalo = c.intervaloAnuncio;
+  cal.usIntervalo = c.intervaloAnuncio * 625;
+  uint64_t usTotal = (uint64_t) minutos * 60000000;
+
+  const uint32_t flotas[] = { 10, 30, 100, 300, 1000, 3000, 10000 };
+  const uint32_t numFlotas = sizeof( flotas ) / sizeof( flotas[0] );
+
+  printf( "%u minutos, %u hilos; periodo %u ms, anuncio %u ms a %.1f ms (+0-10 ms), pasarela cambia de canal cada %u ms\n\n",
+		  minutos, numHilos, c.periodoPublicacionMs, c.duracionAnuncioMs, cal.usIntervalo / 1000.0,
+		  (unsigned) ( Flota::US_ESCANEO / 1000 ) );
+  printf( " nodos  horas-nodo  seg.real  h-nodo/s   paq./s       G  pérdida  choques   ALOHA  medidas\n" );
+
+  bool decodificadas = true;
+  bool comoAloha = true;
+  bool crece = true;
+  double perdidaAnterior = -1;
+  Flota::Resultado grabada;
+  for ( uint32_t k = 0; k < numFlotas; k++ ) {
+	Flota::Resultado r = Flota::simular( flotas[k], usTotal, numHilos, cal, flotas[k] == Flota::FLOTA_CAPTURA ? fichero : nullptr );
+	Flota::escribir( r, usTotal );
+	if ( flotas[k] == Flota::FLOTA_CAPTURA ) {
+	  grabada = r;
+	}
+	decodificadas &= r.decodificados + r.perdidos == r.escuchados;
+	double perdida = r.escuchados > 0 ? (double) r.perdidos / r.escuchados : 0;
+	comoAloha &= fabs( perdida - Flota::perdidaAloha( r, usTotal ) ) < 0.03;
+	crece &= perdida >= perdidaAnterior;
+	perdidaAnterior = perdida;
+  }
+  printf( "\n(pérdida: de lo que pasa por el canal que escucha la pasarela; choques: de todo lo emitido;\n"
+		  " ALOHA: 1 - e^-2G; medidas: las que llegan al menos una vez)\n\n" );
+
+  bool bien = decodificadas;
+  printf( "todo lo oído sin choque se decodifica: %s\n", decodificadas ? "bien" : "MAL" );
+  // los tres paquetes de un evento van seguidos, pero cada evento cae al azar: ALOHA puro en cada canal
+  bien &= comoAloha && crece;
+  printf( "la pérdida crece con los nodos y sigue a ALOHA (3 puntos): %s\n", comoAloha && crece ? "bien" : "MAL" );
+
+  // lo mismo con otro número de hilos: cada nodo sólo depende de sí mismo
+  uint32_t otros = numHilos == 1 ? 3 : 1;
+  Flota::Resultado uno = Flota::simular( flotas[2], usTotal, numHilos, cal, nullptr );
+  Flota::Resultado dos = Flota::simular( flotas[2], usTotal, otros, cal, nullptr );
+  bool b = uno.enAire == dos.enAire && uno.chocados == dos.chocados && uno.escuchados == dos.escuchados
+	&& uno.perdidos == dos.perdidos && uno.medidasRecibidas == dos.medidasRecibidas && uno.eventos == dos.eventos;
+  bien &= b;
+  printf( "con %u hilos y con %u sale lo mismo (%u nodos): %s\n", numHilos, otros, flotas[2], b ? "bien" : "MAL" );
+
+  if ( fichero != nullptr ) {
+	LectorCaptura lector( fichero );
+	InformeAnuncio informe;
+	DecodificadorIBeacon deco;
+	LecturaIBeacon lectura;
+	uint64_t leidos = 0, validos = 0;
+	while ( lector.leer( informe ) ) {
+	  leidos++;
+	  validos += deco.decodificar( informe, lectura );
+	}
+	b = lector.abierto() && leidos == grabada.escuchados - grabada.perdidos && validos == grabada.decodificados;
+	bien &= b;
+	printf( "captura %s: %llu informes, %llu iBeacon: %s\n", fichero, (unsigned long long) leidos,
+			(unsigned long long) validos, b ? "bien" : "MAL" );
+  }
+
+  printf( "\n%s\n", bien ? "OK" : "FALLO" );
+  return bien ? 0 : 1;
+} // ()